@@ -45,6 +45,195 @@ inline const ::flatbuffers::TypeTable *ChannelIdTypeTable();
 
 inline const ::flatbuffers::TypeTable *ChannelInfoTypeTable();
 
+enum class BufferingMode : uint32_t {
+  STANDARD = 0,
+  LOW_LATENCY = 1,
+  DEEP = 2,
+  MIN = STANDARD,
+  MAX = DEEP
+};
+
+inline const BufferingMode (&EnumValuesBufferingMode())[3] {
+  static const BufferingMode values[] = {
+    BufferingMode::STANDARD,
+    BufferingMode::LOW_LATENCY,
+    BufferingMode::DEEP
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesBufferingMode() {
+  static const char * const names[4] = {
+    "STANDARD",
+    "LOW_LATENCY",
+    "DEEP",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameBufferingMode(BufferingMode e) {
+  if (::flatbuffers::IsOutRange(e, BufferingMode::STANDARD, BufferingMode::DEEP)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesBufferingMode()[index];
+}
+
+enum class SignalLink : uint32_t {
+  SINGLE_LINK = 0,
+  DUAL_LINK = 1,
+  QUAD_LINK = 2,
+  MIN = SINGLE_LINK,
+  MAX = QUAD_LINK
+};
+
+inline const SignalLink (&EnumValuesSignalLink())[3] {
+  static const SignalLink values[] = {
+    SignalLink::SINGLE_LINK,
+    SignalLink::DUAL_LINK,
+    SignalLink::QUAD_LINK
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesSignalLink() {
+  static const char * const names[4] = {
+    "SINGLE_LINK",
+    "DUAL_LINK",
+    "QUAD_LINK",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameSignalLink(SignalLink e) {
+  if (::flatbuffers::IsOutRange(e, SignalLink::SINGLE_LINK, SignalLink::QUAD_LINK)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesSignalLink()[index];
+}
+
+enum class UHDDivision : uint32_t {
+  TWO_SAMPLE_INTERLEAVE = 0,
+  SQUARE_DIVISION = 1,
+  MIN = TWO_SAMPLE_INTERLEAVE,
+  MAX = SQUARE_DIVISION
+};
+
+inline const UHDDivision (&EnumValuesUHDDivision())[2] {
+  static const UHDDivision values[] = {
+    UHDDivision::TWO_SAMPLE_INTERLEAVE,
+    UHDDivision::SQUARE_DIVISION
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesUHDDivision() {
+  static const char * const names[3] = {
+    "TWO_SAMPLE_INTERLEAVE",
+    "SQUARE_DIVISION",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameUHDDivision(UHDDivision e) {
+  if (::flatbuffers::IsOutRange(e, UHDDivision::TWO_SAMPLE_INTERLEAVE, UHDDivision::SQUARE_DIVISION)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesUHDDivision()[index];
+}
+
+enum class PixelFormat : uint32_t {
+  YUV8 = 0,
+  V210 = 1,
+  MIN = YUV8,
+  MAX = V210
+};
+
+inline const PixelFormat (&EnumValuesPixelFormat())[2] {
+  static const PixelFormat values[] = {
+    PixelFormat::YUV8,
+    PixelFormat::V210
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesPixelFormat() {
+  static const char * const names[3] = {
+    "YUV8",
+    "V210",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNamePixelFormat(PixelFormat e) {
+  if (::flatbuffers::IsOutRange(e, PixelFormat::YUV8, PixelFormat::V210)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesPixelFormat()[index];
+}
+
+enum class ColorMatrix : uint32_t {
+  REC601 = 0,
+  REC709 = 1,
+  REC2020 = 2,
+  MIN = REC601,
+  MAX = REC2020
+};
+
+inline const ColorMatrix (&EnumValuesColorMatrix())[3] {
+  static const ColorMatrix values[] = {
+    ColorMatrix::REC601,
+    ColorMatrix::REC709,
+    ColorMatrix::REC2020
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesColorMatrix() {
+  static const char * const names[4] = {
+    "REC601",
+    "REC709",
+    "REC2020",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameColorMatrix(ColorMatrix e) {
+  if (::flatbuffers::IsOutRange(e, ColorMatrix::REC601, ColorMatrix::REC2020)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesColorMatrix()[index];
+}
+
+enum class ColorRange : uint32_t {
+  NARROW = 0,
+  FULL = 1,
+  MIN = NARROW,
+  MAX = FULL
+};
+
+inline const ColorRange (&EnumValuesColorRange())[2] {
+  static const ColorRange values[] = {
+    ColorRange::NARROW,
+    ColorRange::FULL
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesColorRange() {
+  static const char * const names[3] = {
+    "NARROW",
+    "FULL",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameColorRange(ColorRange e) {
+  if (::flatbuffers::IsOutRange(e, ColorRange::NARROW, ColorRange::FULL)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesColorRange()[index];
+}
+
 struct TDeviceId : public ::flatbuffers::NativeTable {
   typedef DeviceId TableType;
   static FLATBUFFERS_CONSTEXPR_CPP11 const char *GetFullyQualifiedName() {
@@ -279,6 +468,14 @@ struct TChannelInfo : public ::flatbuffers::NativeTable {
   std::string video_mode_name{};
   int32_t video_mode = 0;
   std::unique_ptr<nos::fb::vec2u> resolution{};
+  nos::bluefish::BufferingMode buffering = nos::bluefish::BufferingMode::STANDARD;
+  uint32_t buffer_cycle_depth = 0;
+  uint32_t capture_lead = 0;
+  bool field_mode = false;
+  nos::bluefish::SignalLink link = nos::bluefish::SignalLink::SINGLE_LINK;
+  nos::bluefish::UHDDivision uhd_division = nos::bluefish::UHDDivision::TWO_SAMPLE_INTERLEAVE;
+  nos::bluefish::PixelFormat pixel_format = nos::bluefish::PixelFormat::YUV8;
+  bool field_transfer = false;
   TChannelInfo() = default;
   TChannelInfo(const TChannelInfo &o);
   TChannelInfo(TChannelInfo&&) FLATBUFFERS_NOEXCEPT = default;
@@ -300,7 +497,15 @@ struct ChannelInfo FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
     VT_CHANNEL = 6,
     VT_VIDEO_MODE_NAME = 8,
     VT_VIDEO_MODE = 10,
-    VT_RESOLUTION = 12
+    VT_RESOLUTION = 12,
+    VT_BUFFERING = 14,
+    VT_BUFFER_CYCLE_DEPTH = 16,
+    VT_CAPTURE_LEAD = 18,
+    VT_FIELD_MODE = 20,
+    VT_LINK = 22,
+    VT_UHD_DIVISION = 24,
+    VT_PIXEL_FORMAT = 26,
+    VT_FIELD_TRANSFER = 28
   };
   const nos::bluefish::DeviceId *device() const {
     return GetPointer<const nos::bluefish::DeviceId *>(VT_DEVICE);
@@ -332,6 +537,54 @@ struct ChannelInfo FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   nos::fb::vec2u *mutable_resolution() {
     return GetStruct<nos::fb::vec2u *>(VT_RESOLUTION);
   }
+  nos::bluefish::BufferingMode buffering() const {
+    return static_cast<nos::bluefish::BufferingMode>(GetField<uint32_t>(VT_BUFFERING, 0));
+  }
+  bool mutate_buffering(nos::bluefish::BufferingMode _buffering = static_cast<nos::bluefish::BufferingMode>(0)) {
+    return SetField<uint32_t>(VT_BUFFERING, static_cast<uint32_t>(_buffering), 0);
+  }
+  uint32_t buffer_cycle_depth() const {
+    return GetField<uint32_t>(VT_BUFFER_CYCLE_DEPTH, 0);
+  }
+  bool mutate_buffer_cycle_depth(uint32_t _buffer_cycle_depth = 0) {
+    return SetField<uint32_t>(VT_BUFFER_CYCLE_DEPTH, _buffer_cycle_depth, 0);
+  }
+  uint32_t capture_lead() const {
+    return GetField<uint32_t>(VT_CAPTURE_LEAD, 0);
+  }
+  bool mutate_capture_lead(uint32_t _capture_lead = 0) {
+    return SetField<uint32_t>(VT_CAPTURE_LEAD, _capture_lead, 0);
+  }
+  bool field_mode() const {
+    return GetField<uint8_t>(VT_FIELD_MODE, 0) != 0;
+  }
+  bool mutate_field_mode(bool _field_mode = 0) {
+    return SetField<uint8_t>(VT_FIELD_MODE, static_cast<uint8_t>(_field_mode), 0);
+  }
+  nos::bluefish::SignalLink link() const {
+    return static_cast<nos::bluefish::SignalLink>(GetField<uint32_t>(VT_LINK, 0));
+  }
+  bool mutate_link(nos::bluefish::SignalLink _link = static_cast<nos::bluefish::SignalLink>(0)) {
+    return SetField<uint32_t>(VT_LINK, static_cast<uint32_t>(_link), 0);
+  }
+  nos::bluefish::UHDDivision uhd_division() const {
+    return static_cast<nos::bluefish::UHDDivision>(GetField<uint32_t>(VT_UHD_DIVISION, 0));
+  }
+  bool mutate_uhd_division(nos::bluefish::UHDDivision _uhd_division = static_cast<nos::bluefish::UHDDivision>(0)) {
+    return SetField<uint32_t>(VT_UHD_DIVISION, static_cast<uint32_t>(_uhd_division), 0);
+  }
+  nos::bluefish::PixelFormat pixel_format() const {
+    return static_cast<nos::bluefish::PixelFormat>(GetField<uint32_t>(VT_PIXEL_FORMAT, 0));
+  }
+  bool mutate_pixel_format(nos::bluefish::PixelFormat _pixel_format = static_cast<nos::bluefish::PixelFormat>(0)) {
+    return SetField<uint32_t>(VT_PIXEL_FORMAT, static_cast<uint32_t>(_pixel_format), 0);
+  }
+  bool field_transfer() const {
+    return GetField<uint8_t>(VT_FIELD_TRANSFER, 0) != 0;
+  }
+  bool mutate_field_transfer(bool _field_transfer = 0) {
+    return SetField<uint8_t>(VT_FIELD_TRANSFER, static_cast<uint8_t>(_field_transfer), 0);
+  }
   template<size_t Index>
   auto get_field() const {
          if constexpr (Index == 0) return device();
@@ -339,6 +592,14 @@ struct ChannelInfo FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
     else if constexpr (Index == 2) return video_mode_name();
     else if constexpr (Index == 3) return video_mode();
     else if constexpr (Index == 4) return resolution();
+    else if constexpr (Index == 5) return buffering();
+    else if constexpr (Index == 6) return buffer_cycle_depth();
+    else if constexpr (Index == 7) return capture_lead();
+    else if constexpr (Index == 8) return field_mode();
+    else if constexpr (Index == 9) return link();
+    else if constexpr (Index == 10) return uhd_division();
+    else if constexpr (Index == 11) return pixel_format();
+    else if constexpr (Index == 12) return field_transfer();
     else static_assert(Index != Index, "Invalid Field Index");
   }
   bool Verify(::flatbuffers::Verifier &verifier) const {
@@ -351,6 +612,14 @@ struct ChannelInfo FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
            verifier.VerifyString(video_mode_name()) &&
            VerifyField<int32_t>(verifier, VT_VIDEO_MODE, 4) &&
            VerifyField<nos::fb::vec2u>(verifier, VT_RESOLUTION, 4) &&
+           VerifyField<uint32_t>(verifier, VT_BUFFERING, 4) &&
+           VerifyField<uint32_t>(verifier, VT_BUFFER_CYCLE_DEPTH, 4) &&
+           VerifyField<uint32_t>(verifier, VT_CAPTURE_LEAD, 4) &&
+           VerifyField<uint8_t>(verifier, VT_FIELD_MODE, 1) &&
+           VerifyField<uint32_t>(verifier, VT_LINK, 4) &&
+           VerifyField<uint32_t>(verifier, VT_UHD_DIVISION, 4) &&
+           VerifyField<uint32_t>(verifier, VT_PIXEL_FORMAT, 4) &&
+           VerifyField<uint8_t>(verifier, VT_FIELD_TRANSFER, 1) &&
            verifier.EndTable();
   }
   TChannelInfo *UnPack(const ::flatbuffers::resolver_function_t *_resolver = nullptr) const;
@@ -377,6 +646,30 @@ struct ChannelInfoBuilder {
   void add_resolution(const nos::fb::vec2u *resolution) {
     fbb_.AddStruct(ChannelInfo::VT_RESOLUTION, resolution);
   }
+  void add_buffering(nos::bluefish::BufferingMode buffering) {
+    fbb_.AddElement<uint32_t>(ChannelInfo::VT_BUFFERING, static_cast<uint32_t>(buffering), 0);
+  }
+  void add_buffer_cycle_depth(uint32_t buffer_cycle_depth) {
+    fbb_.AddElement<uint32_t>(ChannelInfo::VT_BUFFER_CYCLE_DEPTH, buffer_cycle_depth, 0);
+  }
+  void add_capture_lead(uint32_t capture_lead) {
+    fbb_.AddElement<uint32_t>(ChannelInfo::VT_CAPTURE_LEAD, capture_lead, 0);
+  }
+  void add_field_mode(bool field_mode) {
+    fbb_.AddElement<uint8_t>(ChannelInfo::VT_FIELD_MODE, static_cast<uint8_t>(field_mode), 0);
+  }
+  void add_link(nos::bluefish::SignalLink link) {
+    fbb_.AddElement<uint32_t>(ChannelInfo::VT_LINK, static_cast<uint32_t>(link), 0);
+  }
+  void add_uhd_division(nos::bluefish::UHDDivision uhd_division) {
+    fbb_.AddElement<uint32_t>(ChannelInfo::VT_UHD_DIVISION, static_cast<uint32_t>(uhd_division), 0);
+  }
+  void add_pixel_format(nos::bluefish::PixelFormat pixel_format) {
+    fbb_.AddElement<uint32_t>(ChannelInfo::VT_PIXEL_FORMAT, static_cast<uint32_t>(pixel_format), 0);
+  }
+  void add_field_transfer(bool field_transfer) {
+    fbb_.AddElement<uint8_t>(ChannelInfo::VT_FIELD_TRANSFER, static_cast<uint8_t>(field_transfer), 0);
+  }
   explicit ChannelInfoBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -394,13 +687,29 @@ inline ::flatbuffers::Offset<ChannelInfo> CreateChannelInfo(
     ::flatbuffers::Offset<nos::bluefish::ChannelId> channel = 0,
     ::flatbuffers::Offset<::flatbuffers::String> video_mode_name = 0,
     int32_t video_mode = 0,
-    const nos::fb::vec2u *resolution = nullptr) {
+    const nos::fb::vec2u *resolution = nullptr,
+    nos::bluefish::BufferingMode buffering = nos::bluefish::BufferingMode::STANDARD,
+    uint32_t buffer_cycle_depth = 0,
+    uint32_t capture_lead = 0,
+    bool field_mode = false,
+    nos::bluefish::SignalLink link = nos::bluefish::SignalLink::SINGLE_LINK,
+    nos::bluefish::UHDDivision uhd_division = nos::bluefish::UHDDivision::TWO_SAMPLE_INTERLEAVE,
+    nos::bluefish::PixelFormat pixel_format = nos::bluefish::PixelFormat::YUV8,
+    bool field_transfer = false) {
   ChannelInfoBuilder builder_(_fbb);
   builder_.add_resolution(resolution);
+  builder_.add_pixel_format(pixel_format);
+  builder_.add_uhd_division(uhd_division);
+  builder_.add_link(link);
+  builder_.add_capture_lead(capture_lead);
+  builder_.add_buffer_cycle_depth(buffer_cycle_depth);
+  builder_.add_buffering(buffering);
   builder_.add_video_mode(video_mode);
   builder_.add_video_mode_name(video_mode_name);
   builder_.add_channel(channel);
   builder_.add_device(device);
+  builder_.add_field_transfer(field_transfer);
+  builder_.add_field_mode(field_mode);
   return builder_.Finish();
 }
 
@@ -409,13 +718,21 @@ struct ChannelInfo::Traits {
   static auto constexpr Create = CreateChannelInfo;
   static constexpr auto name = "ChannelInfo";
   static constexpr auto fully_qualified_name = "nos.bluefish.ChannelInfo";
-  static constexpr size_t fields_number = 5;
+  static constexpr size_t fields_number = 13;
   static constexpr std::array<const char *, fields_number> field_names = {
     "device",
     "channel",
     "video_mode_name",
     "video_mode",
-    "resolution"
+    "resolution",
+    "buffering",
+    "buffer_cycle_depth",
+    "capture_lead",
+    "field_mode",
+    "link",
+    "uhd_division",
+    "pixel_format",
+    "field_transfer"
   };
   template<size_t Index>
   using FieldType = decltype(std::declval<type>().get_field<Index>());
@@ -427,7 +744,15 @@ inline ::flatbuffers::Offset<ChannelInfo> CreateChannelInfoDirect(
     ::flatbuffers::Offset<nos::bluefish::ChannelId> channel = 0,
     const char *video_mode_name = nullptr,
     int32_t video_mode = 0,
-    const nos::fb::vec2u *resolution = nullptr) {
+    const nos::fb::vec2u *resolution = nullptr,
+    nos::bluefish::BufferingMode buffering = nos::bluefish::BufferingMode::STANDARD,
+    uint32_t buffer_cycle_depth = 0,
+    uint32_t capture_lead = 0,
+    bool field_mode = false,
+    nos::bluefish::SignalLink link = nos::bluefish::SignalLink::SINGLE_LINK,
+    nos::bluefish::UHDDivision uhd_division = nos::bluefish::UHDDivision::TWO_SAMPLE_INTERLEAVE,
+    nos::bluefish::PixelFormat pixel_format = nos::bluefish::PixelFormat::YUV8,
+    bool field_transfer = false) {
   auto video_mode_name__ = video_mode_name ? _fbb.CreateString(video_mode_name) : 0;
   return nos::bluefish::CreateChannelInfo(
       _fbb,
@@ -435,7 +760,15 @@ inline ::flatbuffers::Offset<ChannelInfo> CreateChannelInfoDirect(
       channel,
       video_mode_name__,
       video_mode,
-      resolution);
+      resolution,
+      buffering,
+      buffer_cycle_depth,
+      capture_lead,
+      field_mode,
+      link,
+      uhd_division,
+      pixel_format,
+      field_transfer);
 }
 
 ::flatbuffers::Offset<ChannelInfo> CreateChannelInfo(::flatbuffers::FlatBufferBuilder &_fbb, const TChannelInfo *_o, const ::flatbuffers::rehasher_function_t *_rehasher = nullptr);
@@ -529,7 +862,15 @@ inline bool operator==(const TChannelInfo &lhs, const TChannelInfo &rhs) {
       ((lhs.channel == rhs.channel) || (lhs.channel && rhs.channel && *lhs.channel == *rhs.channel)) &&
       (lhs.video_mode_name == rhs.video_mode_name) &&
       (lhs.video_mode == rhs.video_mode) &&
-      ((lhs.resolution == rhs.resolution) || (lhs.resolution && rhs.resolution && *lhs.resolution == *rhs.resolution));
+      ((lhs.resolution == rhs.resolution) || (lhs.resolution && rhs.resolution && *lhs.resolution == *rhs.resolution)) &&
+      (lhs.buffering == rhs.buffering) &&
+      (lhs.buffer_cycle_depth == rhs.buffer_cycle_depth) &&
+      (lhs.capture_lead == rhs.capture_lead) &&
+      (lhs.field_mode == rhs.field_mode) &&
+      (lhs.link == rhs.link) &&
+      (lhs.uhd_division == rhs.uhd_division) &&
+      (lhs.pixel_format == rhs.pixel_format) &&
+      (lhs.field_transfer == rhs.field_transfer);
 }
 
 inline bool operator!=(const TChannelInfo &lhs, const TChannelInfo &rhs) {
@@ -542,7 +883,15 @@ inline TChannelInfo::TChannelInfo(const TChannelInfo &o)
         channel((o.channel) ? new nos::bluefish::TChannelId(*o.channel) : nullptr),
         video_mode_name(o.video_mode_name),
         video_mode(o.video_mode),
-        resolution((o.resolution) ? new nos::fb::vec2u(*o.resolution) : nullptr) {
+        resolution((o.resolution) ? new nos::fb::vec2u(*o.resolution) : nullptr),
+        buffering(o.buffering),
+        buffer_cycle_depth(o.buffer_cycle_depth),
+        capture_lead(o.capture_lead),
+        field_mode(o.field_mode),
+        link(o.link),
+        uhd_division(o.uhd_division),
+        pixel_format(o.pixel_format),
+        field_transfer(o.field_transfer) {
 }
 
 inline TChannelInfo &TChannelInfo::operator=(TChannelInfo o) FLATBUFFERS_NOEXCEPT {
@@ -551,6 +900,14 @@ inline TChannelInfo &TChannelInfo::operator=(TChannelInfo o) FLATBUFFERS_NOEXCEP
   std::swap(video_mode_name, o.video_mode_name);
   std::swap(video_mode, o.video_mode);
   std::swap(resolution, o.resolution);
+  std::swap(buffering, o.buffering);
+  std::swap(buffer_cycle_depth, o.buffer_cycle_depth);
+  std::swap(capture_lead, o.capture_lead);
+  std::swap(field_mode, o.field_mode);
+  std::swap(link, o.link);
+  std::swap(uhd_division, o.uhd_division);
+  std::swap(pixel_format, o.pixel_format);
+  std::swap(field_transfer, o.field_transfer);
   return *this;
 }
 
@@ -568,6 +925,14 @@ inline void ChannelInfo::UnPackTo(TChannelInfo *_o, const ::flatbuffers::resolve
   { auto _e = video_mode_name(); if (_e) _o->video_mode_name = _e->str(); }
   { auto _e = video_mode(); _o->video_mode = _e; }
   { auto _e = resolution(); if (_e) _o->resolution = std::unique_ptr<nos::fb::vec2u>(new nos::fb::vec2u(*_e)); }
+  { auto _e = buffering(); _o->buffering = _e; }
+  { auto _e = buffer_cycle_depth(); _o->buffer_cycle_depth = _e; }
+  { auto _e = capture_lead(); _o->capture_lead = _e; }
+  { auto _e = field_mode(); _o->field_mode = _e; }
+  { auto _e = link(); _o->link = _e; }
+  { auto _e = uhd_division(); _o->uhd_division = _e; }
+  { auto _e = pixel_format(); _o->pixel_format = _e; }
+  { auto _e = field_transfer(); _o->field_transfer = _e; }
 }
 
 inline ::flatbuffers::Offset<ChannelInfo> ChannelInfo::Pack(::flatbuffers::FlatBufferBuilder &_fbb, const TChannelInfo* _o, const ::flatbuffers::rehasher_function_t *_rehasher) {
@@ -583,13 +948,143 @@ inline ::flatbuffers::Offset<ChannelInfo> CreateChannelInfo(::flatbuffers::FlatB
   auto _video_mode_name = _o->video_mode_name.empty() ? 0 : _fbb.CreateString(_o->video_mode_name);
   auto _video_mode = _o->video_mode;
   auto _resolution = _o->resolution ? _o->resolution.get() : nullptr;
+  auto _buffering = _o->buffering;
+  auto _buffer_cycle_depth = _o->buffer_cycle_depth;
+  auto _capture_lead = _o->capture_lead;
+  auto _field_mode = _o->field_mode;
+  auto _link = _o->link;
+  auto _uhd_division = _o->uhd_division;
+  auto _pixel_format = _o->pixel_format;
+  auto _field_transfer = _o->field_transfer;
   return nos::bluefish::CreateChannelInfo(
       _fbb,
       _device,
       _channel,
       _video_mode_name,
       _video_mode,
-      _resolution);
+      _resolution,
+      _buffering,
+      _buffer_cycle_depth,
+      _capture_lead,
+      _field_mode,
+      _link,
+      _uhd_division,
+      _pixel_format,
+      _field_transfer);
+}
+
+inline const ::flatbuffers::TypeTable *BufferingModeTypeTable() {
+  static const ::flatbuffers::TypeCode type_codes[] = {
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 }
+  };
+  static const ::flatbuffers::TypeFunction type_refs[] = {
+    nos::bluefish::BufferingModeTypeTable
+  };
+  static const char * const names[] = {
+    "STANDARD",
+    "LOW_LATENCY",
+    "DEEP"
+  };
+  static const ::flatbuffers::TypeTable tt = {
+    ::flatbuffers::ST_ENUM, 3, type_codes, type_refs, nullptr, nullptr, names
+  };
+  return &tt;
+}
+
+inline const ::flatbuffers::TypeTable *SignalLinkTypeTable() {
+  static const ::flatbuffers::TypeCode type_codes[] = {
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 }
+  };
+  static const ::flatbuffers::TypeFunction type_refs[] = {
+    nos::bluefish::SignalLinkTypeTable
+  };
+  static const char * const names[] = {
+    "SINGLE_LINK",
+    "DUAL_LINK",
+    "QUAD_LINK"
+  };
+  static const ::flatbuffers::TypeTable tt = {
+    ::flatbuffers::ST_ENUM, 3, type_codes, type_refs, nullptr, nullptr, names
+  };
+  return &tt;
+}
+
+inline const ::flatbuffers::TypeTable *UHDDivisionTypeTable() {
+  static const ::flatbuffers::TypeCode type_codes[] = {
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 }
+  };
+  static const ::flatbuffers::TypeFunction type_refs[] = {
+    nos::bluefish::UHDDivisionTypeTable
+  };
+  static const char * const names[] = {
+    "TWO_SAMPLE_INTERLEAVE",
+    "SQUARE_DIVISION"
+  };
+  static const ::flatbuffers::TypeTable tt = {
+    ::flatbuffers::ST_ENUM, 2, type_codes, type_refs, nullptr, nullptr, names
+  };
+  return &tt;
+}
+
+inline const ::flatbuffers::TypeTable *PixelFormatTypeTable() {
+  static const ::flatbuffers::TypeCode type_codes[] = {
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 }
+  };
+  static const ::flatbuffers::TypeFunction type_refs[] = {
+    nos::bluefish::PixelFormatTypeTable
+  };
+  static const char * const names[] = {
+    "YUV8",
+    "V210"
+  };
+  static const ::flatbuffers::TypeTable tt = {
+    ::flatbuffers::ST_ENUM, 2, type_codes, type_refs, nullptr, nullptr, names
+  };
+  return &tt;
+}
+
+inline const ::flatbuffers::TypeTable *ColorMatrixTypeTable() {
+  static const ::flatbuffers::TypeCode type_codes[] = {
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 }
+  };
+  static const ::flatbuffers::TypeFunction type_refs[] = {
+    nos::bluefish::ColorMatrixTypeTable
+  };
+  static const char * const names[] = {
+    "REC601",
+    "REC709",
+    "REC2020"
+  };
+  static const ::flatbuffers::TypeTable tt = {
+    ::flatbuffers::ST_ENUM, 3, type_codes, type_refs, nullptr, nullptr, names
+  };
+  return &tt;
+}
+
+inline const ::flatbuffers::TypeTable *ColorRangeTypeTable() {
+  static const ::flatbuffers::TypeCode type_codes[] = {
+    { ::flatbuffers::ET_UINT, 0, 0 },
+    { ::flatbuffers::ET_UINT, 0, 0 }
+  };
+  static const ::flatbuffers::TypeFunction type_refs[] = {
+    nos::bluefish::ColorRangeTypeTable
+  };
+  static const char * const names[] = {
+    "NARROW",
+    "FULL"
+  };
+  static const ::flatbuffers::TypeTable tt = {
+    ::flatbuffers::ST_ENUM, 2, type_codes, type_refs, nullptr, nullptr, names
+  };
+  return &tt;
 }
 
 inline const ::flatbuffers::TypeTable *DeviceIdTypeTable() {
@@ -628,22 +1123,42 @@ inline const ::flatbuffers::TypeTable *ChannelInfoTypeTable() {
     { ::flatbuffers::ET_SEQUENCE, 0, 1 },
     { ::flatbuffers::ET_STRING, 0, -1 },
     { ::flatbuffers::ET_INT, 0, -1 },
-    { ::flatbuffers::ET_SEQUENCE, 0, 2 }
+    { ::flatbuffers::ET_SEQUENCE, 0, 2 },
+    { ::flatbuffers::ET_UINT, 0, 3 },
+    { ::flatbuffers::ET_UINT, 0, -1 },
+    { ::flatbuffers::ET_UINT, 0, -1 },
+    { ::flatbuffers::ET_BOOL, 0, -1 },
+    { ::flatbuffers::ET_UINT, 0, 4 },
+    { ::flatbuffers::ET_UINT, 0, 5 },
+    { ::flatbuffers::ET_UINT, 0, 6 },
+    { ::flatbuffers::ET_BOOL, 0, -1 }
   };
   static const ::flatbuffers::TypeFunction type_refs[] = {
     nos::bluefish::DeviceIdTypeTable,
     nos::bluefish::ChannelIdTypeTable,
-    nos::fb::vec2uTypeTable
+    nos::fb::vec2uTypeTable,
+    nos::bluefish::BufferingModeTypeTable,
+    nos::bluefish::SignalLinkTypeTable,
+    nos::bluefish::UHDDivisionTypeTable,
+    nos::bluefish::PixelFormatTypeTable
   };
   static const char * const names[] = {
     "device",
     "channel",
     "video_mode_name",
     "video_mode",
-    "resolution"
+    "resolution",
+    "buffering",
+    "buffer_cycle_depth",
+    "capture_lead",
+    "field_mode",
+    "link",
+    "uhd_division",
+    "pixel_format",
+    "field_transfer"
   };
   static const ::flatbuffers::TypeTable tt = {
-    ::flatbuffers::ST_TABLE, 5, type_codes, type_refs, nullptr, nullptr, names
+    ::flatbuffers::ST_TABLE, 13, type_codes, type_refs, nullptr, nullptr, names
   };
   return &tt;
 }
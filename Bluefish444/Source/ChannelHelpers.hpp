@@ -7,6 +7,13 @@
 #include <Nodos/PluginHelpers.hpp>
 
 #include "Device.hpp"
+#include "VideoFormats.hpp"
+#include "BluefishTypes_generated.h"
+
+// stl
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
 namespace bf
 {
@@ -16,133 +23,218 @@ struct SelectChannelCommand
 	BLUE_S32 DeviceId : 4;
 	EBlueVideoChannel Channel : 5;
 	EVideoModeExt VideoMode : 12;
+	nos::bluefish::SignalLink Link : 2;
 	operator uint32_t() const { return *(uint32_t*)this; }
 };
 static_assert(sizeof(SelectChannelCommand) == sizeof(uint32_t));
 
-struct FormatDescriptor
+// Resolves the ChannelInfo pin value of DMA/VBL nodes. Returns an empty handle if the device is not found.
+inline ChannelHandle ResolveChannelHandle(nosBuffer const& value)
 {
-	EVideoModeExt Format;
-	u32 Width, Height;
-	u8 Interlaced : 1;
-};
+	auto* channelInfo = nos::InterpretPinValue<nos::bluefish::ChannelInfo>(value);
+	if (!channelInfo || !channelInfo->device() || !channelInfo->device()->serial() || !channelInfo->channel())
+		return {};
+	auto device = BluefishDevice::GetDevice(channelInfo->device()->serial()->str());
+	if (!device)
+		return {};
+	return device->GetChannelHandle(static_cast<EBlueVideoChannel>(channelInfo->channel()->id()));
+}
+
+inline EBlueSignalLinkType GetSignalLinkType(nos::bluefish::SignalLink link)
+{
+	switch (link)
+	{
+	case nos::bluefish::SignalLink::DUAL_LINK: return SIGNAL_LINK_TYPE_DUAL_LINK;
+	case nos::bluefish::SignalLink::QUAD_LINK: return SIGNAL_LINK_TYPE_QUAD_LINK;
+	default: return SIGNAL_LINK_TYPE_SINGLE_LINK;
+	}
+}
+
+inline nos::bluefish::SignalLink GetSignalLink(EBlueSignalLinkType linkType)
+{
+	switch (linkType)
+	{
+	case SIGNAL_LINK_TYPE_DUAL_LINK: return nos::bluefish::SignalLink::DUAL_LINK;
+	case SIGNAL_LINK_TYPE_QUAD_LINK: return nos::bluefish::SignalLink::QUAD_LINK;
+	default: return nos::bluefish::SignalLink::SINGLE_LINK;
+	}
+}
 
-inline nos::fb::vec2u UnpackU64(uint64_t val)
+// Progressive modes ignore field_mode, so graphs size their buffers by field_transfer instead
+inline bool IsFieldTransfer(nos::bluefish::TChannelInfo const& info)
 {
-	return nos::fb::vec2u((val >> 32) & 0xFFFFFFFF, val & 0xFFFFFFFF);
+	return info.field_mode && info.video_mode && !bfcUtilsIsVideoModeProgressive(static_cast<EVideoModeExt>(info.video_mode));
 }
 
-inline uint64_t PackU64(nos::fb::vec2u val)
+// Sets field_transfer too, so field_mode must be set before
+inline void SetChannelVideoMode(nos::bluefish::TChannelInfo& info, EVideoModeExt mode)
 {
-	return static_cast<uint64_t>(val.x()) << 32 | val.y();
+	info.video_mode = static_cast<int>(mode);
+	info.video_mode_name = bfcUtilsGetStringForVideoMode(mode);
+	BLUE_U32 width, height, frameRate, frameRateIs1001;
+	scan_mode scanMode;
+	bfcUtilsGetFrameInfoForVideoModeExtV2(mode, &width, &height, &frameRate, &frameRateIs1001, &scanMode);
+	info.resolution = std::make_unique<nos::fb::vec2u>(width, height);
+	info.field_transfer = IsFieldTransfer(info);
 }
 
-inline auto EnumerateFormats()
+inline ChannelSettings GetChannelSettings(nos::bluefish::TChannelInfo const& info)
 {
-	struct FormatDescriptor
+	ChannelSettings settings{};
+	auto& buffering = settings.Buffering;
+	switch (info.buffering)
 	{
-		EVideoModeExt Format;
-		nos::fb::vec2u DeltaSeconds;
-		u32 Width, Height;
-		u8 Interlaced : 1;
-	};
-
-	std::unordered_map<uint64_t, std::unordered_map<uint64_t, std::vector<FormatDescriptor>>> extDeltaSecDescMap;
-	for (auto fmt = VID_FMT_EXT_1080I_5000; fmt < VID_FMT_EXT_LAST_ENTRY_V1; fmt = EVideoModeExt(fmt + 1))
+	case nos::bluefish::BufferingMode::LOW_LATENCY: buffering = {.CycleDepth = 2, .CaptureLead = 1}; break;
+	case nos::bluefish::BufferingMode::DEEP: buffering = {.CycleDepth = 0, .CaptureLead = 3}; break;
+	default: break;
+	}
+	if (info.buffer_cycle_depth)
+		buffering.CycleDepth = info.buffer_cycle_depth;
+	if (info.capture_lead)
+		buffering.CaptureLead = info.capture_lead;
+	settings.FieldMode = info.field_mode;
+	settings.LinkType = GetSignalLinkType(info.link);
+	settings.MemoryFormat = info.pixel_format == nos::bluefish::PixelFormat::V210 ? MEM_FMT_V210 : MEM_FMT_2VUY;
+	settings.UHDPreference = info.uhd_division == nos::bluefish::UHDDivision::SQUARE_DIVISION ? UHD_PREFERENCE_SQUARE_DIVISION : UHD_PREFERENCE_2SI;
+	return settings;
+}
+
+// Context menu item kept between menu requests. Serialized into the builder of each request.
+struct MenuEntry
+{
+	std::string Name;
+	uint32_t Command = 0;
+	std::vector<MenuEntry> Children;
+};
+
+inline flatbuffers::Offset<nos::ContextMenuItem> CreateMenuItem(flatbuffers::FlatBufferBuilder& fbb, MenuEntry const& entry)
+{
+	if (entry.Children.empty())
+		return nos::CreateContextMenuItemDirect(fbb, entry.Name.c_str(), entry.Command);
+	std::vector<flatbuffers::Offset<nos::ContextMenuItem>> children;
+	children.reserve(entry.Children.size());
+	for (auto& child : entry.Children)
+		children.push_back(CreateMenuItem(fbb, child));
+	return nos::CreateContextMenuItemDirect(fbb, entry.Name.c_str(), entry.Command, &children);
+}
+
+inline std::optional<MenuEntry> BuildInputMenu(BluefishDevice& device)
+{
+	MenuEntry inputs{.Name = "Input"};
+	for (EBlueVideoChannel ch = BLUE_VIDEO_OUTPUT_CHANNEL_1; ch <= BLUE_VIDEO_INPUT_CHANNEL_8;
+	     ch = static_cast<EBlueVideoChannel>(static_cast<int>(ch) + 1))
+	{
+		if (!IsInputChannel(ch) || !device.CanChannelDoInput(ch))
+			continue;
+		SelectChannelCommand command = {
+			.DeviceId = device.GetId(),
+			.Channel = ch
+		};
+		std::string channelName = bfcUtilsGetStringForVideoChannel(ch);
+		ReplaceString(channelName, "Input ", "");
+		inputs.Children.push_back({.Name = std::move(channelName), .Command = command});
+	}
+	if (inputs.Children.empty())
+		return std::nullopt;
+	return inputs;
+}
+
+// Channel -> resolution -> frame rate -> scan. Groups are consecutive in the sorted format catalog.
+inline std::optional<MenuEntry> BuildOutputMenu(BluefishDevice& device)
+{
+	MenuEntry outputs{.Name = "Output"};
+	for (EBlueVideoChannel ch = BLUE_VIDEO_OUTPUT_CHANNEL_1; ch <= BLUE_VIDEO_INPUT_CHANNEL_8; ch = static_cast<EBlueVideoChannel>(static_cast<int>(ch) + 1))
 	{
-		if (bfcUtilsIsVideoModePsF(fmt))
+		if (IsInputChannel(ch))
 			continue;
-		bool interlaced = !bfcUtilsIsVideoModeProgressive(fmt);
-		BLUE_U32 w, h;
-		bfcGetVideoWidth(fmt, &w);
-		bfcGetVideoHeight(fmt, UPD_FMT_FRAME, &h);
-		uint32_t dividend = bfcUtilsGetFpsForVideoMode(fmt) * (bfcUtilsIsVideoMode1001Framerate(fmt) ? 1000 : 1);
-		uint32_t divisor = bfcUtilsIsVideoMode1001Framerate(fmt) ? 1001 : 1;
-		auto desc = FormatDescriptor{
-			.Format = fmt,
-			.DeltaSeconds = {dividend, divisor},
-			.Width = w,
-			.Height = h,
-			.Interlaced = interlaced,
+		SelectChannelCommand command = {
+			.DeviceId = device.GetId(),
+			.Channel = ch
 		};
-		extDeltaSecDescMap[PackU64({w, h})][PackU64(desc.DeltaSeconds)].push_back(desc);
+		std::string channelName = bfcUtilsGetStringForVideoChannel(ch);
+		ReplaceString(channelName, "Output ", "");
+		// Dual/quad link groups are offered for formats a single link cannot carry, on channels a group can start from
+		for (auto link : {nos::bluefish::SignalLink::SINGLE_LINK, nos::bluefish::SignalLink::DUAL_LINK, nos::bluefish::SignalLink::QUAD_LINK})
+		{
+			auto linkCount = GetLinkCount(GetSignalLinkType(link));
+			if (GetLinkChannels(ch, linkCount).empty())
+				continue;
+			command.Link = link;
+			MenuEntry channel{.Name = channelName};
+			if (linkCount > 1)
+				channel.Name += "-" + std::to_string(GetChannelNumber(ch) + linkCount - 1) + (linkCount == 2 ? " Dual Link" : " Quad Link");
+			VideoFormat const* previous = nullptr;
+			for (auto& format : GetSdkVideoFormats())
+			{
+				if (format.IsPsF() || (linkCount > 1 && !format.NeedsMultiLink()))
+					continue;
+				bool newExtent = !previous || previous->Width != format.Width || previous->Height != format.Height;
+				if (newExtent)
+					channel.Children.push_back({.Name = std::to_string(format.Width) + "x" + std::to_string(format.Height)});
+				auto& rates = channel.Children.back().Children;
+				if (newExtent || previous->RateNumerator != format.RateNumerator || previous->RateDenominator != format.RateDenominator)
+					rates.push_back({.Name = format.RateName});
+				command.VideoMode = format.Mode;
+				rates.back().Children.push_back({.Name = format.IsProgressive() ? "Progressive" : "Interlaced", .Command = command});
+				previous = &format;
+			}
+			if (!channel.Children.empty())
+				outputs.Children.push_back(std::move(channel));
+		}
 	}
-	return extDeltaSecDescMap;
+	if (outputs.Children.empty())
+		return std::nullopt;
+	return outputs;
+}
+
+// Menus are built once per device. Input entries depend on the signals, so they are rebuilt once the signal monitor of
+// the device detects a change.
+struct DeviceMenus
+{
+	std::optional<std::optional<MenuEntry>> Input, Output;
+	uint32_t InputSignalVersion = 0; // Of the signals Input was built from
+};
+
+inline std::mutex DeviceMenusMutex;
+inline std::unordered_map<std::string, DeviceMenus> DeviceMenuCache; // By serial
+inline uint32_t DeviceMenuCacheAttachCount = 0; // The cache is cleared when cards are attached, i.e. on re-enumeration
+
+// DeviceMenusMutex must be held
+inline DeviceMenus& GetDeviceMenus(BluefishDevice& device)
+{
+	if (auto attachCount = BluefishDevice::GetAttachCount(); attachCount != DeviceMenuCacheAttachCount)
+	{
+		DeviceMenuCache.clear();
+		DeviceMenuCacheAttachCount = attachCount;
+	}
+	return DeviceMenuCache[device.GetSerial()];
 }
 
 inline void EnumerateInputChannels(flatbuffers::FlatBufferBuilder& fbb, std::vector<flatbuffers::Offset<nos::ContextMenuItem>>& devices)
 {
 	BluefishDevice::ForEachDevice([&](BluefishDevice& device) {
-		std::vector<flatbuffers::Offset<nos::ContextMenuItem>> inChannels;
-		for (EBlueVideoChannel ch = BLUE_VIDEO_OUTPUT_CHANNEL_1; ch < BLUE_VIDEO_INPUT_CHANNEL_8;
-		     ch = static_cast<EBlueVideoChannel>(static_cast<int>(ch) + 1))
+		std::unique_lock lock(DeviceMenusMutex);
+		auto& menus = GetDeviceMenus(device);
+		auto signalVersion = device.GetInputSignalVersion(); // Before reading the signals, so that a later change rebuilds
+		if (!menus.Input || menus.InputSignalVersion != signalVersion)
 		{
-			if (!IsInputChannel(ch))
-				continue;
-			SelectChannelCommand command = {
-				.DeviceId = device.GetId(),
-				.Channel = ch
-			};
-			std::string channelName = bfcUtilsGetStringForVideoChannel(ch);
-			ReplaceString(channelName, "Input ", "");
-			if (device.CanChannelDoInput(ch))
-				inChannels.push_back(nos::CreateContextMenuItemDirect(fbb, channelName.c_str(), command));
-			if (!inChannels.empty())
-				devices.push_back(nos::CreateContextMenuItemDirect(fbb, "Input", 0, &inChannels));
+			menus.Input = BuildInputMenu(device);
+			menus.InputSignalVersion = signalVersion;
 		}
+		if (*menus.Input)
+			devices.push_back(CreateMenuItem(fbb, **menus.Input));
 	});
 }
 
 inline void EnumerateOutputChannels(flatbuffers::FlatBufferBuilder& fbb, std::vector<flatbuffers::Offset<nos::ContextMenuItem>>& devices)
 {
 	BluefishDevice::ForEachDevice([&](BluefishDevice& device) {
-		std::vector<flatbuffers::Offset<nos::ContextMenuItem>> outChannels;
-		for (EBlueVideoChannel ch = BLUE_VIDEO_OUTPUT_CHANNEL_1; ch < BLUE_VIDEO_INPUT_CHANNEL_8; ch = static_cast<EBlueVideoChannel>(static_cast<int>(ch) + 1))
-		{
-			SelectChannelCommand command = {
-				.DeviceId = device.GetId(),
-				.Channel = ch
-			};
-			if (IsInputChannel(ch))
-				continue;
-			std::string channelName = bfcUtilsGetStringForVideoChannel(ch);
-			ReplaceString(channelName, "Output ", "");
-			std::vector<flatbuffers::Offset<nos::ContextMenuItem>> extents;
-			static auto descriptors = EnumerateFormats();
-			for (auto& [extPacked, deltaSecDescMap] : descriptors)
-			{
-				auto extent = UnpackU64(extPacked);
-				std::vector<flatbuffers::Offset<nos::ContextMenuItem>> frameRates;
-				for (auto& [deltaSecPacked, descs] : deltaSecDescMap)
-				{
-					auto deltaSec = UnpackU64(deltaSecPacked);
-					std::vector<flatbuffers::Offset<nos::ContextMenuItem>> formats;
-					for (auto& desc : descs)
-					{
-						command.VideoMode = desc.Format;
-						auto name = desc.Interlaced ? "Interlaced" : "Progressive";
-						formats.push_back(nos::CreateContextMenuItemDirect(fbb, name, command));
-					}
-					if (!formats.empty())
-					{
-						float frameRate = static_cast<float>(deltaSec.x()) / static_cast<float>(deltaSec.y());
-						char buf[16] = {};
-						std::sprintf(buf, "%.2f", frameRate);
-						frameRates.push_back(nos::CreateContextMenuItemDirect(fbb, buf, 0, &formats));
-					}
-				}
-				if (!frameRates.empty())
-				{
-					char buf[32] = {};
-					std::sprintf(buf, "%dx%d", extent.x(), extent.y());
-					extents.push_back(nos::CreateContextMenuItemDirect(fbb, buf, 0, &frameRates));
-				}
-			}
-			if (!extents.empty())
-				outChannels.push_back(nos::CreateContextMenuItemDirect(fbb, channelName.c_str(), 0, &extents));
-		}
-		if (!outChannels.empty())
-			devices.push_back(nos::CreateContextMenuItemDirect(fbb, "Output", 0, &outChannels));
+		std::unique_lock lock(DeviceMenusMutex);
+		auto& menus = GetDeviceMenus(device);
+		if (!menus.Output)
+			menus.Output = BuildOutputMenu(device);
+		if (*menus.Output)
+			devices.push_back(CreateMenuItem(fbb, **menus.Output));
 	});
 }
 
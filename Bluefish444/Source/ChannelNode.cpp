@@ -9,12 +9,8 @@ namespace bf
 
 ChannelNode::ChannelNode(const nosFbNode* node): NodeContext(node)
 {
-	auto err = BluefishDevice::InitializeDevices();
-	if (BERR_NO_ERROR != err)
-	{
-		SetNodeStatusMessage(std::string("Error during device initialization: ") + bfcUtilsGetStringForBErr(err), nos::fb::NodeStatusMessageType::FAILURE);
-		return;
-	}
+	// Devices are enumerated in the background, channels of cards that are not attached yet are opened later
+	BluefishDevice::StartEnumeration();
 	LoadChannelInfo(node);
 }
 
@@ -38,6 +34,7 @@ void ChannelNode::LoadChannelInfo(const nosFbNode* node)
 
 ChannelNode::~ChannelNode()
 {
+	CancelDeviceWait();
 	CloseChannel();
 }
 
@@ -68,23 +65,28 @@ void ChannelNode::OnMenuCommand(nosUUID itemID, uint32_t cmd)
 		nosEngine.LogE("No such Bluefish444 device found: %d", command.DeviceId);
 		return;
 	}
+	auto link = command.Link;
 	if (IsInputChannel(command.Channel))
 	{
-		BErr err{};
-		auto setup = device->GetSetupInfoForInput(command.Channel, err);
-		command.VideoMode = setup.VideoModeExt;
-		if (err != BERR_NO_ERROR)
+		// Signal monitor detected the signal already, unless it did with another UHD preference than the one of the
+		// node, which only matters for signals split across links
+		auto uhdPreference = GetChannelSettings(ChannelInfo).UHDPreference;
+		auto signal = device->GetInputSignal(command.Channel);
+		if (!signal.Present || (signal.LinkType != SIGNAL_LINK_TYPE_SINGLE_LINK && signal.UHDPreference != uhdPreference))
 		{
-			nosEngine.LogE("Unable to get input setup info: %s", bfcUtilsGetStringForBErr(err));
-			return;
-		}
-		else if (setup.SignalLinkType != SIGNAL_LINK_TYPE_SINGLE_LINK)
-		{
-			nosEngine.LogE("Unable to open input channel: Only SingleLink is supported for now.");
-			return;
+			BErr err{};
+			auto setup = device->GetSetupInfoForInput(command.Channel, err, uhdPreference);
+			if (err != BERR_NO_ERROR)
+			{
+				nosEngine.LogE("Unable to get input setup info: %s", bfcUtilsGetStringForBErr(err));
+				return;
+			}
+			signal.VideoMode = setup.VideoModeExt;
+			signal.LinkType = static_cast<EBlueSignalLinkType>(setup.SignalLinkType);
 		}
+		command.VideoMode = signal.VideoMode;
+		link = GetSignalLink(signal.LinkType);
 	}
-	std::string pinName = "SingleLink " +  std::to_string(GetChannelNumber(command.Channel));
 
 	nos::bluefish::TChannelInfo channelPin{};
 	nos::bluefish::TDeviceId d;
@@ -95,12 +97,14 @@ void ChannelNode::OnMenuCommand(nosUUID itemID, uint32_t cmd)
 	c.id = static_cast<int>(command.Channel);
 	channelPin.device = std::make_unique<nos::bluefish::TDeviceId>(std::move(d));
 	channelPin.channel = std::make_unique<nos::bluefish::TChannelId>(std::move(c));
-	channelPin.video_mode = static_cast<int>(command.VideoMode);
-	channelPin.video_mode_name = bfcUtilsGetStringForVideoMode(command.VideoMode);
-	BLUE_U32 width, height, frameRate, frameRateIs1001;
-	scan_mode scanMode;
-	auto err = bfcUtilsGetFrameInfoForVideoModeExtV2(command.VideoMode, &width, &height, &frameRate, &frameRateIs1001, &scanMode);
-	channelPin.resolution = std::make_unique<nos::fb::vec2u>(width, height);
+	channelPin.field_mode = ChannelInfo.field_mode;
+	SetChannelVideoMode(channelPin, command.VideoMode);
+	channelPin.buffering = ChannelInfo.buffering;
+	channelPin.buffer_cycle_depth = ChannelInfo.buffer_cycle_depth;
+	channelPin.capture_lead = ChannelInfo.capture_lead;
+	channelPin.link = link;
+	channelPin.uhd_division = ChannelInfo.uhd_division;
+	channelPin.pixel_format = ChannelInfo.pixel_format;
 	nosEngine.SetPinValue(ChannelPinId, nos::Buffer::From(channelPin));
 	UpdateChannel(std::move(channelPin));
 }
@@ -122,8 +126,31 @@ void ChannelNode::OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer
 
 void ChannelNode::UpdateChannel(nos::bluefish::TChannelInfo info)
 {
+	if (info.field_transfer != IsFieldTransfer(info))
+	{
+		// e.g. field_mode edited on the pin
+		info.field_transfer = !info.field_transfer;
+		nosEngine.SetPinValue(ChannelPinId, nos::Buffer::From(info));
+	}
 	if (info == ChannelInfo)
+	{
+		if (IsDeviceReady())
+		{
+			// Posted by WaitForDevice
+			PendingDeviceWait.reset();
+			OpenChannel();
+		}
 		return;
+	}
+	if (IsReconfiguredChannel(info))
+	{
+		// Set by the channel itself after following its input signal, see OpenChannel
+		ChannelInfo = std::move(info);
+		UpdateStatus(nos::fb::NodeStatusMessageType::INFO, GetChannelString() + " " + ChannelInfo.video_mode_name);
+		nosEngine.RecompilePath(NodeId);
+		return;
+	}
+	CancelDeviceWait();
 	CloseChannel();
 	ChannelInfo = std::move(info);
 	OpenChannel();
@@ -134,6 +161,11 @@ void ChannelNode::OpenChannel()
 	if (!ChannelInfo.device || !ChannelInfo.channel)
 		return;
 	auto device = BluefishDevice::GetDevice(ChannelInfo.device->serial);
+	if (!device && !ChannelInfo.device->serial.empty() && !BluefishDevice::IsEnumerationComplete())
+	{
+		WaitForDevice();
+		return;
+	}
 	if (!device)
 	{
 		if (!ChannelInfo.device->serial.empty())
@@ -144,14 +176,29 @@ void ChannelNode::OpenChannel()
 	}
 	EVideoModeExt mode = static_cast<EVideoModeExt>(ChannelInfo.video_mode);
 	auto channel = static_cast<EBlueVideoChannel>(ChannelInfo.channel->id);
-	std::string channelStr = bfcUtilsGetStringForVideoChannel(channel);
+	std::string channelStr = GetChannelString();
 	std::string modeStr = bfcUtilsGetStringForVideoMode(mode);
 	if (IsInputChannel(channel))
 		nosEngine.LogI("Route input %s", channelStr.c_str());
 	else
 		nosEngine.LogI("Route output %s with video mode %s", channelStr.c_str(), modeStr.c_str());
 
-	auto err = device->OpenChannel(channel, mode);
+	ReconfigureCallback onReconfigured;
+	if (IsInputChannel(channel))
+	{
+		// Connected nodes and the graph resize for the new format through the pin, which is set when the engine executes
+		// the node. Called while the channel is open, so the node is alive.
+		onReconfigured = [this, info = ChannelInfo](ChannelFormat const& format) mutable {
+			SetChannelVideoMode(info, format.VideoMode);
+			{
+				std::unique_lock lock(ReconfiguredMutex);
+				ReconfiguredChannelInfo = nos::Buffer::From(info);
+			}
+			nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
+			nosEngine.ScheduleNode(&schedule);
+		};
+	}
+	auto err = device->OpenChannel(channel, mode, GetChannelSettings(ChannelInfo), std::move(onReconfigured));
 	if (BERR_NO_ERROR == err)
 		UpdateStatus(nos::fb::NodeStatusMessageType::INFO, channelStr + " " + modeStr);
 	else
@@ -162,6 +209,42 @@ void ChannelNode::OpenChannel()
 	nosEngine.RecompilePath(NodeId);
 }
 
+nosResult ChannelNode::ExecuteNode(nosNodeExecuteParams* params)
+{
+	nos::Buffer info;
+	{
+		std::unique_lock lock(ReconfiguredMutex);
+		info = std::exchange(ReconfiguredChannelInfo, {});
+	}
+	if (info.Size())
+		nosEngine.SetPinValue(ChannelPinId, info);
+	return NOS_RESULT_SUCCESS;
+}
+
+bool ChannelNode::IsReconfiguredChannel(nos::bluefish::TChannelInfo const& info)
+{
+	if (!ChannelInfo.device || !ChannelInfo.channel)
+		return false;
+	auto channel = static_cast<EBlueVideoChannel>(ChannelInfo.channel->id);
+	if (!IsInputChannel(channel))
+		return false;
+	auto expected = ChannelInfo;
+	SetChannelVideoMode(expected, static_cast<EVideoModeExt>(info.video_mode));
+	if (expected != info)
+		return false;
+	auto device = BluefishDevice::GetDevice(ChannelInfo.device->serial);
+	auto handle = device ? device->GetChannelHandle(channel) : ChannelHandle{};
+	return handle.Generation && handle.Format.VideoMode == static_cast<EVideoModeExt>(info.video_mode);
+}
+
+std::string ChannelNode::GetChannelString() const
+{
+	std::string channelStr = bfcUtilsGetStringForVideoChannel(static_cast<EBlueVideoChannel>(ChannelInfo.channel->id));
+	if (ChannelInfo.link != nos::bluefish::SignalLink::SINGLE_LINK)
+		channelStr += ChannelInfo.link == nos::bluefish::SignalLink::DUAL_LINK ? " (Dual Link)" : " (Quad Link)";
+	return channelStr;
+}
+
 void ChannelNode::CloseChannel()
 {
 	if (!ChannelInfo.device || !ChannelInfo.channel)
@@ -175,6 +258,43 @@ void ChannelNode::CloseChannel()
 	device->CloseChannel(static_cast<EBlueVideoChannel>(ChannelInfo.channel->id));
 }
 
+void ChannelNode::WaitForDevice()
+{
+	auto& serial = ChannelInfo.device->serial;
+	auto cached = BluefishDevice::GetCachedDevice(serial);
+	std::string name = cached ? bfcUtilsGetStringForCardType(cached->CardType) : "Bluefish444 device";
+	UpdateStatus(nos::fb::NodeStatusMessageType::WARNING, "Waiting for " + name + " " + serial + " to attach");
+	auto wait = PendingDeviceWait = std::make_shared<DeviceWait>();
+	BluefishDevice::WhenDeviceReady(serial, [wait, pinId = ChannelPinId, info = nos::Buffer::From(ChannelInfo)](std::shared_ptr<BluefishDevice>) {
+		std::unique_lock lock(wait->Mutex);
+		if (wait->Cancelled || wait->Ready)
+			return;
+		wait->Ready = true;
+		// Opens the channel on the node thread, see UpdateChannel. Nodes connected to the channel pin resolve their
+		// channel again too, now that the device exists.
+		nosEngine.SetPinValue(pinId, info);
+	});
+}
+
+bool ChannelNode::IsDeviceReady()
+{
+	if (!PendingDeviceWait)
+		return false;
+	std::unique_lock lock(PendingDeviceWait->Mutex);
+	return PendingDeviceWait->Ready && !PendingDeviceWait->Cancelled;
+}
+
+void ChannelNode::CancelDeviceWait()
+{
+	if (!PendingDeviceWait)
+		return;
+	{
+		std::unique_lock lock(PendingDeviceWait->Mutex);
+		PendingDeviceWait->Cancelled = true;
+	}
+	PendingDeviceWait.reset();
+}
+
 void ChannelNode::UpdateStatus(nos::fb::NodeStatusMessageType type, std::string text)
 {
 	auto device = BluefishDevice::GetDevice(ChannelInfo.device->serial);
@@ -7,6 +7,12 @@
 
 #include "BluefishTypes_generated.h"
 
+// stl
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
 namespace bf
 {
 
@@ -36,12 +42,37 @@ struct ChannelNode : nos::NodeContext
 	void OnMenuCommand(nosUUID itemID, uint32_t cmd) override;
 	void OnNodeUpdated(const nos::fb::Node* updatedNode) override;
 	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override;
+	// Sets the channel pin to the format the input channel was reconfigured to, see OpenChannel
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override;
 	
 	void UpdateChannel(nos::bluefish::TChannelInfo info);
 	void OpenChannel();
 	void CloseChannel();
+	// Whether info differs only in the video mode the open input channel was reconfigured to for its signal
+	bool IsReconfiguredChannel(nos::bluefish::TChannelInfo const& info);
+	// Channel name with the link count of its group, e.g. "Input Ch 1 (Quad Link)"
+	std::string GetChannelString() const;
+
+	// Once the card of the channel is attached (or enumeration ends without it), the enumeration thread sets the channel
+	// pin to its current value, unless cancelled before that. The channel is then opened on the node thread, when the pin
+	// change arrives, so that ChannelInfo is only accessed from there.
+	struct DeviceWait
+	{
+		std::mutex Mutex;
+		bool Cancelled = false;
+		bool Ready = false;
+	};
+	std::shared_ptr<DeviceWait> PendingDeviceWait;
+	void WaitForDevice();
+	void CancelDeviceWait();
+	bool IsDeviceReady();
 
 	void UpdateStatus(nos::fb::NodeStatusMessageType type, std::string text);
+
+	// Channel info with the video mode the open input channel was reconfigured to, set from the signal monitor thread.
+	// Empty if none is pending.
+	std::mutex ReconfiguredMutex;
+	nos::Buffer ReconfiguredChannelInfo;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ChannelTable.hpp"
+#include "Device.hpp"
+
+namespace bf
+{
+
+ChannelTable::~ChannelTable()
+{
+	for (auto& slot : Slots)
+		delete slot.Current.exchange(nullptr);
+}
+
+std::unique_ptr<Channel> ChannelTable::Exchange(EBlueVideoChannel channel, std::unique_ptr<Channel> next)
+{
+	if (!IsValid(channel))
+		return next;
+	auto& slot = Slots[channel];
+	std::unique_lock lock(slot.WriterMutex);
+	std::unique_ptr<Channel> previous(slot.Current.exchange(next.release()));
+	if (previous)
+		WaitForReaders(slot);
+	return previous;
+}
+
+void ChannelTable::WaitForReaders(Slot& slot)
+{
+	// Two grace periods: A reader may have sampled the epoch before the previous flip and incremented its counter late.
+	for (int phase = 0; phase < 2; ++phase)
+	{
+		auto& readers = slot.Readers[slot.Epoch.fetch_add(1) & 1];
+		for (auto count = readers.load(); count != 0; count = readers.load())
+			readers.wait(count);
+	}
+}
+
+}
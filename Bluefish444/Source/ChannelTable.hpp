@@ -0,0 +1,121 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+
+#define LOAD_FUNC_PTR_V6_5_3
+#include <BlueVelvetCFuncPtr.h>
+
+// stl
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace bf
+{
+
+class Channel;
+
+// Pins a channel for the duration of a DMA/VBI call. While any reference is alive, ChannelTable::Exchange
+// will not return (and destroy) the referenced channel.
+class ChannelRef
+{
+public:
+	ChannelRef() = default;
+	ChannelRef(Channel* channel, std::atomic<uint32_t>* readers) : Ptr(channel), Readers(readers) {}
+	ChannelRef(ChannelRef&& other) noexcept : Ptr(other.Ptr), Readers(other.Readers) { other.Ptr = nullptr; other.Readers = nullptr; }
+	ChannelRef(ChannelRef const&) = delete;
+	ChannelRef& operator=(ChannelRef const&) = delete;
+	ChannelRef& operator=(ChannelRef&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Release();
+			std::swap(Ptr, other.Ptr);
+			std::swap(Readers, other.Readers);
+		}
+		return *this;
+	}
+	~ChannelRef() { Release(); }
+
+	Channel* operator->() const { return Ptr; }
+	Channel& operator*() const { return *Ptr; }
+	Channel* Get() const { return Ptr; }
+	explicit operator bool() const { return Ptr != nullptr; }
+
+private:
+	void Release()
+	{
+		if (Readers && Readers->fetch_sub(1, std::memory_order_acq_rel) == 1)
+			Readers->notify_all();
+		Ptr = nullptr;
+		Readers = nullptr;
+	}
+
+	Channel* Ptr = nullptr;
+	std::atomic<uint32_t>* Readers = nullptr;
+};
+
+// Fixed-size table of open channels, indexed by EBlueVideoChannel.
+// Lookups (Pin) are wait-free and never block on the task thread reopening a channel.
+// Exchange/Close are called from Nodos task thread and wait until every reader of the replaced channel is done.
+class ChannelTable
+{
+public:
+	static constexpr size_t Capacity = static_cast<size_t>(std::max({
+		BLUE_VIDEO_OUTPUT_CHANNEL_1, BLUE_VIDEO_OUTPUT_CHANNEL_2, BLUE_VIDEO_OUTPUT_CHANNEL_3, BLUE_VIDEO_OUTPUT_CHANNEL_4,
+		BLUE_VIDEO_OUTPUT_CHANNEL_5, BLUE_VIDEO_OUTPUT_CHANNEL_6, BLUE_VIDEO_OUTPUT_CHANNEL_7, BLUE_VIDEO_OUTPUT_CHANNEL_8,
+		BLUE_VIDEO_INPUT_CHANNEL_1, BLUE_VIDEO_INPUT_CHANNEL_2, BLUE_VIDEO_INPUT_CHANNEL_3, BLUE_VIDEO_INPUT_CHANNEL_4,
+		BLUE_VIDEO_INPUT_CHANNEL_5, BLUE_VIDEO_INPUT_CHANNEL_6, BLUE_VIDEO_INPUT_CHANNEL_7, BLUE_VIDEO_INPUT_CHANNEL_8})) + 1;
+
+	ChannelTable() = default;
+	ChannelTable(ChannelTable const&) = delete;
+	~ChannelTable();
+
+	static bool IsValid(EBlueVideoChannel channel) { return static_cast<size_t>(channel) < Capacity; }
+
+	ChannelRef Pin(EBlueVideoChannel channel) const
+	{
+		if (!IsValid(channel))
+			return {};
+		auto& slot = Slots[channel];
+		auto& readers = slot.Readers[slot.Epoch.load() & 1];
+		readers.fetch_add(1);
+		auto* current = slot.Current.load();
+		if (!current)
+		{
+			if (readers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				readers.notify_all();
+			return {};
+		}
+		return ChannelRef(current, &readers);
+	}
+
+	// Publishes next (may be null) and returns the previous channel once no reader can observe it anymore.
+	std::unique_ptr<Channel> Exchange(EBlueVideoChannel channel, std::unique_ptr<Channel> next);
+
+private:
+	struct Slot
+	{
+		std::atomic<Channel*> Current = nullptr;
+		std::atomic<uint32_t> Epoch = 0;
+		std::array<std::atomic<uint32_t>, 2> Readers{};
+		std::mutex WriterMutex;
+	};
+
+	static void WaitForReaders(Slot& slot);
+
+	mutable std::array<Slot, Capacity> Slots;
+};
+
+}
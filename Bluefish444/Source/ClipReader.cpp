@@ -0,0 +1,143 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ClipReader.hpp"
+
+#if !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// stl
+#include <algorithm>
+#include <filesystem>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+ClipReader::~ClipReader()
+{
+	Close();
+}
+
+bool ClipReader::Open(std::string const& path, uint32_t frameSize)
+{
+	Close();
+	Path = path;
+#if _WIN32
+	File = CreateFileW(std::filesystem::path(reinterpret_cast<const char8_t*>(path.c_str())).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER fileSize{};
+	if (File != INVALID_HANDLE_VALUE && GetFileSizeEx(File, &fileSize) && fileSize.QuadPart)
+	{
+		Size = fileSize.QuadPart;
+		Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (Mapping)
+			Data = static_cast<uint8_t*>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	struct stat info{};
+	if (file != -1 && fstat(file, &info) == 0 && info.st_size)
+	{
+		Size = info.st_size;
+		auto* mapped = mmap(nullptr, Size, PROT_READ, MAP_SHARED, file, 0);
+		if (mapped != MAP_FAILED)
+			Data = static_cast<uint8_t*>(mapped);
+	}
+	if (file != -1)
+		close(file); // Mapping keeps the file open
+#endif
+	if (!Data)
+	{
+		nosEngine.LogE("Play: Cannot map %s", path.c_str());
+		Close();
+		return false;
+	}
+
+	RecordingHeader header;
+	if (Size >= sizeof(header))
+		memcpy(&header, Data, sizeof(header));
+	if (Size >= sizeof(header) && header.IsValid())
+	{
+		Header = header;
+		auto indexSize = header.IndexCount * sizeof(RecordingIndexEntry);
+		if (header.IndexCount && header.IndexOffset <= Size && indexSize <= Size - header.IndexOffset)
+		{
+			Frames.resize(header.IndexCount);
+			memcpy(Frames.data(), Data + header.IndexOffset, indexSize);
+		}
+		else
+		{
+			// Recording was not closed: Frames up to the end of the file, without times
+			for (uint64_t offset = header.HeaderSize; offset + header.FrameSize <= Size; offset += header.Stride)
+				Frames.push_back({.Offset = offset, .Size = header.FrameSize});
+		}
+		std::erase_if(Frames, [this](RecordingIndexEntry const& frame) { return frame.Offset > Size || frame.Size > Size - frame.Offset; });
+	}
+	else if (frameSize)
+	{
+		for (uint64_t offset = 0; offset + frameSize <= Size; offset += frameSize)
+			Frames.push_back({.Offset = offset, .Size = frameSize});
+	}
+	if (Frames.empty())
+	{
+		nosEngine.LogE("Play: %s has no frames", path.c_str());
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void ClipReader::Close()
+{
+#if _WIN32
+	if (Data)
+		UnmapViewOfFile(Data);
+	if (Mapping)
+		CloseHandle(Mapping);
+	if (File != INVALID_HANDLE_VALUE)
+		CloseHandle(File);
+	Mapping = nullptr;
+	File = INVALID_HANDLE_VALUE;
+#else
+	if (Data)
+		munmap(Data, Size);
+#endif
+	Data = nullptr;
+	Size = 0;
+	Header.reset();
+	Frames.clear();
+}
+
+void ClipReader::Prefetch(uint64_t first, uint32_t count) const
+{
+	if (!Data)
+		return;
+	count = uint32_t(std::min<uint64_t>(count, Frames.size()));
+#if _WIN32
+	std::vector<WIN32_MEMORY_RANGE_ENTRY> ranges;
+	ranges.reserve(count);
+#endif
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		auto& frame = Frames[(first + i) % Frames.size()];
+		// Ranges are widened to whole pages
+		auto begin = frame.Offset & ~uint64_t(4095);
+		auto end = std::min(frame.Offset + frame.Size, Size);
+#if _WIN32
+		ranges.push_back({.VirtualAddress = Data + begin, .NumberOfBytes = size_t(end - begin)});
+#else
+		madvise(Data + begin, end - begin, MADV_WILLNEED);
+#endif
+	}
+#if _WIN32
+	if (!ranges.empty())
+		PrefetchVirtualMemory(GetCurrentProcess(), ranges.size(), ranges.data(), 0);
+#endif
+}
+
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+
+#include "Recording.hpp"
+
+// stl
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace bf
+{
+
+// Read-only memory mapping of a clip for playout: A recording (see Recording.hpp), or a headerless file of back-to-back
+// frames in card memory format. Frames are transferred by DMA straight from the mapping, so that they are neither
+// copied nor uploaded to the GPU; Prefetch makes the OS read the frames ahead of playback in the background, so that
+// transfers do not fault on pages still on disk.
+class ClipReader
+{
+public:
+	ClipReader() = default;
+	ClipReader(ClipReader const&) = delete;
+	~ClipReader();
+
+	// frameSize is the size of the frames of headerless files. Returns false if the file cannot be mapped or has no frames.
+	bool Open(std::string const& path, uint32_t frameSize);
+	void Close();
+	bool IsOpen() const { return Data != nullptr; }
+
+	// Header of recordings, none for headerless files
+	std::optional<RecordingHeader> const& GetHeader() const { return Header; }
+	uint64_t GetFrameCount() const { return Frames.size(); }
+	// Offset, Size and Field of the frame; field count and time only for indexed recordings
+	RecordingIndexEntry const& GetEntry(uint64_t frame) const { return Frames[frame]; }
+	uint8_t* GetData(uint64_t frame) const { return Data + Frames[frame].Offset; }
+	// Starts reading count frames from first into memory without waiting for them, wrapping around at the last frame
+	void Prefetch(uint64_t first, uint32_t count) const;
+	std::string const& GetPath() const { return Path; }
+
+private:
+	std::string Path;
+	uint8_t* Data = nullptr;
+	uint64_t Size = 0;
+	std::optional<RecordingHeader> Header;
+	std::vector<RecordingIndexEntry> Frames;
+#if _WIN32
+	HANDLE File = INVALID_HANDLE_VALUE;
+	HANDLE Mapping = nullptr;
+#endif
+};
+
+}
@@ -0,0 +1,408 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ColorConversion.hpp"
+#include "ParallelRows.hpp"
+
+// stl
+#include <algorithm>
+#include <cmath>
+
+namespace bf::color
+{
+
+namespace
+{
+
+constexpr int32_t Round = 1 << (FractionBits - 1);
+constexpr uint32_t MinRowsPerSlice = 16;
+
+struct LumaWeights
+{
+	double Kr, Kb;
+};
+
+LumaWeights GetLumaWeights(Matrix matrix)
+{
+	switch (matrix)
+	{
+	case Matrix::Rec601: return {0.299, 0.114};
+	case Matrix::Rec2020: return {0.2627, 0.0593};
+	default: return {0.2126, 0.0722};
+	}
+}
+
+int16_t ToFixed(double value)
+{
+	return int16_t(std::lround(value * (1 << FractionBits)));
+}
+
+uint8_t Clamp8(int32_t value)
+{
+	return uint8_t(std::clamp(value, 0, 255));
+}
+
+// Low 16 bits are multiplied with the first element of a pair by madd
+int32_t Pair(int16_t lo, int16_t hi)
+{
+	return int32_t(uint32_t(uint16_t(lo)) | uint32_t(uint16_t(hi)) << 16);
+}
+
+void YUV8ToRGBA8Scalar(YCbCrToRGBCoefficients const& k, uint8_t const* src, uint32_t width, uint32_t x, uint8_t* dst)
+{
+	for (src += x * 2, dst += x * 4; x < width; x += 2, src += 4, dst += 8)
+	{
+		int32_t cb = src[0] - 128, cr = src[2] - 128;
+		for (int i = 0; i < 2; ++i)
+		{
+			int32_t y = k.Y * (src[1 + i * 2] - k.YOffset);
+			dst[i * 4 + 0] = Clamp8((y + k.CrR * cr + Round) >> FractionBits);
+			dst[i * 4 + 1] = Clamp8((y + k.CbG * cb + k.CrG * cr + Round) >> FractionBits);
+			dst[i * 4 + 2] = Clamp8((y + k.CbB * cb + Round) >> FractionBits);
+			dst[i * 4 + 3] = 255;
+		}
+	}
+}
+
+void RGBA8ToYUV8Scalar(RGBToYCbCrCoefficients const& k, uint8_t const* src, uint32_t width, uint32_t x, uint8_t* dst)
+{
+	const int32_t yBias = (k.YOffset << FractionBits) + Round;
+	const int32_t cBias = (128 << (FractionBits + 1)) + (1 << FractionBits);
+	for (src += x * 4, dst += x * 2; x < width; x += 2, src += 8, dst += 4)
+	{
+		int32_t r = src[0] + src[4], g = src[1] + src[5], b = src[2] + src[6];
+		dst[0] = Clamp8((k.CbR * r + k.CbG * g + k.CbB * b + cBias) >> (FractionBits + 1));
+		dst[1] = Clamp8((k.YR * src[0] + k.YG * src[1] + k.YB * src[2] + yBias) >> FractionBits);
+		dst[2] = Clamp8((k.CrR * r + k.CrG * g + k.CrB * b + cBias) >> (FractionBits + 1));
+		dst[3] = Clamp8((k.YR * src[4] + k.YG * src[5] + k.YB * src[6] + yBias) >> FractionBits);
+	}
+}
+
+#if BF_SIMD_X64
+
+// YCbCr to RGB: Y, Cb and Cr are spread to one 16-bit lane per pixel with byte shuffles, then each channel is one or two
+// madds of (Y', C') pairs. RGB to YCbCr: each pixel is widened to R G B A 16-bit lanes, madds and horizontal adds give
+// per pixel (Y) and per pixel pair (Cb, Cr) sums. The SIMD kernels use the same integer math as the scalar ones.
+// Shuffles and packs work within 128-bit lanes, so wider kernels reorder their loads or stores across lanes.
+
+#define BF_2VUY_Y 1, -1, 3, -1, 5, -1, 7, -1, 9, -1, 11, -1, 13, -1, 15, -1
+#define BF_2VUY_CB 0, -1, 0, -1, 4, -1, 4, -1, 8, -1, 8, -1, 12, -1, 12, -1
+#define BF_2VUY_CR 2, -1, 2, -1, 6, -1, 6, -1, 10, -1, 10, -1, 14, -1, 14, -1
+// From [Y0-Y7, Cb0-Cb3, Cr0-Cr3] bytes
+#define BF_2VUY_INTERLEAVE 8, 0, 12, 1, 9, 2, 13, 3, 10, 4, 14, 5, 11, 6, 15, 7
+
+BF_TARGET_SSE41 void YUV8ToRGBA8SSE41(YCbCrToRGBCoefficients const& k, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	const __m128i yShuffle = _mm_setr_epi8(BF_2VUY_Y), cbShuffle = _mm_setr_epi8(BF_2VUY_CB), crShuffle = _mm_setr_epi8(BF_2VUY_CR);
+	const __m128i yOffset = _mm_set1_epi16(k.YOffset), cOffset = _mm_set1_epi16(128), alpha = _mm_set1_epi16(255);
+	const __m128i kR = _mm_set1_epi32(Pair(k.Y, k.CrR)), kG = _mm_set1_epi32(Pair(k.Y, k.CbG));
+	const __m128i kGCr = _mm_set1_epi32(Pair(k.CrG, 0)), kB = _mm_set1_epi32(Pair(k.Y, k.CbB));
+	const __m128i round = _mm_set1_epi32(Round), zero = _mm_setzero_si128();
+	uint32_t x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i in = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + x * 2));
+		__m128i y = _mm_sub_epi16(_mm_shuffle_epi8(in, yShuffle), yOffset);
+		__m128i cb = _mm_sub_epi16(_mm_shuffle_epi8(in, cbShuffle), cOffset);
+		__m128i cr = _mm_sub_epi16(_mm_shuffle_epi8(in, crShuffle), cOffset);
+		__m128i rgb[3];
+		for (int half = 0; half < 2; ++half)
+		{
+			__m128i ycr = half ? _mm_unpackhi_epi16(y, cr) : _mm_unpacklo_epi16(y, cr);
+			__m128i ycb = half ? _mm_unpackhi_epi16(y, cb) : _mm_unpacklo_epi16(y, cb);
+			__m128i cr0 = half ? _mm_unpackhi_epi16(cr, zero) : _mm_unpacklo_epi16(cr, zero);
+			__m128i r = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycr, kR), round), FractionBits);
+			__m128i g = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(ycb, kG), _mm_madd_epi16(cr0, kGCr)), round), FractionBits);
+			__m128i b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycb, kB), round), FractionBits);
+			rgb[0] = half ? _mm_packs_epi32(rgb[0], r) : r;
+			rgb[1] = half ? _mm_packs_epi32(rgb[1], g) : g;
+			rgb[2] = half ? _mm_packs_epi32(rgb[2], b) : b;
+		}
+		__m128i rg = _mm_packus_epi16(rgb[0], rgb[1]);
+		__m128i ba = _mm_packus_epi16(rgb[2], alpha);
+		__m128i rb = _mm_unpacklo_epi8(rg, ba), ga = _mm_unpackhi_epi8(rg, ba);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_unpacklo_epi8(rb, ga));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_unpackhi_epi8(rb, ga));
+	}
+	YUV8ToRGBA8Scalar(k, src, width, x, dst);
+}
+
+BF_TARGET_AVX2 void YUV8ToRGBA8AVX2(YCbCrToRGBCoefficients const& k, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	const __m256i yShuffle = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_2VUY_Y));
+	const __m256i cbShuffle = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_2VUY_CB));
+	const __m256i crShuffle = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_2VUY_CR));
+	const __m256i yOffset = _mm256_set1_epi16(k.YOffset), cOffset = _mm256_set1_epi16(128), alpha = _mm256_set1_epi16(255);
+	const __m256i kR = _mm256_set1_epi32(Pair(k.Y, k.CrR)), kG = _mm256_set1_epi32(Pair(k.Y, k.CbG));
+	const __m256i kGCr = _mm256_set1_epi32(Pair(k.CrG, 0)), kB = _mm256_set1_epi32(Pair(k.Y, k.CbB));
+	const __m256i round = _mm256_set1_epi32(Round), zero = _mm256_setzero_si256();
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m256i in = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + x * 2));
+		__m256i y = _mm256_sub_epi16(_mm256_shuffle_epi8(in, yShuffle), yOffset);
+		__m256i cb = _mm256_sub_epi16(_mm256_shuffle_epi8(in, cbShuffle), cOffset);
+		__m256i cr = _mm256_sub_epi16(_mm256_shuffle_epi8(in, crShuffle), cOffset);
+		__m256i rgb[3];
+		for (int half = 0; half < 2; ++half)
+		{
+			__m256i ycr = half ? _mm256_unpackhi_epi16(y, cr) : _mm256_unpacklo_epi16(y, cr);
+			__m256i ycb = half ? _mm256_unpackhi_epi16(y, cb) : _mm256_unpacklo_epi16(y, cb);
+			__m256i cr0 = half ? _mm256_unpackhi_epi16(cr, zero) : _mm256_unpacklo_epi16(cr, zero);
+			__m256i r = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycr, kR), round), FractionBits);
+			__m256i g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycb, kG), _mm256_madd_epi16(cr0, kGCr)), round), FractionBits);
+			__m256i b = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycb, kB), round), FractionBits);
+			rgb[0] = half ? _mm256_packs_epi32(rgb[0], r) : r;
+			rgb[1] = half ? _mm256_packs_epi32(rgb[1], g) : g;
+			rgb[2] = half ? _mm256_packs_epi32(rgb[2], b) : b;
+		}
+		__m256i rg = _mm256_packus_epi16(rgb[0], rgb[1]);
+		__m256i ba = _mm256_packus_epi16(rgb[2], alpha);
+		__m256i rb = _mm256_unpacklo_epi8(rg, ba), ga = _mm256_unpackhi_epi8(rg, ba);
+		__m256i lo = _mm256_unpacklo_epi8(rb, ga), hi = _mm256_unpackhi_epi8(rb, ga); // Pixels [0-3, 8-11], [4-7, 12-15]
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	YUV8ToRGBA8Scalar(k, src, width, x, dst);
+}
+
+BF_TARGET_AVX512 void YUV8ToRGBA8AVX512(YCbCrToRGBCoefficients const& k, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	const __m512i yShuffle = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_2VUY_Y));
+	const __m512i cbShuffle = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_2VUY_CB));
+	const __m512i crShuffle = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_2VUY_CR));
+	const __m512i yOffset = _mm512_set1_epi16(k.YOffset), cOffset = _mm512_set1_epi16(128), alpha = _mm512_set1_epi16(255);
+	const __m512i kR = _mm512_set1_epi32(Pair(k.Y, k.CrR)), kG = _mm512_set1_epi32(Pair(k.Y, k.CbG));
+	const __m512i kGCr = _mm512_set1_epi32(Pair(k.CrG, 0)), kB = _mm512_set1_epi32(Pair(k.Y, k.CbB));
+	const __m512i round = _mm512_set1_epi32(Round), zero = _mm512_setzero_si512();
+	const __m512i firstHalf = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11), secondHalf = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+	uint32_t x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m512i in = _mm512_loadu_si512(src + x * 2);
+		__m512i y = _mm512_sub_epi16(_mm512_shuffle_epi8(in, yShuffle), yOffset);
+		__m512i cb = _mm512_sub_epi16(_mm512_shuffle_epi8(in, cbShuffle), cOffset);
+		__m512i cr = _mm512_sub_epi16(_mm512_shuffle_epi8(in, crShuffle), cOffset);
+		__m512i rgb[3];
+		for (int half = 0; half < 2; ++half)
+		{
+			__m512i ycr = half ? _mm512_unpackhi_epi16(y, cr) : _mm512_unpacklo_epi16(y, cr);
+			__m512i ycb = half ? _mm512_unpackhi_epi16(y, cb) : _mm512_unpacklo_epi16(y, cb);
+			__m512i cr0 = half ? _mm512_unpackhi_epi16(cr, zero) : _mm512_unpacklo_epi16(cr, zero);
+			__m512i r = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(ycr, kR), round), FractionBits);
+			__m512i g = _mm512_srai_epi32(_mm512_add_epi32(_mm512_add_epi32(_mm512_madd_epi16(ycb, kG), _mm512_madd_epi16(cr0, kGCr)), round), FractionBits);
+			__m512i b = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(ycb, kB), round), FractionBits);
+			rgb[0] = half ? _mm512_packs_epi32(rgb[0], r) : r;
+			rgb[1] = half ? _mm512_packs_epi32(rgb[1], g) : g;
+			rgb[2] = half ? _mm512_packs_epi32(rgb[2], b) : b;
+		}
+		__m512i rg = _mm512_packus_epi16(rgb[0], rgb[1]);
+		__m512i ba = _mm512_packus_epi16(rgb[2], alpha);
+		__m512i rb = _mm512_unpacklo_epi8(rg, ba), ga = _mm512_unpackhi_epi8(rg, ba);
+		__m512i lo = _mm512_unpacklo_epi8(rb, ga), hi = _mm512_unpackhi_epi8(rb, ga); // Pixels [0-3, 8-11, ...], [4-7, 12-15, ...]
+		_mm512_storeu_si512(dst + x * 4, _mm512_permutex2var_epi64(lo, firstHalf, hi));
+		_mm512_storeu_si512(dst + x * 4 + 64, _mm512_permutex2var_epi64(lo, secondHalf, hi));
+	}
+	YUV8ToRGBA8Scalar(k, src, width, x, dst);
+}
+
+BF_TARGET_SSE41 void RGBA8ToYUV8SSE41(RGBToYCbCrCoefficients const& k, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	const __m128i kY = _mm_setr_epi16(k.YR, k.YG, k.YB, 0, k.YR, k.YG, k.YB, 0);
+	const __m128i kCb = _mm_setr_epi16(k.CbR, k.CbG, k.CbB, 0, k.CbR, k.CbG, k.CbB, 0);
+	const __m128i kCr = _mm_setr_epi16(k.CrR, k.CrG, k.CrB, 0, k.CrR, k.CrG, k.CrB, 0);
+	const __m128i yBias = _mm_set1_epi32((k.YOffset << FractionBits) + Round);
+	const __m128i cBias = _mm_set1_epi32((128 << (FractionBits + 1)) + (1 << FractionBits));
+	const __m128i interleave = _mm_setr_epi8(BF_2VUY_INTERLEAVE);
+	uint32_t x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i v[4]; // Pixel pairs as R G B A R G B A
+		for (int i = 0; i < 4; ++i)
+			v[i] = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + x * 4 + i * 8)));
+		__m128i y03 = _mm_hadd_epi32(_mm_madd_epi16(v[0], kY), _mm_madd_epi16(v[1], kY));
+		__m128i y47 = _mm_hadd_epi32(_mm_madd_epi16(v[2], kY), _mm_madd_epi16(v[3], kY));
+		__m128i cb = _mm_hadd_epi32(_mm_hadd_epi32(_mm_madd_epi16(v[0], kCb), _mm_madd_epi16(v[1], kCb)),
+									_mm_hadd_epi32(_mm_madd_epi16(v[2], kCb), _mm_madd_epi16(v[3], kCb)));
+		__m128i cr = _mm_hadd_epi32(_mm_hadd_epi32(_mm_madd_epi16(v[0], kCr), _mm_madd_epi16(v[1], kCr)),
+									_mm_hadd_epi32(_mm_madd_epi16(v[2], kCr), _mm_madd_epi16(v[3], kCr)));
+		y03 = _mm_srai_epi32(_mm_add_epi32(y03, yBias), FractionBits);
+		y47 = _mm_srai_epi32(_mm_add_epi32(y47, yBias), FractionBits);
+		cb = _mm_srai_epi32(_mm_add_epi32(cb, cBias), FractionBits + 1);
+		cr = _mm_srai_epi32(_mm_add_epi32(cr, cBias), FractionBits + 1);
+		__m128i samples = _mm_packus_epi16(_mm_packs_epi32(y03, y47), _mm_packs_epi32(cb, cr));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2), _mm_shuffle_epi8(samples, interleave));
+	}
+	RGBA8ToYUV8Scalar(k, src, width, x, dst);
+}
+
+BF_TARGET_AVX2 void RGBA8ToYUV8AVX2(RGBToYCbCrCoefficients const& k, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	const __m256i kY = _mm256_broadcastsi128_si256(_mm_setr_epi16(k.YR, k.YG, k.YB, 0, k.YR, k.YG, k.YB, 0));
+	const __m256i kCb = _mm256_broadcastsi128_si256(_mm_setr_epi16(k.CbR, k.CbG, k.CbB, 0, k.CbR, k.CbG, k.CbB, 0));
+	const __m256i kCr = _mm256_broadcastsi128_si256(_mm_setr_epi16(k.CrR, k.CrG, k.CrB, 0, k.CrR, k.CrG, k.CrB, 0));
+	const __m256i yBias = _mm256_set1_epi32((k.YOffset << FractionBits) + Round);
+	const __m256i cBias = _mm256_set1_epi32((128 << (FractionBits + 1)) + (1 << FractionBits));
+	const __m256i interleave = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_2VUY_INTERLEAVE));
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m256i v[4]; // Lane 0 holds a pixel pair of pixels 0-7, lane 1 the same pair of pixels 8-15
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128i pair0 = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + x * 4 + i * 8));
+			__m128i pair1 = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + x * 4 + 32 + i * 8));
+			v[i] = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(pair0, pair1));
+		}
+		__m256i y03 = _mm256_hadd_epi32(_mm256_madd_epi16(v[0], kY), _mm256_madd_epi16(v[1], kY));
+		__m256i y47 = _mm256_hadd_epi32(_mm256_madd_epi16(v[2], kY), _mm256_madd_epi16(v[3], kY));
+		__m256i cb = _mm256_hadd_epi32(_mm256_hadd_epi32(_mm256_madd_epi16(v[0], kCb), _mm256_madd_epi16(v[1], kCb)),
+									   _mm256_hadd_epi32(_mm256_madd_epi16(v[2], kCb), _mm256_madd_epi16(v[3], kCb)));
+		__m256i cr = _mm256_hadd_epi32(_mm256_hadd_epi32(_mm256_madd_epi16(v[0], kCr), _mm256_madd_epi16(v[1], kCr)),
+									   _mm256_hadd_epi32(_mm256_madd_epi16(v[2], kCr), _mm256_madd_epi16(v[3], kCr)));
+		y03 = _mm256_srai_epi32(_mm256_add_epi32(y03, yBias), FractionBits);
+		y47 = _mm256_srai_epi32(_mm256_add_epi32(y47, yBias), FractionBits);
+		cb = _mm256_srai_epi32(_mm256_add_epi32(cb, cBias), FractionBits + 1);
+		cr = _mm256_srai_epi32(_mm256_add_epi32(cr, cBias), FractionBits + 1);
+		__m256i samples = _mm256_packus_epi16(_mm256_packs_epi32(y03, y47), _mm256_packs_epi32(cb, cr));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 2), _mm256_shuffle_epi8(samples, interleave));
+	}
+	RGBA8ToYUV8Scalar(k, src, width, x, dst);
+}
+
+// AVX-512 has no horizontal add: [a0 + a1, a2 + a3, b0 + b1, b2 + b3] per 128-bit lane
+BF_TARGET_AVX512 inline __m512i HorizontalAdd(__m512i a, __m512i b)
+{
+	__m512 even = _mm512_shuffle_ps(_mm512_castsi512_ps(a), _mm512_castsi512_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+	__m512 odd = _mm512_shuffle_ps(_mm512_castsi512_ps(a), _mm512_castsi512_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+	return _mm512_add_epi32(_mm512_castps_si512(even), _mm512_castps_si512(odd));
+}
+
+BF_TARGET_AVX512 void RGBA8ToYUV8AVX512(RGBToYCbCrCoefficients const& k, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	const __m512i kY = _mm512_broadcast_i32x4(_mm_setr_epi16(k.YR, k.YG, k.YB, 0, k.YR, k.YG, k.YB, 0));
+	const __m512i kCb = _mm512_broadcast_i32x4(_mm_setr_epi16(k.CbR, k.CbG, k.CbB, 0, k.CbR, k.CbG, k.CbB, 0));
+	const __m512i kCr = _mm512_broadcast_i32x4(_mm_setr_epi16(k.CrR, k.CrG, k.CrB, 0, k.CrR, k.CrG, k.CrB, 0));
+	const __m512i yBias = _mm512_set1_epi32((k.YOffset << FractionBits) + Round);
+	const __m512i cBias = _mm512_set1_epi32((128 << (FractionBits + 1)) + (1 << FractionBits));
+	const __m512i interleave = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_2VUY_INTERLEAVE));
+	uint32_t x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		// Lane j of v[i] holds pixel pair i of pixels 8j to 8j + 7
+		__m512i first = _mm512_loadu_si512(src + x * 4), second = _mm512_loadu_si512(src + x * 4 + 64);
+		__m512i v[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			__m512i pairs = _mm512_permutex2var_epi64(first, _mm512_setr_epi64(i, 4 + i, 8 + i, 12 + i, 0, 0, 0, 0), second);
+			v[i] = _mm512_cvtepu8_epi16(_mm512_castsi512_si256(pairs));
+		}
+		__m512i y03 = HorizontalAdd(_mm512_madd_epi16(v[0], kY), _mm512_madd_epi16(v[1], kY));
+		__m512i y47 = HorizontalAdd(_mm512_madd_epi16(v[2], kY), _mm512_madd_epi16(v[3], kY));
+		__m512i cb = HorizontalAdd(HorizontalAdd(_mm512_madd_epi16(v[0], kCb), _mm512_madd_epi16(v[1], kCb)),
+								   HorizontalAdd(_mm512_madd_epi16(v[2], kCb), _mm512_madd_epi16(v[3], kCb)));
+		__m512i cr = HorizontalAdd(HorizontalAdd(_mm512_madd_epi16(v[0], kCr), _mm512_madd_epi16(v[1], kCr)),
+								   HorizontalAdd(_mm512_madd_epi16(v[2], kCr), _mm512_madd_epi16(v[3], kCr)));
+		y03 = _mm512_srai_epi32(_mm512_add_epi32(y03, yBias), FractionBits);
+		y47 = _mm512_srai_epi32(_mm512_add_epi32(y47, yBias), FractionBits);
+		cb = _mm512_srai_epi32(_mm512_add_epi32(cb, cBias), FractionBits + 1);
+		cr = _mm512_srai_epi32(_mm512_add_epi32(cr, cBias), FractionBits + 1);
+		__m512i samples = _mm512_packus_epi16(_mm512_packs_epi32(y03, y47), _mm512_packs_epi32(cb, cr));
+		_mm512_storeu_si512(dst + x * 2, _mm512_shuffle_epi8(samples, interleave));
+	}
+	RGBA8ToYUV8Scalar(k, src, width, x, dst);
+}
+
+#endif
+
+}
+
+YCbCrToRGBCoefficients GetYCbCrToRGBCoefficients(Matrix matrix, Range range)
+{
+	auto [kr, kb] = GetLumaWeights(matrix);
+	double kg = 1.0 - kr - kb;
+	bool narrow = range == Range::Narrow;
+	double ys = narrow ? 255.0 / 219.0 : 1.0;
+	double cs = narrow ? 255.0 / 224.0 : 1.0;
+	return {
+		.YOffset = int16_t(narrow ? 16 : 0),
+		.Y = ToFixed(ys),
+		.CrR = ToFixed(2 * (1 - kr) * cs),
+		.CbG = ToFixed(-2 * kb * (1 - kb) / kg * cs),
+		.CrG = ToFixed(-2 * kr * (1 - kr) / kg * cs),
+		.CbB = ToFixed(2 * (1 - kb) * cs),
+	};
+}
+
+RGBToYCbCrCoefficients GetRGBToYCbCrCoefficients(Matrix matrix, Range range)
+{
+	auto [kr, kb] = GetLumaWeights(matrix);
+	bool narrow = range == Range::Narrow;
+	double ys = narrow ? 219.0 / 255.0 : 1.0;
+	double cs = narrow ? 224.0 / 255.0 : 1.0;
+	auto yr = ToFixed(kr * ys), yb = ToFixed(kb * ys);
+	auto cbr = ToFixed(-kr / (2 * (1 - kb)) * cs), cbb = ToFixed(0.5 * cs);
+	auto crr = ToFixed(0.5 * cs), crb = ToFixed(-kb / (2 * (1 - kr)) * cs);
+	// Green is rounded so that white maps to peak luma and greys have neutral chroma exactly
+	return {
+		.YOffset = int16_t(narrow ? 16 : 0),
+		.YR = yr,
+		.YG = int16_t(ToFixed(ys) - yr - yb),
+		.YB = yb,
+		.CbR = cbr,
+		.CbG = int16_t(-cbr - cbb),
+		.CbB = cbb,
+		.CrR = crr,
+		.CrG = int16_t(-crr - crb),
+		.CrB = crb,
+	};
+}
+
+void YUV8ToRGBA8Line(SimdLevel level, YCbCrToRGBCoefficients const& coefficients, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	switch (level)
+	{
+#if BF_SIMD_X64
+	case SimdLevel::AVX512: return YUV8ToRGBA8AVX512(coefficients, src, width, dst);
+	case SimdLevel::AVX2: return YUV8ToRGBA8AVX2(coefficients, src, width, dst);
+	case SimdLevel::SSE41: return YUV8ToRGBA8SSE41(coefficients, src, width, dst);
+#endif
+	default: return YUV8ToRGBA8Scalar(coefficients, src, width, 0, dst);
+	}
+}
+
+void RGBA8ToYUV8Line(SimdLevel level, RGBToYCbCrCoefficients const& coefficients, uint8_t const* src, uint32_t width, uint8_t* dst)
+{
+	switch (level)
+	{
+#if BF_SIMD_X64
+	case SimdLevel::AVX512: return RGBA8ToYUV8AVX512(coefficients, src, width, dst);
+	case SimdLevel::AVX2: return RGBA8ToYUV8AVX2(coefficients, src, width, dst);
+	case SimdLevel::SSE41: return RGBA8ToYUV8SSE41(coefficients, src, width, dst);
+#endif
+	default: return RGBA8ToYUV8Scalar(coefficients, src, width, 0, dst);
+	}
+}
+
+void YUV8ToRGBA8(uint8_t const* src, uint32_t srcPitch, uint32_t width, uint32_t height,
+				 uint8_t* dst, uint32_t dstPitch, Matrix matrix, Range range, uint32_t maxThreads)
+{
+	auto level = GetSimdLevel();
+	auto coefficients = GetYCbCrToRGBCoefficients(matrix, range);
+	ParallelRows(height, MinRowsPerSlice, maxThreads, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t row = begin; row < end; ++row)
+			YUV8ToRGBA8Line(level, coefficients, src + size_t(row) * srcPitch, width, dst + size_t(row) * dstPitch);
+	});
+}
+
+void RGBA8ToYUV8(uint8_t const* src, uint32_t srcPitch, uint32_t width, uint32_t height,
+				 uint8_t* dst, uint32_t dstPitch, Matrix matrix, Range range, uint32_t maxThreads)
+{
+	auto level = GetSimdLevel();
+	auto coefficients = GetRGBToYCbCrCoefficients(matrix, range);
+	ParallelRows(height, MinRowsPerSlice, maxThreads, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t row = begin; row < end; ++row)
+			RGBA8ToYUV8Line(level, coefficients, src + size_t(row) * srcPitch, width, dst + size_t(row) * dstPitch);
+	});
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include "Simd.hpp"
+
+// stl
+#include <cstdint>
+
+namespace bf::color
+{
+
+enum class Matrix
+{
+	Rec601,
+	Rec709,
+	Rec2020,
+};
+
+enum class Range
+{
+	Narrow, // Y 16-235, Cb/Cr 16-240
+	Full,
+};
+
+// Fixed-point coefficients with FractionBits fractional bits.
+// YCbCr to RGB: R = Y' + CrR Cr', G = Y' + CbG Cb' + CrG Cr', B = Y' + CbB Cb', where Y' = Y (Y - YOffset), C' = C - 128.
+// RGB to YCbCr: Y = YOffset + YR R + YG G + YB B, Cb = 128 + CbR R + CbG G + CbB B (same for Cr), chroma from the average of a pixel pair.
+constexpr int FractionBits = 13;
+
+struct YCbCrToRGBCoefficients
+{
+	int16_t YOffset;
+	int16_t Y, CrR, CbG, CrG, CbB;
+};
+
+struct RGBToYCbCrCoefficients
+{
+	int16_t YOffset;
+	int16_t YR, YG, YB;
+	int16_t CbR, CbG, CbB;
+	int16_t CrR, CrG, CrB;
+};
+
+YCbCrToRGBCoefficients GetYCbCrToRGBCoefficients(Matrix matrix, Range range);
+RGBToYCbCrCoefficients GetRGBToYCbCrCoefficients(Matrix matrix, Range range);
+
+// 2VUY (Cb Y0 Cr Y1, 8-bit 4:2:2, i.e. the buffers of Channel::DMAReadFrame/DMAWriteFrame) <-> RGBA8 with alpha 255.
+// width must be even. Rows are split across threads (maxThreads 0: all hardware threads, see ParallelRows).
+void YUV8ToRGBA8(uint8_t const* src, uint32_t srcPitch, uint32_t width, uint32_t height,
+				 uint8_t* dst, uint32_t dstPitch, Matrix matrix, Range range, uint32_t maxThreads = 0);
+void RGBA8ToYUV8(uint8_t const* src, uint32_t srcPitch, uint32_t width, uint32_t height,
+				 uint8_t* dst, uint32_t dstPitch, Matrix matrix, Range range, uint32_t maxThreads = 0);
+
+// Single line kernels, exposed for comparing implementations. All levels give identical results.
+void YUV8ToRGBA8Line(SimdLevel level, YCbCrToRGBCoefficients const& coefficients, uint8_t const* src, uint32_t width, uint8_t* dst);
+void RGBA8ToYUV8Line(SimdLevel level, RGBToYCbCrCoefficients const& coefficients, uint8_t const* src, uint32_t width, uint8_t* dst);
+
+}
@@ -0,0 +1,170 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/Modules.h>
+#include <Nodos/PluginHelpers.hpp>
+#include <nosVulkanSubsystem/nosVulkanSubsystem.h>
+#include <nosVulkanSubsystem/Helpers.hpp>
+
+#include "ChannelHelpers.hpp"
+#include "ColorConversion.hpp"
+#include "DMABufferCache.hpp"
+#include "DMABufferPool.hpp"
+#include "Device.hpp"
+#include "V210.hpp"
+
+namespace bf
+{
+// Converts the frames (or fields, in field mode) of a channel between the memory format of its card buffers and a format
+// that CPU stages work on, so that pipelines without a GPU can process what DMA Read outputs and DMA Write takes:
+// - YUV8 (2VUY): RGBA8 with alpha 255, converted with the Matrix and Range of the node
+// - V210: Planar 4:2:2 with 10-bit samples in 16-bit words. The Y plane is followed by the Cb and Cr planes.
+// Outputs are buffers of a pool owned by the node, so they can be transferred by DMA Write without mapping them again.
+struct ConvertNodeBase : nos::NodeContext
+{
+	using NodeContext::NodeContext;
+
+	ChannelHandle Handle{};
+	DMABufferCache Buffers;
+	DMABufferPool Outputs;
+	uint32_t BufferCount = 4;
+	color::Matrix Matrix = color::Matrix::Rec709;
+	color::Range Range = color::Range::Narrow;
+
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
+	{
+		if (pinName == NOS_NAME("Channel"))
+			Handle = ResolveChannelHandle(value);
+		else if (pinName == NOS_NAME("BufferCount"))
+			BufferCount = std::max(*nos::InterpretPinValue<uint32_t>(value), 1u);
+		else if (pinName == NOS_NAME("Matrix"))
+		{
+			switch (*nos::InterpretPinValue<nos::bluefish::ColorMatrix>(value))
+			{
+			case nos::bluefish::ColorMatrix::REC601: Matrix = color::Matrix::Rec601; break;
+			case nos::bluefish::ColorMatrix::REC2020: Matrix = color::Matrix::Rec2020; break;
+			default: Matrix = color::Matrix::Rec709; break;
+			}
+		}
+		else if (pinName == NOS_NAME("Range"))
+			Range = *nos::InterpretPinValue<nos::bluefish::ColorRange>(value) == nos::bluefish::ColorRange::FULL ? color::Range::Full : color::Range::Narrow;
+	}
+
+	void OnPathStop() override
+	{
+		Buffers.Clear();
+	}
+
+	// Lines of a transferred frame, or of a field in field mode
+	static uint32_t GetLineCount(ChannelFormat const& format)
+	{
+		return format.BytesPerLine ? (format.FieldMode ? format.FieldBufferSize : format.BufferSize) / format.BytesPerLine : 0;
+	}
+
+	// Bytes of a frame (or field) in the CPU side format. 0 if the memory format of the channel has no conversion.
+	static uint64_t GetHostSize(ChannelFormat const& format)
+	{
+		switch (format.MemoryFormat)
+		{
+		case MEM_FMT_2VUY: return uint64_t(format.Width) * GetLineCount(format) * 4;
+		case MEM_FMT_V210: return uint64_t(format.Width) * GetLineCount(format) * 2 * sizeof(uint16_t);
+		default: return 0;
+		}
+	}
+
+	static v210::Planar16 GetPlanes(uint8_t* data, ChannelFormat const& format)
+	{
+		auto* y = reinterpret_cast<uint16_t*>(data);
+		size_t planeSize = size_t(format.Width) * GetLineCount(format);
+		return {.Y = y, .Cb = y + planeSize, .Cr = y + planeSize + planeSize / 2};
+	}
+
+	virtual void Convert(ChannelFormat const& format, uint8_t const* src, uint8_t* dst) = 0;
+
+	// Converts the buffer of the Input pin into the next buffer of the pool and outputs it, with the field type of the input
+	nosResult Run(nosNodeExecuteParams* params, bool toCard)
+	{
+		nosResourceShareInfo input{};
+		for (size_t i = 0; i < params->PinCount; ++i)
+			if (params->Pins[i].Name == NOS_NAME("Input"))
+				input = nos::vkss::ConvertToResourceInfo(*nos::InterpretPinValue<nos::sys::vulkan::Buffer>(*params->Pins[i].Data));
+		{
+			// Format is updated if the channel was reopened or reconfigured
+			auto channel = Handle.Acquire();
+			if (!channel)
+				return NOS_RESULT_FAILED;
+		}
+		auto& format = Handle.Format;
+		uint64_t cardSize = format.FieldMode ? format.FieldBufferSize : format.BufferSize;
+		uint64_t hostSize = GetHostSize(format);
+		if (!hostSize)
+		{
+			nosEngine.LogE("Convert: No CPU conversion for %s", bfcUtilsGetStringForMemoryFormat(format.MemoryFormat));
+			return NOS_RESULT_FAILED;
+		}
+		uint64_t srcSize = toCard ? hostSize : cardSize, dstSize = toCard ? cardSize : hostSize;
+		if (input.Info.Buffer.Size < srcSize)
+		{
+			nosEngine.LogE("Convert: Input buffer has %llu bytes, %llu needed", (unsigned long long)input.Info.Buffer.Size, (unsigned long long)srcSize);
+			return NOS_RESULT_FAILED;
+		}
+		auto inputLease = DMABufferPool::Acquire(input);
+		auto* src = Buffers.Get(input);
+		if (!src || !Outputs.Configure(dstSize, BufferCount, DMABufferPool::PageSize))
+			return NOS_RESULT_FAILED;
+		auto* next = Outputs.Next();
+		if (!next)
+			return NOS_RESULT_FAILED;
+		auto output = *next;
+		Convert(format, src, DMABufferPool::Find(output));
+		output.Info.Buffer.FieldType = input.Info.Buffer.FieldType;
+		nosEngine.SetPinValue(PinName2Id[NOS_NAME("Output")], nos::Buffer::From(nos::vkss::ConvertBufferInfo(output)));
+		return NOS_RESULT_SUCCESS;
+	}
+};
+
+struct UnpackFrameNodeContext : ConvertNodeBase
+{
+	using ConvertNodeBase::ConvertNodeBase;
+
+	void Convert(ChannelFormat const& format, uint8_t const* src, uint8_t* dst) override
+	{
+		if (format.MemoryFormat == MEM_FMT_2VUY)
+			return color::YUV8ToRGBA8(src, format.BytesPerLine, format.Width, GetLineCount(format), dst, format.Width * 4, Matrix, Range);
+		v210::Unpack(src, format.BytesPerLine, format.Width, GetLineCount(format), GetPlanes(dst, format));
+	}
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		return Run(params, false);
+	}
+};
+
+struct PackFrameNodeContext : ConvertNodeBase
+{
+	using ConvertNodeBase::ConvertNodeBase;
+
+	void Convert(ChannelFormat const& format, uint8_t const* src, uint8_t* dst) override
+	{
+		if (format.MemoryFormat == MEM_FMT_2VUY)
+			return color::RGBA8ToYUV8(src, format.Width * 4, format.Width, GetLineCount(format), dst, format.BytesPerLine, Matrix, Range);
+		v210::Pack(GetPlanes(const_cast<uint8_t*>(src), format), format.Width, GetLineCount(format), dst, format.BytesPerLine);
+	}
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		return Run(params, true);
+	}
+};
+
+nosResult RegisterUnpackFrameNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("UnpackFrame"), UnpackFrameNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+
+nosResult RegisterPackFrameNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("PackFrame"), PackFrameNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+}
@@ -0,0 +1,136 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "DMABufferCache.hpp"
+#include "DMABufferPool.hpp"
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+DMABufferCache::~DMABufferCache()
+{
+	Clear();
+}
+
+uint8_t* DMABufferCache::Get(nosResourceShareInfo& buffer)
+{
+	++Generation;
+	if (Generation % MaxIdleGenerations == 0)
+		EvictIdle();
+
+	// Buffers of pools are looked up on every use instead of cached: Their memory is freed when the pool is reconfigured,
+	// and stays valid only while a lease is held on them (see DMABufferPool::Acquire).
+	auto* pooled = DMABufferPool::Find(buffer);
+	if (!pooled && DMABufferPool::IsFreed(buffer))
+		return nullptr;
+	auto* data = pooled ? pooled : nosVulkan->Map(&buffer);
+	if (!data)
+		return nullptr;
+
+	Key key{buffer.Memory.Handle, buffer.Memory.Offset};
+	auto it = Entries.find(key);
+	if (it != Entries.end())
+	{
+		if (!pooled && it->second.Data == data && it->second.Size == buffer.Info.Buffer.Size)
+		{
+			it->second.LastUsedGeneration = Generation;
+			return data;
+		}
+		// Pages of a released buffer were unlocked when it was freed, and its address range may belong to another one now.
+		// Pages of a pool buffer are locked by the pool.
+		if (it->second.Data == data && !pooled)
+			Unlock(it->second);
+		Entries.erase(it);
+	}
+	if (pooled)
+		return data;
+
+	Entry entry{.Data = data, .Size = buffer.Info.Buffer.Size, .LastUsedGeneration = Generation};
+	if ((uintptr_t)entry.Data % DMABufferPool::MinAlignment != 0 && !AlignmentWarningReported)
+	{
+		AlignmentWarningReported = true;
+		nosEngine.LogW("DMA buffer is not aligned to %d bytes, transfers may take a slower path. Use buffers of a BF DMA Buffer Pool node.", int(DMABufferPool::MinAlignment));
+	}
+	if (!Lock(entry) && !LockFailureReported)
+	{
+		LockFailureReported = true;
+		nosEngine.LogW("Unable to lock DMA buffer pages in memory, driver will lock them on every transfer");
+	}
+	Entries[key] = entry;
+	return entry.Data;
+}
+
+void DMABufferCache::Clear()
+{
+	for (auto& [key, entry] : Entries)
+		Unlock(entry);
+	Entries.clear();
+}
+
+void DMABufferCache::EvictIdle()
+{
+	for (auto it = Entries.begin(); it != Entries.end();)
+	{
+		if (Generation - it->second.LastUsedGeneration < MaxIdleGenerations)
+		{
+			++it;
+			continue;
+		}
+		Unlock(it->second);
+		it = Entries.erase(it);
+	}
+}
+
+bool DMABufferCache::Lock(Entry& entry)
+{
+	entry.Locked = LockPages(entry.Data, entry.Size);
+	return entry.Locked;
+}
+
+void DMABufferCache::Unlock(Entry& entry)
+{
+	if (!entry.Locked)
+		return;
+	UnlockPages(entry.Data, entry.Size);
+	entry.Locked = false;
+}
+
+bool LockPages(void* data, uint64_t size)
+{
+#if _WIN32
+	bool locked = VirtualLock(data, size);
+	if (!locked && GetLastError() == ERROR_WORKING_SET_QUOTA)
+	{
+		// Grow the working set by the buffer size and retry
+		SIZE_T minSize, maxSize;
+		auto process = GetCurrentProcess();
+		if (GetProcessWorkingSetSize(process, &minSize, &maxSize) &&
+			SetProcessWorkingSetSize(process, minSize + size, maxSize + size))
+			locked = VirtualLock(data, size);
+	}
+	return locked;
+#else
+	return mlock(data, size) == 0;
+#endif
+}
+
+void UnlockPages(void* data, uint64_t size)
+{
+#if _WIN32
+	VirtualUnlock(data, size);
+#else
+	munlock(data, size);
+#endif
+}
+
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <nosVulkanSubsystem/nosVulkanSubsystem.h>
+
+// stl
+#include <cstdint>
+#include <unordered_map>
+
+namespace bf
+{
+
+// Locks/unlocks the pages of host memory transferred by DMA, so that the driver does not lock them on every transfer.
+// LockPages grows the working set of the process if needed.
+bool LockPages(void* data, uint64_t size);
+void UnlockPages(void* data, uint64_t size);
+
+// Host mappings of the Vulkan buffers a DMA node transfers from/to.
+// Each buffer is mapped and its pages are locked in memory once, on first use, instead of on every transfer.
+// Buffers of DMA buffer pools are already mapped and locked by their pool, and are only looked up, on every use.
+// Entries are keyed by memory handle and offset. A new buffer can reuse the handle and offset of a released one, so a hit
+// is only trusted if the buffer still maps to the cached address; Map returns the persistent mapping of a buffer and is
+// cheap to repeat. The cache generation advances on every lookup; entries that are not used for MaxIdleGenerations are
+// considered released by their owner (e.g. a resized ring) and are evicted.
+// Not thread-safe: Owned by a single DMA node.
+class DMABufferCache
+{
+public:
+	static constexpr uint64_t MaxIdleGenerations = 240;
+
+	DMABufferCache() = default;
+	DMABufferCache(DMABufferCache const&) = delete;
+	~DMABufferCache();
+
+	// Returns nullptr if the buffer cannot be mapped.
+	uint8_t* Get(nosResourceShareInfo& buffer);
+	void Clear();
+
+private:
+	struct Key
+	{
+		uint64_t Handle;
+		uint64_t Offset;
+		bool operator==(Key const& other) const { return Handle == other.Handle && Offset == other.Offset; }
+	};
+	struct KeyHash
+	{
+		size_t operator()(Key const& key) const { return std::hash<uint64_t>()(key.Handle) ^ (std::hash<uint64_t>()(key.Offset) << 1); }
+	};
+	struct Entry
+	{
+		uint8_t* Data = nullptr;
+		uint64_t Size = 0; // A buffer reallocated with the handle of a released one is remapped if its size differs
+		uint64_t LastUsedGeneration = 0;
+		bool Locked = false;
+	};
+
+	static bool Lock(Entry& entry);
+	static void Unlock(Entry& entry);
+	void EvictIdle();
+
+	std::unordered_map<Key, Entry, KeyHash> Entries;
+	uint64_t Generation = 0;
+	bool LockFailureReported = false;
+	bool AlignmentWarningReported = false;
+};
+
+}
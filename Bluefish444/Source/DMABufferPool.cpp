@@ -0,0 +1,219 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "DMABufferPool.hpp"
+#include "DMABufferCache.hpp"
+
+// stl
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+DMABufferPool::Lease& DMABufferPool::Lease::operator=(Lease&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		Entry = std::move(other.Entry);
+	}
+	return *this;
+}
+
+DMABufferPool::Lease::~Lease()
+{
+	Release();
+}
+
+void DMABufferPool::Lease::Release()
+{
+	if (!Entry)
+		return;
+	{
+		std::unique_lock lock(RegistryMutex);
+		--Entry->Leases;
+	}
+	LeaseReleased.notify_all();
+	Entry = nullptr;
+}
+
+nosGPUEvent* DMABufferPool::Lease::GetEvent() const
+{
+	return Entry ? &Entry->Event : nullptr;
+}
+
+DMABufferPool::~DMABufferPool()
+{
+	Clear();
+}
+
+bool DMABufferPool::Configure(uint64_t size, uint32_t count, uint64_t alignment)
+{
+	alignment = std::bit_ceil(std::max(alignment, MinAlignment));
+	if (size == Size && alignment == Alignment && count == Buffers.size())
+		return true;
+	Clear();
+	Buffers.resize(count);
+	for (auto& buffer : Buffers)
+	{
+		// Retried with room to align the mapping if the driver ignores the alignment of the allocation
+		if (!Create(buffer, size, alignment, false) && !Create(buffer, size, alignment, true))
+		{
+			nosEngine.LogE("Bluefish444: Cannot create %llu byte DMA buffers aligned to %llu bytes", (unsigned long long)size, (unsigned long long)alignment);
+			Clear();
+			return false;
+		}
+	}
+	Size = size;
+	Alignment = alignment;
+	return true;
+}
+
+nosResourceShareInfo const* DMABufferPool::Next()
+{
+	if (Buffers.empty())
+		return nullptr;
+	std::unique_lock lock(RegistryMutex);
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (true)
+	{
+		for (size_t i = 0; i < Buffers.size(); ++i)
+		{
+			auto index = (NextIndex + i) % Buffers.size();
+			if (Buffers[index].Entry->Leases)
+				continue;
+			NextIndex = uint32_t(index + 1);
+			return &Buffers[index].Range;
+		}
+		// Transfers of all buffers are running
+		if (LeaseReleased.wait_until(lock, deadline) == std::cv_status::timeout)
+		{
+			nosEngine.LogW("Bluefish444: All %zu DMA buffers of a pool are in use", Buffers.size());
+			return nullptr;
+		}
+	}
+}
+
+nosGPUEvent* DMABufferPool::GetEvent(nosResourceShareInfo const* buffer)
+{
+	for (auto& candidate : Buffers)
+		if (&candidate.Range == buffer && candidate.Entry)
+			return &candidate.Entry->Event;
+	return nullptr;
+}
+
+void DMABufferPool::Clear()
+{
+	if (Buffers.empty())
+		return;
+	{
+		// Buffers are unregistered first, so that no new lease is taken, then running transfers are waited for
+		std::unique_lock lock(RegistryMutex);
+		for (auto& buffer : Buffers)
+		{
+			if (!buffer.Data)
+				continue;
+			Key key{buffer.Range.Memory.Handle, buffer.Range.Memory.Offset};
+			Registry.erase(key);
+			FreedKeys.push_back(key);
+			if (FreedKeys.size() > MaxFreedKeys)
+				FreedKeys.pop_front();
+		}
+		LeaseReleased.wait(lock, [this] {
+			return std::all_of(Buffers.begin(), Buffers.end(), [](auto& buffer) { return !buffer.Entry || !buffer.Entry->Leases; });
+		});
+	}
+	// GPU work queued by nodes the buffers were passed to, e.g. copies of the frames read into them
+	nosGPUEvent event = 0;
+	nosCmd cmd;
+	nosVulkan->Begin("Bluefish DMA Buffer Pool Release", &cmd);
+	nosCmdEndParams end{.ForceSubmit = NOS_TRUE, .OutGPUEventHandle = &event};
+	nosVulkan->End(cmd, &end);
+	if (event)
+		nosVulkan->WaitGpuEvent(&event, UINT64_MAX);
+	for (auto& buffer : Buffers)
+		Destroy(buffer);
+	Buffers.clear();
+	Size = 0;
+	Alignment = 0;
+	NextIndex = 0;
+}
+
+uint8_t* DMABufferPool::Find(nosResourceShareInfo const& buffer)
+{
+	std::unique_lock lock(RegistryMutex);
+	auto it = Registry.find({buffer.Memory.Handle, buffer.Memory.Offset});
+	return it != Registry.end() ? it->second->Data : nullptr;
+}
+
+DMABufferPool::Lease DMABufferPool::Acquire(nosResourceShareInfo const& buffer)
+{
+	Lease lease;
+	std::unique_lock lock(RegistryMutex);
+	auto it = Registry.find({buffer.Memory.Handle, buffer.Memory.Offset});
+	if (it == Registry.end())
+		return lease;
+	++it->second->Leases;
+	lease.Entry = it->second;
+	return lease;
+}
+
+bool DMABufferPool::IsFreed(nosResourceShareInfo const& buffer)
+{
+	std::unique_lock lock(RegistryMutex);
+	return std::find(FreedKeys.begin(), FreedKeys.end(), Key{buffer.Memory.Handle, buffer.Memory.Offset}) != FreedKeys.end();
+}
+
+bool DMABufferPool::Create(Buffer& buffer, uint64_t size, uint64_t alignment, bool padded)
+{
+	auto& allocation = buffer.Allocation;
+	allocation = {};
+	allocation.Info.Type = NOS_RESOURCE_TYPE_BUFFER;
+	allocation.Info.Buffer.Size = padded ? size + alignment : size;
+	allocation.Info.Buffer.Alignment = uint32_t(std::min<uint64_t>(alignment, UINT32_MAX));
+	allocation.Info.Buffer.Usage = nosBufferUsage(NOS_BUFFER_USAGE_TRANSFER_SRC | NOS_BUFFER_USAGE_TRANSFER_DST);
+	allocation.Info.Buffer.MemoryFlags = nosMemoryFlags(NOS_MEMORY_FLAGS_HOST_VISIBLE | NOS_MEMORY_FLAGS_DOWNLOAD);
+#if _WIN32
+	allocation.Memory.ExternalMemory.HandleType = NOS_EXTERNAL_MEMORY_HANDLE_TYPE_WIN32;
+#endif
+	if (nosVulkan->CreateResource(&allocation) != NOS_RESULT_SUCCESS)
+		return false;
+	auto* mapped = nosVulkan->Map(&allocation);
+	auto offset = mapped ? (alignment - uintptr_t(mapped) % alignment) % alignment : 0;
+	if (!mapped || (offset && !padded))
+	{
+		nosVulkan->DestroyResource(&allocation);
+		allocation = {};
+		return false;
+	}
+	buffer.Data = mapped + offset;
+	buffer.Range = allocation;
+	buffer.Range.Memory.Offset += offset;
+	buffer.Range.Info.Buffer.Size = size;
+	buffer.Locked = LockPages(buffer.Data, size);
+	if (!buffer.Locked)
+		nosEngine.LogW("Bluefish444: Unable to lock DMA buffer pages in memory, driver will lock them on every transfer");
+	buffer.Entry = std::make_shared<RegistryEntry>(RegistryEntry{.Data = buffer.Data});
+	Key key{buffer.Range.Memory.Handle, buffer.Range.Memory.Offset};
+	std::unique_lock lock(RegistryMutex);
+	Registry[key] = buffer.Entry;
+	std::erase(FreedKeys, key);
+	return true;
+}
+
+void DMABufferPool::Destroy(Buffer& buffer)
+{
+	if (!buffer.Data)
+		return;
+	if (buffer.Entry && buffer.Entry->Event)
+		nosVulkan->WaitGpuEvent(&buffer.Entry->Event, UINT64_MAX);
+	if (buffer.Locked)
+		UnlockPages(buffer.Data, buffer.Range.Info.Buffer.Size);
+	nosVulkan->DestroyResource(&buffer.Allocation);
+	buffer = {};
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <nosVulkanSubsystem/nosVulkanSubsystem.h>
+
+// stl
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace bf
+{
+
+// Host-visible Vulkan buffers owned by the plugin, for the DMA transfers of a channel. Buffers are created, mapped and
+// their pages locked when the pool is configured, and stay so until it is reconfigured or destroyed. Mapped addresses
+// are aligned as requested, so that transfers never take the slow path of the driver for unaligned buffers.
+// Buffers are exported as external memory, like the buffers of mediaio rings.
+// DMABufferCache finds the buffers of all pools through a process-wide registry, instead of mapping them again.
+// Nodes that transfer or convert a buffer hold a Lease on it meanwhile: A leased buffer is neither handed out again nor
+// freed. Buffers are freed once their leases are released and the GPU work queued until then is done.
+class DMABufferPool
+{
+	struct RegistryEntry;
+
+public:
+	static constexpr uint64_t MinAlignment = 64;
+	static constexpr uint64_t PageSize = 4096;
+
+	// Keeps a buffer of a pool from being handed out again or freed. Empty for other buffers.
+	class Lease
+	{
+	public:
+		Lease() = default;
+		Lease(Lease&& other) noexcept : Entry(std::move(other.Entry)) {}
+		Lease& operator=(Lease&& other) noexcept;
+		~Lease();
+
+		explicit operator bool() const { return Entry != nullptr; }
+		// Event slot of the buffer, which the GPUEvent pin of its pool points to. Null if empty.
+		nosGPUEvent* GetEvent() const;
+
+	private:
+		friend class DMABufferPool;
+		void Release();
+
+		std::shared_ptr<RegistryEntry> Entry;
+	};
+
+	DMABufferPool() = default;
+	DMABufferPool(DMABufferPool const&) = delete;
+	~DMABufferPool();
+
+	// Recreates the buffers if the configuration changed. alignment is rounded up to a power of two, at least MinAlignment.
+	// Returns false if a buffer cannot be created or mapped; the pool is then empty.
+	bool Configure(uint64_t size, uint32_t count, uint64_t alignment);
+	// Buffers are handed out in round-robin order, skipping leased ones. Waits for a lease to be released if all buffers
+	// are leased. Null if the pool is empty, or no buffer was released in time.
+	nosResourceShareInfo const* Next();
+	// Event slot of a buffer handed out by Next(), for the GPU submission that writes the buffer. Null for other buffers.
+	// The slot is freed with the buffer, once the buffer is neither registered nor leased, so consumers of the slot must
+	// reach it through a lease of the buffer (see Lease::GetEvent).
+	nosGPUEvent* GetEvent(nosResourceShareInfo const* buffer);
+	void Clear();
+
+	// Mapped address of a buffer of any pool, or null
+	static uint8_t* Find(nosResourceShareInfo const& buffer);
+	// Leases a buffer of any pool. Empty if the buffer is not in a pool.
+	static Lease Acquire(nosResourceShareInfo const& buffer);
+	// Whether the buffer belonged to a pool and was freed: It must not be mapped, as its memory is released.
+	static bool IsFreed(nosResourceShareInfo const& buffer);
+
+private:
+	struct RegistryEntry
+	{
+		uint8_t* Data = nullptr;
+		uint32_t Leases = 0; // Guarded by RegistryMutex
+		nosGPUEvent Event = 0;
+	};
+
+	struct Buffer
+	{
+		nosResourceShareInfo Allocation{}; // Created resource, larger than Range by the alignment if its mapping was unaligned
+		nosResourceShareInfo Range{}; // Aligned range handed out
+		uint8_t* Data = nullptr;
+		bool Locked = false;
+		std::shared_ptr<RegistryEntry> Entry; // Also holds the event slot, which must outlive the Buffers vector
+	};
+
+	bool Create(Buffer& buffer, uint64_t size, uint64_t alignment, bool padded);
+	void Destroy(Buffer& buffer);
+
+	std::vector<Buffer> Buffers;
+	uint64_t Size = 0;
+	uint64_t Alignment = 0;
+	uint32_t NextIndex = 0;
+
+	using Key = std::pair<uint64_t, uint64_t>; // Memory handle and offset
+	static constexpr size_t MaxFreedKeys = 256;
+	inline static std::mutex RegistryMutex;
+	inline static std::condition_variable LeaseReleased;
+	inline static std::map<Key, std::shared_ptr<RegistryEntry>> Registry;
+	inline static std::deque<Key> FreedKeys; // Of the last freed buffers, until a new buffer reuses the key
+};
+
+}
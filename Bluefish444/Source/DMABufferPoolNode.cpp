@@ -0,0 +1,82 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/Modules.h>
+#include <Nodos/PluginHelpers.hpp>
+#include <nosVulkanSubsystem/nosVulkanSubsystem.h>
+#include <nosVulkanSubsystem/Helpers.hpp>
+
+#include "ChannelHelpers.hpp"
+#include "DMABufferPool.hpp"
+#include "Device.hpp"
+
+namespace bf
+{
+// Provides aligned, persistently mapped buffers sized for the frames (or fields, in field mode) of a channel, to be
+// transferred by DMA Read, DMA Write or DMA Pump. Each execution outputs the next buffer of the pool.
+// If Input is connected, it is copied into the buffer by the GPU, and GPUEvent outputs the event of the copy, so that DMA
+// Write and DMA Pump wait only for the copy instead of all GPU work queued when they run.
+struct DMABufferPoolNodeContext : nos::NodeContext
+{
+	using NodeContext::NodeContext;
+
+	ChannelHandle Handle{};
+	DMABufferPool Pool;
+	uint32_t BufferCount = 4;
+	uint64_t Alignment = DMABufferPool::PageSize;
+
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
+	{
+		if (pinName == NOS_NAME("Channel"))
+			Handle = ResolveChannelHandle(value);
+		else if (pinName == NOS_NAME("BufferCount"))
+			BufferCount = std::max(*nos::InterpretPinValue<uint32_t>(value), 1u);
+		else if (pinName == NOS_NAME("Alignment"))
+			Alignment = *nos::InterpretPinValue<uint32_t>(value);
+	}
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		nosResourceShareInfo input{};
+		for (size_t i = 0; i < params->PinCount; ++i)
+			if (params->Pins[i].Name == NOS_NAME("Input"))
+				input = nos::vkss::ConvertToResourceInfo(*nos::InterpretPinValue<nos::sys::vulkan::Buffer>(*params->Pins[i].Data));
+		{
+			// Format is updated if the channel was reopened
+			auto channel = Handle.Acquire();
+			if (!channel)
+				return NOS_RESULT_FAILED;
+		}
+		auto& format = Handle.Format;
+		if (!Pool.Configure(format.FieldMode ? format.FieldBufferSize : format.BufferSize, BufferCount, Alignment))
+			return NOS_RESULT_FAILED;
+		auto* buffer = Pool.Next();
+		if (!buffer)
+			return NOS_RESULT_FAILED;
+		auto output = *buffer;
+		if (input.Memory.Handle)
+		{
+			if (input.Info.Buffer.Size < output.Info.Buffer.Size)
+			{
+				nosEngine.LogE("Bluefish444: DMA buffer pool input has %llu bytes, %llu needed", (unsigned long long)input.Info.Buffer.Size, (unsigned long long)output.Info.Buffer.Size);
+				return NOS_RESULT_FAILED;
+			}
+			auto* event = Pool.GetEvent(buffer);
+			nosCmd cmd;
+			nosVulkan->Begin("Bluefish DMA Buffer Copy", &cmd);
+			nosVulkan->Copy(cmd, &input, &output, nullptr);
+			nosCmdEndParams end{.ForceSubmit = NOS_TRUE, .OutGPUEventHandle = event};
+			nosVulkan->End(cmd, &end);
+			output.Info.Buffer.FieldType = input.Info.Buffer.FieldType;
+			nosEngine.SetPinValue(PinName2Id[NOS_NAME("GPUEvent")], nos::Buffer::From(nos::sys::vulkan::GPUEventResource(uint64_t(event))));
+		}
+		nosEngine.SetPinValue(PinName2Id[NOS_NAME("Output")], nos::Buffer::From(nos::vkss::ConvertBufferInfo(output)));
+		return NOS_RESULT_SUCCESS;
+	}
+};
+
+nosResult RegisterDMABufferPoolNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("DMABufferPool"), DMABufferPoolNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+}
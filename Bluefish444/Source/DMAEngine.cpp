@@ -0,0 +1,228 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "DMAEngine.hpp"
+
+// stl
+#include <algorithm>
+#include <chrono>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+#if !_WIN32
+void DMACompletion::Reset()
+{
+	std::unique_lock lock(Mutex);
+	Complete = false;
+	Failed = false;
+}
+
+void DMACompletion::Signal(bool failed)
+{
+	// Notified under the lock, as the engine may be destroyed as soon as a waiter sees the transfer complete
+	std::unique_lock lock(Mutex);
+	Complete = true;
+	Failed = failed;
+	CV.notify_all();
+}
+
+bool DMACompletion::Wait(uint32_t timeoutMs)
+{
+	std::unique_lock lock(Mutex);
+	if (timeoutMs == DMAEngine::Infinite)
+		CV.wait(lock, [this] { return Complete; });
+	else if (timeoutMs)
+		CV.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return Complete; });
+	return Complete;
+}
+#endif
+
+DMAEngine::DMAEngine(BLUEVELVETC_HANDLE sdk, uint32_t maxInFlight) : Sdk(sdk), MaxInFlight(std::clamp(maxInFlight, 1u, MaxSlots))
+{
+#if _WIN32
+	for (auto& slot : Slots)
+		slot.Event = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+#endif
+}
+
+DMAEngine::~DMAEngine()
+{
+	WaitAll();
+#if _WIN32
+	for (auto& slot : Slots)
+		CloseHandle(slot.Event);
+#endif
+}
+
+void DMAEngine::SetMaxInFlight(uint32_t maxInFlight)
+{
+	MaxInFlight = std::clamp(maxInFlight, 1u, MaxSlots);
+}
+
+std::optional<DMAEngine::Ticket> DMAEngine::Submit(DMATransfer transfer)
+{
+	std::unique_lock lock(Mutex);
+	while (InFlight >= MaxInFlight)
+		ReapOldest(lock, Infinite);
+	return SubmitLocked(transfer, false);
+}
+
+std::optional<DMAEngine::Ticket> DMAEngine::SubmitJoined(std::vector<DMATransfer> parts)
+{
+	if (parts.empty() || parts.size() > MaxSlots)
+		return std::nullopt;
+	std::unique_lock lock(Mutex);
+	uint32_t maxInFlight = std::max<uint32_t>(MaxInFlight, uint32_t(parts.size()));
+	while (InFlight && InFlight + parts.size() > maxInFlight)
+		ReapOldest(lock, Infinite);
+	std::optional<Ticket> ticket;
+	for (size_t i = 0; i < parts.size(); ++i)
+	{
+		if (i + 1 < parts.size())
+			parts[i].OnComplete = nullptr;
+		ticket = SubmitLocked(parts[i], i + 1 < parts.size());
+		if (!ticket)
+		{
+			if (i)
+			{
+				// Parts already queued complete as a failed transfer, and must be done with the memory before returning
+				auto& last = Slots[(Oldest + InFlight - 1) % MaxSlots];
+				last.JoinWithNext = false;
+				last.Failed = true;
+				auto lastQueued = LastSubmitted;
+				while (LastReaped < lastQueued && InFlight)
+					ReapOldest(lock, Infinite);
+			}
+			return std::nullopt;
+		}
+	}
+	return ticket;
+}
+
+std::optional<DMAEngine::Ticket> DMAEngine::SubmitLocked(DMATransfer& transfer, bool joinWithNext)
+{
+	auto& slot = Slots[(Oldest + InFlight) % MaxSlots];
+#if _WIN32
+	slot.Overlapped = {};
+	slot.Overlapped.hEvent = slot.Event;
+	ResetEvent(slot.Event);
+	auto* overlapped = &slot.Overlapped;
+#else
+	slot.Completion.Reset();
+	DMACompletion::Argument overlapped{&slot.Completion};
+#endif
+	auto ret = transfer.Direction == DMADirection::HostToCard
+		           ? bfcDmaWriteToCardAsync(Sdk, transfer.HostBuffer, transfer.Size, overlapped, transfer.CardBuffer, transfer.Offset)
+		           : bfcDmaReadFromCardAsync(Sdk, transfer.HostBuffer, transfer.Size, overlapped, transfer.CardBuffer, transfer.Offset);
+	if (ret < 0)
+	{
+		nosEngine.LogE("DMA %s returned with '%s'", transfer.Direction == DMADirection::HostToCard ? "Write" : "Read", bfcUtilsGetStringForBErr(ret));
+		return std::nullopt;
+	}
+	slot.Id = ++LastSubmitted;
+	slot.Failed = false;
+	slot.JoinWithNext = joinWithNext;
+	slot.Transfer = std::move(transfer);
+	++InFlight;
+	return slot.Id;
+}
+
+uint32_t DMAEngine::Poll()
+{
+	std::unique_lock lock(Mutex);
+	while (InFlight && ReapOldest(lock, 0))
+		;
+	return InFlight;
+}
+
+bool DMAEngine::Wait(Ticket ticket)
+{
+	std::unique_lock lock(Mutex);
+	while (LastReaped < ticket && InFlight)
+		ReapOldest(lock, Infinite);
+	auto& result = Results[ticket % ResultHistory];
+	return ticket <= LastReaped && result.Id == ticket && !result.Failed;
+}
+
+std::optional<bool> DMAEngine::WaitFor(Ticket ticket, uint32_t timeoutMs)
+{
+	std::unique_lock lock(Mutex);
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	while (LastReaped < ticket && InFlight)
+	{
+		auto now = std::chrono::steady_clock::now();
+		auto remaining = uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::max(deadline - now, std::chrono::steady_clock::duration::zero())).count());
+		if (!ReapOldest(lock, remaining) && std::chrono::steady_clock::now() >= deadline)
+			return std::nullopt;
+	}
+	auto& result = Results[ticket % ResultHistory];
+	return ticket <= LastReaped && result.Id == ticket && !result.Failed;
+}
+
+void DMAEngine::WaitAll()
+{
+	std::unique_lock lock(Mutex);
+	while (InFlight)
+		ReapOldest(lock, Infinite);
+}
+
+bool DMAEngine::WaitSlot(Slot& slot, uint32_t timeoutMs)
+{
+#if _WIN32
+	return WaitForSingleObject(slot.Event, timeoutMs == Infinite ? INFINITE : timeoutMs) == WAIT_OBJECT_0;
+#else
+	return slot.Completion.Wait(timeoutMs);
+#endif
+}
+
+bool DMAEngine::ReapOldest(std::unique_lock<std::mutex>& lock, uint32_t timeoutMs)
+{
+	if (Reaping)
+	{
+		if (timeoutMs == Infinite)
+			Reaped.wait(lock);
+		else if (timeoutMs)
+			Reaped.wait_for(lock, std::chrono::milliseconds(timeoutMs));
+		return false;
+	}
+	// Submit never reuses the oldest slot while it is in flight, so it can be waited for without the lock
+	auto& slot = Slots[Oldest];
+	Reaping = true;
+	lock.unlock();
+	bool complete = WaitSlot(slot, timeoutMs);
+	lock.lock();
+	Reaping = false;
+	if (!complete)
+	{
+		Reaped.notify_all();
+		return false;
+	}
+#if _WIN32
+	slot.Failed = slot.Failed || slot.Overlapped.Internal != 0; // NTSTATUS of the transfer
+#else
+	slot.Failed = slot.Failed || slot.Completion.HasFailed();
+#endif
+	if (slot.JoinWithNext)
+	{
+		JoinedPartFailed = JoinedPartFailed || slot.Failed;
+		slot.Failed = false;
+	}
+	else
+	{
+		slot.Failed = slot.Failed || JoinedPartFailed;
+		JoinedPartFailed = false;
+	}
+	Results[slot.Id % ResultHistory] = {.Id = slot.Id, .Failed = slot.Failed};
+	LastReaped = slot.Id;
+	Oldest = (Oldest + 1) % MaxSlots;
+	--InFlight;
+	auto transfer = std::move(slot.Transfer);
+	if (transfer.OnComplete)
+		transfer.OnComplete(!slot.Failed);
+	Reaped.notify_all();
+	return true;
+}
+
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+
+#define LOAD_FUNC_PTR_V6_5_3
+#include <BlueVelvetCFuncPtr.h>
+
+// stl
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace bf
+{
+
+enum class DMADirection
+{
+	HostToCard,
+	CardToHost,
+};
+
+struct DMATransfer
+{
+	DMADirection Direction = DMADirection::HostToCard;
+	uint8_t* HostBuffer = nullptr; // Must stay valid until the transfer is complete
+	uint32_t Size = 0;
+	BLUE_U32 CardBuffer = 0; // e.g. BlueImage_DMABuffer(...)
+	uint32_t Offset = 0;
+	// Called from the thread that reaps the transfer (Poll/Wait/WaitAll/Submit), in submission order.
+	std::function<void(bool success)> OnComplete;
+};
+
+#if !_WIN32
+// Completion of a transfer on platforms without overlapped I/O. Builds for these platforms only run on simulated devices
+// (BLUEFISH444_SIMULATOR_ONLY), and the simulator receives this in place of the OVERLAPPED argument of the SDK.
+class DMACompletion
+{
+public:
+	// Converts to the pointer type the SDK declares for the OVERLAPPED argument
+	struct Argument
+	{
+		DMACompletion* Completion;
+		template <typename T>
+		operator T*() const { return reinterpret_cast<T*>(Completion); }
+	};
+
+	void Reset();
+	void Signal(bool failed);
+	// Returns false if the transfer has not completed within timeoutMs (DMAEngine::Infinite: blocks)
+	bool Wait(uint32_t timeoutMs);
+	bool HasFailed() const { return Failed; }
+
+private:
+	std::mutex Mutex;
+	std::condition_variable CV;
+	bool Complete = false;
+	bool Failed = false;
+};
+#endif
+
+// Completion-based DMA queue of an SDK instance.
+// Submit queues an overlapped transfer and returns a ticket without waiting for it; completions are reaped later.
+class DMAEngine
+{
+public:
+	using Ticket = uint64_t;
+	static constexpr uint32_t MaxSlots = 8;
+	static constexpr uint32_t DefaultMaxInFlight = 2;
+	// Results of this many reaped transfers are kept for Wait
+	static constexpr uint32_t ResultHistory = MaxSlots * 4;
+	static constexpr uint32_t Infinite = UINT32_MAX; // Timeout of blocking waits
+
+	explicit DMAEngine(BLUEVELVETC_HANDLE sdk, uint32_t maxInFlight = DefaultMaxInFlight);
+	~DMAEngine();
+
+	DMAEngine(DMAEngine const&) = delete;
+
+	// Clamped to [1, MaxSlots]. Takes effect on the next Submit.
+	void SetMaxInFlight(uint32_t maxInFlight);
+	uint32_t GetMaxInFlight() const { return MaxInFlight; }
+	uint32_t GetInFlightCount() const { return InFlight; }
+
+	// Blocks only if MaxInFlight transfers are already pending, until the oldest one completes.
+	// Returns nullopt if the SDK rejects the transfer.
+	std::optional<Ticket> Submit(DMATransfer transfer);
+	// Queues the parts of one transfer together so that they run concurrently (e.g. one part per link of a channel group),
+	// even if that exceeds MaxInFlight. The returned ticket is of the last part and fails if any part fails.
+	// Only the OnComplete of the last part is called, with the joined result. If the SDK rejects a part, the parts already
+	// queued are waited for before returning nullopt, so that the caller can release the memory.
+	std::optional<Ticket> SubmitJoined(std::vector<DMATransfer> parts);
+	// Reaps completed transfers without blocking. Returns the number of transfers still in flight.
+	uint32_t Poll();
+	// Blocks until the transfer (and everything submitted before it) completes. Returns false if it failed, or if its
+	// result is no longer known because ResultHistory transfers were reaped since.
+	// Concurrent waits are allowed: One thread blocks on the oldest transfer, without holding the queue lock.
+	bool Wait(Ticket ticket);
+	// Waits up to timeoutMs (0: reaps completed transfers without blocking). Returns the result of the transfer as Wait
+	// does, or nullopt if it is still running.
+	std::optional<bool> WaitFor(Ticket ticket, uint32_t timeoutMs);
+	void WaitAll();
+
+private:
+	struct Slot
+	{
+#if _WIN32
+		OVERLAPPED Overlapped{};
+		HANDLE Event = nullptr;
+#else
+		DMACompletion Completion;
+#endif
+		Ticket Id = 0;
+		bool Failed = false;
+		bool JoinWithNext = false;
+		DMATransfer Transfer;
+	};
+
+	struct Result
+	{
+		Ticket Id = 0;
+		bool Failed = false;
+	};
+
+	// Requires Mutex
+	std::optional<Ticket> SubmitLocked(DMATransfer& transfer, bool joinWithNext);
+	// Requires Mutex, which is released while blocking. Returns false if no transfer was reaped: If the oldest transfer
+	// did not complete within timeoutMs, or if another thread reaped while this one waited for it.
+	bool ReapOldest(std::unique_lock<std::mutex>& lock, uint32_t timeoutMs);
+	// Waits for the transfer of the slot. Does not touch the slot otherwise, as it is called without Mutex.
+	static bool WaitSlot(Slot& slot, uint32_t timeoutMs);
+
+	BLUEVELVETC_HANDLE Sdk;
+	std::atomic<uint32_t> MaxInFlight;
+	std::atomic<uint32_t> InFlight = 0;
+
+	std::mutex Mutex;
+	std::condition_variable Reaped;
+	std::array<Slot, MaxSlots> Slots;
+	std::array<Result, ResultHistory> Results; // Indexed by ticket
+	uint32_t Oldest = 0;
+	Ticket LastSubmitted = 0;
+	Ticket LastReaped = 0;
+	bool Reaping = false; // A thread waits for the oldest slot
+	bool JoinedPartFailed = false;
+};
+
+}
@@ -0,0 +1,254 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "DMANodeBase.hpp"
+
+#include <Nodos/Modules.h>
+#include <nosVulkanSubsystem/Helpers.hpp>
+
+// stl
+#include <algorithm>
+#include <utility>
+
+namespace bf
+{
+
+bool DMANodeBase::UpdateDeltaSeconds(ChannelHandle const& handle)
+{
+	if (DeltaSecondsGeneration == handle.Generation)
+		return false;
+	DeltaSecondsGeneration = handle.Generation;
+	auto& format = handle.Format;
+	nosVec2u deltaSeconds{format.DeltaSeconds[0], format.FieldMode ? format.DeltaSeconds[1] * 2 : format.DeltaSeconds[1]}; // Scheduled per field in field mode
+	if (deltaSeconds.x == DeltaSeconds.x && deltaSeconds.y == DeltaSeconds.y)
+		return false;
+	DeltaSeconds = deltaSeconds;
+	return true;
+}
+
+bool DMANodeBase::ReadFrame(Channel& channel, ChannelFormat const& format, nosResourceShareInfo& outputBuffer)
+{
+	if (!outputBuffer.Memory.Handle)
+		return false;
+	auto lease = DMABufferPool::Acquire(outputBuffer);
+	auto buffer = Buffers.Get(outputBuffer);
+	if (!buffer)
+		return false;
+	return ReadFrame(channel, format, buffer, outputBuffer.Info.Buffer.Size, outputBuffer.Info.Buffer.FieldType);
+}
+
+bool DMANodeBase::ReadFrame(Channel& channel, ChannelFormat const& format, uint8_t* buffer, uint64_t size, nosTextureFieldType& fieldType)
+{
+	if (!buffer || size != (format.FieldMode ? format.FieldBufferSize : format.BufferSize))
+		return false;
+
+	auto depth = format.BufferCycleDepth;
+	BufferId %= depth; // Ring may have shrunk if the channel was reopened
+	auto startCaptureBufferId = (BufferId + format.CaptureLead) % depth; // Buffer will be available after CaptureLead VBIs.
+	auto start = TelemetryClock::now();
+	DMAScheduler::Ticket ticket;
+	if (format.FieldMode)
+	{
+		// Frames start on even field counts: After an odd count the first field of the buffer is complete,
+		// after an even one the second field is, and capture of the next buffer is started.
+		uint32_t field = channel.GetLastFieldCount() & 1 ? 0 : 1;
+		if (field == 1)
+			channel.StartCapture(startCaptureBufferId);
+		ticket = channel.DMAReadField(BufferId, field, buffer, uint32_t(size));
+		if (field == 1)
+			BufferId = (BufferId + 1) % depth;
+		fieldType = GetFieldType(format, field);
+	}
+	else
+	{
+		ticket = channel.DMAReadFrame(startCaptureBufferId, BufferId, buffer, uint32_t(size));
+		BufferId = (BufferId + 1) % depth;
+		fieldType = format.Progressive ? NOS_TEXTURE_FIELD_TYPE_PROGRESSIVE : NOS_TEXTURE_FIELD_TYPE_UNKNOWN;
+	}
+	if (!channel.WaitDMA(ticket))
+		return false;
+	auto& telemetry = channel.GetTelemetry();
+	telemetry.RecordDMA(telemetry.DMARead, TelemetryClock::now() - start);
+	if (LogInterval.IsDue())
+		nosEngine.WatchLog(ReadWatchLogName.c_str(), telemetry.DMARead.GetSnapshot().ToString().c_str());
+	return true;
+}
+
+void DMANodeBase::SkipFrame(Channel& channel, ChannelFormat const& format)
+{
+	auto depth = format.BufferCycleDepth;
+	BufferId %= depth;
+	if (format.FieldMode && channel.GetLastFieldCount() & 1)
+		return; // Only the first field of the buffer is complete
+	channel.StartCapture((BufferId + format.CaptureLead) % depth);
+	BufferId = (BufferId + 1) % depth;
+}
+
+bool DMANodeBase::SetPacingPin(nos::Name pinName, nosBuffer value)
+{
+	if (pinName == NOS_NAME("Pacing"))
+		Pacing = *nos::InterpretPinValue<bool>(value);
+	else if (pinName == NOS_NAME("SafetyMargin"))
+		SafetyMargin = std::chrono::duration_cast<TelemetryClock::duration>(std::chrono::duration<float, std::milli>(std::max(*nos::InterpretPinValue<float>(value), 0.f)));
+	else
+		return false;
+	PacerGeneration = 0;
+	return true;
+}
+
+void DMANodeBase::UpdatePacer(Channel& channel, ChannelHandle const& handle, bool ready)
+{
+	if (!Pacing)
+		return;
+	auto& telemetry = channel.GetTelemetry();
+	if (PacerGeneration != handle.Generation)
+	{
+		Pacer.Reset(telemetry.VBIPeriod, SafetyMargin);
+		PacerGeneration = handle.Generation;
+	}
+	if (ready)
+		Pacer.OnFrameReady(TelemetryClock::now(), telemetry.DMATransfer);
+	else
+		Pacer.OnFrameSkipped();
+}
+
+void DMANodeBase::ScheduleNextFrame(Channel& channel)
+{
+	if (Pacing)
+	{
+		// The VBI dispatcher is started here, as a paced channel may have no VBL waiters
+		std::optional<TelemetryClock::time_point> lastVBI;
+		if (auto* dispatcher = channel.GetVBIDispatcher())
+		{
+			dispatcher->Start();
+			auto latest = dispatcher->GetLatest();
+			if (latest.Sequence && !latest.Failed)
+				lastVBI = latest.Time;
+		}
+		if (PacingLogInterval.IsDue())
+			nosEngine.WatchLog(PacingWatchLogName.c_str(), Pacer.ToString().c_str());
+		auto now = TelemetryClock::now();
+		auto requestTime = Pacer.GetRequestTime(now, lastVBI);
+		if (requestTime > now)
+			return ScheduleNodeAt(NodeId, requestTime);
+	}
+	nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
+	nosEngine.ScheduleNode(&schedule);
+}
+
+bool DMANodeBase::WaitGPU(nosGPUEvent* event, bool poll, ChannelTelemetry& telemetry)
+{
+	auto start = TelemetryClock::now();
+	nosGPUEvent flushEvent = 0;
+	if (!event)
+	{
+		nosCmd cmd;
+		nosVulkan->Begin("Flush Before Bluefish DMA Write", &cmd);
+		nosCmdEndParams end {.ForceSubmit = NOS_TRUE, .OutGPUEventHandle = &flushEvent};
+		nosVulkan->End(cmd, &end);
+		event = &flushEvent;
+		poll = false;
+	}
+	if (!*event)
+		return true; // Submission was already waited for
+	auto res = nosVulkan->WaitGpuEvent(event, poll ? 0 : 10e9);
+	if (poll && res == NOS_RESULT_TIMEOUT)
+	{
+		telemetry.Skipped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	if (res != NOS_RESULT_SUCCESS)
+		nosEngine.LogE("Error when waiting for GPU before Bluefish DMA write");
+	telemetry.GPUFlushWait.Record(TelemetryClock::now() - start);
+	return true;
+}
+
+bool DMANodeBase::WaitGPU(ChannelFormat const& format, nosTextureFieldType fieldType, nosGPUEvent* event, bool poll, ChannelTelemetry& telemetry)
+{
+	if (!format.FieldMode || !poll)
+		return WaitGPU(event, poll, telemetry);
+	if (GetFieldIndex(format, fieldType) == 1u)
+	{
+		if (!std::exchange(SkipSecondField, false))
+			return WaitGPU(event, false, telemetry);
+		telemetry.Skipped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	SkipSecondField = !WaitGPU(event, true, telemetry);
+	return !SkipSecondField;
+}
+
+nosGPUEvent* DMANodeBase::GetGPUEvent(nosBuffer const& value)
+{
+	auto* ref = nos::InterpretPinValue<nos::sys::vulkan::GPUEventResource>(value);
+	return ref ? reinterpret_cast<nosGPUEvent*>(ref->handle()) : nullptr;
+}
+
+nosGPUEvent* DMANodeBase::ResolveGPUEvent(nosGPUEvent* pinEvent, nosResourceShareInfo const& buffer, DMABufferPool::Lease const& lease)
+{
+	if (!pinEvent)
+		return nullptr;
+	if (lease)
+		return lease.GetEvent();
+	return DMABufferPool::IsFreed(buffer) ? nullptr : pinEvent;
+}
+
+bool DMANodeBase::WriteFrame(Channel& channel, ChannelFormat const& format, nosResourceShareInfo& inputBuffer)
+{
+	auto lease = DMABufferPool::Acquire(inputBuffer);
+	auto buffer = Buffers.Get(inputBuffer);
+	if (!buffer)
+		return false;
+	DMAScheduler::Ticket ticket;
+	if (!WriteFrame(channel, format, buffer, inputBuffer.Info.Buffer.Size, inputBuffer.Info.Buffer.FieldType, &ticket))
+		return false;
+	if (!lease)
+		return channel.WaitDMA(ticket);
+	PendingWrites.push_back({std::move(ticket), std::move(lease)});
+	return ReapWrites(MaxTransfersInFlight);
+}
+
+bool DMANodeBase::ReapWrites(size_t maxPending)
+{
+	bool ok = true;
+	// Completed writes are reaped too, so that their buffers return to the pool
+	while (!PendingWrites.empty() && (PendingWrites.size() > maxPending || DMAScheduler::IsDone(PendingWrites.front().Ticket)))
+	{
+		ok &= DMAScheduler::Wait(PendingWrites.front().Ticket);
+		PendingWrites.pop_front();
+	}
+	return ok;
+}
+
+bool DMANodeBase::WriteFrame(Channel& channel, ChannelFormat const& format, uint8_t* buffer, uint64_t size, nosTextureFieldType fieldType, DMAScheduler::Ticket* ticket)
+{
+	if (!buffer || (size != format.BufferSize && !(format.FieldMode && size == format.FieldBufferSize)))
+		return false;
+	DMAScheduler::Ticket queued;
+	bool advance = true;
+	// Frame is scheduled for playback once the transfer completes, before the next VBI wait.
+	BufferId %= format.BufferCycleDepth; // Ring may have shrunk if the channel was reopened
+	if (format.FieldMode && size == format.FieldBufferSize)
+	{
+		// Untagged fields follow the output: The first field of a frame is written after a frame boundary (even field count).
+		auto field = GetFieldIndex(format, fieldType).value_or(channel.GetLastFieldCount() & 1 ? 1 : 0);
+		queued = channel.DMAWriteField(BufferId, field, buffer, uint32_t(size));
+		advance = field == 1;
+	}
+	else
+		queued = channel.DMAWriteFrame(BufferId, buffer, uint32_t(size));
+	// Transfer time is recorded by the channel once the transfer completes
+	auto& telemetry = channel.GetTelemetry();
+	if (LogInterval.IsDue())
+	{
+		nosEngine.WatchLog(WriteWatchLogName.c_str(), telemetry.DMAWrite.GetSnapshot().ToString().c_str());
+		nosEngine.WatchLog(FlushWatchLogName.c_str(), (telemetry.GPUFlushWait.GetSnapshot().ToString() + ", skipped " + std::to_string(telemetry.Skipped.load(std::memory_order_relaxed))).c_str());
+	}
+
+	if (advance)
+		BufferId = (BufferId + 1) % format.BufferCycleDepth;
+	if (ticket)
+		*ticket = std::move(queued);
+	return true;
+}
+
+}
@@ -5,6 +5,13 @@
 #pragma once
 #include <Nodos/PluginHelpers.hpp>
 #include "Device.hpp"
+#include "DMABufferCache.hpp"
+#include "DMABufferPool.hpp"
+#include "NodeTimer.hpp"
+#include "OutputPacer.hpp"
+
+// stl
+#include <deque>
 
 namespace bf
 {
@@ -15,8 +22,119 @@ struct DMANodeBase : nos::NodeContext
 	{
 	}
 
-	static constexpr uint32_t CycledBuffersPerChannel = 4;
+	// Card buffer to transfer next. Cycles through ChannelFormat::BufferCycleDepth buffers.
 	uint32_t BufferId = 0;
+	DMABufferCache Buffers;
+	std::string ReadWatchLogName;
+	std::string WriteWatchLogName;
+	std::string FlushWatchLogName;
+	TelemetryLogInterval LogInterval;
+	// Writes of frames the GPU has not finished are skipped instead of waited for. Needs the GPU event of the frame.
+	bool SkipIncompleteFrames = false;
+	// The first field of the frame was skipped, so its second field is skipped too
+	bool SkipSecondField = false;
+	// Interval of nodes that schedule themselves: A frame, or a field in field mode
+	nosVec2u DeltaSeconds{};
+	uint32_t DeltaSecondsGeneration = 0;
+	// Output pacing of DMA Write and DMA Pump: With Pacing, the next frame is requested at the time the pacer gives
+	bool Pacing = false;
+	TelemetryClock::duration SafetyMargin = std::chrono::milliseconds(1);
+	OutputPacer Pacer;
+	uint32_t PacerGeneration = 0;
+	std::string PacingWatchLogName;
+	TelemetryLogInterval PacingLogInterval;
+	// Writes of pool buffers that are left in flight when the node execution ends, with the lease that keeps their buffer
+	// from being handed out again. At most MaxTransfersInFlight are kept; older ones are reaped by the next write.
+	struct PendingWrite
+	{
+		DMAScheduler::Ticket Ticket;
+		DMABufferPool::Lease Lease;
+	};
+	std::deque<PendingWrite> PendingWrites;
+	uint32_t MaxTransfersInFlight = DMAEngine::DefaultMaxInFlight;
+
+	void SetWatchLogNames(ChannelHandle const& handle)
+	{
+		auto prefix = std::string("Bluefish ") + handle.ChannelName;
+		ReadWatchLogName = prefix + " DMA Read";
+		WriteWatchLogName = prefix + " DMA Write";
+		FlushWatchLogName = prefix + " GPU Flush";
+		PacingWatchLogName = prefix + " Output Pacing";
+	}
+
+	// Sets Pacing or SafetyMargin. Returns false for other pins.
+	bool SetPacingPin(nos::Name pinName, nosBuffer value);
+	// Called for each requested frame once the GPU wait is done. ready is false if the frame is skipped.
+	void UpdatePacer(Channel& channel, ChannelHandle const& handle, bool ready);
+	// Schedules the next run of the node, which requests the next frame: Right away, or with Pacing, at the request time
+	// of the pacer through the node timer, so that the thread executing the node is not blocked until then.
+	void ScheduleNextFrame(Channel& channel);
+
+	// Takes DeltaSeconds from the channel format once per channel generation, as a reopened channel may run another mode.
+	// Returns true if it changed, then the path must be recompiled for the new interval to take effect.
+	bool UpdateDeltaSeconds(ChannelHandle const& handle);
+
+	// Transfers the next card buffer (or field of it) into outputBuffer and waits for the transfer.
+	// Sets the field type of outputBuffer. Shared by DMA Read and DMA Pump.
+	bool ReadFrame(Channel& channel, ChannelFormat const& format, nosResourceShareInfo& outputBuffer);
+	// Same for a host buffer of size bytes, e.g. one that is written to disk (Record)
+	bool ReadFrame(Channel& channel, ChannelFormat const& format, uint8_t* buffer, uint64_t size, nosTextureFieldType& fieldType);
+	// Advances the card buffers like ReadFrame without a transfer, so that capture continues while frames are not read
+	void SkipFrame(Channel& channel, ChannelFormat const& format);
+	// Waits for the GPU submission that wrote a buffer, so that it can be transferred. event is the slot the producer of the
+	// buffer signals, given with the buffer through a GPUEvent pin; without one, all GPU work queued so far is flushed
+	// and waited for. If poll is set and event is given, returns false at once while the submission is still running.
+	bool WaitGPU(nosGPUEvent* event, bool poll, ChannelTelemetry& telemetry);
+	// WaitGPU for a buffer of the given field type. In field mode, fields are skipped in whole frames to keep the field
+	// order: The second field of a skipped first field is skipped too, and the second field of a written one is waited for.
+	bool WaitGPU(ChannelFormat const& format, nosTextureFieldType fieldType, nosGPUEvent* event, bool poll, ChannelTelemetry& telemetry);
+	// Transfers inputBuffer (a frame, or a field in field mode) to the next card buffer. Transfers of pool buffers are left
+	// in flight (see PendingWrites), so that they overlap with the next execution, e.g. its GPU wait; other buffers are
+	// waited for, as they return to their producer (e.g. a buffer ring) once the node execution ends.
+	// Shared by DMA Write and DMA Pump.
+	bool WriteFrame(Channel& channel, ChannelFormat const& format, nosResourceShareInfo& inputBuffer);
+	// Waits for the oldest pending writes until at most maxPending are left, and releases completed ones. Returns false if
+	// any of them failed.
+	bool ReapWrites(size_t maxPending);
+	// Same for a host buffer of size bytes, e.g. a frame of a mapped clip (Play). The buffer must stay valid until the
+	// transfer completes: Until ticket is waited for, or the next VBI wait of the channel returns.
+	bool WriteFrame(Channel& channel, ChannelFormat const& format, uint8_t* buffer, uint64_t size, nosTextureFieldType fieldType, DMAScheduler::Ticket* ticket = nullptr);
+
+	// Event slot from a nos.sys.vulkan.GPUEventResource pin. Null if the pin is not connected. Not dereferenced, as it
+	// may point to a buffer pool slot freed since; see ResolveGPUEvent.
+	static nosGPUEvent* GetGPUEvent(nosBuffer const& value);
+	// Event to wait for before transferring buffer, given the event of the GPUEvent pin and the lease of the buffer.
+	// Pool buffers are waited for through the slot of their lease, which stays valid while leased, rather than the pin
+	// value, which may point to a buffer the pool freed when it was reconfigured. Null, i.e. all GPU work is waited for,
+	// if buffer is such a freed one.
+	static nosGPUEvent* ResolveGPUEvent(nosGPUEvent* pinEvent, nosResourceShareInfo const& buffer, DMABufferPool::Lease const& lease);
+
+	// field: 0 for the first field in time, 1 for the second one
+	static nosTextureFieldType GetFieldType(ChannelFormat const& format, uint32_t field)
+	{
+		return (field == 0) != format.FirstFieldOdd ? NOS_TEXTURE_FIELD_TYPE_EVEN : NOS_TEXTURE_FIELD_TYPE_ODD;
+	}
+
+	static std::optional<uint32_t> GetFieldIndex(ChannelFormat const& format, nosTextureFieldType fieldType)
+	{
+		if (fieldType != NOS_TEXTURE_FIELD_TYPE_EVEN && fieldType != NOS_TEXTURE_FIELD_TYPE_ODD)
+			return std::nullopt;
+		return (fieldType == NOS_TEXTURE_FIELD_TYPE_EVEN) == format.FirstFieldOdd ? 1 : 0;
+	}
+
+	void OnPathStop() override
+	{
+		ReapWrites(0);
+		Buffers.Clear();
+		SkipSecondField = false;
+		CancelScheduledNode(NodeId);
+	}
+
+	~DMANodeBase()
+	{
+		ReapWrites(0);
+		CancelScheduledNode(NodeId);
+	}
 };
 
 }
\ No newline at end of file
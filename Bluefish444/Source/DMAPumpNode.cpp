@@ -0,0 +1,142 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/Modules.h>
+#include <nosVulkanSubsystem/nosVulkanSubsystem.h>
+#include <nosVulkanSubsystem/Helpers.hpp>
+
+#include "DMANodeBase.hpp"
+#include "ChannelHelpers.hpp"
+#include "Device.hpp"
+#include "VBLWaiter.hpp"
+
+namespace bf
+{
+// WaitVBL followed by DMA Read (input channels) or DMA Write (output channels) in one node,
+// so that transfers start right after the interrupt instead of after a node hop.
+struct DMAPumpNodeContext : DMANodeBase
+{
+	DMAPumpNodeContext(const nosFbNode* node) : DMANodeBase(node), Waiter(*this)
+	{
+	}
+
+	nos::Buffer ChannelInfo{};
+	ChannelHandle Handle{};
+	VBLWaiter Waiter;
+
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
+	{
+		if (pinName == NOS_NAME("Channel"))
+		{
+			if (ChannelInfo.Size() == value.Size && memcmp(ChannelInfo.Data(), value.Data, value.Size) == 0)
+				return;
+			ChannelInfo = {};
+			Handle = ResolveChannelHandle(value);
+			Waiter.SetChannel(Handle);
+			if (!Handle)
+				return;
+			ChannelInfo = value;
+			SetWatchLogNames(Handle);
+			UpdateDeltaSeconds(Handle);
+			nosEngine.RecompilePath(NodeId);
+		}
+		else if (pinName == NOS_NAME("BufferToWrite"))
+			nosEngine.SetPinValue(PinName2Id[NOS_NAME("Output")], value);
+		else if (pinName == NOS_NAME("MaxTransfersInFlight"))
+			MaxTransfersInFlight = *nos::InterpretPinValue<uint32_t>(value);
+		else if (pinName == NOS_NAME("SkipIncompleteFrames"))
+			SkipIncompleteFrames = *nos::InterpretPinValue<bool>(value);
+		else
+			SetPacingPin(pinName, value);
+	}
+
+	bool IsInput() const { return IsInputChannel(Handle.VideoChannel); }
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		nosResourceShareInfo inputBuffer{};
+		nosGPUEvent* gpuEvent = nullptr;
+		nosResourceShareInfo outputBuffer{};
+		nosUUID outputBufferId{};
+		for (size_t i = 0; i < params->PinCount; ++i)
+		{
+			auto& pin = params->Pins[i];
+			if (pin.Name == NOS_NAME("Input"))
+				inputBuffer = nos::vkss::ConvertToResourceInfo(*nos::InterpretPinValue<nos::sys::vulkan::Buffer>(*pin.Data));
+			else if (pin.Name == NOS_NAME("GPUEvent"))
+				gpuEvent = GetGPUEvent(*pin.Data);
+			else if (pin.Name == NOS_NAME("Output"))
+			{
+				outputBuffer = nos::vkss::ConvertToResourceInfo(*nos::InterpretPinValue<nos::sys::vulkan::Buffer>(*pin.Data));
+				outputBufferId = pin.Id;
+			}
+		}
+
+		auto channel = Handle.Acquire();
+		if (!channel)
+			return NOS_RESULT_FAILED;
+
+		if (IsInput())
+		{
+			if (!Waiter.Wait(*channel, Handle))
+				return NOS_RESULT_FAILED;
+			if (!ReadFrame(*channel, Handle.Format, outputBuffer))
+				return NOS_RESULT_FAILED;
+			nosEngine.SetPinValue(outputBufferId, nos::Buffer::From(nos::vkss::ConvertBufferInfo(outputBuffer)));
+			return NOS_RESULT_SUCCESS;
+		}
+
+		if (!inputBuffer.Memory.Handle)
+			return NOS_RESULT_FAILED;
+		// A pool buffer is not handed out again while its copy is waited for and it is transferred
+		auto lease = DMABufferPool::Acquire(inputBuffer);
+		gpuEvent = ResolveGPUEvent(gpuEvent, inputBuffer, lease);
+		if (UpdateDeltaSeconds(Handle))
+			nosEngine.RecompilePath(NodeId);
+		channel->SetMaxDMAInFlight(MaxTransfersInFlight);
+		// Waited for before the interrupt, so that only the transfer is left after it. Polled after the interrupt when
+		// skipping, so that the GPU has until the interrupt to finish the frame.
+		bool ready = SkipIncompleteFrames || WaitGPU(gpuEvent, false, channel->GetTelemetry());
+		if (!SkipIncompleteFrames)
+			UpdatePacer(*channel, Handle, ready);
+		if (!Waiter.Wait(*channel, Handle))
+			return NOS_RESULT_FAILED;
+		if (SkipIncompleteFrames)
+		{
+			ready = WaitGPU(Handle.Format, inputBuffer.Info.Buffer.FieldType, gpuEvent, true, channel->GetTelemetry());
+			UpdatePacer(*channel, Handle, ready);
+		}
+		if (ready && !WriteFrame(*channel, Handle.Format, inputBuffer))
+			return NOS_RESULT_FAILED;
+
+		ScheduleNextFrame(*channel);
+		return NOS_RESULT_SUCCESS;
+	}
+
+	void GetScheduleInfo(nosScheduleInfo* out) override
+	{
+		if (IsInput())
+			return DMANodeBase::GetScheduleInfo(out);
+		*out = nosScheduleInfo {
+			.Importance = 1,
+			.DeltaSeconds = DeltaSeconds,
+			.Type = NOS_SCHEDULE_TYPE_ON_DEMAND,
+		};
+	}
+
+	void OnPathStart() override
+	{
+		Waiter.Reset();
+		if (IsInput())
+			return;
+		PacerGeneration = 0;
+		nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
+		nosEngine.ScheduleNode(&schedule);
+	}
+};
+
+nosResult RegisterDMAPumpNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("DMAPump"), DMAPumpNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+}
@@ -0,0 +1,259 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "DMAScheduler.hpp"
+
+// stl
+#include <algorithm>
+
+namespace bf
+{
+
+DMAScheduler::DMAScheduler(uint32_t workerCount) : WorkerCount(std::max(workerCount, 1u)), MaxReapers(std::max(WorkerCount - 1, 1u))
+{
+}
+
+DMAScheduler::~DMAScheduler()
+{
+	Shutdown();
+}
+
+void DMAScheduler::Shutdown()
+{
+	{
+		std::unique_lock lock(Mutex);
+		Stop = true;
+	}
+	JobAvailable.notify_all();
+	for (auto& worker : Workers)
+		worker.join();
+	Workers.clear();
+	// Transfers still running use memory of their submitters, which they may release once the ticket completes
+	auto submitted = std::move(Submitted);
+	for (auto& job : submitted)
+		Reap(job);
+	auto jobs = std::move(Jobs);
+	for (auto& job : jobs)
+		Complete(job, false);
+}
+
+DMAScheduler::Ticket DMAScheduler::Submit(DMAQueue& queue, std::vector<DMATransfer> parts, TelemetryClock::time_point deadline)
+{
+	if (parts.empty())
+		return {};
+	auto done = std::make_shared<Completion>();
+	{
+		std::unique_lock lock(Mutex);
+		JobCompleted.wait(lock, [&] { return Stop || (!queue.Held && queue.Pending < queue.MaxPending); });
+		if (Stop)
+			return {};
+		if (Workers.empty())
+			for (uint32_t i = 0; i < WorkerCount; ++i)
+				Workers.emplace_back([this, placement = Placement] { Run(placement); });
+		++queue.Pending;
+		Jobs.push_back({.Queue = &queue, .Parts = std::move(parts), .Deadline = deadline, .Sequence = ++LastSequence, .Done = done});
+	}
+	JobAvailable.notify_one();
+	return Ticket(std::move(done));
+}
+
+bool DMAScheduler::Wait(Ticket const& ticket)
+{
+	if (!ticket)
+		return false;
+	auto& state = ticket.Done->State;
+	state.wait(0);
+	return state.load() == 1;
+}
+
+void DMAScheduler::WaitAll(DMAQueue& queue)
+{
+	std::unique_lock lock(Mutex);
+	JobCompleted.wait(lock, [&queue] { return queue.Pending == 0; });
+}
+
+void DMAScheduler::Hold(DMAQueue& queue)
+{
+	std::unique_lock lock(Mutex);
+	queue.Held = true;
+	JobCompleted.wait(lock, [&queue] { return queue.Pending == 0; });
+}
+
+void DMAScheduler::Release(DMAQueue& queue)
+{
+	{
+		std::unique_lock lock(Mutex);
+		queue.Held = false;
+	}
+	JobCompleted.notify_all();
+}
+
+void DMAScheduler::SetMaxPending(DMAQueue& queue, uint32_t maxPending)
+{
+	{
+		std::unique_lock lock(Mutex);
+		queue.MaxPending = std::clamp(maxPending, 1u, DMAEngine::MaxSlots);
+	}
+	queue.Engine.SetMaxInFlight(maxPending);
+	JobCompleted.notify_all();
+	JobAvailable.notify_all();
+}
+
+void DMAScheduler::SetThreadPlacement(ThreadPlacement placement)
+{
+	std::unique_lock lock(Mutex);
+	Placement = std::move(placement);
+}
+
+std::vector<DMAScheduler::Job>::iterator DMAScheduler::FindNextLocked()
+{
+	auto next = Jobs.end();
+	for (auto it = Jobs.begin(); it != Jobs.end(); ++it)
+	{
+		if (it->Queue->Submitting || it->Queue->Running >= it->Queue->MaxPending)
+			continue;
+		// Jobs are kept in submission order, so only the first one of each queue can be submitted
+		if (std::any_of(Jobs.begin(), it, [queue = it->Queue](Job const& job) { return job.Queue == queue; }))
+			continue;
+		if (next == Jobs.end() || it->Deadline < next->Deadline || (it->Deadline == next->Deadline && it->Sequence < next->Sequence))
+			next = it;
+	}
+	return next;
+}
+
+bool DMAScheduler::SubmitToEngine(Job& job)
+{
+	auto& engine = job.Queue->Engine;
+	job.Start = TelemetryClock::now();
+	auto ticket = job.Parts.size() == 1 ? engine.Submit(std::move(job.Parts[0])) : engine.SubmitJoined(std::move(job.Parts));
+	job.Parts.clear();
+	if (!ticket)
+		return false;
+	job.EngineTicket = *ticket;
+	return true;
+}
+
+bool DMAScheduler::CanReapLocked() const
+{
+	return std::any_of(Submitted.begin(), Submitted.end(), [](Job const& job) { return !job.Queue->Reaping; });
+}
+
+std::vector<DMAScheduler::Job> DMAScheduler::ReapAny(std::vector<Job> jobs)
+{
+	std::vector<Job> running;
+	for (auto& job : jobs)
+	{
+		if (auto success = job.Queue->Engine.WaitFor(job.EngineTicket, 0))
+			Finish(job, *success);
+		else
+			running.push_back(std::move(job));
+	}
+	if (running.size() != jobs.size() || running.empty())
+		return running;
+	// Engines reap in submission order, so waiting on one engine does not hold back the completions of others for long
+	auto first = std::min_element(running.begin(), running.end(), [](Job const& a, Job const& b) { return a.Deadline < b.Deadline; });
+	if (auto success = first->Queue->Engine.WaitFor(first->EngineTicket, ReapSliceMs))
+	{
+		Finish(*first, *success);
+		running.erase(first);
+	}
+	return running;
+}
+
+void DMAScheduler::Reap(Job& job)
+{
+	Finish(job, job.Queue->Engine.Wait(job.EngineTicket));
+}
+
+void DMAScheduler::Finish(Job& job, bool success)
+{
+	if (success && job.Queue->TransferTime)
+		job.Queue->TransferTime->Record(TelemetryClock::now() - job.Start);
+	Complete(job, success);
+}
+
+void DMAScheduler::Complete(Job& job, bool success)
+{
+	job.Done->State.store(success ? 1 : 2);
+	job.Done->State.notify_all();
+	// Queue may be destroyed as soon as its last transfer is seen complete
+	{
+		std::unique_lock lock(Mutex);
+		if (job.Reaping)
+			job.Queue->Reaping = false;
+		--job.Queue->Pending;
+		if (job.Running)
+			--job.Queue->Running;
+	}
+	JobCompleted.notify_all();
+	JobAvailable.notify_one();
+}
+
+void DMAScheduler::Run(ThreadPlacement const& placement)
+{
+	ScopedThreadPlacement scope(placement, "DMA");
+	while (true)
+	{
+		Job job;
+		std::vector<Job> reaped;
+		bool submit = false;
+		{
+			std::unique_lock lock(Mutex);
+			std::vector<Job>::iterator next;
+			JobAvailable.wait(lock, [&] { return Stop || (next = FindNextLocked()) != Jobs.end() || (Reapers < MaxReapers && CanReapLocked()); });
+			if (Stop)
+				return;
+			// Submitting comes first, so that transfers queued while others run are in flight before those are waited for
+			submit = next != Jobs.end();
+			if (submit)
+			{
+				job = std::move(*next);
+				Jobs.erase(next);
+				job.Running = true;
+				++job.Queue->Running;
+				job.Queue->Submitting = true;
+			}
+			else
+			{
+				// Jobs of a queue are in submission order in Submitted, so this takes the oldest running job of each queue
+				for (auto it = Submitted.begin(); it != Submitted.end();)
+				{
+					if (it->Queue->Reaping)
+					{
+						++it;
+						continue;
+					}
+					it->Queue->Reaping = it->Reaping = true;
+					reaped.push_back(std::move(*it));
+					it = Submitted.erase(it);
+				}
+				++Reapers;
+			}
+		}
+		if (!submit)
+		{
+			auto running = ReapAny(std::move(reaped));
+			{
+				std::unique_lock lock(Mutex);
+				for (auto& other : running)
+					other.Queue->Reaping = other.Reaping = false;
+				// Back in front of the later jobs of their queues, which were submitted after them
+				Submitted.insert(Submitted.begin(), std::make_move_iterator(running.begin()), std::make_move_iterator(running.end()));
+				--Reapers;
+			}
+			JobAvailable.notify_one();
+			continue;
+		}
+		bool submitted = SubmitToEngine(job);
+		{
+			std::unique_lock lock(Mutex);
+			job.Queue->Submitting = false;
+			if (submitted)
+				Submitted.push_back(std::move(job));
+		}
+		JobAvailable.notify_one();
+		if (!submitted)
+			Complete(job, false);
+	}
+}
+
+}
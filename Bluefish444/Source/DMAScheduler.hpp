@@ -0,0 +1,137 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include "DMAEngine.hpp"
+#include "Telemetry.hpp"
+#include "ThreadPlacement.hpp"
+
+// stl
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bf
+{
+
+// Transfers of one channel, i.e. one SDK instance, queued on the DMA scheduler of its device.
+// Members other than Engine are guarded by the scheduler.
+struct DMAQueue
+{
+	explicit DMAQueue(DMAEngine& engine) : Engine(engine) {}
+	DMAEngine& Engine;
+	uint32_t MaxPending = DMAEngine::DefaultMaxInFlight; // Submit blocks while this many transfers are pending
+	uint32_t Pending = 0; // Queued or running transfers
+	uint32_t Running = 0; // Transfers submitted to Engine and not reaped yet. Submitted in order, up to MaxPending at a time.
+	bool Submitting = false; // A worker submits a transfer of the queue, so the next one waits to keep the order
+	bool Reaping = false; // A worker waits for the oldest running transfer of the queue
+	bool Held = false; // Submit blocks while set, see DMAScheduler::Hold
+	LatencyHistogram* TransferTime = nullptr; // Records how long each transfer runs, excluding time in the queue
+};
+
+// DMA transfers of all channels of a card, submitted by a small pool of workers in order of their VBI deadlines.
+// Workers submit transfers without waiting for them, and all but one of them reap running transfers when there is
+// nothing to submit, so that a worker is always free to submit. A reaper takes the oldest running transfer of each queue
+// and completes those that are done. If none is, it waits for the one with the earliest deadline for at most
+// ReapSliceMs before polling the others again, so a slow channel delays completions of others by at most a slice.
+// Each queue thus keeps up to MaxPending transfers in flight while thread count scales with cards instead of channels.
+// Workers are started by the first Submit.
+class DMAScheduler
+{
+	struct Completion
+	{
+		std::atomic<uint32_t> State = 0; // 0: Pending, 1: Done, 2: Failed
+	};
+
+public:
+	static constexpr uint32_t DefaultWorkerCount = 2;
+	static constexpr uint32_t ReapSliceMs = 1;
+
+	// Empty if the transfer could not be queued
+	class Ticket
+	{
+	public:
+		Ticket() = default;
+		explicit operator bool() const { return Done != nullptr; }
+
+	private:
+		friend class DMAScheduler;
+		explicit Ticket(std::shared_ptr<Completion> done) : Done(std::move(done)) {}
+		std::shared_ptr<Completion> Done;
+	};
+
+	explicit DMAScheduler(uint32_t workerCount = DefaultWorkerCount);
+	~DMAScheduler();
+
+	DMAScheduler(DMAScheduler const&) = delete;
+
+	// Queues the parts of a transfer to run together (see DMAEngine::SubmitJoined). Among queues, transfers with earlier
+	// deadlines are submitted first; transfers of a queue are submitted in order. Blocks while MaxPending transfers of the
+	// queue are pending.
+	Ticket Submit(DMAQueue& queue, std::vector<DMATransfer> parts, TelemetryClock::time_point deadline);
+	// Returns false if the transfer failed. Does not need the scheduler, so tickets can be waited for after their channel closed.
+	static bool Wait(Ticket const& ticket);
+	// Whether the transfer completed or failed, without waiting
+	static bool IsDone(Ticket const& ticket) { return !ticket || ticket.Done->State.load() != 0; }
+	// Blocks until all transfers of the queue complete
+	void WaitAll(DMAQueue& queue);
+	// Blocks later submissions of the queue until Release, then waits for its pending transfers, so that the SDK instance
+	// of the queue is not used by DMA meanwhile
+	void Hold(DMAQueue& queue);
+	void Release(DMAQueue& queue);
+	// Also sets the transfers the engine of the queue keeps in flight
+	void SetMaxPending(DMAQueue& queue, uint32_t maxPending);
+	// Applies to workers started afterwards
+	void SetThreadPlacement(ThreadPlacement placement);
+	// Joins the workers after the transfers they run complete. Queued transfers fail, as do later submissions.
+	void Shutdown();
+
+private:
+	struct Job
+	{
+		DMAQueue* Queue = nullptr;
+		std::vector<DMATransfer> Parts;
+		TelemetryClock::time_point Deadline{};
+		uint64_t Sequence = 0;
+		std::shared_ptr<Completion> Done;
+		bool Running = false; // Counted in DMAQueue::Running
+		bool Reaping = false; // Sets DMAQueue::Reaping
+		DMAEngine::Ticket EngineTicket = 0;
+		TelemetryClock::time_point Start{}; // Of the submission to the engine
+	};
+
+	void Run(ThreadPlacement const& placement);
+	// Requires Mutex. Job with the earliest deadline among the first queued jobs of queues that are not submitting and
+	// have room for another running transfer, or Jobs.end().
+	std::vector<Job>::iterator FindNextLocked();
+	// Submits the job to the engine of its queue without waiting for it. Returns false if the engine rejected it.
+	static bool SubmitToEngine(Job& job);
+	// Requires Mutex. Whether a running job of a queue no worker reaps yet is waiting to be reaped.
+	bool CanReapLocked() const;
+	// Completes those of the jobs that are done, waiting for at most ReapSliceMs if none is. Returns the others.
+	std::vector<Job> ReapAny(std::vector<Job> jobs);
+	// Waits for a submitted job and completes it
+	void Reap(Job& job);
+	void Finish(Job& job, bool success);
+	void Complete(Job& job, bool success);
+
+	std::mutex Mutex;
+	std::condition_variable JobAvailable; // Also notified when a queue becomes idle
+	std::condition_variable JobCompleted;
+	std::vector<Job> Jobs; // Few per channel, scanned for the earliest deadline
+	std::vector<Job> Submitted; // Running jobs that no worker reaps, in submission order within each queue
+	uint32_t Reapers = 0; // Workers reaping running jobs
+	uint64_t LastSequence = 0;
+	bool Stop = false;
+	uint32_t WorkerCount;
+	uint32_t MaxReapers;
+	ThreadPlacement Placement;
+	std::vector<std::thread> Workers;
+};
+
+}
@@ -1,12 +1,11 @@
 ﻿// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
 
 #include <Nodos/Modules.h>
-#include <nosUtil/Stopwatch.hpp>
 #include <nosVulkanSubsystem/nosVulkanSubsystem.h>
 #include <nosVulkanSubsystem/Helpers.hpp>
 
 #include "DMANodeBase.hpp"
-#include "BluefishTypes_generated.h"
+#include "ChannelHelpers.hpp"
 #include "Device.hpp"
 
 namespace bf
@@ -16,8 +15,7 @@ struct DMAWriteNodeContext : DMANodeBase
 	using DMANodeBase::DMANodeBase;
 
 	nos::Buffer ChannelInfo{};
-	BluefishDevice* Device = nullptr;
-	EBlueVideoChannel Channel = BLUE_VIDEOCHANNEL_INVALID;
+	ChannelHandle Handle{};
 
 	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
 	{
@@ -25,68 +23,56 @@ struct DMAWriteNodeContext : DMANodeBase
 		{
 			if (ChannelInfo.Size() == value.Size && memcmp(ChannelInfo.Data(), value.Data, value.Size) == 0)
 				return;
-			auto* channelInfo = nos::InterpretPinValue<nos::bluefish::ChannelInfo>(value);
-			Device = nullptr;
 			ChannelInfo = {};
-			if (!channelInfo || !channelInfo->device())
-				return;
-			Device = BluefishDevice::GetDevice(channelInfo->device()->serial()->str()).get();
-			if (!Device || !channelInfo->channel()->name())
+			Handle = ResolveChannelHandle(value);
+			if (!Handle)
 				return;
 			ChannelInfo = value;
-			Channel = static_cast<EBlueVideoChannel>(channelInfo->channel()->id());
-			auto dSec = Device->GetDeltaSeconds(Channel);
-			DeltaSeconds = {dSec[0], dSec[1]};
+			SetWatchLogNames(Handle);
+			UpdateDeltaSeconds(Handle);
 			nosEngine.RecompilePath(NodeId);
 		}
+		else if (pinName == NOS_NAME("MaxTransfersInFlight"))
+			MaxTransfersInFlight = *nos::InterpretPinValue<uint32_t>(value);
+		else if (pinName == NOS_NAME("SkipIncompleteFrames"))
+			SkipIncompleteFrames = *nos::InterpretPinValue<bool>(value);
+		else
+			SetPacingPin(pinName, value);
 	}
 
 	nosResult ExecuteNode(nosNodeExecuteParams* params) override
 	{
 		nosResourceShareInfo inputBuffer{};
+		nosGPUEvent* gpuEvent = nullptr;
 		for (size_t i = 0; i < params->PinCount; ++i)
 		{
 			auto& pin = params->Pins[i];
 			if (pin.Name == NOS_NAME("Input"))
 				inputBuffer = nos::vkss::ConvertToResourceInfo(*nos::InterpretPinValue<nos::sys::vulkan::Buffer>(*pin.Data));
+			else if (pin.Name == NOS_NAME("GPUEvent"))
+				gpuEvent = GetGPUEvent(*pin.Data);
 		}
 		
 		if (!inputBuffer.Memory.Handle)
 			return NOS_RESULT_FAILED;
- 
-		if (!Device || Channel == BLUE_VIDEOCHANNEL_INVALID)
-			return NOS_RESULT_FAILED;
-
-		std::string channelStr = bfcUtilsGetStringForVideoChannel(Channel);
-
-		nosCmd cmd;
-		nosVulkan->Begin("Flush Before Bluefish DMA Write", &cmd);
-		nosGPUEvent event;
-		nosCmdEndParams end {.ForceSubmit = NOS_TRUE, .OutGPUEventHandle = &event};
-		nosVulkan->End(cmd, &end);
-		auto res = nosVulkan->WaitGpuEvent(&event, 10e9);
-		if (res != NOS_RESULT_SUCCESS)
-			nosEngine.LogE("Error when flush before Bluefish DMA write");
-
-		auto buffer = nosVulkan->Map(&inputBuffer);
-		if((uintptr_t)buffer % 64 != 0)
-			nosEngine.LogE("DMA write only accepts buffers addresses to be aligned to 64 bytes"); // TODO: Check device. This is only in Khronos range!
-
-		{
-			nos::util::Stopwatch sw;
-			Device->DMAWriteFrame(Channel, BufferId, buffer, inputBuffer.Info.Buffer.Size);
-			auto elapsed = sw.Elapsed();
-			nosEngine.WatchLog(("Bluefish " + channelStr + " DMA Write").c_str(), nos::util::Stopwatch::ElapsedString(elapsed).c_str());
-		}
+		// A pool buffer is not handed out again while its copy is waited for and it is transferred
+		auto lease = DMABufferPool::Acquire(inputBuffer);
+		gpuEvent = ResolveGPUEvent(gpuEvent, inputBuffer, lease);
 
-		BufferId = (BufferId + 1) % CycledBuffersPerChannel;
+		auto channel = Handle.Acquire();
+		if (!channel)
+			return NOS_RESULT_FAILED;
+		if (UpdateDeltaSeconds(Handle))
+			nosEngine.RecompilePath(NodeId);
+		channel->SetMaxDMAInFlight(MaxTransfersInFlight);
 
-		nosScheduleNodeParams schedule {
-			.NodeId = NodeId,
-			.AddScheduleCount = 1
-		};
-		nosEngine.ScheduleNode(&schedule);
+		// A skipped frame is not scheduled for playback, so the card repeats the last completed one
+		bool ready = WaitGPU(Handle.Format, inputBuffer.Info.Buffer.FieldType, gpuEvent, SkipIncompleteFrames, channel->GetTelemetry());
+		UpdatePacer(*channel, Handle, ready);
+		if (ready && !WriteFrame(*channel, Handle.Format, inputBuffer))
+			return NOS_RESULT_FAILED;
 
+		ScheduleNextFrame(*channel);
 		return NOS_RESULT_SUCCESS;
 	}
 
@@ -101,11 +87,10 @@ struct DMAWriteNodeContext : DMANodeBase
 	
 	void OnPathStart() override
 	{
+		PacerGeneration = 0;
 		nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
 		nosEngine.ScheduleNode(&schedule);
 	}
-
-	nosVec2u DeltaSeconds{};
 };
 
 nosResult RegisterDMAWriteNode(nosNodeFunctions* outFunctions)
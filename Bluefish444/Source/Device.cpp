@@ -1,9 +1,14 @@
 ﻿// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
 
 #include "Device.hpp"
+#include "VideoFormats.hpp"
 
 // stl
 #include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 
 #include "Nodos/Modules.h"
 
@@ -48,36 +53,197 @@ BErr SdkInstance::Detach()
 	return BERR_NO_ERROR;
 }
 
-BErr BluefishDevice::InitializeDevices()
+namespace
 {
-	static bool initialized = false;
-	if (initialized)
-		return BERR_NO_ERROR;
-	auto instance = bfcFactory();
-	
-	BLUE_S32 deviceCount;
-	if (auto err = bfcEnumerate(instance, &deviceCount))
-		return err;
-	if (deviceCount > 0)
+
+using DeviceCallback = std::function<void(std::shared_ptr<BluefishDevice>)>;
+
+struct EnumerationState
+{
+	std::once_flag Started;
+	std::shared_future<BErr> Result;
+	std::vector<CachedDeviceInfo> Cache; // Read-only once enumeration is started
+
+	std::mutex Mutex;
+	bool Complete = false;
+	std::unordered_multimap<std::string, DeviceCallback> Waiters; // By serial
+};
+
+EnumerationState Enumeration;
+
+std::filesystem::path GetDeviceCachePath()
+{
+	if (auto* path = std::getenv("BLUEFISH444_DEVICE_CACHE"))
+		return path;
+#if _WIN32
+	if (auto* localAppData = std::getenv("LOCALAPPDATA"))
+		return std::filesystem::path(localAppData) / "Nodos" / "Bluefish444" / "DeviceCache.txt";
+#else
+	if (auto* cacheHome = std::getenv("XDG_CACHE_HOME"))
+		return std::filesystem::path(cacheHome) / "nodos" / "bluefish444" / "DeviceCache.txt";
+	if (auto* home = std::getenv("HOME"))
+		return std::filesystem::path(home) / ".cache" / "nodos" / "bluefish444" / "DeviceCache.txt";
+#endif
+	return {};
+}
+
+// One card per line: serial, device id and card type separated by tabs
+std::vector<CachedDeviceInfo> LoadDeviceCache(std::filesystem::path const& path)
+{
+	std::vector<CachedDeviceInfo> cache;
+	std::ifstream file(path);
+	std::string line;
+	while (std::getline(file, line))
 	{
-		for (int deviceId = 1; deviceId <= deviceCount; ++deviceId)
-		{
-			BErr deviceInitErr;
-			auto device = std::make_shared<BluefishDevice>(deviceId, deviceInitErr);
-			if (BERR_NO_ERROR != deviceInitErr)
+		std::istringstream fields(line);
+		CachedDeviceInfo info;
+		if (std::getline(fields, info.Serial, '\t') && fields >> info.Id >> info.CardType && !info.Serial.empty())
+			cache.push_back(std::move(info));
+	}
+	return cache;
+}
+
+void SaveDeviceCache(std::filesystem::path const& path, std::vector<CachedDeviceInfo> const& cache)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+	std::ofstream file(path, std::ios::trunc);
+	for (auto& info : cache)
+		file << info.Serial << '\t' << info.Id << '\t' << info.CardType << '\n';
+	if (!file)
+		nosEngine.LogW("Unable to write Bluefish444 device cache to %s", path.string().c_str());
+}
+
+}
+
+void BluefishDevice::StartEnumeration()
+{
+	std::call_once(Enumeration.Started, [] {
+		auto cachePath = GetDeviceCachePath();
+		if (!cachePath.empty())
+			Enumeration.Cache = LoadDeviceCache(cachePath);
+		Enumeration.Result = std::async(std::launch::async, [cachePath]() -> BErr {
+			auto instance = bfcFactory();
+			BLUE_S32 deviceCount = 0;
+			auto err = bfcEnumerate(instance, &deviceCount);
+			bfcDestroy(instance);
+			if (BERR_NO_ERROR == err)
+			{
+				// Attaching a card takes long, so cards are attached concurrently and become available one by one
+				std::vector<std::future<void>> attaches;
+				for (BLUE_S32 deviceId = 1; deviceId <= deviceCount; ++deviceId)
+					attaches.push_back(std::async(std::launch::async, &BluefishDevice::AttachDevice, deviceId));
+				for (auto& attach : attaches)
+					attach.wait();
+			}
+			else
+				nosEngine.LogE("Unable to enumerate Bluefish444 devices: %s", bfcUtilsGetStringForBErr(err));
+
+			std::vector<CachedDeviceInfo> cache;
+			ForEachDevice([&cache](BluefishDevice& device) {
+				cache.push_back({device.GetSerial(), device.GetId(), static_cast<int>(device.GetInfo().CardType)});
+			});
+			std::sort(cache.begin(), cache.end(), [](auto& a, auto& b) { return a.Id < b.Id; });
+			auto changed = cache.size() != Enumeration.Cache.size() ||
+						   !std::equal(cache.begin(), cache.end(), Enumeration.Cache.begin(), [](auto& a, auto& b) {
+							   return a.Serial == b.Serial && a.Id == b.Id && a.CardType == b.CardType;
+						   });
+			if (BERR_NO_ERROR == err && changed && !cachePath.empty())
+				SaveDeviceCache(cachePath, cache);
+
+			std::unordered_multimap<std::string, DeviceCallback> waiters;
 			{
-				nosEngine.LogE("Error during device initialization: %s", bfcUtilsGetStringForBErr(deviceInitErr));
-				continue;
+				std::unique_lock lock(Enumeration.Mutex);
+				Enumeration.Complete = true;
+				waiters = std::move(Enumeration.Waiters);
 			}
-			Devices[device->GetSerial()] = std::move(device);
+			for (auto& [serial, callback] : waiters)
+				callback(nullptr);
+			return err;
+		}).share();
+	});
+}
+
+BErr BluefishDevice::InitializeDevices()
+{
+	StartEnumeration();
+	return Enumeration.Result.get();
+}
+
+void BluefishDevice::WaitForEnumeration()
+{
+	if (Enumeration.Result.valid())
+		Enumeration.Result.wait();
+}
+
+void BluefishDevice::ShutdownDevices()
+{
+	WaitForEnumeration();
+	std::unordered_map<std::string, std::shared_ptr<BluefishDevice>> devices;
+	{
+		std::unique_lock lock(DevicesMutex);
+		devices.swap(Devices);
+	}
+	// Nodes may still hold devices, which then outlive this without threads
+	for (auto& [serial, device] : devices)
+		device->Shutdown();
+}
+
+bool BluefishDevice::IsEnumerationComplete()
+{
+	std::unique_lock lock(Enumeration.Mutex);
+	return Enumeration.Complete;
+}
+
+void BluefishDevice::WhenDeviceReady(std::string const& serial, std::function<void(std::shared_ptr<BluefishDevice>)> callback)
+{
+	std::shared_ptr<BluefishDevice> device;
+	{
+		std::unique_lock lock(Enumeration.Mutex);
+		device = GetDevice(serial);
+		if (!device && !Enumeration.Complete)
+		{
+			Enumeration.Waiters.emplace(serial, std::move(callback));
+			return;
 		}
 	}
-	
-	bfcDestroy(instance);
-	initialized = true;
-	return BERR_NO_ERROR;
+	callback(std::move(device));
 }
 
+std::optional<CachedDeviceInfo> BluefishDevice::GetCachedDevice(std::string const& serial)
+{
+	for (auto& info : Enumeration.Cache)
+		if (info.Serial == serial)
+			return info;
+	return std::nullopt;
+}
+
+void BluefishDevice::AttachDevice(BLUE_S32 deviceId)
+{
+	BErr deviceInitErr;
+	auto device = std::make_shared<BluefishDevice>(deviceId, deviceInitErr);
+	if (BERR_NO_ERROR != deviceInitErr)
+	{
+		nosEngine.LogE("Error during device initialization: %s", bfcUtilsGetStringForBErr(deviceInitErr));
+		return;
+	}
+	auto serial = device->GetSerial();
+	{
+		std::unique_lock lock(DevicesMutex);
+		Devices[serial] = device;
+		++AttachCount;
+	}
+	std::vector<DeviceCallback> callbacks;
+	{
+		std::unique_lock lock(Enumeration.Mutex);
+		auto [first, last] = Enumeration.Waiters.equal_range(serial);
+		for (auto it = first; it != last; ++it)
+			callbacks.push_back(std::move(it->second));
+		Enumeration.Waiters.erase(first, last);
+	}
+	for (auto& callback : callbacks)
+		callback(device);
+}
 
 BluefishDevice::BluefishDevice(BLUE_S32 deviceId, BErr& error) : Id(deviceId), Instance()
 {
@@ -85,102 +251,235 @@ BluefishDevice::BluefishDevice(BLUE_S32 deviceId, BErr& error) : Id(deviceId), I
 	if (BERR_NO_ERROR != error)
 		return;
 	bfcUtilsGetDeviceInfo(Id, &Info);
+	Placement = LoadThreadPlacement(GetSerial(), GetCardNumaNode(Id));
+	DMA.SetThreadPlacement(Placement);
+	if (Placement.NumaNode >= 0 || !Placement.Cpus.empty() || Placement.Priority != ThreadPriority::Normal)
+		nosEngine.LogI("Bluefish444: DMA and VBI threads of %s %s run on %s", GetName().c_str(), GetSerial().c_str(), Placement.ToString().c_str());
 	bfcSetCardProperty32(Instance, VIDEO_BLACKGENERATOR, ENUM_BLACKGENERATOR_OFF);
 	bfcSetCardProperty32(Instance, VIDEO_IMAGE_ORIENTATION, ImageOrientation_Normal);
+	PollSignals(); // Inputs are listed as soon as the device is available
+	SignalMonitor = std::thread([this] { MonitorSignals(); });
 }
 
 BluefishDevice::~BluefishDevice()
 {
-	Channels.clear();
+	Shutdown();
 }
 
-bool BluefishDevice::CanChannelDoInput(EBlueVideoChannel channel)
+void BluefishDevice::Shutdown()
 {
-	blue_setup_info setup = bfcUtilsGetDefaultSetupInfoInput(channel);
-	setup.DeviceId = GetId();
-	auto err = bfcUtilsGetSetupInfoForInputSignal(nullptr, &setup, UHD_PREFERENCE_DEFAULT);
-	return BERR_NO_ERROR == err;
+	if (SignalMonitor.joinable())
+	{
+		{
+			std::unique_lock lock(SignalMutex);
+			StopSignalMonitor = true;
+		}
+		SignalMonitorWakeup.notify_all();
+		SignalMonitor.join();
+	}
+	for (size_t i = 0; i < ChannelTable::Capacity; ++i)
+		CloseChannel(static_cast<EBlueVideoChannel>(i));
+	DMA.Shutdown();
 }
 
-blue_setup_info BluefishDevice::GetSetupInfoForInput(EBlueVideoChannel channel, BErr& err) const
+void BluefishDevice::MonitorSignals()
+{
+	std::unique_lock lock(SignalMutex);
+	while (true)
+	{
+		SignalMonitorWakeup.wait_for(lock, SignalPollInterval, [this] { return StopSignalMonitor || SignalCheckRequested; });
+		if (StopSignalMonitor)
+			break;
+		SignalCheckRequested = false;
+		lock.unlock();
+		PollSignals();
+		lock.lock();
+	}
+}
+
+void BluefishDevice::RequestSignalCheck()
+{
+	{
+		std::unique_lock lock(SignalMutex);
+		SignalCheckRequested = true;
+	}
+	SignalMonitorWakeup.notify_all();
+}
+
+void BluefishDevice::PollSignals()
+{
+	for (auto ch = BLUE_VIDEO_OUTPUT_CHANNEL_1; ch <= BLUE_VIDEO_INPUT_CHANNEL_8; ch = static_cast<EBlueVideoChannel>(static_cast<int>(ch) + 1))
+	{
+		if (!IsInputChannel(ch))
+			continue;
+		// Open channels are detected with their own UHD preference, so that the mode compares with theirs
+		auto channel = Channels.Pin(ch);
+		InputSignal signal{.UHDPreference = channel ? channel->GetSettings().UHDPreference : UHD_PREFERENCE_DEFAULT};
+		blue_setup_info setup = bfcUtilsGetDefaultSetupInfoInput(ch);
+		setup.DeviceId = GetId();
+		if (BERR_NO_ERROR == bfcUtilsGetSetupInfoForInputSignal(nullptr, &setup, signal.UHDPreference))
+		{
+			signal.Present = true;
+			signal.VideoMode = setup.VideoModeExt;
+			signal.LinkType = static_cast<EBlueSignalLinkType>(setup.SignalLinkType);
+		}
+		bool check;
+		{
+			std::unique_lock lock(SignalMutex);
+			auto& previous = InputSignals[ch];
+			auto& checkedGeneration = CheckedGenerations[ch];
+			// Each signal is compared once with each generation of the channel, so that failed reconfigurations are
+			// not retried until the signal changes again
+			check = channel && signal.Present && (previous != signal || checkedGeneration != channel->GetGeneration());
+			if (previous != signal)
+				++InputSignalVersion;
+			previous = signal;
+			checkedGeneration = channel ? channel->GetGeneration() : 0;
+		}
+		if (!check)
+			continue;
+		auto format = channel->GetFormat();
+		if (signal.VideoMode == format.VideoMode && GetLinkCount(signal.LinkType) == format.LinkCount)
+			continue;
+		if (GetLinkCount(signal.LinkType) != format.LinkCount)
+			nosEngine.LogW("%s: Input signal changed to %d links, reopen the channel to follow it", bfcUtilsGetStringForVideoChannel(ch), GetLinkCount(signal.LinkType));
+		else if (auto err = channel->Reconfigure(); BERR_NO_ERROR != err)
+			nosEngine.LogE("%s: Unable to follow the input signal to %s: %s", bfcUtilsGetStringForVideoChannel(ch), bfcUtilsGetStringForVideoMode(signal.VideoMode), bfcUtilsGetStringForBErr(err));
+		std::unique_lock lock(SignalMutex);
+		CheckedGenerations[ch] = channel->GetGeneration();
+	}
+}
+
+InputSignal BluefishDevice::GetInputSignal(EBlueVideoChannel channel) const
+{
+	std::unique_lock lock(SignalMutex);
+	auto it = InputSignals.find(channel);
+	return it == InputSignals.end() ? InputSignal{} : it->second;
+}
+
+blue_setup_info BluefishDevice::GetSetupInfoForInput(EBlueVideoChannel channel, BErr& err, EBlueUHDPreference uhdPreference) const
 {
 	blue_setup_info setup = bfcUtilsGetDefaultSetupInfoInput(channel);
 	setup.DeviceId = GetId();
-	err = bfcUtilsGetSetupInfoForInputSignal(nullptr, &setup, UHD_PREFERENCE_DEFAULT);
+	err = bfcUtilsGetSetupInfoForInputSignal(nullptr, &setup, uhdPreference);
 	if (BERR_NO_ERROR != err)
 	{
-		err = bfcUtilsGetRecommendedSetupInfoInput(nullptr, &setup, UHD_PREFERENCE_DEFAULT);
+		err = bfcUtilsGetRecommendedSetupInfoInput(nullptr, &setup, uhdPreference);
 		if (BERR_NO_ERROR != err)
 			return setup;
 	}
-	setup.SignalLinkType = SIGNAL_LINK_TYPE_SINGLE_LINK; // Support only single link for now
 	setup.MemoryFormat = MEM_FMT_2VUY;
 	setup.VideoEngine = VIDEO_ENGINE_FRAMESTORE;
 	setup.TransportSampling = Signal_FormatType_422;
 	return setup;
 }
 
-BErr BluefishDevice::OpenChannel(EBlueVideoChannel channel, EVideoModeExt mode)
+BErr BluefishDevice::OpenChannel(EBlueVideoChannel channel, EVideoModeExt mode, ChannelSettings settings, ReconfigureCallback onReconfigured)
 {
-	CloseChannel(channel);
+	if (!ChannelTable::IsValid(channel))
+		return BERR_INVALID_ARG;
+	std::unique_lock openLock(OpenMutex);
+	auto group = GetGroupChannel(channel);
+	if (group != channel)
+	{
+		nosEngine.LogE("%s is a link of %s channel group", bfcUtilsGetStringForVideoChannel(channel), bfcUtilsGetStringForVideoChannel(group));
+		return BERR_INVALID_ARG;
+	}
+	CloseChannelLocked(channel);
+	auto linkCount = GetLinkCount(settings.LinkType);
+	if (IsInputChannel(channel))
+	{
+		BErr err;
+		auto setup = GetSetupInfoForInput(channel, err, settings.UHDPreference);
+		if (BERR_NO_ERROR == err)
+			linkCount = GetLinkCount(setup.SignalLinkType);
+	}
+	auto links = GetLinkChannels(channel, linkCount);
+	if (links.empty())
+	{
+		nosEngine.LogE("%s cannot be the first channel of a %d link channel group", bfcUtilsGetStringForVideoChannel(channel), linkCount);
+		return BERR_INVALID_ARG;
+	}
+	if (!AreLinksFree(channel, links))
+		return BERR_INVALID_ARG;
 	BErr error;
-	auto chObject = std::make_unique<Channel>(this, channel, mode, error);
+	auto chObject = std::make_unique<Channel>(this, channel, mode, settings, ++LastGeneration, error, std::move(onReconfigured));
 	if (BERR_NO_ERROR != error)
 		return error;
-	Channels[channel] = std::move(chObject);
+	// The input signal may have changed its link count since it was detected above
+	auto finalLinkCount = chObject->GetFormat().LinkCount;
+	if (finalLinkCount != linkCount)
+	{
+		links = GetLinkChannels(channel, finalLinkCount);
+		if (links.empty())
+		{
+			nosEngine.LogE("%s cannot be the first channel of a %d link channel group", bfcUtilsGetStringForVideoChannel(channel), finalLinkCount);
+			return BERR_INVALID_ARG;
+		}
+		if (!AreLinksFree(channel, links))
+			return BERR_INVALID_ARG;
+	}
+	{
+		std::unique_lock lock(GroupMutex);
+		for (size_t i = 1; i < links.size(); ++i)
+			GroupOfLink[links[i]] = channel;
+	}
+	Channels.Exchange(channel, std::move(chObject));
 	return error;
 }
 
-void BluefishDevice::CloseChannel(EBlueVideoChannel channel)
+bool BluefishDevice::AreLinksFree(EBlueVideoChannel channel, std::vector<EBlueVideoChannel> const& links) const
 {
-	auto it = Channels.find(channel);
-	if (it != Channels.end())
-		Channels.erase(it);
+	for (size_t i = 1; i < links.size(); ++i)
+	{
+		if (Channels.Pin(links[i]))
+		{
+			nosEngine.LogE("%s: Link %s is already open", bfcUtilsGetStringForVideoChannel(channel), bfcUtilsGetStringForVideoChannel(links[i]));
+			return false;
+		}
+		if (auto group = GetGroupChannel(links[i]); group != links[i])
+		{
+			nosEngine.LogE("%s: Link %s belongs to the %s channel group", bfcUtilsGetStringForVideoChannel(channel), bfcUtilsGetStringForVideoChannel(links[i]), bfcUtilsGetStringForVideoChannel(group));
+			return false;
+		}
+	}
+	return true;
 }
 
-bool BluefishDevice::DMAWriteFrame(EBlueVideoChannel channel, uint32_t bufferId, uint8_t* inBuffer, uint32_t size) const
+void BluefishDevice::CloseChannel(EBlueVideoChannel channel)
 {
-	auto it = Channels.find(channel);
-	if (it == Channels.end())
-	{
-		nosEngine.LogE("DMA Write: Channel %s not open!", bfcUtilsGetStringForVideoChannel(channel));
-		return false;
-	}
-	return it->second->DMAWriteFrame(bufferId, inBuffer, size);
+	std::unique_lock openLock(OpenMutex);
+	CloseChannelLocked(channel);
 }
 
-bool BluefishDevice::DMAReadFrame(EBlueVideoChannel channel, uint32_t startCaptureBufferId, uint32_t readBufferId, uint8_t* outBuffer, uint32_t size) const
+void BluefishDevice::CloseChannelLocked(EBlueVideoChannel channel)
 {
-	auto it = Channels.find(channel);
-	if (it == Channels.end())
-	{
-		nosEngine.LogE("DMA Read: Channel %s not open!", bfcUtilsGetStringForVideoChannel(channel));
-		return false;
-	}
-	return it->second->DMAReadFrame(startCaptureBufferId, readBufferId, outBuffer, size);
+	Channels.Exchange(channel, nullptr);
+	std::unique_lock lock(GroupMutex);
+	std::erase_if(GroupOfLink, [channel](auto const& linkGroup) { return linkGroup.second == channel; });
 }
 
-bool BluefishDevice::WaitVBI(EBlueVideoChannel channel, unsigned long& fieldCount) const
+EBlueVideoChannel BluefishDevice::GetGroupChannel(EBlueVideoChannel channel) const
 {
-	auto it = Channels.find(channel);
-	if (it == Channels.end())
-	{
-		nosEngine.LogE("Wait VBI: Channel %s not open!", bfcUtilsGetStringForVideoChannel(channel));
-		return false;
-	}
-	return it->second->WaitVBI(fieldCount);
+	std::unique_lock lock(GroupMutex);
+	auto it = GroupOfLink.find(channel);
+	return it == GroupOfLink.end() ? channel : it->second;
 }
 
-std::array<uint32_t, 2> BluefishDevice::GetDeltaSeconds(EBlueVideoChannel channel) const
+ChannelHandle BluefishDevice::GetChannelHandle(EBlueVideoChannel channel)
 {
-	auto it = Channels.find(channel);
-	if (it == Channels.end())
-		return {0, 0};
-	return it->second->GetDeltaSeconds();
+	ChannelHandle handle{.Device = this, .VideoChannel = channel, .ChannelName = bfcUtilsGetStringForVideoChannel(channel)};
+	if (auto ch = Channels.Pin(channel))
+	{
+		handle.Generation = ch->GetGeneration();
+		handle.Format = ch->GetFormat();
+	}
+	return handle;
 }
 
 std::shared_ptr<BluefishDevice> BluefishDevice::GetDevice(std::string const& serial)
 {
+	std::unique_lock lock(DevicesMutex);
 	auto it = Devices.find(serial);
 	if (it == Devices.end())
 		return nullptr;
@@ -189,6 +488,7 @@ std::shared_ptr<BluefishDevice> BluefishDevice::GetDevice(std::string const& ser
 
 std::shared_ptr<BluefishDevice> BluefishDevice::GetDevice(BLUE_S32 id)
 {
+	std::unique_lock lock(DevicesMutex);
 	for (auto& [serial, device] : Devices)
 	{
 		if (device->GetId() == id)
@@ -199,7 +499,13 @@ std::shared_ptr<BluefishDevice> BluefishDevice::GetDevice(BLUE_S32 id)
 
 void BluefishDevice::ForEachDevice(std::function<void(BluefishDevice&)>&& func)
 {
-	for (auto& [serial, device] : Devices)
+	std::vector<std::shared_ptr<BluefishDevice>> devices;
+	{
+		std::unique_lock lock(DevicesMutex);
+		for (auto& [serial, device] : Devices)
+			devices.push_back(device);
+	}
+	for (auto& device : devices)
 		func(*device);
 }
 
@@ -221,30 +527,56 @@ std::string BluefishDevice::GetName() const
 	return bfcUtilsGetStringForCardType(Info.CardType);
 }
 
-Channel::Channel(BluefishDevice* device, EBlueVideoChannel channel, EVideoModeExt mode, BErr& err)
-	: Device(device), VideoChannel(channel), Instance()
+ChannelRef ChannelHandle::Acquire()
+{
+	if (!Device)
+		return {};
+	auto ch = Device->PinChannel(VideoChannel);
+	if (ch && ch->GetGeneration() != Generation)
+		Format = ch->GetFormat(&Generation);
+	return ch;
+}
+
+Channel::Channel(BluefishDevice* device, EBlueVideoChannel channel, EVideoModeExt mode, ChannelSettings settings, uint32_t generation, BErr& err, ReconfigureCallback onReconfigured)
+	: Device(device), VideoChannel(channel), Settings(settings), OnReconfigured(std::move(onReconfigured)), Generation(generation), Instance(), DMA(Instance)
 {
 	err = Instance.Attach(Device);
 	if (BERR_NO_ERROR != err)
 		return;
+	BLUE_U32 cardBufferCount = 0;
+	err = bfcGetRenderBufferCount(Instance, &cardBufferCount);
+	if (BERR_NO_ERROR != err)
+		return;
+	auto& buffering = settings.Buffering;
+	Format.BufferCycleDepth = buffering.CycleDepth ? buffering.CycleDepth : cardBufferCount;
+	Format.CaptureLead = buffering.CaptureLead;
+	if (Format.BufferCycleDepth < 2 || Format.BufferCycleDepth > cardBufferCount)
+	{
+		nosEngine.LogE("%s: Buffer cycle depth must be between 2 and %d (card buffer count), got %d", bfcUtilsGetStringForVideoChannel(channel), cardBufferCount, Format.BufferCycleDepth);
+		err = BERR_INVALID_ARG;
+		return;
+	}
+	if (IsInputChannel(channel) && (Format.CaptureLead < 1 || Format.CaptureLead >= Format.BufferCycleDepth))
+	{
+		nosEngine.LogE("%s: Capture lead must be between 1 and %d (buffer cycle depth - 1), got %d", bfcUtilsGetStringForVideoChannel(channel), Format.BufferCycleDepth - 1, Format.CaptureLead);
+		err = BERR_INVALID_ARG;
+		return;
+	}
+	EBlueSignalLinkType linkType = settings.LinkType;
 	if (IsInputChannel(channel))
 	{
-		auto setup = device->GetSetupInfoForInput(channel, err);
-		if (BERR_NO_ERROR != err)
-			return;
-		err = bfcUtilsValidateSetupInfo(&setup);
+		auto setup = device->GetSetupInfoForInput(channel, err, settings.UHDPreference);
 		if (BERR_NO_ERROR != err)
 			return;
-		err = bfcUtilsSetupInput(Instance, &setup);
-		mode = setup.VideoModeExt;
+		err = SetupInput(setup, mode, linkType);
 	}
 	else
 	{
 		auto setup = bfcUtilsGetDefaultSetupInfoOutput(channel, mode);
-		setup.MemoryFormat = MEM_FMT_2VUY;
+		setup.MemoryFormat = settings.MemoryFormat;
 		setup.VideoEngine = VIDEO_ENGINE_FRAMESTORE;
 		setup.TransportSampling = Signal_FormatType_422;
-		setup.SignalLinkType = SIGNAL_LINK_TYPE_SINGLE_LINK; // Support only single link for now
+		setup.SignalLinkType = linkType;
 		if (BERR_NO_ERROR != err)
 			return;
 		err = bfcUtilsValidateSetupInfo(&setup);
@@ -252,48 +584,275 @@ Channel::Channel(BluefishDevice* device, EBlueVideoChannel channel, EVideoModeEx
 			return;
 		err = bfcUtilsSetupOutput(Instance, &setup);
 	}
+	if (BERR_NO_ERROR != err)
+		return;
+	err = DescribeVideoMode(mode, linkType, Format);
+	if (BERR_NO_ERROR != err)
+		return;
+	FieldInterrupts = Format.FieldMode;
+	// Bound to the channel without setting it up again, so reconfigurations done on Instance apply to its waits too
+	err = VBIInstance.Attach(Device);
+	if (BERR_NO_ERROR != err)
+		return;
+	err = bfcSetCardProperty32(VBIInstance, IsInputChannel(channel) ? DEFAULT_VIDEO_INPUT_CHANNEL : DEFAULT_VIDEO_OUTPUT_CHANNEL, channel);
+	if (BERR_NO_ERROR != err)
+		return;
+	auto hardwareWait = [this](unsigned long& fieldCount) {
+		if (Reconfiguring)
+			return false;
+		bool ok;
+		{
+			std::shared_lock lock(SetupMutex);
+			auto updateType = FieldInterrupts ? UPD_FMT_FIELD : UPD_FMT_FRAME;
+			ok = BERR_NO_ERROR == (IsInputChannel(VideoChannel)
+				                       ? bfcWaitVideoInputSync(VBIInstance, updateType, &fieldCount)
+				                       : bfcWaitVideoOutputSync(VBIInstance, updateType, &fieldCount));
+		}
+		if (ok)
+			LastFieldCount = fieldCount;
+		// Inputs lose or regain their signal, or change format, when waits start or stop failing; the signal is detected
+		// right away instead of at the next poll of the monitor
+		if (IsInputChannel(VideoChannel) && ok == LastVBIFailed)
+			Device->RequestSignalCheck();
+		LastVBIFailed = !ok;
+		return ok;
+	};
+	Queue.TransferTime = &Telemetry.DMATransfer;
+	VBI = std::make_unique<VBIDispatcher>(hardwareWait, std::chrono::nanoseconds(Telemetry.VBIPeriod), &Telemetry, Device->GetThreadPlacement());
+}
+
+BErr Channel::SetupInput(blue_setup_info setup, EVideoModeExt& mode, EBlueSignalLinkType& linkType)
+{
+	setup.MemoryFormat = Settings.MemoryFormat;
+	auto err = bfcUtilsValidateSetupInfo(&setup);
+	if (BERR_NO_ERROR != err)
+		return err;
+	err = bfcUtilsSetupInput(Instance, &setup);
+	mode = setup.VideoModeExt;
+	linkType = static_cast<EBlueSignalLinkType>(setup.SignalLinkType);
+	return err;
+}
+
+BErr Channel::DescribeVideoMode(EVideoModeExt mode, EBlueSignalLinkType linkType, ChannelFormat& format)
+{
+	format.VideoMode = mode;
+	format.LinkCount = GetLinkCount(linkType);
+	bfcGetVideoWidth(mode, &format.Width);
+	bfcGetVideoHeight(mode, UPD_FMT_FRAME, &format.Height);
+	format.MemoryFormat = Settings.MemoryFormat;
+	auto err = bfcGetVideoBytesPerLineV2(mode, Settings.MemoryFormat, &format.BytesPerLine);
+	if (BERR_NO_ERROR != err)
+	{
+		nosEngine.LogE("%s: Cannot get line pitch of %s in %s", bfcUtilsGetStringForVideoChannel(VideoChannel), bfcUtilsGetStringForVideoMode(mode), bfcUtilsGetStringForMemoryFormat(Settings.MemoryFormat));
+		return err;
+	}
+	format.BufferSize = format.BytesPerLine * format.Height;
+	format.Progressive = bfcUtilsIsVideoModeProgressive(mode);
+	format.FieldMode = Settings.FieldMode && !format.Progressive;
+	uint32_t fieldHeight = format.Height;
+	bfcGetVideoHeight(mode, UPD_FMT_FIELD, &fieldHeight);
+	format.FieldBufferSize = format.BytesPerLine * fieldHeight;
+	auto* catalogFormat = FindVideoFormat(mode);
+	format.FirstFieldOdd = !format.Progressive && catalogFormat && catalogFormat->FirstFieldOdd;
 	uint32_t dividend = bfcUtilsGetFpsForVideoMode(mode) * (bfcUtilsIsVideoMode1001Framerate(mode) ? 1000 : 1);
 	uint32_t divisor = bfcUtilsIsVideoMode1001Framerate(mode) ? 1001 : 1;
-	DeltaSeconds = {divisor, dividend};
+	format.DeltaSeconds = {divisor, dividend};
+	Telemetry.VBIPeriod = uint64_t(1'000'000'000) * divisor / (format.FieldMode ? dividend * 2 : dividend);
+	return BERR_NO_ERROR;
+}
+
+BErr Channel::Reconfigure()
+{
+	BErr err;
+	auto setup = Device->GetSetupInfoForInput(VideoChannel, err, Settings.UHDPreference);
+	if (BERR_NO_ERROR != err)
+		return err;
+	auto format = GetFormat();
+	auto previousMode = format.VideoMode;
+	if (GetLinkCount(static_cast<EBlueSignalLinkType>(setup.SignalLinkType)) != format.LinkCount)
+		return BERR_INVALID_ARG;
+	// Transfers queued for the previous format complete before the card buffers are set up again, and no DMA, capture
+	// or VBI wait uses the card until then. Transfers queued afterwards by nodes that have not seen the new generation
+	// yet only fail or carry one stale frame.
+	auto& scheduler = Device->GetDMAScheduler();
+	scheduler.Hold(Queue);
+	Reconfiguring = true;
+	EVideoModeExt mode;
+	EBlueSignalLinkType linkType;
+	{
+		std::unique_lock setupLock(SetupMutex);
+		err = SetupInput(setup, mode, linkType);
+		if (BERR_NO_ERROR == err)
+			err = DescribeVideoMode(mode, linkType, format);
+		if (BERR_NO_ERROR == err)
+		{
+			std::unique_lock lock(FormatMutex);
+			Format = format;
+			Generation = ++Device->LastGeneration;
+			FieldInterrupts = format.FieldMode;
+		}
+	}
+	Reconfiguring = false;
+	scheduler.Release(Queue);
+	if (BERR_NO_ERROR != err)
+		return err;
+	nosEngine.LogI("%s: Input signal changed from %s to %s", bfcUtilsGetStringForVideoChannel(VideoChannel), bfcUtilsGetStringForVideoMode(previousMode), bfcUtilsGetStringForVideoMode(mode));
+	if (OnReconfigured)
+		OnReconfigured(format);
+	return BERR_NO_ERROR;
+}
+
+ChannelFormat Channel::GetFormat(uint32_t* generation) const
+{
+	std::unique_lock lock(FormatMutex);
+	if (generation)
+		*generation = Generation;
+	return Format;
 }
 
 Channel::~Channel()
 {
+	Device->GetDMAScheduler().WaitAll(Queue);
+	if (VBI)
+		VBI->Stop();
 }
 
-bool Channel::DMAWriteFrame(uint32_t bufferId, uint8_t* inBuffer, uint32_t size)
+DMAScheduler::Ticket Channel::Schedule(std::vector<DMATransfer> parts)
 {
-	auto ret = bfcDmaWriteToCardAsync(Instance, inBuffer, size, nullptr, BlueImage_DMABuffer(bufferId, BLUE_DMA_DATA_TYPE_IMAGE_FRAME), 0);
-	if(ret < 0)
+	// Transfers are due at the next VBI: Written frames must be scheduled for playback and read ones are overwritten
+	auto deadline = TelemetryClock::now();
+	if (auto last = VBI ? VBI->GetLatest() : VBISample{}; last.Sequence && !last.Failed)
+		deadline = std::max(deadline, last.Time + std::chrono::nanoseconds(Telemetry.VBIPeriod));
+	return Device->GetDMAScheduler().Submit(Queue, std::move(parts), deadline);
+}
+
+bool Channel::WaitDMA(DMAScheduler::Ticket const& ticket)
+{
+	return Device->GetDMAScheduler().Wait(ticket);
+}
+
+void Channel::SetMaxDMAInFlight(uint32_t maxInFlight)
+{
+	Device->GetDMAScheduler().SetMaxPending(Queue, maxInFlight);
+}
+
+DMAScheduler::Ticket Channel::SubmitBands(DMATransfer transfer)
+{
+	uint32_t pitch, linkCount;
 	{
-		nosEngine.LogE("DMA Write returned with '%s'", bfcUtilsGetStringForBErr(ret));
-		return false;
+		std::unique_lock lock(FormatMutex);
+		pitch = Format.BytesPerLine;
+		linkCount = Format.LinkCount;
 	}
-	
-	// Tell the card to playback this frame at the next interrupt - using this macros tells the card to playback, Image, VBI/Vanc and Hanc data.
-	auto err = bfcRenderBufferUpdate(Instance, BlueBuffer_Image(bufferId));
-	return err == BERR_NO_ERROR;
+	// Frames and fields alike: Bands are whole lines of the transferred buffer
+	uint32_t lines = pitch ? transfer.Size / pitch : 0;
+	if (linkCount < 2 || lines < linkCount)
+	{
+		std::vector<DMATransfer> parts;
+		parts.push_back(std::move(transfer));
+		return Schedule(std::move(parts));
+	}
+	uint32_t partSize = (lines + linkCount - 1) / linkCount * pitch;
+	std::vector<DMATransfer> parts;
+	for (uint32_t offset = 0; offset < transfer.Size; offset += partSize)
+	{
+		auto& part = parts.emplace_back();
+		part.Direction = transfer.Direction;
+		part.HostBuffer = transfer.HostBuffer + offset;
+		part.Size = std::min(partSize, transfer.Size - offset);
+		part.CardBuffer = transfer.CardBuffer;
+		part.Offset = transfer.Offset + offset;
+	}
+	parts.back().OnComplete = std::move(transfer.OnComplete);
+	return Schedule(std::move(parts));
+}
+
+DMAScheduler::Ticket Channel::DMAWriteFrame(uint32_t bufferId, uint8_t* inBuffer, uint32_t size)
+{
+	return SubmitBands({
+		.Direction = DMADirection::HostToCard,
+		.HostBuffer = inBuffer,
+		.Size = size,
+		.CardBuffer = BlueImage_DMABuffer(bufferId, BLUE_DMA_DATA_TYPE_IMAGE_FRAME),
+		.OnComplete = [this, bufferId, start = TelemetryClock::now()](bool success) {
+			if (!success)
+			{
+				nosEngine.LogE("DMA Write to buffer %d failed", bufferId);
+				return;
+			}
+			Telemetry.RecordDMA(Telemetry.DMAWrite, TelemetryClock::now() - start);
+			// Tell the card to playback this frame at the next interrupt - using this macros tells the card to playback, Image, VBI/Vanc and Hanc data.
+			auto err = bfcRenderBufferUpdate(Instance, BlueBuffer_Image(bufferId));
+			if (err != BERR_NO_ERROR)
+				nosEngine.LogE("DMA Write: Cannot set playback buffer to %d", bufferId);
+		},
+	});
+}
+
+DMAScheduler::Ticket Channel::DMAWriteField(uint32_t bufferId, uint32_t field, uint8_t* inBuffer, uint32_t size)
+{
+	DMATransfer transfer{
+		.Direction = DMADirection::HostToCard,
+		.HostBuffer = inBuffer,
+		.Size = size,
+		.CardBuffer = BlueImage_DMABuffer(bufferId, field ? BLUE_DMA_DATA_TYPE_IMAGE_FIELD2 : BLUE_DMA_DATA_TYPE_IMAGE_FIELD1),
+	};
+	transfer.OnComplete = [this, bufferId, field, start = TelemetryClock::now()](bool success) {
+		if (!success)
+		{
+			nosEngine.LogE("DMA Write to field %d of buffer %d failed", field + 1, bufferId);
+			return;
+		}
+		Telemetry.RecordDMA(Telemetry.DMAWrite, TelemetryClock::now() - start);
+		if (!field)
+			return;
+		auto err = bfcRenderBufferUpdate(Instance, BlueBuffer_Image(bufferId));
+		if (err != BERR_NO_ERROR)
+			nosEngine.LogE("DMA Write: Cannot set playback buffer to %d", bufferId);
+	};
+	return SubmitBands(std::move(transfer));
 }
 
-bool Channel::DMAReadFrame(uint32_t startCaptureBufferId, uint32_t readBufferId, uint8_t* outBuffer, uint32_t size)
+DMAScheduler::Ticket Channel::DMAReadField(uint32_t bufferId, uint32_t field, uint8_t* outBuffer, uint32_t size)
 {
-	auto err = bfcRenderBufferCapture(Instance, BlueBuffer_Image(startCaptureBufferId));
+	return SubmitBands({
+		.Direction = DMADirection::CardToHost,
+		.HostBuffer = outBuffer,
+		.Size = size,
+		.CardBuffer = BlueImage_DMABuffer(bufferId, field ? BLUE_DMA_DATA_TYPE_IMAGE_FIELD2 : BLUE_DMA_DATA_TYPE_IMAGE_FIELD1),
+	});
+}
+
+void Channel::StartCapture(uint32_t bufferId)
+{
+	std::shared_lock lock(SetupMutex);
+	auto err = bfcRenderBufferCapture(Instance, BlueBuffer_Image(bufferId));
 	if (err != BERR_NO_ERROR)
-		nosEngine.LogE("DMA Read: Cannot set capture buffer to %d", startCaptureBufferId);
-	auto ret = bfcDmaReadFromCardAsync(Instance, outBuffer, size, nullptr, BlueImage_DMABuffer(readBufferId, BLUE_DMA_DATA_TYPE_IMAGE_FRAME), 0);
-	if (ret < 0)
-	{
-		nosEngine.LogE("DMA Read returned with '%s'", bfcUtilsGetStringForBErr(ret));
-		return false;
-	}
-	return err == BERR_NO_ERROR;
+		nosEngine.LogE("DMA Read: Cannot set capture buffer to %d", bufferId);
+}
+
+DMAScheduler::Ticket Channel::DMAReadFrame(uint32_t startCaptureBufferId, uint32_t readBufferId, uint8_t* outBuffer, uint32_t size)
+{
+	StartCapture(startCaptureBufferId);
+	return SubmitBands({
+		.Direction = DMADirection::CardToHost,
+		.HostBuffer = outBuffer,
+		.Size = size,
+		.CardBuffer = BlueImage_DMABuffer(readBufferId, BLUE_DMA_DATA_TYPE_IMAGE_FRAME),
+	});
 }
 
-bool Channel::WaitVBI(unsigned long& fieldCount) const
+bool Channel::WaitVBI(VBISample& sample)
 {
-	return BERR_NO_ERROR == (IsInputChannel(VideoChannel)
-		                         ? bfcWaitVideoInputSync(Instance, UPD_FMT_FRAME, &fieldCount)
-		                         : bfcWaitVideoOutputSync(Instance, UPD_FMT_FRAME, &fieldCount));
+	Device->GetDMAScheduler().WaitAll(Queue); // Written frames must be scheduled before the interrupt
+	if (!VBI)
+		return false;
+	auto start = TelemetryClock::now();
+	sample = VBI->Wait();
+	if (sample.Failed)
+		return false;
+	Telemetry.VBIWait.Record(TelemetryClock::now() - start);
+	return true;
 }
 
 }
\ No newline at end of file
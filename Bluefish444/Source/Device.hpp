@@ -15,6 +15,12 @@
 #include <BlueVelvetCFuncPtr.h>
 #include <BlueVelvetCExternHelper.h>
 
+#include "ChannelTable.hpp"
+#include "DMAEngine.hpp"
+#include "DMAScheduler.hpp"
+#include "Telemetry.hpp"
+#include "VBIDispatcher.hpp"
+
 // stl
 #include <unordered_map>
 #include <string>
@@ -22,10 +28,76 @@
 #include <functional>
 #include <array>
 #include <optional>
+#include <atomic>
+#include <vector>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 
 namespace bf
 {
 
+class BluefishDevice;
+class Channel;
+
+// Card buffer ring of a channel. DMA nodes cycle through CycleDepth card buffers; for input channels,
+// capture into a buffer is started CaptureLead VBIs before it is read.
+struct BufferingSettings
+{
+	uint32_t CycleDepth = 4; // 0: All buffers of the card
+	uint32_t CaptureLead = 2;
+};
+
+struct ChannelSettings
+{
+	BufferingSettings Buffering{};
+	bool FieldMode = false; // Wait for and transfer each field separately. Ignored for progressive video modes.
+	EBlueSignalLinkType LinkType = SIGNAL_LINK_TYPE_SINGLE_LINK; // Outputs only, inputs use the link type of the signal
+	EBlueUHDPreference UHDPreference = UHD_PREFERENCE_DEFAULT; // Used when detecting input signals
+	EMemoryFormat MemoryFormat = MEM_FMT_2VUY; // MEM_FMT_2VUY or MEM_FMT_V210
+};
+
+// Properties of an open channel that the per-frame paths need. Computed when the channel is opened, and again when an
+// input channel is reconfigured for a new signal format.
+struct ChannelFormat
+{
+	EVideoModeExt VideoMode = VID_FMT_EXT_INVALID;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	EMemoryFormat MemoryFormat = MEM_FMT_2VUY;
+	uint32_t BytesPerLine = 0; // Line pitch in card memory format, including padding (e.g. V210 lines are 128 byte aligned)
+	uint32_t BufferSize = 0; // Bytes per frame in card memory format
+	bool Progressive = true;
+	std::array<uint32_t, 2> DeltaSeconds{};
+	uint32_t BufferCycleDepth = 4;
+	uint32_t CaptureLead = 2;
+	bool FieldMode = false; // VBIs are field interrupts and DMAs transfer single fields
+	uint32_t FieldBufferSize = 0; // Bytes per field in card memory format
+	bool FirstFieldOdd = false; // First field in time carries the odd lines, see VideoFormat
+	uint32_t LinkCount = 1; // Physical channels bound to this channel. DMAs are split into one band of lines per link.
+};
+
+// Resolved reference to a channel of a device, meant to be cached by nodes (e.g. on pin change) instead of looking up
+// devices by serial every frame. Each time a channel is opened or reconfigured it gets a new generation, so reopening
+// invalidates handles to the previous channel. Acquire re-resolves them in place.
+struct ChannelHandle
+{
+	BluefishDevice* Device = nullptr;
+	EBlueVideoChannel VideoChannel = BLUE_VIDEOCHANNEL_INVALID;
+	const char* ChannelName = "";
+	uint32_t Generation = 0; // 0: Channel was not open when resolved
+	ChannelFormat Format{};
+
+	// Pins the channel for the duration of a DMA/VBI call. Returns an empty reference if the channel is not open.
+	// If the channel was reopened or reconfigured since the handle was resolved, Generation and Format are updated before
+	// returning.
+	ChannelRef Acquire();
+	explicit operator bool() const { return Device != nullptr; }
+};
+
 class SdkInstance
 {
 public:
@@ -40,63 +112,204 @@ protected:
 	std::optional<BLUE_S32> AttachedDevice = std::nullopt;
 };
 
+// Signal on an input, as last detected by the signal monitor of the device
+struct InputSignal
+{
+	bool Present = false;
+	EVideoModeExt VideoMode = VID_FMT_EXT_INVALID;
+	EBlueSignalLinkType LinkType = SIGNAL_LINK_TYPE_SINGLE_LINK;
+	EBlueUHDPreference UHDPreference = UHD_PREFERENCE_DEFAULT; // Video mode was detected with, see ChannelSettings
+	bool operator==(InputSignal const&) const = default;
+};
+
+// Called from the signal monitor thread after the channel was reconfigured for a new format of its input signal.
+// Must not call into the engine other than to schedule nodes, see ChannelNode::OpenChannel.
+using ReconfigureCallback = std::function<void(ChannelFormat const& format)>;
+
+// Card identity remembered from the previous session, so that nodes can refer to a card before enumeration attaches it
+struct CachedDeviceInfo
+{
+	std::string Serial;
+	BLUE_S32 Id = 0;
+	int CardType = 0;
+};
+
 class BluefishDevice
 {
 public:
+	// Attaches all cards in the background, one thread per card. Called on plugin initialization, later calls do nothing.
+	static void StartEnumeration();
+	// Blocks until enumeration completes, starting it if needed
 	static BErr InitializeDevices();
+	// Blocks until enumeration completes if it was started
+	static void WaitForEnumeration();
+	// Waits for enumeration, then shuts down and forgets all devices, so that no thread calls into the SDK afterwards.
+	// Called before the plugin is unloaded.
+	static void ShutdownDevices();
+	static bool IsEnumerationComplete();
+	// Calls callback with the device once the card with the serial is attached, or with nullptr if enumeration completes
+	// without it. Called right away if either is already the case, otherwise from an enumeration thread.
+	static void WhenDeviceReady(std::string const& serial, std::function<void(std::shared_ptr<BluefishDevice>)> callback);
+	// From the device cache of the previous session
+	static std::optional<CachedDeviceInfo> GetCachedDevice(std::string const& serial);
+	// Devices are looked up concurrently with enumeration: Returned devices stay valid, but a device missing now may
+	// be attached later.
 	static std::shared_ptr<BluefishDevice> GetDevice(std::string const& serial);
 	static std::shared_ptr<BluefishDevice> GetDevice(BLUE_S32 id);
 	static void ForEachDevice(std::function<void(BluefishDevice&)>&& func);
+	// Advances each time a card is attached, so that state kept per serial (e.g. menus) can be dropped on re-enumeration
+	static uint32_t GetAttachCount() { return AttachCount; }
 	
 	BluefishDevice(BLUE_S32 deviceId, BErr& error);
 	~BluefishDevice();
 
-	bool CanChannelDoInput(EBlueVideoChannel channel);
-	blue_setup_info GetSetupInfoForInput(EBlueVideoChannel channel, BErr& err) const;
+	// Stops the signal monitor, closes all channels (joining their VBI dispatchers) and stops the DMA workers.
+	// The device is not to be used afterwards.
+	void Shutdown();
+
+	// From the last poll of the signal monitor, so that menus can be built without querying the card
+	bool CanChannelDoInput(EBlueVideoChannel channel) const { return GetInputSignal(channel).Present; }
+	InputSignal GetInputSignal(EBlueVideoChannel channel) const;
+	// Advances each time the signal monitor detects a change of the signal of an input
+	uint32_t GetInputSignalVersion() const { return InputSignalVersion; }
+	// Wakes the signal monitor to detect the input signals now instead of at its next poll, e.g. when the VBI waits of
+	// an input start or stop failing
+	void RequestSignalCheck();
+	blue_setup_info GetSetupInfoForInput(EBlueVideoChannel channel, BErr& err, EBlueUHDPreference uhdPreference = UHD_PREFERENCE_DEFAULT) const;
 
 	// Called from Nodos Task Manager Thread
-    BErr OpenChannel(EBlueVideoChannel channel, EVideoModeExt mode);
+	// Multi-link channels reserve the following link count - 1 channels of the same direction, which cannot be opened
+	// on their own while the group is open.
+	// Input channels follow format changes of their signal without being reopened, see Channel::Reconfigure.
+    BErr OpenChannel(EBlueVideoChannel channel, EVideoModeExt mode, ChannelSettings settings = {}, ReconfigureCallback onReconfigured = {});
+	// Blocks until DMA/VBI calls in flight on the channel return
 	void CloseChannel(EBlueVideoChannel channel);
+	// Returns the channel of the group the channel is a secondary link of, or the channel itself.
+	EBlueVideoChannel GetGroupChannel(EBlueVideoChannel channel) const;
 
+	// Handle is valid even if the channel is not open yet, in which case its Generation is 0.
+	ChannelHandle GetChannelHandle(EBlueVideoChannel channel);
 	// Called from user-created threads (DMA Thread node in In/Out graphs)
-	bool DMAWriteFrame(EBlueVideoChannel channel, uint32_t bufferId, uint8_t* inBuffer, uint32_t size) const;
-	bool DMAReadFrame(EBlueVideoChannel channel, uint32_t nextCaptureBufferId, uint32_t readBufferId, uint8_t* outBuffer, uint32_t size) const;
-	bool WaitVBI(EBlueVideoChannel channel, unsigned long& fieldCount) const;
-	std::array<uint32_t, 2> GetDeltaSeconds(EBlueVideoChannel channel) const;
+	ChannelRef PinChannel(EBlueVideoChannel channel) const { return Channels.Pin(channel); }
 	
 	std::string GetSerial() const;
 	BLUE_S32 GetId() const { return Id; }
 	std::string GetName() const;
 	blue_device_info const& GetInfo() const { return Info; }
+	DMAScheduler& GetDMAScheduler() { return DMA; }
+	ThreadPlacement const& GetThreadPlacement() const { return Placement; }
 private:
+	friend class Channel;
+
+	static void AttachDevice(BLUE_S32 deviceId);
+	// Signal monitor thread: Detects the signal of each input when requested by RequestSignalCheck, at the latest every
+	// SignalPollInterval, and reconfigures open input channels whose signal changed format.
+	static constexpr std::chrono::milliseconds SignalPollInterval{500};
+	void MonitorSignals();
+	void PollSignals();
+	// Requires OpenMutex. Logs and returns false if a secondary link of the group is open or belongs to another group.
+	bool AreLinksFree(EBlueVideoChannel channel, std::vector<EBlueVideoChannel> const& links) const;
+	void CloseChannelLocked(EBlueVideoChannel channel);
+
+	inline static std::mutex DevicesMutex;
 	inline static std::unordered_map<std::string, std::shared_ptr<BluefishDevice>> Devices = {};
+	inline static std::atomic<uint32_t> AttachCount = 0;
 
 	BLUE_S32 Id = 0;
 	SdkInstance Instance;
 	blue_device_info Info{};
+	ThreadPlacement Placement; // Of DMA scheduler workers and VBI dispatchers of the channels
+
+	DMAScheduler DMA; // Outlives the channels
+	ChannelTable Channels;
+	std::atomic<uint32_t> LastGeneration = 0; // Also incremented by the signal monitor on reconfiguration
+	// Serializes OpenChannel and CloseChannel, so that the links of a group are checked and reserved in one step
+	std::mutex OpenMutex;
+	mutable std::mutex GroupMutex; // Guards GroupOfLink, which is also read by menus and nodes
+	std::unordered_map<EBlueVideoChannel, EBlueVideoChannel> GroupOfLink; // Secondary link -> channel of the group
 
-	std::unordered_map<EBlueVideoChannel, std::unique_ptr<class Channel>> Channels;
+	mutable std::mutex SignalMutex;
+	std::condition_variable SignalMonitorWakeup; // Notified to stop the monitor or check the signals
+	bool StopSignalMonitor = false;
+	bool SignalCheckRequested = false;
+	std::unordered_map<EBlueVideoChannel, InputSignal> InputSignals;
+	std::atomic<uint32_t> InputSignalVersion = 0;
+	std::unordered_map<EBlueVideoChannel, uint32_t> CheckedGenerations; // Of the open channel each input signal was compared with
+	std::thread SignalMonitor; // Joined before the channels are closed
 };
 
 class Channel
 {
 public:
-	Channel(BluefishDevice* device, EBlueVideoChannel channel, EVideoModeExt mode, BErr& err);
+	Channel(BluefishDevice* device, EBlueVideoChannel channel, EVideoModeExt mode, ChannelSettings settings, uint32_t generation, BErr& err, ReconfigureCallback onReconfigured = {});
 	~Channel();
 
 	Channel(Channel const&) = delete;
 	
 	// Called from DMA threads
-	bool DMAWriteFrame(uint32_t bufferId, uint8_t* inBuffer, uint32_t size);
-	bool DMAReadFrame(uint32_t nextCaptureBufferId, uint32_t readBufferId, uint8_t* outBuffer, uint32_t size);
-	bool WaitVBI(unsigned long& fieldCount) const;
-	std::array<uint32_t, 2> GetDeltaSeconds() const { return DeltaSeconds; }
+	// DMA calls return as soon as the transfer is queued on the DMA scheduler of the device, which runs it before
+	// transfers of other channels with later VBI deadlines. Buffers must stay valid until the returned ticket is waited for.
+	// Written frames are scheduled for playback when their transfer completes, at the latest before the next WaitVBI returns.
+	DMAScheduler::Ticket DMAWriteFrame(uint32_t bufferId, uint8_t* inBuffer, uint32_t size);
+	DMAScheduler::Ticket DMAReadFrame(uint32_t nextCaptureBufferId, uint32_t readBufferId, uint8_t* outBuffer, uint32_t size);
+	// Field mode: field is 0 for the first field in time, 1 for the second one.
+	// A buffer is scheduled for playback once its second field is written.
+	DMAScheduler::Ticket DMAWriteField(uint32_t bufferId, uint32_t field, uint8_t* inBuffer, uint32_t size);
+	DMAScheduler::Ticket DMAReadField(uint32_t bufferId, uint32_t field, uint8_t* outBuffer, uint32_t size);
+	void StartCapture(uint32_t bufferId);
+	bool WaitDMA(DMAScheduler::Ticket const& ticket);
+	// Transfers of the channel that can be pending before a DMA call blocks
+	void SetMaxDMAInFlight(uint32_t maxInFlight);
+	// Waits for the next field interrupt in field mode, frame interrupt otherwise, after completing queued DMAs.
+	// All waiters of the channel share one hardware wait on the VBI dispatcher thread of the channel.
+	bool WaitVBI(VBISample& sample);
+	// For subscribers that do not transfer frames, e.g. schedulers. Null if the channel failed to open.
+	VBIDispatcher* GetVBIDispatcher() { return VBI.get(); }
+	unsigned long GetLastFieldCount() const { return LastFieldCount; }
+	std::array<uint32_t, 2> GetDeltaSeconds() const { return GetFormat().DeltaSeconds; }
+	// Copied, since reconfiguration replaces the format. If generation is given, the generation of the format is stored in it.
+	ChannelFormat GetFormat(uint32_t* generation = nullptr) const;
+	uint32_t GetGeneration() const { return Generation; }
+	ChannelSettings const& GetSettings() const { return Settings; }
+	ChannelTelemetry& GetTelemetry() { return Telemetry; }
+
+	// Called from the signal monitor thread of the device: Sets the card up again for the signal detected on the input,
+	// on the same SDK instance, card buffers and VBI dispatcher. DMA submissions of the channel are held and queued DMAs
+	// complete first, and the VBI wait and capture calls are excluded meanwhile (see SetupMutex). The channel gets a new
+	// generation, through which DMA nodes pick up the new format on their next Acquire. Fails if the signal changed its
+	// link count, since the links of the group are reserved when the channel is opened.
+	BErr Reconfigure();
 	
 protected:
+	BErr SetupInput(blue_setup_info setup, EVideoModeExt& mode, EBlueSignalLinkType& linkType);
+	// Fills the video mode dependent fields of format and sets the VBI period of the telemetry
+	BErr DescribeVideoMode(EVideoModeExt mode, EBlueSignalLinkType linkType, ChannelFormat& format);
+
+	// Transfers of multi-link channels are split into one band of lines per link and joined into one ticket. The bands
+	// are transfers of the same card buffer on the channel's SDK instance, run concurrently; they are not routed per link.
+	DMAScheduler::Ticket SubmitBands(DMATransfer transfer);
+	DMAScheduler::Ticket Schedule(std::vector<DMATransfer> parts);
+
 	BluefishDevice* Device;
 	EBlueVideoChannel VideoChannel;
+	ChannelSettings Settings;
+	ReconfigureCallback OnReconfigured;
+	std::atomic<uint32_t> Generation;
 	SdkInstance Instance;
-	std::array<uint32_t, 2> DeltaSeconds{};
+	DMAEngine DMA;
+	DMAQueue Queue{DMA};
+	mutable std::mutex FormatMutex; // Format and Generation are replaced together on reconfiguration
+	ChannelFormat Format{};
+	std::atomic<bool> FieldInterrupts = false; // Update type of the hardware VBI wait
+	// Held exclusively by Reconfigure while the card is set up again, shared by calls on Instance outside the DMA queue
+	// and by the hardware VBI wait. Reconfiguring makes the VBI wait skip the card, so that it cannot starve Reconfigure.
+	std::shared_mutex SetupMutex;
+	std::atomic<bool> Reconfiguring = false;
+	bool LastVBIFailed = false; // Of the VBI dispatcher thread, to request a signal check when waits start or stop failing
+	std::atomic<unsigned long> LastFieldCount = 0;
+	ChannelTelemetry Telemetry;
+	SdkInstance VBIInstance; // Only waited on by the VBI dispatcher, so that its blocking waits do not share an instance with DMA
+	std::unique_ptr<VBIDispatcher> VBI; // Stopped before the SDK instances are detached
 };
 
 inline void ReplaceString(std::string &str, const std::string &toReplace, const std::string &replacement) {
@@ -128,4 +341,31 @@ inline bool IsInputChannel(EBlueVideoChannel ch)
 		   ch == BLUE_VIDEO_INPUT_CHANNEL_7 || ch == BLUE_VIDEO_INPUT_CHANNEL_8;
 }
 
+inline uint32_t GetLinkCount(EBlueSignalLinkType linkType)
+{
+	switch (linkType)
+	{
+	case SIGNAL_LINK_TYPE_DUAL_LINK: return 2;
+	case SIGNAL_LINK_TYPE_QUAD_LINK: return 4;
+	default: return 1;
+	}
+}
+
+// Physical channels of a channel group: The channel itself and the following linkCount - 1 channels of the same direction.
+// Returns an empty list if the group would not start at a multiple of linkCount or would exceed the 8 channels of a direction.
+inline std::vector<EBlueVideoChannel> GetLinkChannels(EBlueVideoChannel channel, uint32_t linkCount)
+{
+	static constexpr EBlueVideoChannel Inputs[] = {
+		BLUE_VIDEO_INPUT_CHANNEL_1, BLUE_VIDEO_INPUT_CHANNEL_2, BLUE_VIDEO_INPUT_CHANNEL_3, BLUE_VIDEO_INPUT_CHANNEL_4,
+		BLUE_VIDEO_INPUT_CHANNEL_5, BLUE_VIDEO_INPUT_CHANNEL_6, BLUE_VIDEO_INPUT_CHANNEL_7, BLUE_VIDEO_INPUT_CHANNEL_8};
+	static constexpr EBlueVideoChannel Outputs[] = {
+		BLUE_VIDEO_OUTPUT_CHANNEL_1, BLUE_VIDEO_OUTPUT_CHANNEL_2, BLUE_VIDEO_OUTPUT_CHANNEL_3, BLUE_VIDEO_OUTPUT_CHANNEL_4,
+		BLUE_VIDEO_OUTPUT_CHANNEL_5, BLUE_VIDEO_OUTPUT_CHANNEL_6, BLUE_VIDEO_OUTPUT_CHANNEL_7, BLUE_VIDEO_OUTPUT_CHANNEL_8};
+	auto& channels = IsInputChannel(channel) ? Inputs : Outputs;
+	uint32_t first = GetChannelNumber(channel) - 1;
+	if (!linkCount || first % linkCount || first + linkCount > std::size(channels))
+		return {};
+	return std::vector<EBlueVideoChannel>(std::begin(channels) + first, std::begin(channels) + first + linkCount);
+}
+
 }
\ No newline at end of file
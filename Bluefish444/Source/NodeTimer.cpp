@@ -0,0 +1,109 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "NodeTimer.hpp"
+
+// stl
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+namespace
+{
+
+struct NodeTimer
+{
+	struct Request
+	{
+		nosUUID NodeId;
+		TelemetryClock::time_point Time;
+	};
+
+	std::mutex Mutex;
+	std::condition_variable Changed;
+	std::vector<Request> Requests; // At most one per node
+	std::thread Thread;
+	bool Stop = false;
+
+	static bool IsSameNode(nosUUID const& a, nosUUID const& b)
+	{
+		return 0 == memcmp(&a, &b, sizeof(nosUUID));
+	}
+
+	// Requires Mutex
+	void RemoveLocked(nosUUID const& nodeId)
+	{
+		std::erase_if(Requests, [&](auto& request) { return IsSameNode(request.NodeId, nodeId); });
+	}
+
+	void Run()
+	{
+		std::unique_lock lock(Mutex);
+		while (!Stop)
+		{
+			if (Requests.empty())
+			{
+				Changed.wait(lock);
+				continue;
+			}
+			auto next = std::min_element(Requests.begin(), Requests.end(), [](auto& a, auto& b) { return a.Time < b.Time; });
+			if (TelemetryClock::now() < next->Time)
+			{
+				Changed.wait_until(lock, next->Time);
+				continue;
+			}
+			nosScheduleNodeParams schedule{.NodeId = next->NodeId, .AddScheduleCount = 1};
+			Requests.erase(next);
+			// Not called under the lock, as the engine may hold its own locks while a node cancels its request
+			lock.unlock();
+			nosEngine.ScheduleNode(&schedule);
+			lock.lock();
+		}
+	}
+};
+
+NodeTimer Timer;
+
+}
+
+void ScheduleNodeAt(nosUUID const& nodeId, TelemetryClock::time_point time)
+{
+	std::unique_lock lock(Timer.Mutex);
+	if (!Timer.Thread.joinable())
+	{
+		Timer.Stop = false;
+		Timer.Thread = std::thread([] { Timer.Run(); });
+	}
+	Timer.RemoveLocked(nodeId);
+	Timer.Requests.push_back({nodeId, time});
+	Timer.Changed.notify_one();
+}
+
+void CancelScheduledNode(nosUUID const& nodeId)
+{
+	std::unique_lock lock(Timer.Mutex);
+	Timer.RemoveLocked(nodeId);
+}
+
+void StopNodeTimer()
+{
+	std::thread thread;
+	{
+		std::unique_lock lock(Timer.Mutex);
+		Timer.Stop = true;
+		Timer.Requests.clear();
+		thread = std::move(Timer.Thread);
+	}
+	Timer.Changed.notify_one();
+	if (thread.joinable())
+		thread.join();
+}
+
+}
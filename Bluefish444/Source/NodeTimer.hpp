@@ -0,0 +1,25 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <Nodos/PluginHelpers.hpp>
+
+#include "Telemetry.hpp"
+
+namespace bf
+{
+
+// Schedules nodes at a later time from a timer thread shared by all nodes, so that a node that paces its runs (e.g. DMA
+// Write with Pacing) does not block the thread executing it until its next run.
+
+// Schedules the node once at time through nosEngine.ScheduleNode. Replaces a pending request of the node.
+void ScheduleNodeAt(nosUUID const& nodeId, TelemetryClock::time_point time);
+// Drops the pending request of the node. A request that is due as this is called may still schedule the node once.
+void CancelScheduledNode(nosUUID const& nodeId);
+// Joins the timer thread, e.g. before the plugin is unloaded. Pending requests are dropped.
+// The thread is started again on the next ScheduleNodeAt call.
+void StopNodeTimer();
+
+}
@@ -0,0 +1,91 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "OutputPacer.hpp"
+
+// stl
+#include <algorithm>
+#include <cstdio>
+
+namespace bf
+{
+
+void OutputPacer::Reset(uint64_t vbiPeriod, TelemetryClock::duration minMargin)
+{
+	VBIPeriod = vbiPeriod;
+	MinMargin = minMargin;
+	Margin = minMargin;
+	RequestTime = {};
+	TargetVBI = {};
+	Production.Reset();
+	LastTransferTime = {};
+	ProductionP99 = 0;
+	TransferP99 = 0;
+	WindowCount = 0;
+	Measured = false;
+	Misses = 0;
+}
+
+bool OutputPacer::OnFrameReady(TelemetryClock::time_point now, LatencyHistogram const& transferTime)
+{
+	if (RequestTime != TelemetryClock::time_point{})
+		Production.Record(now - RequestTime);
+	bool late = TargetVBI != TelemetryClock::time_point{} && now + std::chrono::nanoseconds(TransferP99) > TargetVBI;
+	if (late)
+		OnMiss();
+	else if (TargetVBI != TelemetryClock::time_point{})
+		Margin -= (Margin - MinMargin) / 64;
+	RequestTime = {};
+	TargetVBI = {};
+
+	if (++WindowCount < WindowFrames)
+		return !late;
+	WindowCount = 0;
+	ProductionP99 = Production.GetSnapshot().Percentile(99);
+	Production.Reset();
+	auto transfers = transferTime.GetSnapshot();
+	auto window = transfers.Since(LastTransferTime);
+	if (window.Count)
+		TransferP99 = window.Percentile(99);
+	LastTransferTime = std::move(transfers);
+	Measured = true;
+	return !late;
+}
+
+void OutputPacer::OnFrameSkipped()
+{
+	if (TargetVBI != TelemetryClock::time_point{})
+		OnMiss();
+	RequestTime = {};
+	TargetVBI = {};
+}
+
+void OutputPacer::OnMiss()
+{
+	++Misses;
+	Margin = std::min<TelemetryClock::duration>(std::max<TelemetryClock::duration>(Margin * 2, std::chrono::microseconds(100)), std::chrono::nanoseconds(VBIPeriod / 2));
+}
+
+TelemetryClock::time_point OutputPacer::GetRequestTime(TelemetryClock::time_point now, std::optional<TelemetryClock::time_point> lastVBI)
+{
+	RequestTime = now;
+	if (!Measured || !lastVBI || !VBIPeriod)
+		return now;
+	auto period = std::chrono::nanoseconds(VBIPeriod);
+	auto lead = std::chrono::duration_cast<TelemetryClock::duration>(std::chrono::nanoseconds(ProductionP99 + TransferP99)) + Margin;
+	// First VBI the frame can make, at p99 durations
+	auto periods = (now + lead - *lastVBI + period - std::chrono::nanoseconds(1)) / period;
+	TargetVBI = *lastVBI + std::max<int64_t>(periods, 1) * std::chrono::duration_cast<TelemetryClock::duration>(period);
+	RequestTime = std::max(now, TargetVBI - lead);
+	return RequestTime;
+}
+
+std::string OutputPacer::ToString() const
+{
+	auto ms = [](uint64_t ns) { return ns / 1e6; };
+	char str[128];
+	snprintf(str, sizeof(str), "margin %.2f ms, production p99 %.2f ms, transfer p99 %.2f ms, missed %llu",
+	         ms(std::chrono::duration_cast<std::chrono::nanoseconds>(Margin).count()), ms(ProductionP99), ms(TransferP99), (unsigned long long)Misses);
+	return str;
+}
+
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include "Telemetry.hpp"
+
+// stl
+#include <string>
+
+namespace bf
+{
+
+// Paces the frame requests of an output channel, so that frames are produced as late as possible: The next frame is
+// requested when its production and transfer, at their p99 durations over the last frames, complete a safety margin
+// before the VBI it is shown at. The margin doubles when a frame misses its VBI and decays back to the minimum while
+// frames are on time. Until durations are measured, frames are requested right away.
+class OutputPacer
+{
+public:
+	static constexpr uint32_t WindowFrames = 32; // p99 durations are measured over this many frames
+
+	// vbiPeriod: Nanoseconds between the VBIs the channel is written at
+	void Reset(uint64_t vbiPeriod, TelemetryClock::duration minMargin);
+	// Called when the requested frame is ready to be transferred. transferTime: Run time of the transfers of the channel.
+	// Returns false if the frame is too late for the VBI it was requested for.
+	bool OnFrameReady(TelemetryClock::time_point now, LatencyHistogram const& transferTime);
+	// Called instead of OnFrameReady when the requested frame is not written, e.g. the GPU has not finished it
+	void OnFrameSkipped();
+	// Time to request the next frame at. lastVBI: Wake time of the latest VBI of the channel, if any.
+	TelemetryClock::time_point GetRequestTime(TelemetryClock::time_point now, std::optional<TelemetryClock::time_point> lastVBI);
+
+	TelemetryClock::duration GetMargin() const { return Margin; }
+	uint64_t GetMisses() const { return Misses; }
+	// e.g. "margin 1.00 ms, production p99 4.10 ms, transfer p99 1.20 ms, missed 2"
+	std::string ToString() const;
+
+private:
+	void OnMiss();
+
+	uint64_t VBIPeriod = 0;
+	TelemetryClock::duration MinMargin{};
+	TelemetryClock::duration Margin{};
+	TelemetryClock::time_point RequestTime{}; // Of the frame in production
+	TelemetryClock::time_point TargetVBI{}; // Of the frame in production. Epoch if not paced.
+	LatencyHistogram Production; // Request to ready, over the current window
+	LatencySnapshot LastTransferTime; // Transfer times at the start of the current window
+	uint64_t ProductionP99 = 0;
+	uint64_t TransferP99 = 0;
+	uint32_t WindowCount = 0;
+	bool Measured = false;
+	uint64_t Misses = 0;
+};
+
+}
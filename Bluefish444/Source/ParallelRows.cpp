@@ -0,0 +1,109 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ParallelRows.hpp"
+
+// stl
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bf
+{
+
+namespace
+{
+
+struct RowWorkers
+{
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::deque<std::function<void()>> Queue;
+	std::vector<std::thread> Threads;
+	bool Stop = false;
+
+	void Run()
+	{
+		while (true)
+		{
+			std::function<void()> work;
+			{
+				std::unique_lock lock(Mutex);
+				WorkAvailable.wait(lock, [this] { return Stop || !Queue.empty(); });
+				if (Queue.empty())
+					return;
+				work = std::move(Queue.front());
+				Queue.pop_front();
+			}
+			work();
+		}
+	}
+
+	// Requires Mutex
+	void StartLocked()
+	{
+		if (!Threads.empty())
+			return;
+		Stop = false;
+		uint32_t count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		for (uint32_t i = 0; i < count; ++i)
+			Threads.emplace_back([this] { Run(); });
+	}
+};
+
+RowWorkers Workers;
+
+}
+
+void ParallelRows(uint32_t rows, uint32_t minRowsPerSlice, uint32_t maxThreads, std::function<void(uint32_t begin, uint32_t end)> const& fn)
+{
+	if (maxThreads == 0)
+		maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	uint32_t slices = std::min(maxThreads, rows / std::max(minRowsPerSlice, 1u));
+	if (slices <= 1)
+	{
+		if (rows)
+			fn(0, rows);
+		return;
+	}
+
+	std::mutex doneMutex;
+	std::condition_variable doneCondition;
+	uint32_t remaining = slices - 1;
+	auto sliceBegin = [rows, slices](uint32_t slice) { return uint32_t(uint64_t(rows) * slice / slices); };
+	{
+		std::unique_lock lock(Workers.Mutex);
+		Workers.StartLocked();
+		for (uint32_t slice = 1; slice < slices; ++slice)
+		{
+			Workers.Queue.push_back([&, begin = sliceBegin(slice), end = sliceBegin(slice + 1)] {
+				fn(begin, end);
+				std::unique_lock doneLock(doneMutex);
+				if (--remaining == 0)
+					doneCondition.notify_one();
+			});
+		}
+	}
+	Workers.WorkAvailable.notify_all();
+	fn(0, sliceBegin(1));
+	std::unique_lock doneLock(doneMutex);
+	doneCondition.wait(doneLock, [&] { return remaining == 0; });
+}
+
+void StopRowWorkers()
+{
+	std::vector<std::thread> threads;
+	{
+		std::unique_lock lock(Workers.Mutex);
+		Workers.Stop = true;
+		threads = std::move(Workers.Threads);
+		Workers.Threads.clear();
+	}
+	Workers.WorkAvailable.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+// stl
+#include <cstdint>
+#include <functional>
+
+namespace bf
+{
+
+// Splits [0, rows) into contiguous slices of at least minRowsPerSlice rows and runs fn(begin, end) on each slice,
+// using the calling thread and a shared pool of worker threads. Returns when all slices are done.
+// maxThreads limits the number of slices (0: number of hardware threads, 1: run on the calling thread).
+void ParallelRows(uint32_t rows, uint32_t minRowsPerSlice, uint32_t maxThreads, std::function<void(uint32_t begin, uint32_t end)> const& fn);
+
+// Joins the worker threads, e.g. before the plugin is unloaded. Must not overlap with ParallelRows calls.
+// Workers are started again on the next ParallelRows call.
+void StopRowWorkers();
+
+}
@@ -0,0 +1,211 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/Modules.h>
+
+#include "DMANodeBase.hpp"
+#include "ChannelHelpers.hpp"
+#include "Device.hpp"
+#include "ClipReader.hpp"
+
+// stl
+#include <atomic>
+#include <mutex>
+
+namespace bf
+{
+// Plays a clip in card memory format (a recording of the Record node, or a headerless file of frames) on an output
+// channel: Waits for the VBI and transfers the frame due at it from the memory-mapped clip, without the GPU.
+// The clip position follows the field count of the channel, so that each VBI shows the frame it is due to show even if
+// a wait was missed.
+struct PlayNodeContext : DMANodeBase
+{
+	PlayNodeContext(const nosFbNode* node) : DMANodeBase(node)
+	{
+	}
+
+	nos::Buffer ChannelInfo{};
+	ChannelHandle Handle{};
+	VBISample LastVBI{};
+	ClipReader Clip;
+	uint32_t ClipGeneration = 0; // Of the channel the clip was checked against
+	bool FieldEntries = false; // Clip has a field per entry, played one per field VBI
+	std::optional<int64_t> StartFieldCount; // Field count the first frame is played after
+	uint64_t PrefetchedEnd = 0; // Position up to which frames were prefetched
+	uint64_t PublishedFrame = UINT64_MAX;
+	DMAScheduler::Ticket LastTransfer;
+	bool Loop = true;
+	uint32_t ReadAhead = 8;
+
+	// Set from pin changes, applied by the next execution
+	std::mutex RequestMutex;
+	std::string Path;
+	std::atomic_bool PathChanged = false;
+
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
+	{
+		if (pinName == NOS_NAME("Channel"))
+		{
+			if (ChannelInfo.Size() == value.Size && memcmp(ChannelInfo.Data(), value.Data, value.Size) == 0)
+				return;
+			ChannelInfo = {};
+			Handle = ResolveChannelHandle(value);
+			if (!Handle)
+				return;
+			ChannelInfo = value;
+			SetWatchLogNames(Handle);
+			UpdateDeltaSeconds(Handle);
+			nosEngine.RecompilePath(NodeId);
+		}
+		else if (pinName == NOS_NAME("Path"))
+		{
+			std::unique_lock lock(RequestMutex);
+			Path = nos::InterpretPinValue<const char>(value);
+			PathChanged = true;
+		}
+		else if (pinName == NOS_NAME("Loop"))
+			Loop = *nos::InterpretPinValue<bool>(value);
+		else if (pinName == NOS_NAME("ReadAhead"))
+			ReadAhead = std::max(*nos::InterpretPinValue<uint32_t>(value), 1u);
+	}
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		auto result = PlayNextFrame();
+		if (result == NOS_RESULT_SUCCESS)
+		{
+			nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
+			nosEngine.ScheduleNode(&schedule);
+		}
+		return result;
+	}
+
+	nosResult PlayNextFrame()
+	{
+		auto channel = Handle.Acquire();
+		if (!channel)
+			return NOS_RESULT_FAILED;
+		if (UpdateDeltaSeconds(Handle))
+			nosEngine.RecompilePath(NodeId);
+		if (IsInputChannel(Handle.VideoChannel))
+		{
+			nosEngine.LogE("Play: %s is not an output channel", Handle.ChannelName);
+			return NOS_RESULT_FAILED;
+		}
+		if (PathChanged.exchange(false) || (Clip.IsOpen() && ClipGeneration != Handle.Generation))
+			OpenClip(*channel);
+
+		if (!channel->WaitVBI(LastVBI))
+			return NOS_RESULT_FAILED;
+		if (!Clip.IsOpen())
+			return NOS_RESULT_SUCCESS;
+
+		// Frames start after a frame boundary (even field count), fields after the field count of their parity
+		int64_t fieldCount = LastVBI.FieldCount;
+		if (!StartFieldCount)
+			StartFieldCount = ((fieldCount + 1) & ~int64_t(1)) + (FieldEntries && Clip.GetEntry(0).Field == 1 ? 1 : 0);
+		auto elapsed = fieldCount - *StartFieldCount;
+		if (elapsed < 0)
+			return NOS_RESULT_SUCCESS;
+		uint64_t position = FieldEntries ? elapsed : elapsed / 2;
+		if (!FieldEntries && Handle.Format.FieldMode && elapsed % 2)
+			return NOS_RESULT_SUCCESS; // Frames are written at frame boundaries in field mode
+		auto count = Clip.GetFrameCount();
+		if (!Loop && position >= count)
+			return NOS_RESULT_SUCCESS; // Card keeps showing the last frame
+
+		auto frame = position % count;
+		auto& entry = Clip.GetEntry(frame);
+		auto fieldType = entry.Field == RecordingIndexEntry::Frame ? NOS_TEXTURE_FIELD_TYPE_UNKNOWN : GetFieldType(Handle.Format, entry.Field);
+		if (!WriteFrame(*channel, Handle.Format, Clip.GetData(frame), entry.Size, fieldType, &LastTransfer))
+			return NOS_RESULT_FAILED;
+
+		// Each frame entering the window is prefetched once, the whole window after a jump
+		PrefetchedEnd = std::max(PrefetchedEnd, position + 1);
+		auto windowEnd = position + 1 + ReadAhead;
+		if (PrefetchedEnd < windowEnd)
+		{
+			Clip.Prefetch(PrefetchedEnd, uint32_t(windowEnd - PrefetchedEnd));
+			PrefetchedEnd = windowEnd;
+		}
+		if (PublishedFrame != frame)
+		{
+			PublishedFrame = frame;
+			nosEngine.SetPinValue(PinName2Id[NOS_NAME("Frame")], nos::Buffer::From(uint32_t(frame)));
+		}
+		return NOS_RESULT_SUCCESS;
+	}
+
+	void OpenClip(Channel& channel)
+	{
+		CloseClip(channel);
+		std::string path;
+		{
+			std::unique_lock lock(RequestMutex);
+			path = Path;
+		}
+		auto& format = Handle.Format;
+		if (path.empty() || !Clip.Open(path, format.BufferSize))
+			return;
+		auto& header = Clip.GetHeader();
+		FieldEntries = format.FieldMode && Clip.GetEntry(0).Size == format.FieldBufferSize;
+		bool matches = FieldEntries || Clip.GetEntry(0).Size == format.BufferSize;
+		if (header)
+			matches = matches && header->MemoryFormat == uint32_t(format.MemoryFormat) && header->Width == format.Width &&
+			          header->Height == format.Height && header->BytesPerLine == format.BytesPerLine;
+		if (!matches)
+		{
+			nosEngine.LogE("Play: Frames of %s do not match the video mode and pixel format of %s", path.c_str(), Handle.ChannelName);
+			Clip.Close();
+			return;
+		}
+		if (header && header->VideoMode != uint32_t(format.VideoMode))
+			nosEngine.LogW("Play: %s was recorded in another video mode, playing at the frame rate of %s", path.c_str(), Handle.ChannelName);
+		ClipGeneration = Handle.Generation;
+		Clip.Prefetch(0, ReadAhead);
+		PrefetchedEnd = ReadAhead;
+		nosEngine.LogI("Play: Playing %llu %s of %s on %s", (unsigned long long)Clip.GetFrameCount(), FieldEntries ? "fields" : "frames", path.c_str(), Handle.ChannelName);
+	}
+
+	// Transfers read from the mapping, so they must complete before it is unmapped
+	void CloseClip(Channel& channel)
+	{
+		if (LastTransfer)
+			channel.WaitDMA(LastTransfer);
+		LastTransfer = {};
+		Clip.Close();
+		StartFieldCount.reset();
+		PrefetchedEnd = 0;
+	}
+
+	void GetScheduleInfo(nosScheduleInfo* out) override
+	{
+		*out = nosScheduleInfo {
+			.Importance = 1,
+			.DeltaSeconds = DeltaSeconds,
+			.Type = NOS_SCHEDULE_TYPE_ON_DEMAND,
+		};
+	}
+
+	void OnPathStart() override
+	{
+		PathChanged = true; // Reopened, so that playback restarts at the first frame
+		nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
+		nosEngine.ScheduleNode(&schedule);
+	}
+
+	void OnPathStop() override
+	{
+		if (auto channel = Handle.Acquire())
+			CloseClip(*channel);
+		else
+			Clip.Close(); // Transfers completed when the channel was closed
+		DMANodeBase::OnPathStop();
+	}
+};
+
+nosResult RegisterPlayNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("Play"), PlayNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+}
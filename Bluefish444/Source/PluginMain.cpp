@@ -9,6 +9,11 @@
 #define LOAD_FUNC_PTR_V6_5_3
 #include <BlueVelvetCFuncPtr.h>
 
+#include "Device.hpp"
+#include "NodeTimer.hpp"
+#include "ParallelRows.hpp"
+#include "Simulator.hpp"
+
 NOS_INIT()
 NOS_VULKAN_INIT()
 
@@ -27,6 +32,14 @@ enum class Nodes : int
 	OutputNode,
 	DMARead,
 	InputNode,
+	DMAPump,
+	DMABufferPool,
+	Record,
+	Play,
+	ReplayCapture,
+	Replay,
+	UnpackFrame,
+	PackFrame,
 	Count
 };
 
@@ -36,6 +49,14 @@ nosResult RegisterDMAWriteNode(nosNodeFunctions*);
 nosResult RegisterOutputNode(nosNodeFunctions*);
 nosResult RegisterDMAReadNode(nosNodeFunctions*);
 nosResult RegisterInputNode(nosNodeFunctions*);
+nosResult RegisterDMAPumpNode(nosNodeFunctions*);
+nosResult RegisterDMABufferPoolNode(nosNodeFunctions*);
+nosResult RegisterRecordNode(nosNodeFunctions*);
+nosResult RegisterPlayNode(nosNodeFunctions*);
+nosResult RegisterReplayCaptureNode(nosNodeFunctions*);
+nosResult RegisterReplayNode(nosNodeFunctions*);
+nosResult RegisterUnpackFrameNode(nosNodeFunctions*);
+nosResult RegisterPackFrameNode(nosNodeFunctions*);
 
 NOSAPI_ATTR nosResult NOSAPI_CALL ExportNodeFunctions(size_t* outCount, nosNodeFunctions** outFunctions)
 {
@@ -49,11 +70,33 @@ NOSAPI_ATTR nosResult NOSAPI_CALL ExportNodeFunctions(size_t* outCount, nosNodeF
 	NOS_RETURN_ON_FAILURE(RegisterOutputNode(outFunctions[static_cast<int>(Nodes::OutputNode)]))
 	NOS_RETURN_ON_FAILURE(RegisterDMAReadNode(outFunctions[static_cast<int>(Nodes::DMARead)]))
 	NOS_RETURN_ON_FAILURE(RegisterInputNode(outFunctions[static_cast<int>(Nodes::InputNode)]))
+	NOS_RETURN_ON_FAILURE(RegisterDMAPumpNode(outFunctions[static_cast<int>(Nodes::DMAPump)]))
+	NOS_RETURN_ON_FAILURE(RegisterDMABufferPoolNode(outFunctions[static_cast<int>(Nodes::DMABufferPool)]))
+	NOS_RETURN_ON_FAILURE(RegisterRecordNode(outFunctions[static_cast<int>(Nodes::Record)]))
+	NOS_RETURN_ON_FAILURE(RegisterPlayNode(outFunctions[static_cast<int>(Nodes::Play)]))
+	NOS_RETURN_ON_FAILURE(RegisterReplayCaptureNode(outFunctions[static_cast<int>(Nodes::ReplayCapture)]))
+	NOS_RETURN_ON_FAILURE(RegisterReplayNode(outFunctions[static_cast<int>(Nodes::Replay)]))
+	NOS_RETURN_ON_FAILURE(RegisterUnpackFrameNode(outFunctions[static_cast<int>(Nodes::UnpackFrame)]))
+	NOS_RETURN_ON_FAILURE(RegisterPackFrameNode(outFunctions[static_cast<int>(Nodes::PackFrame)]))
 	return NOS_RESULT_SUCCESS;
 }
 
 NOSAPI_ATTR nosResult NOSAPI_CALL Initialize()
 {
+	if (sim::IsSimulatorRequested())
+	{
+		if (!sim::LoadFunctionPointers_Simulator(sim::LoadConfigFromEnvironment()))
+			return NOS_RESULT_FAILED;
+		nosModuleStatusMessage message{
+			.ModuleId = nosEngine.Module->Id,
+			.UpdateType = NOS_MODULE_STATUS_MESSAGE_UPDATE_TYPE_REPLACE,
+			.MessageType = NOS_MODULE_STATUS_MESSAGE_TYPE_WARNING,
+			.Message = "Running on simulated Bluefish444 devices (BLUEFISH444_SIMULATOR is set)"
+		};
+		nosEngine.SendModuleStatusMessageUpdate(&message);
+		BluefishDevice::StartEnumeration();
+		return NOS_RESULT_SUCCESS;
+	}
 	if (!LoadFunctionPointers_BlueVelvetC())
 	{
 		constexpr auto text = "Failed to load BlueVelvetC function pointers. Make sure you have at Bluefish SDK with version at least 6.5.3.";
@@ -66,6 +109,7 @@ NOSAPI_ATTR nosResult NOSAPI_CALL Initialize()
 		nosEngine.SendModuleStatusMessageUpdate(&message);
 		return NOS_RESULT_FAILED;
 	}
+	BluefishDevice::StartEnumeration();
 	return NOS_RESULT_SUCCESS;
 }
 
@@ -73,6 +117,11 @@ NOSAPI_ATTR nosResult NOSAPI_CALL Initialize()
 /// After this point, you must have your DLL dependencies unloaded (if any).
 NOSAPI_ATTR nosResult NOSAPI_CALL OnPreUnloadPlugin()
 {
+	// Threads of devices and channels call into the SDK, so they are stopped before the simulator is unloaded
+	BluefishDevice::ShutdownDevices();
+	StopNodeTimer();
+	StopRowWorkers();
+	sim::UnloadSimulator();
 	return NOS_RESULT_SUCCESS;
 }
 
@@ -0,0 +1,209 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/Modules.h>
+
+#include "DMANodeBase.hpp"
+#include "ChannelHelpers.hpp"
+#include "Device.hpp"
+#include "RecordingWriter.hpp"
+
+// stl
+#include <atomic>
+#include <mutex>
+
+namespace bf
+{
+// Waits for the next VBI of an input channel and reads the frame into host memory that is written to disk as is (see
+// RecordingWriter and Recording.hpp). Frames never go through the GPU, so that recording many channels at once is only
+// bound by DMA and disk bandwidth.
+struct RecordNodeContext : DMANodeBase
+{
+	RecordNodeContext(const nosFbNode* node) : DMANodeBase(node)
+	{
+	}
+
+	nos::Buffer ChannelInfo{};
+	ChannelHandle Handle{};
+	VBISample LastVBI{};
+	RecordingWriter Writer;
+	uint32_t RecordingGeneration = 0; // Of the channel the open recording is of
+	uint64_t Dropped = 0;
+	uint64_t PublishedWritten = UINT64_MAX;
+	uint64_t PublishedDropped = UINT64_MAX;
+
+	// Set from pin changes, applied by the next execution
+	std::mutex RequestMutex;
+	std::string Path;
+	uint32_t QueueDepth = 8;
+	std::atomic_bool RecordRequested = false;
+
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
+	{
+		if (pinName == NOS_NAME("Channel"))
+		{
+			if (ChannelInfo.Size() == value.Size && memcmp(ChannelInfo.Data(), value.Data, value.Size) == 0)
+				return;
+			ChannelInfo = {};
+			Handle = ResolveChannelHandle(value);
+			if (!Handle)
+				return;
+			ChannelInfo = value;
+			SetWatchLogNames(Handle);
+		}
+		else if (pinName == NOS_NAME("Path"))
+		{
+			std::unique_lock lock(RequestMutex);
+			Path = nos::InterpretPinValue<const char>(value);
+		}
+		else if (pinName == NOS_NAME("QueueDepth"))
+		{
+			std::unique_lock lock(RequestMutex);
+			QueueDepth = *nos::InterpretPinValue<uint32_t>(value);
+		}
+		else if (pinName == NOS_NAME("Recording"))
+			RecordRequested = *nos::InterpretPinValue<bool>(value);
+	}
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		auto channel = Handle.Acquire();
+		if (!channel)
+			return NOS_RESULT_FAILED;
+		if (!IsInputChannel(Handle.VideoChannel))
+		{
+			nosEngine.LogE("Record: %s is not an input channel", Handle.ChannelName);
+			return NOS_RESULT_FAILED;
+		}
+		if (Writer.IsOpen() && RecordingGeneration != Handle.Generation)
+		{
+			// Reopened, or reconfigured to the signal of the input. Frames of another format cannot go to the same file.
+			if (IsRecordingFormat(Handle.Format))
+				RecordingGeneration = Handle.Generation;
+			else
+			{
+				nosEngine.LogW("Record: Format of %s changed, stopping recording to %s", Handle.ChannelName, Writer.GetPath().c_str());
+				StopRecording();
+			}
+		}
+		if (RecordRequested != Writer.IsOpen())
+		{
+			if (Writer.IsOpen())
+				Writer.Close();
+			else if (!Open())
+				StopRecording();
+		}
+
+		if (!channel->WaitVBI(LastVBI))
+			return NOS_RESULT_FAILED;
+		auto& format = Handle.Format;
+		auto* slot = Writer.Acquire();
+		if (!slot)
+		{
+			if (Writer.IsOpen())
+				++Dropped; // Disk is behind
+			SkipFrame(*channel, format);
+		}
+		else
+		{
+			nosTextureFieldType fieldType{};
+			if (!ReadFrame(*channel, format, slot, format.FieldMode ? format.FieldBufferSize : format.BufferSize, fieldType))
+			{
+				Writer.Abort();
+				++Dropped;
+				UpdateOutputs();
+				return NOS_RESULT_FAILED;
+			}
+			Writer.Submit(LastVBI.FieldCount, LastVBI.Time, GetFieldIndex(format, fieldType).value_or(RecordingIndexEntry::Frame));
+		}
+		UpdateOutputs();
+		return NOS_RESULT_SUCCESS;
+	}
+
+	bool Open()
+	{
+		std::string path;
+		uint32_t queueDepth;
+		{
+			std::unique_lock lock(RequestMutex);
+			path = Path;
+			queueDepth = QueueDepth;
+		}
+		if (path.empty())
+		{
+			nosEngine.LogE("Record: No path to record %s to", Handle.ChannelName);
+			return false;
+		}
+		auto header = MakeHeader(Handle.Format);
+		strncpy(header.Serial, Handle.Device->GetSerial().c_str(), sizeof(header.Serial) - 1);
+		strncpy(header.Channel, Handle.ChannelName, sizeof(header.Channel) - 1);
+		if (!Writer.Open(path, header, queueDepth, Handle.Device->GetThreadPlacement().NumaNode))
+			return false;
+		RecordingGeneration = Handle.Generation;
+		Dropped = 0;
+		nosEngine.LogI("Record: Recording %s to %s", Handle.ChannelName, path.c_str());
+		return true;
+	}
+
+	static RecordingHeader MakeHeader(ChannelFormat const& format)
+	{
+		return {
+			.VideoMode = uint32_t(format.VideoMode),
+			.MemoryFormat = uint32_t(format.MemoryFormat),
+			.Width = format.Width,
+			.Height = format.Height,
+			.BytesPerLine = format.BytesPerLine,
+			.FrameSize = format.FieldMode ? format.FieldBufferSize : format.BufferSize,
+			.DeltaSeconds = {format.DeltaSeconds[0], format.DeltaSeconds[1]},
+			.FieldMode = format.FieldMode,
+			.FirstFieldOdd = format.FirstFieldOdd,
+			.Progressive = format.Progressive,
+			.LinkCount = format.LinkCount,
+		};
+	}
+
+	// Whether frames of format can be appended to the open recording
+	bool IsRecordingFormat(ChannelFormat const& format) const
+	{
+		auto header = MakeHeader(format);
+		auto& recording = Writer.GetHeader();
+		return header.VideoMode == recording.VideoMode && header.MemoryFormat == recording.MemoryFormat &&
+			   header.BytesPerLine == recording.BytesPerLine && header.FrameSize == recording.FrameSize &&
+			   header.FieldMode == recording.FieldMode && header.LinkCount == recording.LinkCount;
+	}
+
+	void StopRecording()
+	{
+		Writer.Close();
+		RecordRequested = false;
+		nosEngine.SetPinValue(PinName2Id[NOS_NAME("Recording")], nos::Buffer::From(false));
+	}
+
+	void UpdateOutputs()
+	{
+		if (PublishedWritten != Writer.GetWritten())
+		{
+			PublishedWritten = Writer.GetWritten();
+			nosEngine.SetPinValue(PinName2Id[NOS_NAME("FramesWritten")], nos::Buffer::From(uint32_t(PublishedWritten)));
+		}
+		if (PublishedDropped != Dropped + Writer.GetFailed())
+		{
+			PublishedDropped = Dropped + Writer.GetFailed();
+			nosEngine.SetPinValue(PinName2Id[NOS_NAME("FramesDropped")], nos::Buffer::From(uint32_t(PublishedDropped)));
+		}
+	}
+
+	void OnPathStop() override
+	{
+		// Not resumed on path start, which would replace the recording
+		if (Writer.IsOpen() || RecordRequested)
+			StopRecording();
+		DMANodeBase::OnPathStop();
+	}
+};
+
+nosResult RegisterRecordNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("Record"), RecordNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+}
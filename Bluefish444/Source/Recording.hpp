@@ -0,0 +1,69 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+// stl
+#include <cstdint>
+#include <cstring>
+
+namespace bf
+{
+
+// Raw recording container written by the Record node:
+//   [Header, HeaderSize bytes][Frame 0, Stride bytes][Frame 1]...[Index, IndexCount entries, padded to a block]
+// Every part starts on a RecordingBlockSize boundary, so that recordings are written and read with unbuffered I/O.
+// Frames are card buffers as read by DMA (fields in field mode), in MemoryFormat with BytesPerLine pitch, zero padded
+// to Stride. The index is written when the recording is closed: A recording that was not closed has IndexCount 0, and
+// its frames are found at HeaderSize + i * Stride up to the end of the file, without field counts and times.
+// All values are little-endian.
+constexpr uint64_t RecordingBlockSize = 4096;
+constexpr char RecordingMagic[8] = {'B', 'F', '4', '4', '4', 'R', 'A', 'W'};
+constexpr uint32_t RecordingVersion = 1;
+
+constexpr uint64_t AlignToRecordingBlock(uint64_t size)
+{
+	return (size + RecordingBlockSize - 1) / RecordingBlockSize * RecordingBlockSize;
+}
+
+struct RecordingHeader
+{
+	char Magic[8]{};
+	uint32_t Version = RecordingVersion;
+	uint32_t HeaderSize = RecordingBlockSize;
+	uint32_t VideoMode = 0; // EVideoModeExt
+	uint32_t MemoryFormat = 0; // EMemoryFormat
+	uint32_t Width = 0;
+	uint32_t Height = 0; // Of frames, also in field mode
+	uint32_t BytesPerLine = 0;
+	uint32_t FrameSize = 0; // Bytes of each frame (or field) without padding
+	uint64_t Stride = 0;
+	uint32_t DeltaSeconds[2]{}; // Frame duration as a fraction of seconds
+	uint32_t FieldMode = 0; // Each entry is a field
+	uint32_t FirstFieldOdd = 0;
+	uint32_t Progressive = 0;
+	uint32_t LinkCount = 1;
+	int64_t StartTime = 0; // UTC time of the first frame, in nanoseconds since the Unix epoch
+	uint64_t IndexOffset = 0;
+	uint64_t IndexCount = 0;
+	char Serial[32]{}; // Of the card
+	char Channel[32]{};
+
+	bool IsValid() const { return 0 == memcmp(Magic, RecordingMagic, sizeof(Magic)) && Version == RecordingVersion && Stride; }
+};
+static_assert(sizeof(RecordingHeader) == 160 && sizeof(RecordingHeader) <= RecordingBlockSize);
+
+struct RecordingIndexEntry
+{
+	static constexpr uint32_t Frame = 2;
+
+	uint64_t FieldCount = 0; // Field count of the card at the VBI the frame was read after
+	int64_t Time = 0; // Wake time of that VBI, in nanoseconds after StartTime
+	uint64_t Offset = 0; // Of the frame in the file
+	uint32_t Size = 0;
+	uint32_t Field = Frame; // In field mode, 0 for the first field in time and 1 for the second one
+};
+static_assert(sizeof(RecordingIndexEntry) == 32);
+
+}
@@ -0,0 +1,330 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "RecordingWriter.hpp"
+#include "DMABufferCache.hpp"
+#include "ThreadPlacement.hpp"
+
+#if !_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// stl
+#include <algorithm>
+#include <filesystem>
+#include <utility>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+RecordingWriter::~RecordingWriter()
+{
+	Close();
+}
+
+bool RecordingWriter::Open(std::string const& path, RecordingHeader const& header, uint32_t queueDepth, int numaNode)
+{
+	Close();
+	Header = header;
+	memcpy(Header.Magic, RecordingMagic, sizeof(Header.Magic));
+	Header.Version = RecordingVersion;
+	Header.HeaderSize = RecordingBlockSize;
+	Header.Stride = AlignToRecordingBlock(Header.FrameSize);
+	Header.StartTime = 0;
+	Header.IndexOffset = 0;
+	Header.IndexCount = 0;
+	Path = path;
+	NumaNode = numaNode;
+
+#if _WIN32
+	File = CreateFileW(std::filesystem::path(reinterpret_cast<const char8_t*>(path.c_str())).c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+	                   CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, nullptr);
+	if (File != InvalidFile)
+		CompletionPort = CreateIoCompletionPort(File, nullptr, 0, 1);
+#else
+	File = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+	if (File == InvalidFile && errno == EINVAL) // File system without direct I/O, e.g. tmpfs
+		File = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (File == InvalidFile)
+	{
+		nosEngine.LogE("Record: Cannot create %s", path.c_str());
+		return false;
+	}
+
+	SlotCount = std::max(queueDepth, 1u);
+	Slots = std::make_unique<Slot[]>(SlotCount);
+	for (uint32_t i = 0; i < SlotCount; ++i)
+	{
+		auto& slot = Slots[i];
+		slot.Data = static_cast<uint8_t*>(AllocateHostMemory(Header.Stride, NumaNode));
+		if (!slot.Data)
+		{
+			nosEngine.LogE("Record: Cannot allocate %d buffers of %llu bytes", SlotCount, (unsigned long long)Header.Stride);
+			Release();
+			return false;
+		}
+		memset(slot.Data, 0, Header.Stride); // Padding after the frame stays zero
+		LockPages(slot.Data, Header.Stride);
+	}
+	Current = nullptr;
+	NextOffset = Header.HeaderSize;
+	Index.clear();
+	FirstFrameTime.reset();
+	Written = 0;
+	Failed = 0;
+	Pending = 0;
+
+	// Rewritten with the index on close. Until then, readers find the frames from the header alone.
+	auto* block = static_cast<uint8_t*>(AllocateHostMemory(RecordingBlockSize, -1));
+	bool ok = block;
+	if (block)
+	{
+		memcpy(block, &Header, sizeof(Header));
+		ok = WriteBlocking(block, RecordingBlockSize, 0);
+		FreeHostMemory(block, RecordingBlockSize);
+	}
+	if (!ok)
+	{
+		nosEngine.LogE("Record: Cannot write to %s", path.c_str());
+		Release();
+		return false;
+	}
+#if !_WIN32
+	StopWriter = false;
+	Writer = std::thread([this] { RunWriter(); });
+#endif
+	return true;
+}
+
+uint8_t* RecordingWriter::Acquire()
+{
+	if (!IsOpen())
+		return nullptr;
+	Reap(0);
+	for (uint32_t i = 0; i < SlotCount; ++i)
+	{
+		auto& slot = Slots[i];
+		if (slot.State.load() != SlotState::Free)
+			continue;
+		slot.State = SlotState::Acquired;
+		Current = &slot;
+		return slot.Data;
+	}
+	return nullptr;
+}
+
+void RecordingWriter::Abort()
+{
+	if (Current)
+		std::exchange(Current, nullptr)->State = SlotState::Free;
+}
+
+void RecordingWriter::Submit(uint64_t fieldCount, TelemetryClock::time_point time, uint32_t field)
+{
+	if (!Current)
+		return;
+	auto& slot = *std::exchange(Current, nullptr);
+	if (!FirstFrameTime)
+	{
+		FirstFrameTime = time;
+		auto sinceFrame = TelemetryClock::now() - time;
+		Header.StartTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch() - sinceFrame).count();
+	}
+	slot.Offset = NextOffset;
+	NextOffset += Header.Stride;
+	slot.Entry = Index.size();
+	Index.push_back({
+		.FieldCount = fieldCount,
+		.Time = std::chrono::duration_cast<std::chrono::nanoseconds>(time - *FirstFrameTime).count(),
+		.Offset = slot.Offset,
+		.Size = Header.FrameSize,
+		.Field = field,
+	});
+	++Pending;
+	slot.State = SlotState::Writing;
+	if (!StartWrite(slot))
+		slot.State = SlotState::Failed;
+}
+
+bool RecordingWriter::Close()
+{
+	if (!IsOpen())
+		return true;
+	if (Current)
+	{
+		Current->State = SlotState::Free;
+		Current = nullptr;
+	}
+	while (Pending)
+		Reap(100);
+#if !_WIN32
+	{
+		std::unique_lock lock(QueueMutex);
+		StopWriter = true;
+	}
+	QueueChanged.notify_all();
+	Writer.join();
+#endif
+
+	std::erase_if(Index, [](RecordingIndexEntry const& entry) { return entry.Size == 0; });
+	Header.IndexOffset = NextOffset;
+	Header.IndexCount = Index.size();
+	bool ok = Failed == 0;
+	auto indexSize = AlignToRecordingBlock(Index.size() * sizeof(RecordingIndexEntry));
+	auto blockSize = std::max(indexSize, RecordingBlockSize);
+	auto* block = static_cast<uint8_t*>(AllocateHostMemory(blockSize, -1));
+	if (block)
+	{
+		memcpy(block, Index.data(), Index.size() * sizeof(RecordingIndexEntry));
+		ok = (!indexSize || WriteBlocking(block, indexSize, Header.IndexOffset)) && ok;
+		memset(block, 0, RecordingBlockSize);
+		memcpy(block, &Header, sizeof(Header));
+		ok = WriteBlocking(block, RecordingBlockSize, 0) && ok;
+		FreeHostMemory(block, blockSize);
+	}
+	else
+		ok = false;
+	if (!ok)
+		nosEngine.LogE("Record: %s is incomplete, %llu frames failed to write", Path.c_str(), (unsigned long long)Failed);
+	Release();
+	return ok;
+}
+
+void RecordingWriter::Reap(uint32_t timeoutMs)
+{
+#if _WIN32
+	OVERLAPPED_ENTRY entries[16];
+	ULONG removed = 0;
+	if (Pending && GetQueuedCompletionStatusEx(CompletionPort, entries, ULONG(std::size(entries)), &removed, timeoutMs, FALSE))
+	{
+		for (ULONG i = 0; i < removed; ++i)
+		{
+			auto* slot = reinterpret_cast<Slot*>(entries[i].lpOverlapped);
+			bool ok = entries[i].Internal == 0 && entries[i].dwNumberOfBytesTransferred == Header.Stride; // NTSTATUS of the write
+			slot->State = ok ? SlotState::Written : SlotState::Failed;
+		}
+	}
+#else
+	if (timeoutMs)
+	{
+		std::unique_lock lock(QueueMutex);
+		QueueChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+			for (uint32_t i = 0; i < SlotCount; ++i)
+				if (Slots[i].State.load() == SlotState::Written || Slots[i].State.load() == SlotState::Failed)
+					return true;
+			return false;
+		});
+	}
+#endif
+	for (uint32_t i = 0; i < SlotCount; ++i)
+	{
+		auto& slot = Slots[i];
+		auto state = slot.State.load();
+		if (state != SlotState::Written && state != SlotState::Failed)
+			continue;
+		if (state == SlotState::Written)
+			++Written;
+		else
+		{
+			if (!Failed)
+				nosEngine.LogE("Record: Write to %s failed", Path.c_str());
+			++Failed;
+			Index[slot.Entry].Size = 0;
+		}
+		slot.State = SlotState::Free;
+		--Pending;
+	}
+}
+
+bool RecordingWriter::StartWrite(Slot& slot)
+{
+#if _WIN32
+	slot.Overlapped = {};
+	slot.Overlapped.Offset = DWORD(slot.Offset);
+	slot.Overlapped.OffsetHigh = DWORD(slot.Offset >> 32);
+	// Completes through the completion port, also if the write completes right away
+	return WriteFile(File, slot.Data, DWORD(Header.Stride), nullptr, &slot.Overlapped) || GetLastError() == ERROR_IO_PENDING;
+#else
+	{
+		std::unique_lock lock(QueueMutex);
+		Queue.push_back(&slot);
+	}
+	QueueChanged.notify_all();
+	return true;
+#endif
+}
+
+bool RecordingWriter::WriteBlocking(uint8_t const* data, uint64_t size, uint64_t offset)
+{
+#if _WIN32
+	OVERLAPPED overlapped{};
+	overlapped.Offset = DWORD(offset);
+	overlapped.OffsetHigh = DWORD(offset >> 32);
+	auto event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (!event)
+		return false;
+	overlapped.hEvent = HANDLE(uintptr_t(event) | 1); // Low bit set: Completion is not queued to the completion port
+	DWORD written = 0;
+	bool ok = WriteFile(File, data, DWORD(size), nullptr, &overlapped) || GetLastError() == ERROR_IO_PENDING;
+	ok = ok && GetOverlappedResult(File, &overlapped, &written, TRUE) && written == size;
+	CloseHandle(event);
+	return ok;
+#else
+	return pwrite(File, data, size, off_t(offset)) == ssize_t(size);
+#endif
+}
+
+void RecordingWriter::Release()
+{
+	for (uint32_t i = 0; i < SlotCount; ++i)
+	{
+		auto& slot = Slots[i];
+		if (!slot.Data)
+			continue;
+		UnlockPages(slot.Data, Header.Stride);
+		FreeHostMemory(slot.Data, Header.Stride);
+	}
+	Slots.reset();
+	SlotCount = 0;
+#if _WIN32
+	if (CompletionPort)
+		CloseHandle(CompletionPort);
+	CompletionPort = nullptr;
+	if (File != InvalidFile)
+		CloseHandle(File);
+#else
+	if (File != InvalidFile)
+		close(File);
+#endif
+	File = InvalidFile;
+}
+
+#if !_WIN32
+void RecordingWriter::RunWriter()
+{
+	while (true)
+	{
+		Slot* slot = nullptr;
+		{
+			std::unique_lock lock(QueueMutex);
+			QueueChanged.wait(lock, [this] { return StopWriter || !Queue.empty(); });
+			if (Queue.empty())
+				return;
+			slot = Queue.front();
+			Queue.pop_front();
+		}
+		bool ok = pwrite(File, slot->Data, Header.Stride, off_t(slot->Offset)) == ssize_t(Header.Stride);
+		{
+			std::unique_lock lock(QueueMutex);
+			slot->State = ok ? SlotState::Written : SlotState::Failed;
+		}
+		QueueChanged.notify_all();
+	}
+}
+#endif
+
+}
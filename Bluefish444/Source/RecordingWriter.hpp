@@ -0,0 +1,124 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+
+#include "Recording.hpp"
+#include "Telemetry.hpp"
+
+// stl
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bf
+{
+
+// Writes a recording with unbuffered I/O straight from the host buffers frames are read into by DMA, so that frames are
+// neither copied nor cached by the OS: Each frame is read into one of QueueDepth block-aligned, locked slots and
+// written from there with overlapped I/O (an I/O completion port on Windows, O_DIRECT writes on a writer thread
+// elsewhere). At most QueueDepth writes are in flight; frames arriving while all slots are being written are dropped.
+// Not thread-safe: Owned by a single node.
+class RecordingWriter
+{
+public:
+	RecordingWriter() = default;
+	RecordingWriter(RecordingWriter const&) = delete;
+	~RecordingWriter();
+
+	// Creates the file, replacing an existing one. header must describe the frames; its Stride, index and start time
+	// are filled in by the writer. Slots are allocated on numaNode if given (-1: any).
+	bool Open(std::string const& path, RecordingHeader const& header, uint32_t queueDepth, int numaNode);
+	bool IsOpen() const { return File != InvalidFile; }
+	// Slot of Stride bytes to read the next frame into. Null if all slots are being written, i.e. the disk is behind.
+	uint8_t* Acquire();
+	// Writes the slot returned by the last Acquire. field: See RecordingIndexEntry.
+	void Submit(uint64_t fieldCount, TelemetryClock::time_point time, uint32_t field);
+	// Frees the slot returned by the last Acquire without writing it, e.g. when the frame could not be read into it
+	void Abort();
+	// Waits for pending writes, then writes the index and the final header. Returns false if any write failed.
+	bool Close();
+
+	uint64_t GetWritten() const { return Written; }
+	uint64_t GetFailed() const { return Failed; }
+	std::string const& GetPath() const { return Path; }
+	RecordingHeader const& GetHeader() const { return Header; }
+
+private:
+#if _WIN32
+	using FileHandle = HANDLE;
+	static inline FileHandle const InvalidFile = INVALID_HANDLE_VALUE;
+#else
+	using FileHandle = int;
+	static constexpr FileHandle InvalidFile = -1;
+#endif
+
+	enum class SlotState : uint32_t
+	{
+		Free,
+		Acquired,
+		Writing,
+		Written,
+		Failed,
+	};
+
+	struct Slot
+	{
+#if _WIN32
+		OVERLAPPED Overlapped{}; // First, so that completions map back to their slot
+#endif
+		uint8_t* Data = nullptr;
+		uint64_t Offset = 0;
+		size_t Entry = 0; // In Index
+		std::atomic<SlotState> State = SlotState::Free;
+	};
+
+	// Marks completed slots free and fails the index entries of failed writes. timeoutMs: How long to wait for a write
+	// to complete if none has yet (0: do not wait).
+	void Reap(uint32_t timeoutMs);
+	bool StartWrite(Slot& slot);
+	bool WriteBlocking(uint8_t const* data, uint64_t size, uint64_t offset);
+	void Release();
+#if !_WIN32
+	void RunWriter();
+#endif
+
+	std::string Path;
+	FileHandle File = InvalidFile;
+	RecordingHeader Header{};
+	std::unique_ptr<Slot[]> Slots;
+	uint32_t SlotCount = 0;
+	Slot* Current = nullptr;
+	uint64_t NextOffset = 0;
+	std::vector<RecordingIndexEntry> Index;
+	std::optional<TelemetryClock::time_point> FirstFrameTime;
+	uint64_t Written = 0;
+	uint64_t Failed = 0;
+	uint32_t Pending = 0; // Slots being written
+#if _WIN32
+	HANDLE CompletionPort = nullptr;
+#else
+	std::thread Writer;
+	std::mutex QueueMutex;
+	std::condition_variable QueueChanged;
+	std::deque<Slot*> Queue;
+	bool StopWriter = false;
+#endif
+	int NumaNode = -1;
+};
+
+}
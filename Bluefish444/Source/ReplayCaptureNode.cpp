@@ -0,0 +1,141 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/Modules.h>
+
+#include "DMANodeBase.hpp"
+#include "ChannelHelpers.hpp"
+#include "Device.hpp"
+#include "Recording.hpp"
+#include "ReplayRing.hpp"
+
+// stl
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+namespace bf
+{
+// Waits for the next VBI of an input channel and reads the frame into a replay ring, from which Replay nodes play it
+// out. Frames stay in host memory and never go through the GPU.
+struct ReplayCaptureNodeContext : DMANodeBase
+{
+	ReplayCaptureNodeContext(const nosFbNode* node) : DMANodeBase(node)
+	{
+	}
+
+	nos::Buffer ChannelInfo{};
+	ChannelHandle Handle{};
+	VBISample LastVBI{};
+	std::shared_ptr<ReplayRing> Ring;
+	uint32_t RingGeneration = 0; // Of the channel the ring was created for
+	uint64_t Dropped = 0;
+	uint64_t PublishedDropped = UINT64_MAX;
+
+	// Set from pin changes, applied by the next execution
+	std::mutex RequestMutex;
+	std::string RingName = "Replay";
+	float Seconds = 60;
+	bool LargePages = true;
+	std::atomic_bool RingChanged = true;
+
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
+	{
+		if (pinName == NOS_NAME("Channel"))
+		{
+			if (ChannelInfo.Size() == value.Size && memcmp(ChannelInfo.Data(), value.Data, value.Size) == 0)
+				return;
+			ChannelInfo = {};
+			Handle = ResolveChannelHandle(value);
+			if (!Handle)
+				return;
+			ChannelInfo = value;
+			SetWatchLogNames(Handle);
+			return;
+		}
+		std::unique_lock lock(RequestMutex);
+		if (pinName == NOS_NAME("Ring"))
+			RingName = nos::InterpretPinValue<const char>(value);
+		else if (pinName == NOS_NAME("Seconds"))
+			Seconds = *nos::InterpretPinValue<float>(value);
+		else if (pinName == NOS_NAME("LargePages"))
+			LargePages = *nos::InterpretPinValue<bool>(value);
+		else
+			return;
+		RingChanged = true;
+	}
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		auto channel = Handle.Acquire();
+		if (!channel)
+			return NOS_RESULT_FAILED;
+		if (!IsInputChannel(Handle.VideoChannel))
+		{
+			nosEngine.LogE("Replay Capture: %s is not an input channel", Handle.ChannelName);
+			return NOS_RESULT_FAILED;
+		}
+		// Not retried every frame if allocation fails
+		if (RingChanged.exchange(false) || RingGeneration != Handle.Generation)
+			CreateRing();
+
+		if (!channel->WaitVBI(LastVBI))
+			return NOS_RESULT_FAILED;
+		auto& format = Handle.Format;
+		auto* slot = Ring ? Ring->BeginWrite(LastVBI.FieldCount) : nullptr;
+		if (!slot)
+		{
+			if (Ring)
+				++Dropped; // Slot is being replayed
+			SkipFrame(*channel, format);
+		}
+		else
+		{
+			nosTextureFieldType fieldType{};
+			bool ok = ReadFrame(*channel, format, slot, Ring->GetFrameSize(), fieldType);
+			Ring->EndWrite(LastVBI.FieldCount, LastVBI.Time, GetFieldIndex(format, fieldType).value_or(RecordingIndexEntry::Frame), ok);
+			if (!ok)
+				return NOS_RESULT_FAILED;
+		}
+		nosEngine.SetPinValue(PinName2Id[NOS_NAME("FieldCount")], nos::Buffer::From(uint32_t(LastVBI.FieldCount)));
+		if (PublishedDropped != Dropped)
+		{
+			PublishedDropped = Dropped;
+			nosEngine.SetPinValue(PinName2Id[NOS_NAME("FramesDropped")], nos::Buffer::From(uint32_t(Dropped)));
+		}
+		return NOS_RESULT_SUCCESS;
+	}
+
+	void CreateRing()
+	{
+		std::string name;
+		float seconds;
+		bool largePages;
+		{
+			std::unique_lock lock(RequestMutex);
+			name = RingName;
+			seconds = Seconds;
+			largePages = LargePages;
+		}
+		Ring = {}; // Freed before the new ring is allocated, unless frames of it are being replayed
+		RingGeneration = Handle.Generation;
+		Dropped = 0;
+		auto& format = Handle.Format;
+		auto& dSec = format.DeltaSeconds;
+		if (name.empty() || !dSec[0] || !(seconds > 0))
+			return;
+		// Fields in field mode
+		double entriesPerSecond = double(dSec[1]) / dSec[0] * (format.FieldMode ? 2 : 1);
+		auto capacity = uint32_t(std::clamp(std::ceil(seconds * entriesPerSecond), 1.0, double(UINT32_MAX)));
+		Ring = ReplayRing::Create(name, format, capacity, Handle.Device->GetThreadPlacement().NumaNode, largePages);
+		if (Ring)
+			nosEngine.LogI("Replay Capture: Ring %s holds %u %s of %s", name.c_str(), capacity, format.FieldMode ? "fields" : "frames", Handle.ChannelName);
+	}
+};
+
+nosResult RegisterReplayCaptureNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("ReplayCapture"), ReplayCaptureNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+}
@@ -0,0 +1,235 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/Modules.h>
+
+#include "DMANodeBase.hpp"
+#include "ChannelHelpers.hpp"
+#include "Device.hpp"
+#include "Recording.hpp"
+#include "ReplayRing.hpp"
+
+// stl
+#include <atomic>
+#include <cmath>
+#include <mutex>
+
+namespace bf
+{
+// Plays frames of a replay ring (see Replay Capture) on an output channel: At each VBI, the frame due is transferred by
+// DMA straight from the ring, at any speed from a cue point given as a field count of the input or a delay behind live.
+struct ReplayNodeContext : DMANodeBase
+{
+	ReplayNodeContext(const nosFbNode* node) : DMANodeBase(node)
+	{
+	}
+
+	nos::Buffer ChannelInfo{};
+	ChannelHandle Handle{};
+	VBISample LastVBI{};
+	std::weak_ptr<ReplayRing> CuedRing; // Ring the cue point is in
+	ReplayRing const* MismatchedRing = nullptr; // Logged once
+	int64_t CueFieldCount = 0; // Of the first field (or frame) of the cued frame
+	double Position = 0; // Frames played since the cue point
+	std::optional<unsigned long> LastOutputFieldCount;
+	ReplayRing::Pin InFlight; // Frame being transferred
+	DMAScheduler::Ticket LastTransfer;
+	uint64_t PublishedFieldCount = UINT64_MAX;
+
+	// Set from pin changes, applied by the next execution
+	std::mutex RequestMutex;
+	std::string RingName = "Replay";
+	std::atomic_bool Playing = false;
+	std::atomic<float> Speed = 1;
+	std::atomic<uint32_t> Start = 0;
+	std::atomic<float> Delay = 5;
+	std::atomic_bool Cue = true;
+
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
+	{
+		if (pinName == NOS_NAME("Channel"))
+		{
+			if (ChannelInfo.Size() == value.Size && memcmp(ChannelInfo.Data(), value.Data, value.Size) == 0)
+				return;
+			ChannelInfo = {};
+			Handle = ResolveChannelHandle(value);
+			if (!Handle)
+				return;
+			ChannelInfo = value;
+			SetWatchLogNames(Handle);
+			UpdateDeltaSeconds(Handle);
+			nosEngine.RecompilePath(NodeId);
+		}
+		else if (pinName == NOS_NAME("Ring"))
+		{
+			std::unique_lock lock(RequestMutex);
+			RingName = nos::InterpretPinValue<const char>(value);
+		}
+		else if (pinName == NOS_NAME("Playing"))
+		{
+			bool playing = *nos::InterpretPinValue<bool>(value);
+			if (playing && !Playing)
+				Cue = true;
+			Playing = playing;
+		}
+		else if (pinName == NOS_NAME("Speed"))
+			Speed = *nos::InterpretPinValue<float>(value);
+		else if (pinName == NOS_NAME("Start"))
+		{
+			Start = *nos::InterpretPinValue<uint32_t>(value);
+			Cue = true;
+		}
+		else if (pinName == NOS_NAME("Delay"))
+		{
+			Delay = *nos::InterpretPinValue<float>(value);
+			Cue = true;
+		}
+	}
+
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		auto result = PlayNextFrame();
+		if (result == NOS_RESULT_SUCCESS)
+		{
+			nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
+			nosEngine.ScheduleNode(&schedule);
+		}
+		return result;
+	}
+
+	nosResult PlayNextFrame()
+	{
+		auto channel = Handle.Acquire();
+		if (!channel)
+			return NOS_RESULT_FAILED;
+		if (UpdateDeltaSeconds(Handle))
+			nosEngine.RecompilePath(NodeId);
+		if (IsInputChannel(Handle.VideoChannel))
+		{
+			nosEngine.LogE("Replay: %s is not an output channel", Handle.ChannelName);
+			return NOS_RESULT_FAILED;
+		}
+		std::shared_ptr<ReplayRing> ring;
+		{
+			std::unique_lock lock(RequestMutex);
+			ring = ReplayRing::Find(RingName);
+		}
+
+		if (!channel->WaitVBI(LastVBI))
+			return NOS_RESULT_FAILED;
+		InFlight.Release(); // Transfers queued before the VBI wait completed before it returned
+		if (!Playing || !ring || !IsCompatible(*ring))
+		{
+			LastOutputFieldCount.reset();
+			return NOS_RESULT_SUCCESS;
+		}
+		if (Cue.exchange(false) || CuedRing.lock() != ring)
+		{
+			if (!CueRing(*ring))
+			{
+				Cue = true; // Retried once the ring has frames
+				return NOS_RESULT_SUCCESS;
+			}
+		}
+
+		// Position advances at frame boundaries of the output, so that both fields of a frame are played in field mode
+		auto fieldCount = LastVBI.FieldCount;
+		if (LastOutputFieldCount)
+			Position += Speed * (int64_t(fieldCount / 2) - int64_t(*LastOutputFieldCount / 2));
+		LastOutputFieldCount = fieldCount;
+		auto step = ring->GetFieldCountStep();
+		int64_t field = step == 1 ? fieldCount & 1 : 0;
+		auto latest = int64_t(*ring->GetLatest());
+		// Frames next to be overwritten are not replayed, so that pinning them does not drop captures
+		int64_t capacity = ring->GetCapacity();
+		auto oldest = latest - std::max<int64_t>(capacity - 3, 0) * step;
+		auto frame = int64_t(std::floor(Position));
+		auto due = CueFieldCount + 2 * frame + field;
+		if (due > latest || due < oldest)
+		{
+			// Caught up with live or overtaken by capture: Continues from the latest or oldest frame
+			auto floorHalf = [](int64_t value) { return value >= 0 ? value / 2 : -((1 - value) / 2); };
+			frame = due > latest ? floorHalf(latest - field - CueFieldCount) : -floorHalf(CueFieldCount + field - oldest);
+			Position = double(frame);
+			due = CueFieldCount + 2 * frame + field;
+		}
+		auto pin = due >= 0 ? ring->Acquire(due) : ReplayRing::Pin{};
+		if (!pin)
+			return NOS_RESULT_SUCCESS; // Frame was dropped or is being captured: Card repeats the last frame
+
+		auto& format = Handle.Format;
+		auto fieldType = pin.GetField() == RecordingIndexEntry::Frame ? NOS_TEXTURE_FIELD_TYPE_UNKNOWN : GetFieldType(format, pin.GetField());
+		if (!WriteFrame(*channel, format, pin.GetData(), pin.GetSize(), fieldType, &LastTransfer))
+			return NOS_RESULT_FAILED;
+		InFlight = std::move(pin);
+		if (PublishedFieldCount != uint64_t(due))
+		{
+			PublishedFieldCount = due;
+			nosEngine.SetPinValue(PinName2Id[NOS_NAME("FieldCount")], nos::Buffer::From(uint32_t(due)));
+		}
+		return NOS_RESULT_SUCCESS;
+	}
+
+	bool IsCompatible(ReplayRing const& ring)
+	{
+		auto& format = Handle.Format;
+		auto& source = ring.GetFormat();
+		bool compatible = source.FieldMode == format.FieldMode && source.MemoryFormat == format.MemoryFormat && source.Width == format.Width &&
+		                  source.Height == format.Height && source.BytesPerLine == format.BytesPerLine;
+		if (!compatible && MismatchedRing != &ring)
+			nosEngine.LogE("Replay: Frames of the replay ring do not match the video mode and pixel format of %s", Handle.ChannelName);
+		MismatchedRing = compatible ? nullptr : &ring;
+		return compatible;
+	}
+
+	bool CueRing(ReplayRing& ring)
+	{
+		auto latest = ring.GetLatest();
+		if (!latest)
+			return false;
+		std::optional<uint64_t> cue = Start.load();
+		if (!*cue)
+			cue = ring.FindFieldCount(TelemetryClock::now() - std::chrono::duration_cast<TelemetryClock::duration>(std::chrono::duration<float>(std::max(Delay.load(), 0.f))));
+		if (!cue)
+			cue = *latest - std::min<uint64_t>(*latest, uint64_t(ring.GetCapacity() - 1) * ring.GetFieldCountStep()); // Delay is longer than the ring
+		CueFieldCount = int64_t(*cue);
+		// Frames in field mode start with their first field
+		if (ring.GetFieldCountStep() == 1)
+			if (auto pin = ring.Acquire(*cue); pin && pin.GetField() == 1)
+				--CueFieldCount;
+		CuedRing = ring.weak_from_this();
+		Position = 0;
+		LastOutputFieldCount.reset();
+		return true;
+	}
+
+	void GetScheduleInfo(nosScheduleInfo* out) override
+	{
+		*out = nosScheduleInfo {
+			.Importance = 1,
+			.DeltaSeconds = DeltaSeconds,
+			.Type = NOS_SCHEDULE_TYPE_ON_DEMAND,
+		};
+	}
+
+	void OnPathStart() override
+	{
+		nosScheduleNodeParams schedule{.NodeId = NodeId, .AddScheduleCount = 1};
+		nosEngine.ScheduleNode(&schedule);
+	}
+
+	void OnPathStop() override
+	{
+		if (auto channel = Handle.Acquire(); channel && LastTransfer)
+			channel->WaitDMA(LastTransfer);
+		LastTransfer = {};
+		InFlight.Release();
+		DMANodeBase::OnPathStop();
+	}
+};
+
+nosResult RegisterReplayNode(nosNodeFunctions* outFunctions)
+{
+	NOS_BIND_NODE_CLASS(NOS_NAME("Replay"), ReplayNodeContext, outFunctions)
+	return NOS_RESULT_SUCCESS;
+}
+}
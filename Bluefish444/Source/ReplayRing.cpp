@@ -0,0 +1,183 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ReplayRing.hpp"
+#include "DMABufferCache.hpp"
+#include "ThreadPlacement.hpp"
+
+// stl
+#include <algorithm>
+#include <utility>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+namespace
+{
+constexpr uint64_t PageSize = 4096;
+}
+
+ReplayRing::Pin& ReplayRing::Pin::operator=(Pin&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+	Release();
+	Ring = std::move(other.Ring);
+	PinnedSlot = std::exchange(other.PinnedSlot, nullptr);
+	return *this;
+}
+
+void ReplayRing::Pin::Release()
+{
+	if (PinnedSlot)
+		PinnedSlot->Readers.fetch_sub(1);
+	PinnedSlot = nullptr;
+	Ring.reset();
+}
+
+uint8_t* ReplayRing::Pin::GetData() const
+{
+	return Ring->Data + (PinnedSlot - Ring->Slots.get()) * Ring->Stride;
+}
+
+ReplayRing::ReplayRing(ChannelFormat const& format, uint32_t capacity, int numaNode, bool largePages)
+	: Format(format), FrameSize(format.FieldMode ? format.FieldBufferSize : format.BufferSize), Capacity(capacity), Step(format.FieldMode ? 1 : 2)
+{
+	auto& dSec = format.DeltaSeconds;
+	FieldPeriod = std::chrono::duration_cast<TelemetryClock::duration>(std::chrono::nanoseconds(uint64_t(1'000'000'000) * dSec[0] / (dSec[1] * 2)));
+	Stride = (FrameSize + PageSize - 1) / PageSize * PageSize; // Frames start on pages for DMA
+	Size = Stride * Capacity;
+	if (!Size)
+		return;
+	Data = static_cast<uint8_t*>(AllocateHostMemory(Size, numaNode, largePages));
+	if (!Data)
+		return;
+	Locked = LockPages(Data, Size);
+	if (!Locked)
+		nosEngine.LogW("Bluefish444: Unable to lock %llu MB of replay memory, driver will lock frames on every transfer", (unsigned long long)(Size >> 20));
+	Slots = std::make_unique<Slot[]>(Capacity);
+}
+
+ReplayRing::~ReplayRing()
+{
+	if (Locked)
+		UnlockPages(Data, Size);
+	FreeHostMemory(Data, Size);
+}
+
+std::shared_ptr<ReplayRing> ReplayRing::Create(std::string const& name, ChannelFormat const& format, uint32_t capacity, int numaNode, bool largePages)
+{
+	auto ring = std::make_shared<ReplayRing>(format, capacity, numaNode, largePages);
+	if (!ring->Data)
+	{
+		nosEngine.LogE("Bluefish444: Cannot allocate %llu MB for replay ring %s", (unsigned long long)(ring->Size >> 20), name.c_str());
+		return nullptr;
+	}
+	std::unique_lock lock(RegistryMutex);
+	std::erase_if(Registry, [](auto const& entry) { return entry.second.expired(); });
+	Registry[name] = ring;
+	return ring;
+}
+
+std::shared_ptr<ReplayRing> ReplayRing::Find(std::string const& name)
+{
+	std::unique_lock lock(RegistryMutex);
+	auto it = Registry.find(name);
+	return it != Registry.end() ? it->second.lock() : nullptr;
+}
+
+uint8_t* ReplayRing::BeginWrite(uint64_t fieldCount)
+{
+	auto& slot = GetSlot(fieldCount);
+	auto sequence = slot.Sequence.load();
+	// Marked before checking for readers, and readers pin before checking the mark: Either the reader sees the write
+	// and fails to pin, or the write sees the reader and is dropped.
+	slot.Sequence.store(sequence + 1);
+	if (slot.Readers.load())
+	{
+		slot.Sequence.store(sequence + 2); // Frame is unchanged
+		return nullptr;
+	}
+	return Data + (&slot - Slots.get()) * Stride;
+}
+
+void ReplayRing::EndWrite(uint64_t fieldCount, TelemetryClock::time_point time, uint32_t field, bool ok)
+{
+	auto& slot = GetSlot(fieldCount);
+	slot.FieldCount = ok ? fieldCount : NoFrame;
+	slot.Time = time.time_since_epoch().count();
+	slot.Field = field;
+	slot.Sequence.fetch_add(1);
+	if (ok)
+		Latest = fieldCount + 1;
+}
+
+ReplayRing::Pin ReplayRing::Acquire(uint64_t fieldCount)
+{
+	auto& slot = GetSlot(fieldCount);
+	slot.Readers.fetch_add(1);
+	// A write that ends between the loads changes the sequence, so stored is of the frame being pinned
+	auto sequence = slot.Sequence.load();
+	auto stored = slot.FieldCount.load();
+	if (sequence % 2 || slot.Sequence.load() != sequence || stored == NoFrame || stored / Step != fieldCount / Step)
+	{
+		slot.Readers.fetch_sub(1);
+		return {};
+	}
+	Pin pin;
+	pin.Ring = shared_from_this();
+	pin.PinnedSlot = &slot;
+	return pin;
+}
+
+std::optional<uint64_t> ReplayRing::GetLatest() const
+{
+	auto latest = Latest.load();
+	return latest ? std::optional(latest - 1) : std::nullopt;
+}
+
+std::optional<TelemetryClock::time_point> ReplayRing::ReadSlotTime(uint64_t fieldCount) const
+{
+	auto& slot = GetSlot(fieldCount);
+	auto sequence = slot.Sequence.load();
+	auto stored = slot.FieldCount.load();
+	auto time = slot.Time.load();
+	if (sequence % 2 || slot.Sequence.load() != sequence || stored == NoFrame || stored / Step != fieldCount / Step)
+		return std::nullopt;
+	return TelemetryClock::time_point(TelemetryClock::duration(time));
+}
+
+std::optional<uint64_t> ReplayRing::FindFieldCount(TelemetryClock::time_point time) const
+{
+	auto latest = GetLatest();
+	if (!latest)
+		return std::nullopt;
+	auto latestTime = ReadSlotTime(*latest);
+	if (!latestTime || !FieldPeriod.count())
+		return std::nullopt;
+	// Estimated from the field rate, then the closest capture time around the estimate is taken
+	int64_t entries = std::max<int64_t>(0, ((*latestTime - time) / FieldPeriod + Step / 2) / Step);
+	if (entries >= Capacity)
+		return std::nullopt;
+	std::optional<uint64_t> best;
+	TelemetryClock::duration bestDistance = TelemetryClock::duration::max();
+	for (int64_t i = std::max<int64_t>(0, entries - 1); i <= std::min<int64_t>(Capacity - 1, entries + 1); ++i)
+	{
+		if (uint64_t(i) * Step > *latest)
+			break;
+		auto fieldCount = *latest - i * Step;
+		auto frameTime = ReadSlotTime(fieldCount);
+		if (!frameTime)
+			continue;
+		auto distance = *frameTime > time ? *frameTime - time : time - *frameTime;
+		if (distance < bestDistance)
+		{
+			best = fieldCount;
+			bestDistance = distance;
+		}
+	}
+	return best;
+}
+
+}
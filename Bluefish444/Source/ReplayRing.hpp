@@ -0,0 +1,113 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include "Device.hpp"
+
+// stl
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace bf
+{
+
+// Rolling buffer of the last frames (fields in field mode) captured on an input channel, for instant replay. Frames are
+// read by DMA into the ring and written to output channels by DMA from it, so that they are never copied; the ring is
+// one host memory arena of large pages where available, so that minutes of UHD fit without GPU memory.
+// Frames are found by the field count they were captured at: Each frame has a fixed slot, so that lookups take
+// constant time. Captured frames replace the frame one ring length older. Frames are pinned while replayed; the capture
+// of a frame whose slot is pinned is dropped.
+// Rings are shared by name between the capturing node and any number of replaying nodes.
+class ReplayRing : public std::enable_shared_from_this<ReplayRing>
+{
+	static constexpr uint64_t NoFrame = UINT64_MAX;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> Sequence = 0; // Odd while the slot is being written
+		std::atomic<uint32_t> Readers = 0;
+		std::atomic<uint64_t> FieldCount = NoFrame;
+		std::atomic<int64_t> Time = 0; // TelemetryClock ticks
+		std::atomic<uint32_t> Field = 0; // See RecordingIndexEntry
+	};
+
+public:
+	// Frame pinned for reading. The frame is not overwritten, and the ring not freed, until the pin is released.
+	class Pin
+	{
+	public:
+		Pin() = default;
+		Pin(Pin&& other) noexcept { *this = std::move(other); }
+		Pin& operator=(Pin&& other) noexcept;
+		~Pin() { Release(); }
+		void Release();
+		explicit operator bool() const { return PinnedSlot != nullptr; }
+
+		uint8_t* GetData() const;
+		uint32_t GetSize() const { return Ring->FrameSize; }
+		uint64_t GetFieldCount() const { return PinnedSlot->FieldCount; }
+		TelemetryClock::time_point GetTime() const { return TelemetryClock::time_point(TelemetryClock::duration(PinnedSlot->Time)); }
+		// 0 for the first field in time, 1 for the second one, RecordingIndexEntry::Frame for frames
+		uint32_t GetField() const { return PinnedSlot->Field; }
+
+	private:
+		friend class ReplayRing;
+		std::shared_ptr<ReplayRing> Ring;
+		Slot* PinnedSlot = nullptr;
+	};
+
+	ReplayRing(ChannelFormat const& format, uint32_t capacity, int numaNode, bool largePages);
+	~ReplayRing();
+	ReplayRing(ReplayRing const&) = delete;
+
+	// Registers a new ring under name, replacing the ring registered before. Null if the ring cannot be allocated.
+	static std::shared_ptr<ReplayRing> Create(std::string const& name, ChannelFormat const& format, uint32_t capacity, int numaNode, bool largePages);
+	static std::shared_ptr<ReplayRing> Find(std::string const& name);
+
+	ChannelFormat const& GetFormat() const { return Format; }
+	uint32_t GetCapacity() const { return Capacity; }
+	uint32_t GetFrameSize() const { return FrameSize; }
+	// Field counts advance by this per ring entry: 1 in field mode, 2 otherwise
+	uint32_t GetFieldCountStep() const { return Step; }
+
+	// Capture, from a single thread: Slot to read the frame captured at fieldCount into, or null if the slot is pinned.
+	// A returned slot must be published with EndWrite.
+	uint8_t* BeginWrite(uint64_t fieldCount);
+	// Publishes the frame, unless the transfer failed
+	void EndWrite(uint64_t fieldCount, TelemetryClock::time_point time, uint32_t field, bool ok);
+
+	// Frame captured at fieldCount, if it is still in the ring
+	Pin Acquire(uint64_t fieldCount);
+	// Field count of the last captured frame
+	std::optional<uint64_t> GetLatest() const;
+	// Field count of the frame captured closest to time, if it is still in the ring
+	std::optional<uint64_t> FindFieldCount(TelemetryClock::time_point time) const;
+
+private:
+	Slot& GetSlot(uint64_t fieldCount) const { return Slots[fieldCount / Step % Capacity]; }
+	// Metadata of a slot if it holds the frame of fieldCount, read consistently with a concurrent write
+	std::optional<TelemetryClock::time_point> ReadSlotTime(uint64_t fieldCount) const;
+
+	ChannelFormat Format;
+	uint32_t FrameSize = 0;
+	uint64_t Stride = 0;
+	uint32_t Capacity = 0;
+	uint32_t Step = 2;
+	TelemetryClock::duration FieldPeriod{}; // Between field count increments
+	uint8_t* Data = nullptr;
+	uint64_t Size = 0;
+	bool Locked = false;
+	std::unique_ptr<Slot[]> Slots;
+	std::atomic<uint64_t> Latest = 0; // Field count + 1 of the last captured frame, 0 if none
+
+	inline static std::mutex RegistryMutex;
+	inline static std::unordered_map<std::string, std::weak_ptr<ReplayRing>> Registry;
+};
+
+}
@@ -0,0 +1,97 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "Simd.hpp"
+
+#if BF_SIMD_X64 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// stl
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+namespace
+{
+
+SimdLevel DetectSimdLevel()
+{
+#if !BF_SIMD_X64
+	return SimdLevel::Scalar;
+#elif defined(_MSC_VER)
+	int regs[4]{};
+	__cpuid(regs, 1);
+	bool sse41 = regs[2] & (1 << 19);
+	bool osxsave = regs[2] & (1 << 27);
+	bool avx = regs[2] & (1 << 28);
+	if (!sse41)
+		return SimdLevel::Scalar;
+	if (!osxsave || !avx)
+		return SimdLevel::SSE41;
+	auto xcr0 = _xgetbv(0);
+	if ((xcr0 & 0x6) != 0x6) // XMM and YMM state
+		return SimdLevel::SSE41;
+	__cpuidex(regs, 7, 0);
+	bool avx2 = regs[1] & (1 << 5);
+	bool avx512f = regs[1] & (1 << 16);
+	bool avx512bw = regs[1] & (1 << 30);
+	if (!avx2)
+		return SimdLevel::SSE41;
+	if (avx512f && avx512bw && (xcr0 & 0xE0) == 0xE0) // Opmask and ZMM state
+		return SimdLevel::AVX512;
+	return SimdLevel::AVX2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return SimdLevel::AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return SimdLevel::SSE41;
+	return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel LoadSimdLevel()
+{
+	auto level = DetectSimdLevel();
+	if (auto* requested = std::getenv("BLUEFISH444_SIMD"))
+	{
+		for (auto candidate : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512})
+		{
+			if (0 == strcmp(requested, GetSimdLevelName(candidate)))
+			{
+				level = std::min(level, candidate);
+				break;
+			}
+		}
+	}
+	nosEngine.LogI("Bluefish444: Using %s CPU kernels", GetSimdLevelName(level));
+	return level;
+}
+
+}
+
+SimdLevel GetSimdLevel()
+{
+	static const SimdLevel level = LoadSimdLevel();
+	return level;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::SSE41: return "sse4.1";
+	case SimdLevel::AVX2: return "avx2";
+	case SimdLevel::AVX512: return "avx512";
+	default: return "scalar";
+	}
+}
+
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BF_SIMD_X64 1
+#else
+#define BF_SIMD_X64 0
+#endif
+
+// Kernels for an instruction set are compiled per function, so that the plugin still loads on CPUs without it.
+// MSVC does not need this: Intrinsics can be used without enabling the instruction set for the whole translation unit.
+#if BF_SIMD_X64 && (defined(__GNUC__) || defined(__clang__))
+#define BF_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define BF_TARGET_AVX2 __attribute__((target("avx2")))
+#define BF_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define BF_TARGET_SSE41
+#define BF_TARGET_AVX2
+#define BF_TARGET_AVX512
+#endif
+
+#if BF_SIMD_X64
+#include <immintrin.h>
+#endif
+
+namespace bf
+{
+
+enum class SimdLevel
+{
+	Scalar,
+	SSE41,
+	AVX2,
+	AVX512, // F + BW
+};
+
+// Highest level supported by the CPU and the OS, detected once.
+// BLUEFISH444_SIMD=scalar|sse4.1|avx2|avx512 lowers it, e.g. to compare kernels.
+SimdLevel GetSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
+}
@@ -0,0 +1,849 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "Simulator.hpp"
+#include "VideoFormats.hpp"
+
+// stl
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <random>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
+
+#include <Nodos/Modules.h>
+
+namespace bf::sim
+{
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+struct ChannelDesc
+{
+	EBlueVideoChannel Channel;
+	bool Input;
+	uint32_t Number;
+	const char* Name;
+};
+
+constexpr ChannelDesc ChannelDescs[] = {
+	{BLUE_VIDEO_OUTPUT_CHANNEL_1, false, 1, "Output Ch 1"},
+	{BLUE_VIDEO_OUTPUT_CHANNEL_2, false, 2, "Output Ch 2"},
+	{BLUE_VIDEO_OUTPUT_CHANNEL_3, false, 3, "Output Ch 3"},
+	{BLUE_VIDEO_OUTPUT_CHANNEL_4, false, 4, "Output Ch 4"},
+	{BLUE_VIDEO_OUTPUT_CHANNEL_5, false, 5, "Output Ch 5"},
+	{BLUE_VIDEO_OUTPUT_CHANNEL_6, false, 6, "Output Ch 6"},
+	{BLUE_VIDEO_OUTPUT_CHANNEL_7, false, 7, "Output Ch 7"},
+	{BLUE_VIDEO_OUTPUT_CHANNEL_8, false, 8, "Output Ch 8"},
+	{BLUE_VIDEO_INPUT_CHANNEL_1, true, 1, "Input Ch 1"},
+	{BLUE_VIDEO_INPUT_CHANNEL_2, true, 2, "Input Ch 2"},
+	{BLUE_VIDEO_INPUT_CHANNEL_3, true, 3, "Input Ch 3"},
+	{BLUE_VIDEO_INPUT_CHANNEL_4, true, 4, "Input Ch 4"},
+	{BLUE_VIDEO_INPUT_CHANNEL_5, true, 5, "Input Ch 5"},
+	{BLUE_VIDEO_INPUT_CHANNEL_6, true, 6, "Input Ch 6"},
+	{BLUE_VIDEO_INPUT_CHANNEL_7, true, 7, "Input Ch 7"},
+	{BLUE_VIDEO_INPUT_CHANNEL_8, true, 8, "Input Ch 8"},
+};
+constexpr size_t ChannelCount = std::size(ChannelDescs);
+
+size_t FindChannelIndex(uint32_t channel)
+{
+	for (size_t i = 0; i < ChannelCount; ++i)
+		if (ChannelDescs[i].Channel == channel)
+			return i;
+	return ChannelCount;
+}
+
+struct CardChannel
+{
+	std::mutex Mutex;
+	VideoFormat const* Mode = nullptr;
+	EMemoryFormat MemoryFormat = MEM_FMT_2VUY;
+	std::vector<std::vector<uint8_t>> Buffers;
+	std::optional<uint32_t> CaptureBuffer;
+	std::optional<uint32_t> PlaybackBuffer;
+	uint64_t Waits = 0;
+};
+
+// Card buffer addressed by a DMA buffer id. Field DMAs transfer every other line of the frame.
+struct DMATarget
+{
+	uint32_t Buffer;
+	uint32_t Field; // 0: Frame, 1: First field, 2: Second field
+};
+
+struct Transfer
+{
+	CardChannel* Channel;
+	uint32_t Buffer;
+	uint32_t Field;
+	uint32_t Pitch;
+	uint8_t* Data;
+	uint32_t Size;
+	uint32_t Offset;
+	bool Write;
+#if _WIN32
+	OVERLAPPED* Overlapped = nullptr;
+#else
+	DMACompletion* Completion = nullptr; // Passed by DMAEngine in place of OVERLAPPED
+#endif
+};
+
+struct Card
+{
+	BLUE_S32 Id = 0;
+	blue_device_info Info{};
+	Clock::time_point Epoch = Clock::now(); // All channels of a card are genlocked to the same reference
+	std::array<CardChannel, ChannelCount> Channels;
+	std::mutex LinkMutex;
+
+	// Overlapped transfers are completed by a DMA worker per card, on all platforms
+	std::mutex QueueMutex;
+	std::condition_variable QueueCV;
+	std::deque<Transfer> Queue;
+	bool Stopping = false;
+	std::thread Worker;
+};
+
+struct Handle
+{
+	Card* Attached = nullptr;
+	size_t ChannelIndex = ChannelCount;
+};
+
+struct Simulator
+{
+	SimulatorConfig Config;
+	std::vector<std::unique_ptr<Card>> Cards;
+	std::unordered_map<unsigned long, DMATarget> DMABufferIds;
+	std::unordered_map<unsigned long, uint32_t> RenderBufferIds;
+	std::mt19937 JitterRng{0xB1F};
+	std::mutex JitterMutex;
+	Clock::time_point Start = Clock::now(); // Of input mode switches
+};
+
+// Intentionally leaked: SdkInstance objects held in static storage may call bfcDestroy after the plugin has been unloaded.
+Simulator* Sim = nullptr;
+
+Handle* ToHandle(BLUEVELVETC_HANDLE handle)
+{
+	return reinterpret_cast<Handle*>(handle);
+}
+
+Card* FindCard(BLUE_S32 id)
+{
+	if (id < 1 || id > static_cast<BLUE_S32>(Sim->Cards.size()))
+		return nullptr;
+	return Sim->Cards[id - 1].get();
+}
+
+bool IsChannelAvailable(size_t channelIndex)
+{
+	if (channelIndex >= ChannelCount)
+		return false;
+	auto& desc = ChannelDescs[channelIndex];
+	return desc.Number <= (desc.Input ? Sim->Config.InputChannelCount : Sim->Config.OutputChannelCount);
+}
+
+Clock::duration GetFieldPeriod(VideoFormat const& mode)
+{
+	double frameSeconds = double(mode.RateDenominator) / mode.RateNumerator;
+	frameSeconds *= 1.0 + Sim->Config.ClockDriftPpm * 1e-6;
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frameSeconds * 0.5));
+}
+
+uint32_t GetBytesPerLine(VideoFormat const& mode, EMemoryFormat memoryFormat)
+{
+	if (memoryFormat == MEM_FMT_V210)
+		return (mode.Width + 47) / 48 * 128; // 6 pixels per 16 bytes, lines aligned to 128 bytes
+	return mode.Width * 2; // 2VUY
+}
+
+void FillBlack(std::vector<uint8_t>& buffer, EMemoryFormat memoryFormat)
+{
+	if (memoryFormat == MEM_FMT_V210)
+	{
+		// Y: 64, Cb/Cr: 512
+		constexpr uint32_t words[4] = {512 | 64 << 10 | 512 << 20, 64 | 512 << 10 | 64 << 20, 512 | 64 << 10 | 512 << 20, 64 | 512 << 10 | 64 << 20};
+		for (size_t i = 0; i + sizeof(words) <= buffer.size(); i += sizeof(words))
+			memcpy(buffer.data() + i, words, sizeof(words));
+		return;
+	}
+	for (size_t i = 0; i + 1 < buffer.size(); i += 2)
+	{
+		buffer[i] = 0x80;
+		buffer[i + 1] = 0x10;
+	}
+}
+
+void DoTransfer(Card& card, Transfer const& transfer)
+{
+	std::this_thread::sleep_for(Sim->Config.DMALatency);
+	std::unique_lock link(card.LinkMutex);
+	auto start = Clock::now();
+	{
+		std::unique_lock lock(transfer.Channel->Mutex);
+		auto& buffer = transfer.Channel->Buffers[transfer.Buffer];
+		if (!transfer.Field)
+		{
+			if (buffer.size() < transfer.Offset + transfer.Size)
+				buffer.resize(transfer.Offset + transfer.Size);
+			if (transfer.Write)
+				memcpy(buffer.data() + transfer.Offset, transfer.Data, transfer.Size);
+			else
+				memcpy(transfer.Data, buffer.data() + transfer.Offset, transfer.Size);
+		}
+		else if (transfer.Pitch)
+		{
+			// Field lines are packed in host memory, interleaved in the card buffer. Offset is into the field, e.g. of
+			// the band of one link of a multi-link transfer.
+			uint32_t firstLine = transfer.Offset / transfer.Pitch;
+			for (uint32_t line = 0; line * transfer.Pitch < transfer.Size; ++line)
+			{
+				size_t cardOffset = size_t((firstLine + line) * 2 + transfer.Field - 1) * transfer.Pitch;
+				uint32_t lineSize = std::min(transfer.Pitch, transfer.Size - line * transfer.Pitch);
+				if (buffer.size() < cardOffset + lineSize)
+					buffer.resize(cardOffset + lineSize);
+				if (transfer.Write)
+					memcpy(buffer.data() + cardOffset, transfer.Data + line * transfer.Pitch, lineSize);
+				else
+					memcpy(transfer.Data + line * transfer.Pitch, buffer.data() + cardOffset, lineSize);
+			}
+		}
+	}
+	auto busy = std::chrono::duration<double>(transfer.Size / (Sim->Config.DMABandwidthMBps * 1e6));
+	std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(busy));
+}
+
+bool IsOverlapped(Transfer const& transfer)
+{
+#if _WIN32
+	return transfer.Overlapped;
+#else
+	return transfer.Completion;
+#endif
+}
+
+void SignalCompletion(Transfer const& transfer)
+{
+#if _WIN32
+	if (!transfer.Overlapped)
+		return;
+	transfer.Overlapped->Internal = 0;
+	transfer.Overlapped->InternalHigh = transfer.Size;
+	SetEvent(transfer.Overlapped->hEvent);
+#else
+	if (transfer.Completion)
+		transfer.Completion->Signal(false);
+#endif
+}
+
+void RunDMAWorker(Card& card)
+{
+	while (true)
+	{
+		Transfer transfer;
+		{
+			std::unique_lock lock(card.QueueMutex);
+			card.QueueCV.wait(lock, [&] { return card.Stopping || !card.Queue.empty(); });
+			if (card.Queue.empty())
+				return;
+			transfer = card.Queue.front();
+			card.Queue.pop_front();
+		}
+		DoTransfer(card, transfer);
+		SignalCompletion(transfer);
+	}
+}
+
+// Entry points. Parameter types of some are deduced from the SDK's function pointer typedefs,
+// which differ slightly between SDK versions and platforms.
+
+BLUEVELVETC_HANDLE Factory()
+{
+	return reinterpret_cast<BLUEVELVETC_HANDLE>(new Handle());
+}
+
+void Destroy(BLUEVELVETC_HANDLE handle)
+{
+	delete ToHandle(handle);
+}
+
+BErr Enumerate(BLUEVELVETC_HANDLE, BLUE_S32* deviceCount)
+{
+	*deviceCount = static_cast<BLUE_S32>(Sim->Cards.size());
+	return BERR_NO_ERROR;
+}
+
+BErr Attach(BLUEVELVETC_HANDLE handle, BLUE_S32 deviceId)
+{
+	auto* card = FindCard(deviceId);
+	if (!card)
+		return BERR_INVALID_ARG;
+	if (Sim->Config.AttachLatency.count() > 0)
+		std::this_thread::sleep_for(Sim->Config.AttachLatency);
+	*ToHandle(handle) = Handle{.Attached = card};
+	return BERR_NO_ERROR;
+}
+
+BErr Detach(BLUEVELVETC_HANDLE handle)
+{
+	*ToHandle(handle) = Handle{};
+	return BERR_NO_ERROR;
+}
+
+template <typename Property, typename Value>
+BErr SetCardProperty32(BLUEVELVETC_HANDLE handle, Property property, Value value)
+{
+	auto* h = ToHandle(handle);
+	if (!h->Attached)
+		return BERR_INVALID_ARG;
+	// Binds the handle to a channel for waits without setting the channel up, like the SDK's default channel properties
+	if (property == DEFAULT_VIDEO_INPUT_CHANNEL || property == DEFAULT_VIDEO_OUTPUT_CHANNEL)
+	{
+		auto index = FindChannelIndex(value);
+		if (!IsChannelAvailable(index) || ChannelDescs[index].Input != (property == DEFAULT_VIDEO_INPUT_CHANNEL))
+			return BERR_INVALID_ARG;
+		h->ChannelIndex = index;
+	}
+	return BERR_NO_ERROR;
+}
+
+template <typename Property, typename Value>
+BErr QueryCardProperty32(BLUEVELVETC_HANDLE handle, Property, Value* value)
+{
+	*value = 0;
+	return ToHandle(handle)->Attached ? BERR_NO_ERROR : BERR_INVALID_ARG;
+}
+
+template <typename UpdateType, typename FieldCount>
+BErr WaitVideoSync(BLUEVELVETC_HANDLE handle, UpdateType updateType, FieldCount* fieldCount, bool input)
+{
+	auto* h = ToHandle(handle);
+	if (!h->Attached || h->ChannelIndex >= ChannelCount || ChannelDescs[h->ChannelIndex].Input != input)
+		return BERR_INVALID_ARG;
+	auto& card = *h->Attached;
+	auto& channel = card.Channels[h->ChannelIndex];
+	VideoFormat const* mode;
+	uint64_t waits;
+	{
+		std::unique_lock lock(channel.Mutex);
+		mode = channel.Mode;
+		waits = ++channel.Waits;
+	}
+	if (!mode)
+		return BERR_INVALID_VIDEO_MODE;
+
+	auto fieldPeriod = GetFieldPeriod(*mode);
+	uint64_t fieldsPerWait = updateType == UPD_FMT_FIELD ? 1 : 2;
+	uint64_t fields = (Clock::now() - card.Epoch) / fieldPeriod;
+	uint64_t next = (fields / fieldsPerWait + 1) * fieldsPerWait;
+	auto& config = Sim->Config;
+	if (config.MissedVBIInterval && waits % config.MissedVBIInterval == 0)
+		next += fieldsPerWait;
+	Clock::duration jitter{};
+	if (config.VBIJitter.count() > 0)
+	{
+		std::unique_lock lock(Sim->JitterMutex);
+		jitter = std::chrono::microseconds(std::uniform_int_distribution<int64_t>(0, config.VBIJitter.count())(Sim->JitterRng));
+	}
+	std::this_thread::sleep_until(card.Epoch + next * fieldPeriod + jitter);
+	*fieldCount = static_cast<FieldCount>(next);
+	return BERR_NO_ERROR;
+}
+
+template <typename UpdateType, typename FieldCount>
+BErr WaitVideoInputSync(BLUEVELVETC_HANDLE handle, UpdateType updateType, FieldCount* fieldCount)
+{
+	return WaitVideoSync(handle, updateType, fieldCount, true);
+}
+
+template <typename UpdateType, typename FieldCount>
+BErr WaitVideoOutputSync(BLUEVELVETC_HANDLE handle, UpdateType updateType, FieldCount* fieldCount)
+{
+	return WaitVideoSync(handle, updateType, fieldCount, false);
+}
+
+template <typename Ret, typename Data, typename Size, typename Overlapped, typename BufferId, typename Offset>
+Ret Dma(BLUEVELVETC_HANDLE handle, Data* data, Size size, Overlapped* overlapped, BufferId bufferId, Offset offset, bool write)
+{
+	auto* h = ToHandle(handle);
+	if (!h->Attached || !IsChannelAvailable(h->ChannelIndex))
+		return BERR_INVALID_ARG;
+	auto it = Sim->DMABufferIds.find(static_cast<unsigned long>(bufferId));
+	if (it == Sim->DMABufferIds.end())
+		return BERR_INVALID_ARG;
+	auto& card = *h->Attached;
+	auto& channel = card.Channels[h->ChannelIndex];
+	uint32_t pitch = 0;
+	{
+		std::unique_lock lock(channel.Mutex);
+		if (it->second.Buffer >= channel.Buffers.size())
+			return BERR_INVALID_ARG;
+		if (channel.Mode)
+			pitch = GetBytesPerLine(*channel.Mode, channel.MemoryFormat);
+	}
+	Transfer transfer{
+		.Channel = &channel,
+		.Buffer = it->second.Buffer,
+		.Field = it->second.Field,
+		.Pitch = pitch,
+		.Data = reinterpret_cast<uint8_t*>(data),
+		.Size = static_cast<uint32_t>(size),
+		.Offset = static_cast<uint32_t>(offset),
+		.Write = write,
+	};
+#if _WIN32
+	if constexpr (std::is_same_v<Overlapped, OVERLAPPED>)
+	{
+		transfer.Overlapped = overlapped;
+		if (overlapped)
+			ResetEvent(overlapped->hEvent);
+	}
+#else
+	transfer.Completion = reinterpret_cast<DMACompletion*>(overlapped);
+#endif
+	if (IsOverlapped(transfer))
+	{
+		std::unique_lock lock(card.QueueMutex);
+		if (!card.Stopping)
+		{
+			card.Queue.push_back(transfer);
+			card.QueueCV.notify_one();
+			return BERR_NO_ERROR;
+		}
+	}
+	DoTransfer(card, transfer);
+	SignalCompletion(transfer);
+	return BERR_NO_ERROR;
+}
+
+template <typename Ret, typename Data, typename Size, typename Overlapped, typename BufferId, typename Offset>
+Ret DmaReadFromCardAsync(BLUEVELVETC_HANDLE handle, Data* data, Size size, Overlapped* overlapped, BufferId bufferId, Offset offset)
+{
+	return Dma<Ret>(handle, data, size, overlapped, bufferId, offset, false);
+}
+
+template <typename Ret, typename Data, typename Size, typename Overlapped, typename BufferId, typename Offset>
+Ret DmaWriteToCardAsync(BLUEVELVETC_HANDLE handle, Data* data, Size size, Overlapped* overlapped, BufferId bufferId, Offset offset)
+{
+	return Dma<Ret>(handle, data, size, overlapped, bufferId, offset, true);
+}
+
+template <typename BufferId>
+BErr RenderBuffer(BLUEVELVETC_HANDLE handle, BufferId bufferId, bool capture)
+{
+	auto* h = ToHandle(handle);
+	if (!h->Attached || !IsChannelAvailable(h->ChannelIndex) || ChannelDescs[h->ChannelIndex].Input != capture)
+		return BERR_INVALID_ARG;
+	auto it = Sim->RenderBufferIds.find(static_cast<unsigned long>(bufferId));
+	if (it == Sim->RenderBufferIds.end())
+		return BERR_INVALID_ARG;
+	auto& channel = h->Attached->Channels[h->ChannelIndex];
+	std::unique_lock lock(channel.Mutex);
+	(capture ? channel.CaptureBuffer : channel.PlaybackBuffer) = it->second;
+	return BERR_NO_ERROR;
+}
+
+template <typename BufferId>
+BErr RenderBufferCapture(BLUEVELVETC_HANDLE handle, BufferId bufferId)
+{
+	return RenderBuffer(handle, bufferId, true);
+}
+
+template <typename BufferId>
+BErr RenderBufferUpdate(BLUEVELVETC_HANDLE handle, BufferId bufferId)
+{
+	return RenderBuffer(handle, bufferId, false);
+}
+
+template <typename Count>
+BErr GetRenderBufferCount(BLUEVELVETC_HANDLE handle, Count* count)
+{
+	auto* h = ToHandle(handle);
+	if (!h->Attached)
+		return BERR_INVALID_ARG;
+	*count = Sim->Config.BufferCount;
+	return BERR_NO_ERROR;
+}
+
+template <typename Mode, typename Value>
+BErr GetVideoWidth(Mode mode, Value* width)
+{
+	auto* desc = FindVideoFormat(mode);
+	if (!desc)
+		return BERR_INVALID_VIDEO_MODE;
+	*width = desc->Width;
+	return BERR_NO_ERROR;
+}
+
+template <typename Mode, typename MemoryFormat, typename Value>
+BErr GetVideoBytesPerLine(Mode mode, MemoryFormat memoryFormat, Value* bytesPerLine)
+{
+	auto* desc = FindVideoFormat(mode);
+	if (!desc)
+		return BERR_INVALID_VIDEO_MODE;
+	if (memoryFormat != MEM_FMT_2VUY && memoryFormat != MEM_FMT_V210)
+		return BERR_NOT_SUPPORTED;
+	*bytesPerLine = GetBytesPerLine(*desc, static_cast<EMemoryFormat>(memoryFormat));
+	return BERR_NO_ERROR;
+}
+
+template <typename Mode, typename UpdateType, typename Value>
+BErr GetVideoHeight(Mode mode, UpdateType updateType, Value* height)
+{
+	auto* desc = FindVideoFormat(mode);
+	if (!desc)
+		return BERR_INVALID_VIDEO_MODE;
+	*height = (updateType == UPD_FMT_FIELD && !desc->IsProgressive()) ? desc->Height / 2 : desc->Height;
+	return BERR_NO_ERROR;
+}
+
+template <typename Err>
+const char* UtilsGetStringForBErr(Err err)
+{
+	switch (err)
+	{
+	case BERR_NO_ERROR: return "No error";
+	case BERR_INVALID_ARG: return "Invalid argument (simulator)";
+	case BERR_INVALID_VIDEO_MODE: return "Invalid video mode (simulator)";
+	case BERR_NOT_SUPPORTED: return "Not supported (simulator)";
+	default: return "Unknown error (simulator)";
+	}
+}
+
+template <typename CardType>
+const char* UtilsGetStringForCardType(CardType)
+{
+	return "Simulated Bluefish444 Card";
+}
+
+template <typename Mode>
+const char* UtilsGetStringForVideoMode(Mode mode)
+{
+	auto* desc = FindVideoFormat(mode);
+	return desc ? desc->Name : "Invalid video mode";
+}
+
+template <typename MemoryFormat>
+const char* UtilsGetStringForMemoryFormat(MemoryFormat memoryFormat)
+{
+	switch (memoryFormat)
+	{
+	case MEM_FMT_2VUY: return "2VUY";
+	case MEM_FMT_V210: return "V210";
+	default: return "Unsupported memory format (simulator)";
+	}
+}
+
+template <typename Channel>
+const char* UtilsGetStringForVideoChannel(Channel channel)
+{
+	auto index = FindChannelIndex(channel);
+	return index < ChannelCount ? ChannelDescs[index].Name : "Invalid channel";
+}
+
+BErr UtilsGetDeviceInfo(BLUE_S32 deviceId, blue_device_info* info)
+{
+	auto* card = FindCard(deviceId);
+	if (!card)
+		return BERR_INVALID_ARG;
+	*info = card->Info;
+	return BERR_NO_ERROR;
+}
+
+blue_setup_info UtilsGetDefaultSetupInfoInput(EBlueVideoChannel channel)
+{
+	blue_setup_info setup{};
+	setup.VideoChannel = channel;
+	setup.VideoModeExt = VID_FMT_EXT_INVALID;
+	setup.MemoryFormat = MEM_FMT_2VUY;
+	setup.VideoEngine = VIDEO_ENGINE_FRAMESTORE;
+	setup.TransportSampling = Signal_FormatType_422;
+	setup.SignalLinkType = SIGNAL_LINK_TYPE_SINGLE_LINK;
+	return setup;
+}
+
+blue_setup_info UtilsGetDefaultSetupInfoOutput(EBlueVideoChannel channel, EVideoModeExt mode)
+{
+	auto setup = UtilsGetDefaultSetupInfoInput(channel);
+	setup.VideoModeExt = mode;
+	return setup;
+}
+
+EVideoModeExt GetInputVideoMode()
+{
+	auto& config = Sim->Config;
+	if (config.AlternateInputVideoMode == VID_FMT_EXT_INVALID || config.InputModeSwitchInterval.count() <= 0)
+		return config.InputVideoMode;
+	return (Clock::now() - Sim->Start) / config.InputModeSwitchInterval % 2 ? config.AlternateInputVideoMode : config.InputVideoMode;
+}
+
+template <typename Preference>
+BErr UtilsGetSetupInfoForInputSignal(BLUEVELVETC_HANDLE, blue_setup_info* setup, Preference)
+{
+	auto index = FindChannelIndex(setup->VideoChannel);
+	if (!FindCard(setup->DeviceId) || !IsChannelAvailable(index) || !ChannelDescs[index].Input)
+		return BERR_NOT_SUPPORTED;
+	setup->VideoModeExt = GetInputVideoMode();
+	switch (Sim->Config.InputLinkCount)
+	{
+	case 2: setup->SignalLinkType = SIGNAL_LINK_TYPE_DUAL_LINK; break;
+	case 4: setup->SignalLinkType = SIGNAL_LINK_TYPE_QUAD_LINK; break;
+	default: setup->SignalLinkType = SIGNAL_LINK_TYPE_SINGLE_LINK; break;
+	}
+	return BERR_NO_ERROR;
+}
+
+BErr UtilsValidateSetupInfo(blue_setup_info* setup)
+{
+	auto index = FindChannelIndex(setup->VideoChannel);
+	if (!FindVideoFormat(setup->VideoModeExt) || !IsChannelAvailable(index))
+		return BERR_INVALID_ARG;
+	if (setup->MemoryFormat != MEM_FMT_2VUY && setup->MemoryFormat != MEM_FMT_V210)
+		return BERR_NOT_SUPPORTED;
+	uint32_t links = 1;
+	switch (setup->SignalLinkType)
+	{
+	case SIGNAL_LINK_TYPE_SINGLE_LINK: break;
+	case SIGNAL_LINK_TYPE_DUAL_LINK: links = 2; break;
+	case SIGNAL_LINK_TYPE_QUAD_LINK: links = 4; break;
+	default: return BERR_NOT_SUPPORTED;
+	}
+	// Links of a group are consecutive connectors starting at a multiple of the link count
+	auto& desc = ChannelDescs[index];
+	if ((desc.Number - 1) % links || !IsChannelAvailable(index + links - 1))
+		return BERR_INVALID_ARG;
+	return BERR_NO_ERROR;
+}
+
+BErr Setup(BLUEVELVETC_HANDLE handle, blue_setup_info* setup, bool input)
+{
+	auto* h = ToHandle(handle);
+	auto index = FindChannelIndex(setup->VideoChannel);
+	if (!h->Attached || !IsChannelAvailable(index) || ChannelDescs[index].Input != input)
+		return BERR_INVALID_ARG;
+	auto* mode = FindVideoFormat(input ? GetInputVideoMode() : setup->VideoModeExt);
+	if (!mode)
+		return BERR_INVALID_VIDEO_MODE;
+	setup->VideoModeExt = mode->Mode;
+	auto& channel = h->Attached->Channels[index];
+	{
+		std::unique_lock lock(channel.Mutex);
+		channel.Mode = mode;
+		channel.MemoryFormat = static_cast<EMemoryFormat>(setup->MemoryFormat);
+		channel.Buffers.assign(Sim->Config.BufferCount, {});
+		for (auto& buffer : channel.Buffers)
+		{
+			buffer.resize(GetBytesPerLine(*mode, channel.MemoryFormat) * mode->Height);
+			FillBlack(buffer, channel.MemoryFormat);
+		}
+		channel.CaptureBuffer = std::nullopt;
+		channel.PlaybackBuffer = std::nullopt;
+	}
+	h->ChannelIndex = index;
+	return BERR_NO_ERROR;
+}
+
+BErr UtilsSetupInput(BLUEVELVETC_HANDLE handle, blue_setup_info* setup)
+{
+	return Setup(handle, setup, true);
+}
+
+BErr UtilsSetupOutput(BLUEVELVETC_HANDLE handle, blue_setup_info* setup)
+{
+	return Setup(handle, setup, false);
+}
+
+template <typename Ret, typename Mode>
+Ret UtilsGetFpsForVideoMode(Mode mode)
+{
+	auto* desc = FindVideoFormat(mode);
+	return static_cast<Ret>(desc ? desc->GetFps() : 0);
+}
+
+template <typename Ret, typename Mode>
+Ret UtilsIsVideoMode1001Framerate(Mode mode)
+{
+	auto* desc = FindVideoFormat(mode);
+	return static_cast<Ret>(desc && desc->Is1001());
+}
+
+template <typename Ret, typename Mode>
+Ret UtilsIsVideoModeProgressive(Mode mode)
+{
+	auto* desc = FindVideoFormat(mode);
+	return static_cast<Ret>(desc && desc->IsProgressive());
+}
+
+template <typename Ret, typename Mode>
+Ret UtilsIsVideoModePsF(Mode mode)
+{
+	auto* desc = FindVideoFormat(mode);
+	return static_cast<Ret>(desc && desc->IsPsF());
+}
+
+template <typename Mode, typename Value, typename ScanMode>
+BErr UtilsGetFrameInfoForVideoModeExtV2(Mode mode, Value* width, Value* height, Value* rate, Value* is1001, ScanMode* scanMode)
+{
+	auto* desc = FindVideoFormat(mode);
+	if (!desc)
+		return BERR_INVALID_VIDEO_MODE;
+	*width = desc->Width;
+	*height = desc->Height;
+	*rate = desc->GetFps();
+	*is1001 = desc->Is1001();
+	*scanMode = static_cast<ScanMode>(desc->IsProgressive() ? 0 : 1);
+	return BERR_NO_ERROR;
+}
+
+std::optional<std::string> GetEnv(const char* name)
+{
+	if (auto* value = std::getenv(name))
+		return std::string(value);
+	return std::nullopt;
+}
+
+template <typename T>
+void ReadEnv(const char* name, T& out)
+{
+	auto value = GetEnv(name);
+	if (!value)
+		return;
+	if constexpr (std::is_floating_point_v<T>)
+		out = std::strtod(value->c_str(), nullptr);
+	else if constexpr (std::is_same_v<T, std::chrono::microseconds> || std::is_same_v<T, std::chrono::milliseconds>)
+		out = T(std::strtoll(value->c_str(), nullptr, 10));
+	else
+		out = static_cast<T>(std::strtoul(value->c_str(), nullptr, 10));
+}
+
+} // namespace
+
+bool IsSimulatorRequested()
+{
+	auto value = GetEnv("BLUEFISH444_SIMULATOR");
+	return value && !value->empty() && *value != "0";
+}
+
+SimulatorConfig LoadConfigFromEnvironment()
+{
+	SimulatorConfig config;
+	ReadEnv("BLUEFISH444_SIM_DEVICES", config.DeviceCount);
+	ReadEnv("BLUEFISH444_SIM_INPUTS", config.InputChannelCount);
+	ReadEnv("BLUEFISH444_SIM_OUTPUTS", config.OutputChannelCount);
+	ReadEnv("BLUEFISH444_SIM_BUFFERS", config.BufferCount);
+	ReadEnv("BLUEFISH444_SIM_INPUT_LINKS", config.InputLinkCount);
+	ReadEnv("BLUEFISH444_SIM_ATTACH_LATENCY_US", config.AttachLatency);
+	ReadEnv("BLUEFISH444_SIM_CLOCK_DRIFT_PPM", config.ClockDriftPpm);
+	ReadEnv("BLUEFISH444_SIM_VBI_JITTER_US", config.VBIJitter);
+	ReadEnv("BLUEFISH444_SIM_MISSED_VBI_INTERVAL", config.MissedVBIInterval);
+	ReadEnv("BLUEFISH444_SIM_DMA_MBPS", config.DMABandwidthMBps);
+	ReadEnv("BLUEFISH444_SIM_DMA_LATENCY_US", config.DMALatency);
+	ReadEnv("BLUEFISH444_SIM_INPUT_SWITCH_MS", config.InputModeSwitchInterval);
+	auto readMode = [](const char* name, EVideoModeExt& out) {
+		auto modeName = GetEnv(name);
+		if (!modeName)
+			return;
+		if (auto* desc = FindVideoFormat(*modeName))
+			out = desc->Mode;
+		else
+			nosEngine.LogW("Bluefish444 Simulator: Unknown input video mode '%s'", modeName->c_str());
+	};
+	readMode("BLUEFISH444_SIM_INPUT_MODE", config.InputVideoMode);
+	readMode("BLUEFISH444_SIM_ALTERNATE_INPUT_MODE", config.AlternateInputVideoMode);
+	return config;
+}
+
+bool LoadFunctionPointers_Simulator(SimulatorConfig const& config)
+{
+	if (Sim)
+		return true;
+	if (config.DeviceCount == 0 || config.DeviceCount > 15 || config.BufferCount == 0 || config.DMABandwidthMBps <= 0.0 ||
+		(config.InputLinkCount != 1 && config.InputLinkCount != 2 && config.InputLinkCount != 4))
+	{
+		nosEngine.LogE("Bluefish444 Simulator: Invalid configuration");
+		return false;
+	}
+	Sim = new Simulator{.Config = config};
+	for (uint32_t i = 0; i < config.BufferCount; ++i)
+	{
+		Sim->DMABufferIds[BlueImage_DMABuffer(i, BLUE_DMA_DATA_TYPE_IMAGE_FRAME)] = {i, 0};
+		Sim->DMABufferIds[BlueImage_DMABuffer(i, BLUE_DMA_DATA_TYPE_IMAGE_FIELD1)] = {i, 1};
+		Sim->DMABufferIds[BlueImage_DMABuffer(i, BLUE_DMA_DATA_TYPE_IMAGE_FIELD2)] = {i, 2};
+		Sim->RenderBufferIds[BlueBuffer_Image(i)] = i;
+	}
+	for (uint32_t i = 0; i < config.DeviceCount; ++i)
+	{
+		auto card = std::make_unique<Card>();
+		card->Id = static_cast<BLUE_S32>(i + 1);
+		card->Info.CardType = CRD_BLUE_KRONOS_K8;
+		std::string serial = "SIM" + std::to_string(i + 1);
+		memcpy(card->Info.CardSerialNumber, serial.c_str(), std::min(serial.size(), sizeof(card->Info.CardSerialNumber) - 1));
+		card->Worker = std::thread(RunDMAWorker, std::ref(*card));
+		Sim->Cards.push_back(std::move(card));
+	}
+
+	bfcFactory = &Factory;
+	bfcDestroy = &Destroy;
+	bfcEnumerate = &Enumerate;
+	bfcAttach = &Attach;
+	bfcDetach = &Detach;
+	bfcSetCardProperty32 = &SetCardProperty32;
+	bfcQueryCardProperty32 = &QueryCardProperty32;
+	bfcWaitVideoInputSync = &WaitVideoInputSync;
+	bfcWaitVideoOutputSync = &WaitVideoOutputSync;
+	bfcDmaReadFromCardAsync = &DmaReadFromCardAsync;
+	bfcDmaWriteToCardAsync = &DmaWriteToCardAsync;
+	bfcRenderBufferCapture = &RenderBufferCapture;
+	bfcRenderBufferUpdate = &RenderBufferUpdate;
+	bfcGetRenderBufferCount = &GetRenderBufferCount;
+	bfcGetVideoWidth = &GetVideoWidth;
+	bfcGetVideoBytesPerLineV2 = &GetVideoBytesPerLine;
+	bfcGetVideoHeight = &GetVideoHeight;
+	bfcUtilsGetStringForBErr = &UtilsGetStringForBErr;
+	bfcUtilsGetStringForCardType = &UtilsGetStringForCardType;
+	bfcUtilsGetStringForVideoMode = &UtilsGetStringForVideoMode;
+	bfcUtilsGetStringForVideoChannel = &UtilsGetStringForVideoChannel;
+	bfcUtilsGetStringForMemoryFormat = &UtilsGetStringForMemoryFormat;
+	bfcUtilsGetDeviceInfo = &UtilsGetDeviceInfo;
+	bfcUtilsGetDefaultSetupInfoInput = &UtilsGetDefaultSetupInfoInput;
+	bfcUtilsGetDefaultSetupInfoOutput = &UtilsGetDefaultSetupInfoOutput;
+	bfcUtilsGetSetupInfoForInputSignal = &UtilsGetSetupInfoForInputSignal;
+	bfcUtilsGetRecommendedSetupInfoInput = &UtilsGetSetupInfoForInputSignal;
+	bfcUtilsValidateSetupInfo = &UtilsValidateSetupInfo;
+	bfcUtilsSetupInput = &UtilsSetupInput;
+	bfcUtilsSetupOutput = &UtilsSetupOutput;
+	bfcUtilsGetFpsForVideoMode = &UtilsGetFpsForVideoMode;
+	bfcUtilsIsVideoMode1001Framerate = &UtilsIsVideoMode1001Framerate;
+	bfcUtilsIsVideoModeProgressive = &UtilsIsVideoModeProgressive;
+	bfcUtilsIsVideoModePsF = &UtilsIsVideoModePsF;
+	bfcUtilsGetFrameInfoForVideoModeExtV2 = &UtilsGetFrameInfoForVideoModeExtV2;
+
+	nosEngine.LogI("Bluefish444 Simulator: %u device(s), %u input(s) and %u output(s) per device",
+				   config.DeviceCount, config.InputChannelCount, config.OutputChannelCount);
+	return true;
+}
+
+void UnloadSimulator()
+{
+	if (!Sim)
+		return;
+	for (auto& card : Sim->Cards)
+	{
+		{
+			std::unique_lock lock(card->QueueMutex);
+			card->Stopping = true;
+		}
+		card->QueueCV.notify_all();
+		if (card->Worker.joinable())
+			card->Worker.join();
+	}
+}
+
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include "Device.hpp"
+
+// stl
+#include <chrono>
+
+namespace bf::sim
+{
+
+// Software model of a Bluefish card, installed behind the BlueVelvetC function pointer table.
+// Lets BluefishDevice/Channel run on machines without a card (e.g. CI) while keeping VBI and DMA timing realistic.
+struct SimulatorConfig
+{
+	uint32_t DeviceCount = 1;
+	uint32_t InputChannelCount = 8;
+	uint32_t OutputChannelCount = 8;
+	uint32_t BufferCount = 4; // Card buffers per channel
+	EVideoModeExt InputVideoMode = VID_FMT_EXT_1080P_5000;
+	uint32_t InputLinkCount = 1; // Links of the signal detected on all inputs: 1, 2 or 4
+	// Signal of all inputs switches between InputVideoMode and this every InputModeSwitchInterval, e.g. to test
+	// reconfiguration of open input channels. VID_FMT_EXT_INVALID: Never.
+	EVideoModeExt AlternateInputVideoMode = VID_FMT_EXT_INVALID;
+	std::chrono::milliseconds InputModeSwitchInterval{10'000};
+	std::chrono::microseconds AttachLatency{0}; // Time each bfcAttach call takes, e.g. to reproduce slow startup with many cards
+
+	// VBI cadence
+	double ClockDriftPpm = 0.0; // Positive values make the simulated card clock run slower than the host clock
+	std::chrono::microseconds VBIJitter{0}; // Upper bound of random wake-up delay after each interrupt
+	uint32_t MissedVBIInterval = 0; // Every Nth VBI wait misses an interrupt (0: never)
+
+	// DMA model: Each card has a single link shared by all of its channels
+	double DMABandwidthMBps = 6000.0;
+	std::chrono::microseconds DMALatency{30};
+};
+
+// Simulator is selected by setting BLUEFISH444_SIMULATOR=1.
+// Other BLUEFISH444_SIM_* variables override the fields of SimulatorConfig (see README).
+bool IsSimulatorRequested();
+SimulatorConfig LoadConfigFromEnvironment();
+
+// Points the BlueVelvetC function pointers to the simulated card.
+bool LoadFunctionPointers_Simulator(SimulatorConfig const& config);
+// Stops simulator threads. Function pointers stay valid, DMA transfers complete synchronously afterwards.
+void UnloadSimulator();
+
+}
@@ -0,0 +1,241 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "Telemetry.hpp"
+
+// stl
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace bf
+{
+
+uint32_t LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+	value = std::min<uint64_t>(value, (1ull << MaxValueBits) - 1);
+	if (value < SubBucketCount)
+		return uint32_t(value);
+	uint32_t exponent = std::bit_width(value) - 1;
+	uint32_t shift = exponent - SubBucketBits;
+	uint32_t sub = uint32_t(value >> shift) & (SubBucketCount - 1);
+	return (shift + 1) * SubBucketCount + sub;
+}
+
+uint64_t LatencyHistogram::GetBucketLowerBound(uint32_t index)
+{
+	if (index < SubBucketCount)
+		return index;
+	uint32_t shift = index / SubBucketCount - 1;
+	uint64_t sub = index % SubBucketCount;
+	return (SubBucketCount + sub) << shift;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(uint32_t index)
+{
+	if (index < SubBucketCount)
+		return index;
+	uint32_t shift = index / SubBucketCount - 1;
+	return GetBucketLowerBound(index) + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds)
+{
+	Buckets[GetBucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	Sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+	auto min = Min.load(std::memory_order_relaxed);
+	while (nanoseconds < min && !Min.compare_exchange_weak(min, nanoseconds, std::memory_order_relaxed))
+		;
+	auto max = Max.load(std::memory_order_relaxed);
+	while (nanoseconds > max && !Max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+		;
+}
+
+LatencySnapshot LatencyHistogram::GetSnapshot() const
+{
+	LatencySnapshot snapshot;
+	for (uint32_t i = 0; i < BucketCount; ++i)
+	{
+		snapshot.Buckets[i] = Buckets[i].load(std::memory_order_relaxed);
+		snapshot.Count += snapshot.Buckets[i];
+	}
+	if (!snapshot.Count)
+		return snapshot;
+	snapshot.Sum = Sum.load(std::memory_order_relaxed);
+	snapshot.Min = Min.load(std::memory_order_relaxed);
+	snapshot.Max = Max.load(std::memory_order_relaxed);
+	return snapshot;
+}
+
+void LatencyHistogram::Reset()
+{
+	for (auto& bucket : Buckets)
+		bucket.store(0, std::memory_order_relaxed);
+	Sum = 0;
+	Min = UINT64_MAX;
+	Max = 0;
+}
+
+uint64_t LatencySnapshot::Percentile(double percentile) const
+{
+	if (!Count)
+		return 0;
+	auto rank = uint64_t(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * Count));
+	if (rank == 0)
+		return Min;
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < Buckets.size(); ++i)
+	{
+		seen += Buckets[i];
+		if (seen >= rank)
+			return std::clamp(LatencyHistogram::GetBucketUpperBound(i), Min, Max);
+	}
+	return Max;
+}
+
+LatencySnapshot LatencySnapshot::Since(LatencySnapshot const& earlier) const
+{
+	LatencySnapshot window;
+	std::optional<uint32_t> first, last;
+	for (uint32_t i = 0; i < Buckets.size(); ++i)
+	{
+		window.Buckets[i] = Buckets[i] - std::min(Buckets[i], earlier.Buckets[i]);
+		window.Count += window.Buckets[i];
+		if (window.Buckets[i])
+		{
+			first = first.value_or(i);
+			last = i;
+		}
+	}
+	if (!window.Count)
+		return window;
+	window.Sum = Sum - std::min(Sum, earlier.Sum);
+	window.Min = std::max(LatencyHistogram::GetBucketLowerBound(*first), Min);
+	window.Max = std::min(LatencyHistogram::GetBucketUpperBound(*last), Max);
+	return window;
+}
+
+std::string LatencySnapshot::ToString() const
+{
+	if (!Count)
+		return "-";
+	auto ms = [](uint64_t ns) { return ns / 1e6; };
+	char str[96];
+	snprintf(str, sizeof(str), "p50 %.2f ms, p99 %.2f ms, max %.2f ms (%llu)", ms(Percentile(50)), ms(Percentile(99)), ms(Max), (unsigned long long)Count);
+	return str;
+}
+
+void ChannelTelemetry::RecordDMA(LatencyHistogram& histogram, TelemetryClock::duration elapsed)
+{
+	histogram.Record(elapsed);
+	auto vbiPeriod = VBIPeriod.load(std::memory_order_relaxed);
+	if (vbiPeriod && uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) > vbiPeriod)
+		Late.fetch_add(1, std::memory_order_relaxed);
+}
+
+ChannelTelemetrySnapshot ChannelTelemetry::GetSnapshot() const
+{
+	return {
+		.DMARead = DMARead.GetSnapshot(),
+		.DMAWrite = DMAWrite.GetSnapshot(),
+		.DMATransfer = DMATransfer.GetSnapshot(),
+		.GPUFlushWait = GPUFlushWait.GetSnapshot(),
+		.VBIWait = VBIWait.GetSnapshot(),
+		.VBIJitter = VBIJitter.GetSnapshot(),
+		.Frames = Frames.load(std::memory_order_relaxed),
+		.Dropped = Dropped.load(std::memory_order_relaxed),
+		.Late = Late.load(std::memory_order_relaxed),
+		.Repeated = Repeated.load(std::memory_order_relaxed),
+		.LateWakeups = LateWakeups.load(std::memory_order_relaxed),
+		.Discontinuities = Discontinuities.load(std::memory_order_relaxed),
+		.Skipped = Skipped.load(std::memory_order_relaxed),
+	};
+}
+
+void ChannelTelemetry::Reset()
+{
+	DMARead.Reset();
+	DMAWrite.Reset();
+	DMATransfer.Reset();
+	GPUFlushWait.Reset();
+	VBIWait.Reset();
+	VBIJitter.Reset();
+	Frames = 0;
+	Dropped = 0;
+	Late = 0;
+	Repeated = 0;
+	LateWakeups = 0;
+	Discontinuities = 0;
+	Skipped = 0;
+}
+
+void VBITimingMonitor::Reset(uint64_t fieldPeriod, uint32_t fieldsPerWait)
+{
+	*this = {};
+	FieldPeriod = fieldPeriod;
+	FieldsPerWait = std::max(fieldsPerWait, 1u);
+}
+
+VBITiming VBITimingMonitor::Update(unsigned long fieldCount, TelemetryClock::time_point wakeTime, ChannelTelemetry* telemetry)
+{
+	VBITiming timing{.FieldCount = fieldCount, .ExpectedFieldCount = fieldCount};
+	auto resync = [&] {
+		Epoch = wakeTime - std::chrono::nanoseconds(int64_t(fieldCount) * int64_t(FieldPeriod));
+		Floor = 0;
+	};
+	if (!LastFieldCount || !FieldPeriod)
+	{
+		resync();
+		LastFieldCount = fieldCount;
+		LastWakeTime = wakeTime;
+		return timing;
+	}
+	timing.ExpectedFieldCount = *LastFieldCount + FieldsPerWait;
+	auto delta = int64_t(fieldCount) - int64_t(*LastFieldCount);
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(wakeTime - LastWakeTime).count();
+	auto elapsedFields = (elapsed + int64_t(FieldPeriod) / 2) / int64_t(FieldPeriod);
+	LastFieldCount = fieldCount;
+	LastWakeTime = wakeTime;
+
+	if (std::abs(delta - elapsedFields) > int64_t(FieldsPerWait))
+	{
+		timing.Discontinuity = true;
+		++Discontinuities;
+		resync();
+	}
+	else
+	{
+		if (delta < int64_t(FieldsPerWait))
+		{
+			timing.Repeated = true;
+			++Repeated;
+		}
+		else if (delta > int64_t(FieldsPerWait))
+		{
+			timing.Dropped = uint32_t((delta - 1) / FieldsPerWait);
+			Dropped += timing.Dropped;
+		}
+		auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(wakeTime - Epoch).count() - int64_t(fieldCount) * int64_t(FieldPeriod);
+		if (offset < Floor)
+			Floor = offset;
+		else
+			Floor += (offset - Floor) / 256;
+		timing.Jitter = offset - Floor;
+		timing.Late = uint64_t(timing.Jitter) > FieldPeriod / 4;
+		LateWakeups += timing.Late;
+	}
+
+	if (telemetry)
+	{
+		if (!timing.Discontinuity)
+			telemetry->VBIJitter.Record(uint64_t(timing.Jitter));
+		telemetry->Dropped.fetch_add(timing.Dropped, std::memory_order_relaxed);
+		telemetry->Repeated.fetch_add(timing.Repeated, std::memory_order_relaxed);
+		telemetry->LateWakeups.fetch_add(timing.Late, std::memory_order_relaxed);
+		telemetry->Discontinuities.fetch_add(timing.Discontinuity, std::memory_order_relaxed);
+	}
+	return timing;
+}
+
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+// stl
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace bf
+{
+
+using TelemetryClock = std::chrono::steady_clock;
+
+struct LatencySnapshot;
+
+// Latency histogram with HDR-style buckets: Each power of two range is split into 16 linear sub-buckets, so recorded
+// values are kept with at most 1/16 relative error, from 1 ns up to ~18 minutes. Record is lock-free, does not allocate
+// and may be called from any thread.
+class LatencyHistogram
+{
+public:
+	static constexpr uint32_t SubBucketBits = 4;
+	static constexpr uint32_t SubBucketCount = 1u << SubBucketBits;
+	static constexpr uint32_t MaxValueBits = 40; // Larger values are clamped
+	static constexpr uint32_t BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+	void Record(uint64_t nanoseconds);
+	void Record(TelemetryClock::duration elapsed) { Record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())); }
+	// Buckets are read one by one, values recorded meanwhile may be partially included
+	LatencySnapshot GetSnapshot() const;
+	void Reset();
+
+	static uint32_t GetBucketIndex(uint64_t value);
+	// Smallest and largest value of the bucket
+	static uint64_t GetBucketLowerBound(uint32_t index);
+	static uint64_t GetBucketUpperBound(uint32_t index);
+
+private:
+	std::array<std::atomic<uint64_t>, BucketCount> Buckets{};
+	std::atomic<uint64_t> Sum = 0;
+	std::atomic<uint64_t> Min = UINT64_MAX;
+	std::atomic<uint64_t> Max = 0;
+};
+
+struct LatencySnapshot
+{
+	std::array<uint64_t, LatencyHistogram::BucketCount> Buckets{};
+	uint64_t Count = 0;
+	uint64_t Sum = 0;
+	uint64_t Min = 0;
+	uint64_t Max = 0;
+
+	// Upper bound of the bucket the value at percentile (0-100) falls into, clamped to Max. 0 if nothing was recorded.
+	uint64_t Percentile(double percentile) const;
+	uint64_t Mean() const { return Count ? Sum / Count : 0; }
+	// Values recorded after earlier was taken. Min and Max are bucket bounds.
+	LatencySnapshot Since(LatencySnapshot const& earlier) const;
+	// e.g. "p50 1.21 ms, p99 2.40 ms, max 3.05 ms (1500)"
+	std::string ToString() const;
+};
+
+struct ChannelTelemetrySnapshot
+{
+	LatencySnapshot DMARead;
+	LatencySnapshot DMAWrite;
+	LatencySnapshot DMATransfer;
+	LatencySnapshot GPUFlushWait;
+	LatencySnapshot VBIWait;
+	LatencySnapshot VBIJitter;
+	uint64_t Frames = 0;
+	uint64_t Dropped = 0;
+	uint64_t Late = 0;
+	uint64_t Repeated = 0;
+	uint64_t LateWakeups = 0;
+	uint64_t Discontinuities = 0;
+	uint64_t Skipped = 0;
+};
+
+// Counters of a channel, written by the DMA/VBI paths and read by anyone through snapshots.
+struct ChannelTelemetry
+{
+	LatencyHistogram DMARead; // Until the transfer is complete
+	LatencyHistogram DMAWrite; // From the call until the transfer is complete, including time in the queue
+	LatencyHistogram DMATransfer; // Run time of transfers on the DMA scheduler, excluding time in the queue
+	LatencyHistogram GPUFlushWait; // GPU work before DMA Write: The submission that wrote the frame, or a full flush
+	LatencyHistogram VBIWait; // Time subscribers wait for the next VBI, excluding the DMAs completed before it
+	LatencyHistogram VBIJitter; // Wake-up delay after the estimated interrupt time, see VBITimingMonitor
+	std::atomic<uint64_t> Frames = 0; // VBIs published by the dispatcher (fields in field mode)
+	std::atomic<uint64_t> Dropped = 0; // VBIs missed between waits
+	std::atomic<uint64_t> Late = 0; // DMAs that took longer than a VBI period
+	std::atomic<uint64_t> Repeated = 0; // Waits that returned before the next VBI
+	std::atomic<uint64_t> LateWakeups = 0;
+	std::atomic<uint64_t> Discontinuities = 0; // Field count jumps not explained by elapsed time, e.g. signal changes
+	std::atomic<uint64_t> Skipped = 0; // Frames not written because the GPU had not finished them (SkipIncompleteFrames)
+	std::atomic<uint64_t> VBIPeriod = 0; // Nanoseconds, set when the channel is opened or reconfigured
+
+	// Records into the histogram and counts the transfer as late if it exceeds the VBI period
+	void RecordDMA(LatencyHistogram& histogram, TelemetryClock::duration elapsed);
+	ChannelTelemetrySnapshot GetSnapshot() const;
+	void Reset();
+};
+
+// Result of a VBI wait, classified by VBITimingMonitor
+struct VBITiming
+{
+	unsigned long FieldCount = 0;
+	unsigned long ExpectedFieldCount = 0;
+	uint32_t Dropped = 0; // VBIs missed since the previous wait
+	bool Repeated = false; // Field count advanced less than one VBI
+	bool Late = false; // Woke up more than a quarter field after the interrupt
+	bool Discontinuity = false; // Field count does not match the elapsed time, timing is resynchronized
+	int64_t Jitter = 0; // Nanoseconds after the estimated interrupt time
+};
+
+// Tracks the field counts returned by consecutive VBI waits of one waiter against the expected count and the elapsed time.
+// Interrupt times are not reported by the card, so they are estimated from the earliest wake-ups: The wake-up offset from
+// the nominal field grid is followed by a floor that drops to earlier samples at once and rises slowly (to follow clock drift).
+class VBITimingMonitor
+{
+public:
+	// fieldsPerWait: 1 for field interrupts, 2 for frame interrupts (field counts advance by 2 per frame in all video modes)
+	void Reset(uint64_t fieldPeriod, uint32_t fieldsPerWait);
+	// Classifies the wait and adds the result to the telemetry counters if given
+	VBITiming Update(unsigned long fieldCount, TelemetryClock::time_point wakeTime, ChannelTelemetry* telemetry = nullptr);
+
+	uint64_t GetDropped() const { return Dropped; }
+	uint64_t GetRepeated() const { return Repeated; }
+	uint64_t GetLateWakeups() const { return LateWakeups; }
+	uint64_t GetDiscontinuities() const { return Discontinuities; }
+
+private:
+	uint64_t FieldPeriod = 0; // Nanoseconds
+	uint32_t FieldsPerWait = 2;
+	std::optional<unsigned long> LastFieldCount;
+	TelemetryClock::time_point LastWakeTime{};
+	TelemetryClock::time_point Epoch{}; // Wake time of the first wait, minus its field count in field periods
+	int64_t Floor = 0; // Estimated interrupt offset from the field grid, in nanoseconds
+	uint64_t Dropped = 0;
+	uint64_t Repeated = 0;
+	uint64_t LateWakeups = 0;
+	uint64_t Discontinuities = 0;
+};
+
+// Limits telemetry WatchLogs of a node to one per interval, so that summaries are only formatted when shown
+struct TelemetryLogInterval
+{
+	TelemetryClock::duration Interval = std::chrono::seconds(1);
+	TelemetryClock::time_point Next{};
+
+	bool IsDue()
+	{
+		auto now = TelemetryClock::now();
+		if (now < Next)
+			return false;
+		Next = now + Interval;
+		return true;
+	}
+};
+
+}
@@ -0,0 +1,389 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ThreadPlacement.hpp"
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#include <SetupAPI.h>
+#include <initguid.h>
+#include <devpkey.h>
+#pragma comment(lib, "SetupAPI.lib")
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// stl
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <tuple>
+
+#include <Nodos/Modules.h>
+
+namespace bf
+{
+
+namespace
+{
+
+constexpr uint32_t MaxCpus = 1024;
+
+std::optional<std::string> GetSetting(const char* name, std::string const& serial)
+{
+	if (!serial.empty())
+		if (auto* value = std::getenv((std::string(name) + "_" + serial).c_str()))
+			return value;
+	if (auto* value = std::getenv(name))
+		return value;
+	return std::nullopt;
+}
+
+// "0-3,8,10-11"
+std::vector<uint32_t> ParseCpuList(std::string const& list)
+{
+	std::vector<uint32_t> cpus;
+	std::stringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ','))
+	{
+		unsigned first = 0, last = 0;
+		auto count = sscanf(range.c_str(), "%u-%u", &first, &last);
+		if (count < 1)
+			continue;
+		if (count == 1)
+			last = first;
+		for (auto cpu = first; cpu <= last && cpu < MaxCpus; ++cpu)
+			cpus.push_back(cpu);
+	}
+	std::sort(cpus.begin(), cpus.end());
+	cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+	return cpus;
+}
+
+std::string FormatCpuList(std::vector<uint32_t> const& cpus)
+{
+	std::string list;
+	for (size_t i = 0; i < cpus.size();)
+	{
+		size_t j = i;
+		while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+			++j;
+		if (!list.empty())
+			list += ',';
+		list += std::to_string(cpus[i]);
+		if (j > i)
+			list += '-' + std::to_string(cpus[j]);
+		i = j + 1;
+	}
+	return list;
+}
+
+const char* GetPriorityName(ThreadPriority priority)
+{
+	switch (priority)
+	{
+	case ThreadPriority::High: return "high";
+	case ThreadPriority::RealTime: return "real-time";
+	default: return "normal";
+	}
+}
+
+#if _WIN32
+// Loaded at runtime so that the plugin does not link against avrt.lib
+struct MMCSS
+{
+	using SetCharacteristicsFn = HANDLE(WINAPI*)(LPCWSTR, LPDWORD);
+	using SetPriorityFn = BOOL(WINAPI*)(HANDLE, int);
+	using RevertFn = BOOL(WINAPI*)(HANDLE);
+	static constexpr int PriorityCritical = 2; // AVRT_PRIORITY_CRITICAL
+
+	MMCSS()
+	{
+		if (auto module = LoadLibraryW(L"avrt.dll"))
+		{
+			SetCharacteristics = reinterpret_cast<SetCharacteristicsFn>(GetProcAddress(module, "AvSetMmThreadCharacteristicsW"));
+			SetPriority = reinterpret_cast<SetPriorityFn>(GetProcAddress(module, "AvSetMmThreadPriority"));
+			Revert = reinterpret_cast<RevertFn>(GetProcAddress(module, "AvRevertMmThreadCharacteristics"));
+		}
+	}
+	static MMCSS const& Get()
+	{
+		static MMCSS mmcss;
+		return mmcss;
+	}
+
+	SetCharacteristicsFn SetCharacteristics = nullptr;
+	SetPriorityFn SetPriority = nullptr;
+	RevertFn Revert = nullptr;
+};
+
+bool SetAffinity(ThreadPlacement const& placement)
+{
+	GROUP_AFFINITY affinity{};
+	if (!placement.Cpus.empty())
+	{
+		// A thread runs in one processor group: Processors of the group of the first listed processor are used
+		affinity.Group = WORD(placement.Cpus[0] / 64);
+		for (auto cpu : placement.Cpus)
+			if (cpu / 64 == affinity.Group)
+				affinity.Mask |= KAFFINITY(1) << (cpu % 64);
+	}
+	else if (!GetNumaNodeProcessorMaskEx(USHORT(placement.NumaNode), &affinity))
+		return false;
+	return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+}
+
+bool SetPriority(ThreadPriority priority, void*& taskHandle)
+{
+	if (priority == ThreadPriority::High)
+		return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+	auto& mmcss = MMCSS::Get();
+	if (mmcss.SetCharacteristics)
+	{
+		DWORD taskIndex = 0;
+		if (auto task = mmcss.SetCharacteristics(L"Pro Audio", &taskIndex))
+		{
+			taskHandle = task;
+			if (mmcss.SetPriority)
+				mmcss.SetPriority(task, MMCSS::PriorityCritical);
+			return true;
+		}
+	}
+	// MMCSS service is not running
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+}
+
+// Large pages need the "Lock pages in memory" user right, enabled in the process token
+bool EnableLockMemoryPrivilege()
+{
+	static bool enabled = [] {
+		HANDLE token;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+			return false;
+		TOKEN_PRIVILEGES privileges{.PrivilegeCount = 1};
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+		// Succeeds without enabling privileges the user does not have, reported by ERROR_NOT_ALL_ASSIGNED
+		bool ok = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+		          AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+		CloseHandle(token);
+		return ok;
+	}();
+	return enabled;
+}
+
+// NUMA nodes of the PCIe devices of Bluefish444 cards, in bus order
+std::vector<int> GetCardPciNumaNodes()
+{
+	ULONG highestNode = 0;
+	if (!GetNumaHighestNodeNumber(&highestNode) || highestNode == 0)
+		return {};
+	struct PciDevice
+	{
+		DWORD Bus = 0, Address = 0; // Address: Device number in the high word, function number in the low word
+		int NumaNode = -1;
+	};
+	std::vector<PciDevice> devices;
+	auto deviceSet = SetupDiGetClassDevsW(nullptr, L"PCI", nullptr, DIGCF_ALLCLASSES | DIGCF_PRESENT);
+	if (deviceSet == INVALID_HANDLE_VALUE)
+		return {};
+	SP_DEVINFO_DATA info{.cbSize = sizeof(SP_DEVINFO_DATA)};
+	for (DWORD i = 0; SetupDiEnumDeviceInfo(deviceSet, i, &info); ++i)
+	{
+		wchar_t manufacturer[256]{};
+		if (!SetupDiGetDeviceRegistryPropertyW(deviceSet, &info, SPDRP_MFG, nullptr, reinterpret_cast<PBYTE>(manufacturer), sizeof(manufacturer) - sizeof(wchar_t), nullptr))
+			continue;
+		std::wstring name = manufacturer;
+		std::transform(name.begin(), name.end(), name.begin(), [](wchar_t c) { return wchar_t(std::towlower(c)); });
+		if (name.find(L"bluefish") == std::wstring::npos)
+			continue;
+		PciDevice device;
+		SetupDiGetDeviceRegistryPropertyW(deviceSet, &info, SPDRP_BUSNUMBER, nullptr, reinterpret_cast<PBYTE>(&device.Bus), sizeof(device.Bus), nullptr);
+		SetupDiGetDeviceRegistryPropertyW(deviceSet, &info, SPDRP_ADDRESS, nullptr, reinterpret_cast<PBYTE>(&device.Address), sizeof(device.Address), nullptr);
+		DEVPROPTYPE type = DEVPROP_TYPE_EMPTY;
+		ULONG domain = 0;
+		USHORT node = 0;
+		if (SetupDiGetDevicePropertyW(deviceSet, &info, &DEVPKEY_Numa_Proximity_Domain, &type, reinterpret_cast<PBYTE>(&domain), sizeof(domain), nullptr, 0) &&
+		    type == DEVPROP_TYPE_UINT32 && GetNumaProximityNodeEx(domain, &node))
+			device.NumaNode = node;
+		devices.push_back(device);
+	}
+	SetupDiDestroyDeviceInfoList(deviceSet);
+	std::sort(devices.begin(), devices.end(), [](auto& a, auto& b) { return std::tie(a.Bus, a.Address) < std::tie(b.Bus, b.Address); });
+	std::vector<int> nodes;
+	for (auto& device : devices)
+		nodes.push_back(device.NumaNode);
+	return nodes;
+}
+#else
+std::vector<uint32_t> GetNumaNodeCpus(int node)
+{
+	std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+	std::string list;
+	if (!std::getline(file, list))
+		return {};
+	return ParseCpuList(list);
+}
+
+// NUMA nodes of the PCIe devices bound to the Bluefish444 driver, in bus order
+std::vector<int> GetCardPciNumaNodes()
+{
+	namespace fs = std::filesystem;
+	std::error_code error;
+	if (!fs::exists("/sys/devices/system/node/node1", error))
+		return {};
+	std::vector<fs::path> devices;
+	for (auto& entry : fs::directory_iterator("/sys/bus/pci/devices", error))
+	{
+		auto driver = fs::read_symlink(entry.path() / "driver", error).filename().string();
+		std::transform(driver.begin(), driver.end(), driver.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+		if (driver.find("blue") != std::string::npos)
+			devices.push_back(entry.path());
+	}
+	// Names are fixed width addresses (domain:bus:device.function), so they sort in bus order
+	std::sort(devices.begin(), devices.end());
+	std::vector<int> nodes;
+	for (auto& device : devices)
+	{
+		int node = -1;
+		std::ifstream(device / "numa_node") >> node;
+		nodes.push_back(node);
+	}
+	return nodes;
+}
+
+bool SetAffinity(ThreadPlacement const& placement)
+{
+	auto cpus = placement.Cpus.empty() ? GetNumaNodeCpus(placement.NumaNode) : placement.Cpus;
+	if (cpus.empty())
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (auto cpu : cpus)
+		if (cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &set);
+	return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+bool SetPriority(ThreadPriority priority, void*&)
+{
+	if (priority == ThreadPriority::High)
+		return 0 == setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), -10);
+	sched_param param{};
+	param.sched_priority = std::min(50, sched_get_priority_max(SCHED_FIFO));
+	return 0 == pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+#endif
+
+}
+
+std::string ThreadPlacement::ToString() const
+{
+	std::string str = NumaNode < 0 ? "any NUMA node" : "NUMA node " + std::to_string(NumaNode);
+	if (!Cpus.empty())
+		str += ", CPUs " + FormatCpuList(Cpus);
+	return str + ", " + GetPriorityName(Priority) + " priority";
+}
+
+int GetCardNumaNode(int32_t deviceId)
+{
+	auto nodes = GetCardPciNumaNodes();
+	if (deviceId < 1 || size_t(deviceId) > nodes.size())
+		return -1;
+	return std::max(nodes[deviceId - 1], -1);
+}
+
+ThreadPlacement LoadThreadPlacement(std::string const& serial, int cardNumaNode)
+{
+	ThreadPlacement placement{.NumaNode = cardNumaNode};
+	if (auto node = GetSetting("BLUEFISH444_NUMA_NODE", serial))
+		placement.NumaNode = int(std::strtol(node->c_str(), nullptr, 10));
+	if (auto cpus = GetSetting("BLUEFISH444_CPUS", serial))
+		placement.Cpus = ParseCpuList(*cpus);
+	if (auto priority = GetSetting("BLUEFISH444_THREAD_PRIORITY", serial))
+	{
+		if (*priority == "high")
+			placement.Priority = ThreadPriority::High;
+		else if (*priority == "realtime")
+			placement.Priority = ThreadPriority::RealTime;
+		else if (*priority != "normal")
+			nosEngine.LogW("Bluefish444: Unknown thread priority '%s'", priority->c_str());
+	}
+	return placement;
+}
+
+ScopedThreadPlacement::ScopedThreadPlacement(ThreadPlacement const& placement, const char* threadName)
+{
+	if ((placement.NumaNode >= 0 || !placement.Cpus.empty()) && !SetAffinity(placement))
+		nosEngine.LogW("Bluefish444: Failed to pin %s thread to %s", threadName, placement.ToString().c_str());
+	if (placement.Priority != ThreadPriority::Normal && !SetPriority(placement.Priority, TaskHandle))
+		nosEngine.LogW("Bluefish444: Failed to raise %s thread to %s priority", threadName, GetPriorityName(placement.Priority));
+}
+
+ScopedThreadPlacement::~ScopedThreadPlacement()
+{
+#if _WIN32
+	if (TaskHandle && MMCSS::Get().Revert)
+		MMCSS::Get().Revert(TaskHandle);
+#endif
+}
+
+void* AllocateHostMemory(size_t size, int numaNode, bool largePages)
+{
+#if _WIN32
+	auto process = GetCurrentProcess();
+	if (auto largePage = largePages ? GetLargePageMinimum() : 0; largePage && EnableLockMemoryPrivilege())
+	{
+		// Large pages are never paged out, so they are also locked for DMA
+		auto largeSize = (size + largePage - 1) / largePage * largePage;
+		DWORD type = MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES;
+		auto data = numaNode >= 0 ? VirtualAllocExNuma(process, nullptr, largeSize, type, PAGE_READWRITE, DWORD(numaNode))
+		                          : VirtualAlloc(nullptr, largeSize, type, PAGE_READWRITE);
+		if (data)
+			return data;
+	}
+	if (numaNode >= 0)
+		return VirtualAllocExNuma(process, nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, DWORD(numaNode));
+	return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED)
+		return nullptr;
+	if (numaNode >= 0 && numaNode < 64)
+	{
+		// Preferred policy without libnuma: Pages fall back to other nodes if the node runs out of memory
+		constexpr int PreferredPolicy = 1; // MPOL_PREFERRED
+		unsigned long nodeMask = 1ul << numaNode;
+		syscall(SYS_mbind, data, size, PreferredPolicy, &nodeMask, sizeof(nodeMask) * 8 + 1, 0); // The kernel reads maxnode - 1 bits
+	}
+	if (largePages)
+		madvise(data, size, MADV_HUGEPAGE); // Transparent huge pages: MAP_HUGETLB would need pages reserved by the system
+	return data;
+#endif
+}
+
+void FreeHostMemory(void* data, size_t size)
+{
+	if (!data)
+		return;
+#if _WIN32
+	VirtualFree(data, 0, MEM_RELEASE);
+#else
+	munmap(data, size);
+#endif
+}
+
+}
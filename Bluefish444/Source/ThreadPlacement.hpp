@@ -0,0 +1,63 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bf
+{
+
+enum class ThreadPriority
+{
+	Normal,
+	High,
+	RealTime, // MMCSS "Pro Audio" task on Windows, SCHED_FIFO elsewhere
+};
+
+// Where the DMA and VBI threads of a card run, and where host memory for its transfers is allocated
+struct ThreadPlacement
+{
+	int NumaNode = -1; // -1: Any
+	std::vector<uint32_t> Cpus; // Logical processors. Empty: All processors of NumaNode, or no pinning if NumaNode is -1.
+	ThreadPriority Priority = ThreadPriority::Normal;
+
+	// e.g. "NUMA node 1, CPUs 8-15, real-time priority"
+	std::string ToString() const;
+};
+
+// NUMA node of the PCIe device of a card, by its SDK device id (1-based). -1 if unknown or if the system has a single node.
+// The SDK does not report the PCIe address of a card: Cards are matched with the Bluefish444 PCIe devices in bus order,
+// which is the order the driver enumerates them in.
+int GetCardNumaNode(int32_t deviceId);
+
+// Runs on the NUMA node of the card, overridden by BLUEFISH444_NUMA_NODE. Also reads BLUEFISH444_CPUS (e.g. "8-15,24-31")
+// and BLUEFISH444_THREAD_PRIORITY (normal, high or realtime). Each is overridden for a card by the same variable suffixed
+// with its serial, e.g. BLUEFISH444_CPUS_<serial>.
+ThreadPlacement LoadThreadPlacement(std::string const& serial, int cardNumaNode = -1);
+
+// Applies the placement to the calling thread for the lifetime of the object. Failures are logged once per thread and
+// leave the thread where it was.
+class ScopedThreadPlacement
+{
+public:
+	ScopedThreadPlacement(ThreadPlacement const& placement, const char* threadName);
+	~ScopedThreadPlacement();
+
+	ScopedThreadPlacement(ScopedThreadPlacement const&) = delete;
+
+private:
+	void* TaskHandle = nullptr; // MMCSS registration
+};
+
+// Page-aligned memory on the NUMA node if given. Returns null on failure. With largePages, large (huge) pages are used
+// where available: Windows needs the "Lock pages in memory" user right for them; falls back to normal pages.
+void* AllocateHostMemory(size_t size, int numaNode, bool largePages = false);
+void FreeHostMemory(void* data, size_t size);
+
+}
@@ -0,0 +1,292 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "V210.hpp"
+
+// stl
+#include <cstring>
+
+namespace bf::v210
+{
+
+namespace
+{
+
+// Scalar reference
+
+void UnpackLineScalar(uint8_t const* src, uint32_t width, uint32_t x, uint16_t* y, uint16_t* cb, uint16_t* cr)
+{
+	src += x / PixelsPerBlock * BytesPerBlock;
+	for (; x < width; x += PixelsPerBlock, src += BytesPerBlock)
+	{
+		uint32_t words[4];
+		memcpy(words, src, sizeof(words));
+		uint16_t samples[12];
+		for (uint32_t i = 0; i < 12; ++i)
+			samples[i] = (words[i / 3] >> (i % 3 * 10)) & 0x3FF;
+		for (uint32_t pair = 0; pair < 3 && x + pair * 2 < width; ++pair)
+		{
+			cb[x / 2 + pair] = samples[pair * 4];
+			y[x + pair * 2] = samples[pair * 4 + 1];
+			cr[x / 2 + pair] = samples[pair * 4 + 2];
+			y[x + pair * 2 + 1] = samples[pair * 4 + 3];
+		}
+	}
+}
+
+void PackLineScalar(uint16_t const* y, uint16_t const* cb, uint16_t const* cr, uint32_t width, uint32_t x, uint8_t* dst)
+{
+	dst += x / PixelsPerBlock * BytesPerBlock;
+	for (; x < width; x += PixelsPerBlock, dst += BytesPerBlock)
+	{
+		uint16_t samples[12]{};
+		for (uint32_t pair = 0; pair < 3 && x + pair * 2 < width; ++pair)
+		{
+			samples[pair * 4] = cb[x / 2 + pair];
+			samples[pair * 4 + 1] = y[x + pair * 2];
+			samples[pair * 4 + 2] = cr[x / 2 + pair];
+			samples[pair * 4 + 3] = y[x + pair * 2 + 1];
+		}
+		uint32_t words[4]{};
+		for (uint32_t i = 0; i < 12; ++i)
+			words[i / 3] |= uint32_t(samples[i] & 0x3FF) << (i % 3 * 10);
+		memcpy(dst, words, sizeof(words));
+	}
+}
+
+#if BF_SIMD_X64
+
+// Within a block, words 0-3 hold samples (A, B, C) = (bits 0-9, 10-19, 20-29):
+//   W0: Cb0 Y0 Cr0 | W1: Y1 Cb1 Y2 | W2: Cr1 Y3 Cb2 | W3: Y4 Cr2 Y5
+// Unpack packs A and B of a block into one vector of 8 x 16-bit (A0-A3 B0-B3) and C into another (C0-C3),
+// then gathers Y0-Y5 and [Cb0-Cb2, _, Cr0-Cr2, _] with byte shuffles. Pack does the reverse.
+// Stores of a block write 2 (Y) and 1 (Cb, Cr) samples past it, which the next block overwrites. SIMD loops leave
+// at least one block for the scalar tail so that nothing is written past the line.
+
+#define BF_V210_Y_FROM_AB 8, 9, 2, 3, -1, -1, 12, 13, 6, 7, -1, -1, -1, -1, -1, -1
+#define BF_V210_Y_FROM_C -1, -1, -1, -1, 2, 3, -1, -1, -1, -1, 6, 7, -1, -1, -1, -1
+#define BF_V210_CBCR_FROM_AB 0, 1, 10, 11, -1, -1, -1, -1, -1, -1, 4, 5, 14, 15, -1, -1
+#define BF_V210_CBCR_FROM_C -1, -1, -1, -1, 4, 5, -1, -1, 0, 1, -1, -1, -1, -1, -1, -1
+
+// Pack: Y is Y0-Y7, CbCr is Cb0-Cb3 Cr0-Cr3 (16-bit), results are 32-bit A, B, C
+#define BF_V210_A_FROM_Y -1, -1, -1, -1, 2, 3, -1, -1, -1, -1, -1, -1, 8, 9, -1, -1
+#define BF_V210_A_FROM_CBCR 0, 1, -1, -1, -1, -1, -1, -1, 10, 11, -1, -1, -1, -1, -1, -1
+#define BF_V210_B_FROM_Y 0, 1, -1, -1, -1, -1, -1, -1, 6, 7, -1, -1, -1, -1, -1, -1
+#define BF_V210_B_FROM_CBCR -1, -1, -1, -1, 2, 3, -1, -1, -1, -1, -1, -1, 12, 13, -1, -1
+#define BF_V210_C_FROM_Y -1, -1, -1, -1, 4, 5, -1, -1, -1, -1, -1, -1, 10, 11, -1, -1
+#define BF_V210_C_FROM_CBCR 8, 9, -1, -1, -1, -1, -1, -1, 4, 5, -1, -1, -1, -1, -1, -1
+
+BF_TARGET_SSE41 inline void StoreBlock(__m128i yv, __m128i cbcr, uint16_t* y, uint16_t* cb, uint16_t* cr)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(y), yv);
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(cb), cbcr);
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(cr), _mm_unpackhi_epi64(cbcr, cbcr));
+}
+
+BF_TARGET_SSE41 void UnpackLineSSE41(uint8_t const* src, uint32_t width, uint16_t* y, uint16_t* cb, uint16_t* cr)
+{
+	const __m128i mask = _mm_set1_epi32(0x3FF);
+	const __m128i yFromAB = _mm_setr_epi8(BF_V210_Y_FROM_AB);
+	const __m128i yFromC = _mm_setr_epi8(BF_V210_Y_FROM_C);
+	const __m128i cFromAB = _mm_setr_epi8(BF_V210_CBCR_FROM_AB);
+	const __m128i cFromC = _mm_setr_epi8(BF_V210_CBCR_FROM_C);
+	uint32_t x = 0;
+	for (; x + PixelsPerBlock + 2 <= width; x += PixelsPerBlock, src += BytesPerBlock)
+	{
+		__m128i words = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src));
+		__m128i a = _mm_and_si128(words, mask);
+		__m128i b = _mm_and_si128(_mm_srli_epi32(words, 10), mask);
+		__m128i c = _mm_and_si128(_mm_srli_epi32(words, 20), mask);
+		__m128i ab = _mm_packus_epi32(a, b);
+		__m128i cc = _mm_packus_epi32(c, c);
+		__m128i yv = _mm_or_si128(_mm_shuffle_epi8(ab, yFromAB), _mm_shuffle_epi8(cc, yFromC));
+		__m128i cbcr = _mm_or_si128(_mm_shuffle_epi8(ab, cFromAB), _mm_shuffle_epi8(cc, cFromC));
+		StoreBlock(yv, cbcr, y + x, cb + x / 2, cr + x / 2);
+	}
+	UnpackLineScalar(src - x / PixelsPerBlock * BytesPerBlock, width, x, y, cb, cr);
+}
+
+BF_TARGET_AVX2 void UnpackLineAVX2(uint8_t const* src, uint32_t width, uint16_t* y, uint16_t* cb, uint16_t* cr)
+{
+	const __m256i mask = _mm256_set1_epi32(0x3FF);
+	const __m256i yFromAB = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_Y_FROM_AB));
+	const __m256i yFromC = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_Y_FROM_C));
+	const __m256i cFromAB = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_CBCR_FROM_AB));
+	const __m256i cFromC = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_CBCR_FROM_C));
+	uint32_t x = 0;
+	for (; x + 2 * PixelsPerBlock + 2 <= width; x += 2 * PixelsPerBlock, src += 2 * BytesPerBlock)
+	{
+		__m256i words = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src));
+		__m256i a = _mm256_and_si256(words, mask);
+		__m256i b = _mm256_and_si256(_mm256_srli_epi32(words, 10), mask);
+		__m256i c = _mm256_and_si256(_mm256_srli_epi32(words, 20), mask);
+		__m256i ab = _mm256_packus_epi32(a, b); // Per 128-bit lane, i.e. per block
+		__m256i cc = _mm256_packus_epi32(c, c);
+		__m256i yv = _mm256_or_si256(_mm256_shuffle_epi8(ab, yFromAB), _mm256_shuffle_epi8(cc, yFromC));
+		__m256i cbcr = _mm256_or_si256(_mm256_shuffle_epi8(ab, cFromAB), _mm256_shuffle_epi8(cc, cFromC));
+		StoreBlock(_mm256_castsi256_si128(yv), _mm256_castsi256_si128(cbcr), y + x, cb + x / 2, cr + x / 2);
+		StoreBlock(_mm256_extracti128_si256(yv, 1), _mm256_extracti128_si256(cbcr, 1), y + x + 6, cb + x / 2 + 3, cr + x / 2 + 3);
+	}
+	UnpackLineScalar(src - x / PixelsPerBlock * BytesPerBlock, width, x, y, cb, cr);
+}
+
+BF_TARGET_AVX512 void UnpackLineAVX512(uint8_t const* src, uint32_t width, uint16_t* y, uint16_t* cb, uint16_t* cr)
+{
+	const __m512i mask = _mm512_set1_epi32(0x3FF);
+	const __m512i yFromAB = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_Y_FROM_AB));
+	const __m512i yFromC = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_Y_FROM_C));
+	const __m512i cFromAB = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_CBCR_FROM_AB));
+	const __m512i cFromC = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_CBCR_FROM_C));
+	uint32_t x = 0;
+	for (; x + 4 * PixelsPerBlock + 2 <= width; x += 4 * PixelsPerBlock, src += 4 * BytesPerBlock)
+	{
+		__m512i words = _mm512_loadu_si512(src);
+		__m512i a = _mm512_and_si512(words, mask);
+		__m512i b = _mm512_and_si512(_mm512_srli_epi32(words, 10), mask);
+		__m512i c = _mm512_and_si512(_mm512_srli_epi32(words, 20), mask);
+		__m512i ab = _mm512_packus_epi32(a, b);
+		__m512i cc = _mm512_packus_epi32(c, c);
+		__m512i yv = _mm512_or_si512(_mm512_shuffle_epi8(ab, yFromAB), _mm512_shuffle_epi8(cc, yFromC));
+		__m512i cbcr = _mm512_or_si512(_mm512_shuffle_epi8(ab, cFromAB), _mm512_shuffle_epi8(cc, cFromC));
+		StoreBlock(_mm512_extracti32x4_epi32(yv, 0), _mm512_extracti32x4_epi32(cbcr, 0), y + x, cb + x / 2, cr + x / 2);
+		StoreBlock(_mm512_extracti32x4_epi32(yv, 1), _mm512_extracti32x4_epi32(cbcr, 1), y + x + 6, cb + x / 2 + 3, cr + x / 2 + 3);
+		StoreBlock(_mm512_extracti32x4_epi32(yv, 2), _mm512_extracti32x4_epi32(cbcr, 2), y + x + 12, cb + x / 2 + 6, cr + x / 2 + 6);
+		StoreBlock(_mm512_extracti32x4_epi32(yv, 3), _mm512_extracti32x4_epi32(cbcr, 3), y + x + 18, cb + x / 2 + 9, cr + x / 2 + 9);
+	}
+	UnpackLineScalar(src - x / PixelsPerBlock * BytesPerBlock, width, x, y, cb, cr);
+}
+
+BF_TARGET_SSE41 inline __m128i LoadBlock(uint16_t const* y, uint16_t const* cb, uint16_t const* cr, __m128i& cbcr)
+{
+	cbcr = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(cb)), _mm_loadl_epi64(reinterpret_cast<__m128i const*>(cr)));
+	return _mm_loadu_si128(reinterpret_cast<__m128i const*>(y));
+}
+
+BF_TARGET_SSE41 void PackLineSSE41(uint16_t const* y, uint16_t const* cb, uint16_t const* cr, uint32_t width, uint8_t* dst)
+{
+	const __m128i mask = _mm_set1_epi32(0x3FF);
+	const __m128i aFromY = _mm_setr_epi8(BF_V210_A_FROM_Y), aFromC = _mm_setr_epi8(BF_V210_A_FROM_CBCR);
+	const __m128i bFromY = _mm_setr_epi8(BF_V210_B_FROM_Y), bFromC = _mm_setr_epi8(BF_V210_B_FROM_CBCR);
+	const __m128i cFromY = _mm_setr_epi8(BF_V210_C_FROM_Y), cFromC = _mm_setr_epi8(BF_V210_C_FROM_CBCR);
+	uint32_t x = 0;
+	for (; x + PixelsPerBlock + 2 <= width; x += PixelsPerBlock, dst += BytesPerBlock)
+	{
+		__m128i cbcr;
+		__m128i yv = LoadBlock(y + x, cb + x / 2, cr + x / 2, cbcr);
+		__m128i a = _mm_and_si128(_mm_or_si128(_mm_shuffle_epi8(yv, aFromY), _mm_shuffle_epi8(cbcr, aFromC)), mask);
+		__m128i b = _mm_and_si128(_mm_or_si128(_mm_shuffle_epi8(yv, bFromY), _mm_shuffle_epi8(cbcr, bFromC)), mask);
+		__m128i c = _mm_and_si128(_mm_or_si128(_mm_shuffle_epi8(yv, cFromY), _mm_shuffle_epi8(cbcr, cFromC)), mask);
+		__m128i words = _mm_or_si128(a, _mm_or_si128(_mm_slli_epi32(b, 10), _mm_slli_epi32(c, 20)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), words);
+	}
+	PackLineScalar(y, cb, cr, width, x, dst - x / PixelsPerBlock * BytesPerBlock);
+}
+
+BF_TARGET_AVX2 void PackLineAVX2(uint16_t const* y, uint16_t const* cb, uint16_t const* cr, uint32_t width, uint8_t* dst)
+{
+	const __m256i mask = _mm256_set1_epi32(0x3FF);
+	const __m256i aFromY = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_A_FROM_Y));
+	const __m256i aFromC = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_A_FROM_CBCR));
+	const __m256i bFromY = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_B_FROM_Y));
+	const __m256i bFromC = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_B_FROM_CBCR));
+	const __m256i cFromY = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_C_FROM_Y));
+	const __m256i cFromC = _mm256_broadcastsi128_si256(_mm_setr_epi8(BF_V210_C_FROM_CBCR));
+	uint32_t x = 0;
+	for (; x + 2 * PixelsPerBlock + 2 <= width; x += 2 * PixelsPerBlock, dst += 2 * BytesPerBlock)
+	{
+		__m128i cbcr0, cbcr1;
+		__m128i y0 = LoadBlock(y + x, cb + x / 2, cr + x / 2, cbcr0);
+		__m128i y1 = LoadBlock(y + x + 6, cb + x / 2 + 3, cr + x / 2 + 3, cbcr1);
+		__m256i yv = _mm256_inserti128_si256(_mm256_castsi128_si256(y0), y1, 1);
+		__m256i cbcr = _mm256_inserti128_si256(_mm256_castsi128_si256(cbcr0), cbcr1, 1);
+		__m256i a = _mm256_and_si256(_mm256_or_si256(_mm256_shuffle_epi8(yv, aFromY), _mm256_shuffle_epi8(cbcr, aFromC)), mask);
+		__m256i b = _mm256_and_si256(_mm256_or_si256(_mm256_shuffle_epi8(yv, bFromY), _mm256_shuffle_epi8(cbcr, bFromC)), mask);
+		__m256i c = _mm256_and_si256(_mm256_or_si256(_mm256_shuffle_epi8(yv, cFromY), _mm256_shuffle_epi8(cbcr, cFromC)), mask);
+		__m256i words = _mm256_or_si256(a, _mm256_or_si256(_mm256_slli_epi32(b, 10), _mm256_slli_epi32(c, 20)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), words);
+	}
+	PackLineScalar(y, cb, cr, width, x, dst - x / PixelsPerBlock * BytesPerBlock);
+}
+
+BF_TARGET_AVX512 void PackLineAVX512(uint16_t const* y, uint16_t const* cb, uint16_t const* cr, uint32_t width, uint8_t* dst)
+{
+	const __m512i mask = _mm512_set1_epi32(0x3FF);
+	const __m512i aFromY = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_A_FROM_Y));
+	const __m512i aFromC = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_A_FROM_CBCR));
+	const __m512i bFromY = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_B_FROM_Y));
+	const __m512i bFromC = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_B_FROM_CBCR));
+	const __m512i cFromY = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_C_FROM_Y));
+	const __m512i cFromC = _mm512_broadcast_i32x4(_mm_setr_epi8(BF_V210_C_FROM_CBCR));
+	uint32_t x = 0;
+	for (; x + 4 * PixelsPerBlock + 2 <= width; x += 4 * PixelsPerBlock, dst += 4 * BytesPerBlock)
+	{
+		__m128i cbcr0, cbcr1, cbcr2, cbcr3;
+		__m128i y0 = LoadBlock(y + x, cb + x / 2, cr + x / 2, cbcr0);
+		__m128i y1 = LoadBlock(y + x + 6, cb + x / 2 + 3, cr + x / 2 + 3, cbcr1);
+		__m128i y2 = LoadBlock(y + x + 12, cb + x / 2 + 6, cr + x / 2 + 6, cbcr2);
+		__m128i y3 = LoadBlock(y + x + 18, cb + x / 2 + 9, cr + x / 2 + 9, cbcr3);
+		__m512i yv = _mm512_inserti32x4(_mm512_inserti32x4(_mm512_inserti32x4(_mm512_castsi128_si512(y0), y1, 1), y2, 2), y3, 3);
+		__m512i cbcr = _mm512_inserti32x4(_mm512_inserti32x4(_mm512_inserti32x4(_mm512_castsi128_si512(cbcr0), cbcr1, 1), cbcr2, 2), cbcr3, 3);
+		__m512i a = _mm512_and_si512(_mm512_or_si512(_mm512_shuffle_epi8(yv, aFromY), _mm512_shuffle_epi8(cbcr, aFromC)), mask);
+		__m512i b = _mm512_and_si512(_mm512_or_si512(_mm512_shuffle_epi8(yv, bFromY), _mm512_shuffle_epi8(cbcr, bFromC)), mask);
+		__m512i c = _mm512_and_si512(_mm512_or_si512(_mm512_shuffle_epi8(yv, cFromY), _mm512_shuffle_epi8(cbcr, cFromC)), mask);
+		__m512i words = _mm512_or_si512(a, _mm512_or_si512(_mm512_slli_epi32(b, 10), _mm512_slli_epi32(c, 20)));
+		_mm512_storeu_si512(dst, words);
+	}
+	PackLineScalar(y, cb, cr, width, x, dst - x / PixelsPerBlock * BytesPerBlock);
+}
+
+#endif
+
+}
+
+void UnpackLine(SimdLevel level, uint8_t const* src, uint32_t width, uint16_t* y, uint16_t* cb, uint16_t* cr)
+{
+	switch (level)
+	{
+#if BF_SIMD_X64
+	case SimdLevel::AVX512: return UnpackLineAVX512(src, width, y, cb, cr);
+	case SimdLevel::AVX2: return UnpackLineAVX2(src, width, y, cb, cr);
+	case SimdLevel::SSE41: return UnpackLineSSE41(src, width, y, cb, cr);
+#endif
+	default: return UnpackLineScalar(src, width, 0, y, cb, cr);
+	}
+}
+
+void PackLine(SimdLevel level, uint16_t const* y, uint16_t const* cb, uint16_t const* cr, uint32_t width, uint8_t* dst)
+{
+	switch (level)
+	{
+#if BF_SIMD_X64
+	case SimdLevel::AVX512: return PackLineAVX512(y, cb, cr, width, dst);
+	case SimdLevel::AVX2: return PackLineAVX2(y, cb, cr, width, dst);
+	case SimdLevel::SSE41: return PackLineSSE41(y, cb, cr, width, dst);
+#endif
+	default: return PackLineScalar(y, cb, cr, width, 0, dst);
+	}
+}
+
+void Unpack(uint8_t const* src, uint32_t srcPitch, uint32_t width, uint32_t height, Planar16 dst)
+{
+	auto level = GetSimdLevel();
+	for (uint32_t line = 0; line < height; ++line)
+	{
+		size_t offset = size_t(line) * width;
+		UnpackLine(level, src + size_t(line) * srcPitch, width, dst.Y + offset, dst.Cb + offset / 2, dst.Cr + offset / 2);
+	}
+}
+
+void Pack(Planar16 src, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstPitch)
+{
+	auto level = GetSimdLevel();
+	uint32_t usedBytes = (width + PixelsPerBlock - 1) / PixelsPerBlock * BytesPerBlock;
+	for (uint32_t line = 0; line < height; ++line)
+	{
+		size_t offset = size_t(line) * width;
+		auto* dstLine = dst + size_t(line) * dstPitch;
+		PackLine(level, src.Y + offset, src.Cb + offset / 2, src.Cr + offset / 2, width, dstLine);
+		if (dstPitch > usedBytes)
+			memset(dstLine + usedBytes, 0, dstPitch - usedBytes);
+	}
+}
+
+}
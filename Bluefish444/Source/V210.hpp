@@ -0,0 +1,42 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include "Simd.hpp"
+
+// stl
+#include <cstdint>
+
+namespace bf::v210
+{
+
+// V210: 10-bit 4:2:2, 6 pixels (Cb Y Cr Y Cb Y Cr Y Cb Y Cr Y) packed into 4 little-endian 32-bit words, 3 samples per word.
+constexpr uint32_t PixelsPerBlock = 6;
+constexpr uint32_t BytesPerBlock = 16;
+
+constexpr uint32_t GetBytesPerLine(uint32_t width)
+{
+	return (width + 47) / 48 * 128; // Lines are aligned to 128 bytes
+}
+
+// Planar 4:2:2 with 10-bit samples in the low bits of 16-bit words. Planes are tightly packed:
+// Y has width samples per line, Cb and Cr have width / 2.
+struct Planar16
+{
+	uint16_t* Y = nullptr;
+	uint16_t* Cb = nullptr;
+	uint16_t* Cr = nullptr;
+};
+
+// width must be even. Kernels of the detected SIMD level are used.
+void Unpack(uint8_t const* src, uint32_t srcPitch, uint32_t width, uint32_t height, Planar16 dst);
+// Samples are truncated to 10 bits. Line padding is zeroed.
+void Pack(Planar16 src, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstPitch);
+
+// Single line kernels, exposed for comparing implementations. Scalar versions are the reference.
+void UnpackLine(SimdLevel level, uint8_t const* src, uint32_t width, uint16_t* y, uint16_t* cb, uint16_t* cr);
+void PackLine(SimdLevel level, uint16_t const* y, uint16_t const* cb, uint16_t const* cr, uint32_t width, uint8_t* dst);
+
+}
@@ -0,0 +1,107 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "VBIDispatcher.hpp"
+
+namespace bf
+{
+
+VBIDispatcher::VBIDispatcher(std::function<bool(unsigned long& fieldCount)> hardwareWait, TelemetryClock::duration retryDelay, ChannelTelemetry* telemetry, ThreadPlacement placement)
+	: HardwareWait(std::move(hardwareWait)), RetryDelay(retryDelay), Telemetry(telemetry), Placement(std::move(placement))
+{
+}
+
+VBIDispatcher::~VBIDispatcher()
+{
+	Stop();
+}
+
+void VBIDispatcher::Start()
+{
+	if (Started)
+		return;
+	std::unique_lock lock(ThreadMutex);
+	if (Started || Stopping)
+		return;
+	Thread = std::thread([this] { Run(); });
+	Started = true;
+}
+
+void VBIDispatcher::Stop()
+{
+	std::unique_lock lock(ThreadMutex);
+	Stopping = true;
+	if (Thread.joinable())
+		Thread.join();
+	// Releases waiters that are still blocked, or that did not get to start the thread
+	Publish(0, TelemetryClock::now(), true);
+}
+
+void VBIDispatcher::Run()
+{
+	ScopedThreadPlacement scope(Placement, "VBI");
+	while (!Stopping)
+	{
+		unsigned long fieldCount = 0;
+		bool ok = HardwareWait(fieldCount);
+		auto now = TelemetryClock::now();
+		if (ok && Telemetry)
+			Telemetry->Frames.fetch_add(1, std::memory_order_relaxed);
+		Publish(fieldCount, now, !ok);
+		if (!ok)
+			std::this_thread::sleep_for(RetryDelay);
+	}
+}
+
+void VBIDispatcher::Publish(unsigned long fieldCount, TelemetryClock::time_point time, bool failed)
+{
+	auto sequence = Sequence.load(std::memory_order_relaxed) + 1;
+	auto& slot = Slots[sequence % SlotCount];
+	slot.Version.store(sequence * 2 - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release); // Odd version is visible before any of the new data
+	slot.FieldCount.store(fieldCount, std::memory_order_relaxed);
+	slot.Time.store(time.time_since_epoch().count(), std::memory_order_relaxed);
+	slot.Failed.store(failed, std::memory_order_relaxed);
+	slot.Version.store(sequence * 2, std::memory_order_release);
+	Sequence.store(sequence, std::memory_order_release);
+	Sequence.notify_all();
+}
+
+VBISample VBIDispatcher::Read(uint64_t sequence) const
+{
+	while (true)
+	{
+		auto& slot = Slots[sequence % SlotCount];
+		auto version = slot.Version.load(std::memory_order_acquire);
+		VBISample sample{
+			.Sequence = sequence,
+			.FieldCount = slot.FieldCount.load(std::memory_order_relaxed),
+			.Time = TelemetryClock::time_point(TelemetryClock::duration(slot.Time.load(std::memory_order_relaxed))),
+			.Failed = slot.Failed.load(std::memory_order_relaxed),
+		};
+		std::atomic_thread_fence(std::memory_order_acquire); // Data is read before the version is checked again
+		if (version == sequence * 2 && slot.Version.load(std::memory_order_relaxed) == version)
+			return sample;
+		sequence = Sequence.load(std::memory_order_acquire); // Writer lapped the reader and is overwriting the slot
+	}
+}
+
+VBISample VBIDispatcher::Wait()
+{
+	auto sequence = Sequence.load(std::memory_order_acquire);
+	if (!Started && !Stopping)
+		Start();
+	if (Stopping)
+		return {.Sequence = sequence, .Failed = true};
+	Sequence.wait(sequence, std::memory_order_acquire);
+	return Read(Sequence.load(std::memory_order_acquire));
+}
+
+VBISample VBIDispatcher::GetLatest() const
+{
+	auto sequence = Sequence.load(std::memory_order_acquire);
+	if (!sequence)
+		return {};
+	return Read(sequence);
+}
+
+}
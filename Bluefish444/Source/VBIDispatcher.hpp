@@ -0,0 +1,78 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include "Telemetry.hpp"
+#include "ThreadPlacement.hpp"
+
+// stl
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace bf
+{
+
+struct VBISample
+{
+	uint64_t Sequence = 0; // Increments with each published VBI. 0: None yet
+	unsigned long FieldCount = 0;
+	TelemetryClock::time_point Time{}; // When the dispatcher woke up for the interrupt
+	bool Failed = false; // Hardware wait failed (e.g. no input signal) or the dispatcher stopped
+};
+
+// Does the hardware VBI wait of a channel on a single thread and publishes each interrupt to any number of waiters
+// through an eventcount, so that nodes syncing to the same channel do not each block in the SDK.
+// The thread is started by the first Wait.
+class VBIDispatcher
+{
+public:
+	// hardwareWait is called from the dispatcher thread only. retryDelay is slept after failed waits.
+	VBIDispatcher(std::function<bool(unsigned long& fieldCount)> hardwareWait, TelemetryClock::duration retryDelay, ChannelTelemetry* telemetry = nullptr, ThreadPlacement placement = {});
+	~VBIDispatcher();
+
+	VBIDispatcher(VBIDispatcher const&) = delete;
+
+	// Blocks until the next VBI is published, i.e. behaves like a hardware wait started at the time of the call.
+	VBISample Wait();
+	// Returns the last published VBI without waiting
+	VBISample GetLatest() const;
+	// Starts the thread without waiting, for subscribers that only read GetLatest
+	void Start();
+	// Joins the thread. Waiters blocked meanwhile return a failed sample.
+	void Stop();
+
+private:
+	void Run();
+	void Publish(unsigned long fieldCount, TelemetryClock::time_point time, bool failed);
+	VBISample Read(uint64_t sequence) const;
+
+	// Seqlock: Version is odd while the writer fills the slot, and twice the sequence of the sample once it is complete
+	struct Slot
+	{
+		std::atomic<uint64_t> Version = 0;
+		std::atomic<unsigned long> FieldCount = 0;
+		std::atomic<TelemetryClock::rep> Time = 0;
+		std::atomic<bool> Failed = false;
+	};
+	static constexpr uint64_t SlotCount = 8; // Readers retry if the writer laps them while they copy a slot
+
+	std::function<bool(unsigned long&)> HardwareWait;
+	TelemetryClock::duration RetryDelay;
+	ChannelTelemetry* Telemetry;
+	ThreadPlacement Placement;
+
+	std::array<Slot, SlotCount> Slots;
+	std::atomic<uint64_t> Sequence = 0; // Eventcount waited on with atomic wait/notify
+
+	std::mutex ThreadMutex;
+	std::thread Thread;
+	std::atomic<bool> Started = false;
+	std::atomic<bool> Stopping = false;
+};
+
+}
@@ -0,0 +1,69 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "VBLWaiter.hpp"
+
+// stl
+#include <utility>
+
+namespace bf
+{
+
+void VBLWaiter::SetChannel(ChannelHandle const& handle)
+{
+	WatchLogName = std::string("Bluefish ") + handle.ChannelName + " VBI Wait";
+}
+
+bool VBLWaiter::Wait(Channel& channel, ChannelHandle const& handle)
+{
+	auto& format = handle.Format;
+	if (MonitorGeneration != handle.Generation)
+	{
+		// Field counts advance by 2 per frame, also in progressive video modes
+		auto& dSec = format.DeltaSeconds;
+		Monitor.Reset(uint64_t(1'000'000'000) * dSec[0] / (dSec[1] * 2), format.FieldMode ? 1 : 2);
+		MonitorGeneration = handle.Generation;
+		PublishCounters = true;
+	}
+	if (!channel.WaitVBI(LastVBI))
+		return false;
+	auto& telemetry = channel.GetTelemetry();
+	auto timing = Monitor.Update(LastVBI.FieldCount, LastVBI.Time, &telemetry);
+	if (timing.Dropped)
+		nosEngine.LogW("%s dropped %d %s", handle.ChannelName, timing.Dropped, format.FieldMode ? "fields" : "frames");
+	if (timing.Discontinuity)
+		nosEngine.LogW("%s: Field count jumped to %lu, expected %lu. Resynchronizing VBI timing.", handle.ChannelName, timing.FieldCount, timing.ExpectedFieldCount);
+	UpdateOutputs(timing);
+	if (LogInterval.IsDue())
+	{
+		auto snapshot = telemetry.GetSnapshot();
+		auto summary = snapshot.VBIWait.ToString() + ", jitter " + snapshot.VBIJitter.ToString() + ", frames " + std::to_string(snapshot.Frames) +
+		               ", dropped " + std::to_string(snapshot.Dropped) + ", repeated " + std::to_string(snapshot.Repeated) +
+		               ", late wakeups " + std::to_string(snapshot.LateWakeups) + ", late DMAs " + std::to_string(snapshot.Late);
+		nosEngine.WatchLog(WatchLogName.c_str(), summary.c_str());
+	}
+	return true;
+}
+
+void VBLWaiter::UpdateOutputs(VBITiming const& timing)
+{
+	SetOutput(NOS_NAME_STATIC("FieldCount"), uint32_t(timing.FieldCount));
+	SetOutput(NOS_NAME_STATIC("Jitter"), float(timing.Jitter / 1e3));
+	// Counters are only set when they change
+	bool all = std::exchange(PublishCounters, false);
+	if (all || timing.Dropped)
+		SetOutput(NOS_NAME_STATIC("Dropped"), uint32_t(Monitor.GetDropped()));
+	if (all || timing.Repeated)
+		SetOutput(NOS_NAME_STATIC("Repeated"), uint32_t(Monitor.GetRepeated()));
+	if (all || timing.Late)
+		SetOutput(NOS_NAME_STATIC("LateWakeups"), uint32_t(Monitor.GetLateWakeups()));
+	if (all || timing.Discontinuity)
+		SetOutput(NOS_NAME_STATIC("Discontinuities"), uint32_t(Monitor.GetDiscontinuities()));
+}
+
+template <typename T>
+void VBLWaiter::SetOutput(nos::Name pinName, T value)
+{
+	nosEngine.SetPinValue(Node.PinName2Id[pinName], nos::Buffer::From(value));
+}
+
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#include <Nodos/PluginHelpers.hpp>
+
+#include "Device.hpp"
+
+// stl
+#include <string>
+
+namespace bf
+{
+
+// VBI wait of the WaitVBL and DMA Pump nodes. Classifies each VBI with a VBITimingMonitor, logs drops and sets the
+// FieldCount, Dropped, Repeated, LateWakeups, Discontinuities and Jitter output pins of the node.
+class VBLWaiter
+{
+public:
+	explicit VBLWaiter(nos::NodeContext& node) : Node(node) {}
+
+	void SetChannel(ChannelHandle const& handle);
+	// Restarts the counters, e.g. on path start. Counters also restart when the channel is reopened.
+	void Reset() { MonitorGeneration = 0; }
+	// Returns false if the wait failed, e.g. the input has no signal
+	bool Wait(Channel& channel, ChannelHandle const& handle);
+	VBISample const& GetLastVBI() const { return LastVBI; }
+
+private:
+	void UpdateOutputs(VBITiming const& timing);
+	template <typename T>
+	void SetOutput(nos::Name pinName, T value);
+
+	nos::NodeContext& Node;
+	VBISample LastVBI{};
+	VBITimingMonitor Monitor;
+	uint32_t MonitorGeneration = 0;
+	bool PublishCounters = true;
+	std::string WatchLogName;
+	TelemetryLogInterval LogInterval;
+};
+
+}
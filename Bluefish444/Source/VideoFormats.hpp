@@ -0,0 +1,192 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+#define LOAD_FUNC_PTR_V6_5_3
+#include <BlueVelvetCFuncPtr.h>
+
+// stl
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bf
+{
+
+enum class VideoScan : uint8_t
+{
+	Progressive,
+	Interlaced,
+	PsF,
+};
+
+struct VideoFormat
+{
+	EVideoModeExt Mode;
+	const char* Name;
+	const char* RateName; // Frame rate as shown in menus
+	uint32_t Width, Height;
+	uint32_t RateNumerator, RateDenominator; // Frames per second
+	VideoScan Scan;
+	uint32_t BufferSize; // Bytes per frame in 2VUY
+	bool FirstFieldOdd; // Interlaced modes: The first field in time carries the odd lines (525 line NTSC)
+
+	constexpr bool IsProgressive() const { return Scan == VideoScan::Progressive; }
+	constexpr bool IsPsF() const { return Scan == VideoScan::PsF; }
+	constexpr bool Is1001() const { return RateDenominator == 1001; }
+	constexpr uint32_t GetFps() const { return (RateNumerator + RateDenominator - 1) / RateDenominator; } // e.g. 30 for 29.97
+	constexpr uint64_t GetBytesPerSecond() const { return uint64_t(BufferSize) * RateNumerator / RateDenominator; }
+	constexpr bool NeedsMultiLink() const; // More active video than a single 3G-SDI link carries
+};
+
+// Active video of the fastest format a single 3G-SDI link carries (1080p 60), in 2VUY bytes per second
+inline constexpr uint64_t SingleLinkMaxBytesPerSecond = uint64_t(1920) * 2 * 1080 * 60;
+
+constexpr bool VideoFormat::NeedsMultiLink() const
+{
+	return GetBytesPerSecond() > SingleLinkMaxBytesPerSecond;
+}
+
+namespace detail
+{
+constexpr VideoFormat MakeVideoFormat(EVideoModeExt mode, const char* name, const char* rateName, uint32_t width, uint32_t height, uint32_t fps, bool is1001, VideoScan scan, bool firstFieldOdd = false)
+{
+	return {mode, name, rateName, width, height, is1001 ? fps * 1000 : fps, is1001 ? 1001u : 1u, scan, width * 2 * height, firstFieldOdd};
+}
+
+constexpr bool IsBefore(VideoFormat const& a, VideoFormat const& b)
+{
+	if (a.Width != b.Width)
+		return a.Width < b.Width;
+	if (a.Height != b.Height)
+		return a.Height < b.Height;
+	auto rateA = uint64_t(a.RateNumerator) * b.RateDenominator, rateB = uint64_t(b.RateNumerator) * a.RateDenominator;
+	if (rateA != rateB)
+		return rateA < rateB;
+	return a.Scan < b.Scan;
+}
+}
+
+// SMPTE video modes of the SDK, sorted by width, height, frame rate and scan so that menus can group consecutive entries.
+// Replaces per-mode bfcUtils queries on paths that only need these properties.
+inline constexpr auto VideoFormats = [] {
+	using enum VideoScan;
+	using detail::MakeVideoFormat;
+	std::array formats = {
+		MakeVideoFormat(VID_FMT_EXT_PAL, "PAL", "25.00", 720, 576, 25, false, Interlaced),
+		MakeVideoFormat(VID_FMT_EXT_NTSC, "NTSC", "29.97", 720, 486, 30, true, Interlaced, true),
+		MakeVideoFormat(VID_FMT_EXT_720P_5000, "720p 50", "50.00", 1280, 720, 50, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_720P_5994, "720p 59.94", "59.94", 1280, 720, 60, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_720P_6000, "720p 60", "60.00", 1280, 720, 60, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080I_5000, "1080i 50", "25.00", 1920, 1080, 25, false, Interlaced),
+		MakeVideoFormat(VID_FMT_EXT_1080I_5994, "1080i 59.94", "29.97", 1920, 1080, 30, true, Interlaced),
+		MakeVideoFormat(VID_FMT_EXT_1080I_6000, "1080i 60", "30.00", 1920, 1080, 30, false, Interlaced),
+		MakeVideoFormat(VID_FMT_EXT_1080PSF_2398, "1080PsF 23.98", "23.98", 1920, 1080, 24, true, PsF),
+		MakeVideoFormat(VID_FMT_EXT_1080PSF_2400, "1080PsF 24", "24.00", 1920, 1080, 24, false, PsF),
+		MakeVideoFormat(VID_FMT_EXT_1080PSF_2500, "1080PsF 25", "25.00", 1920, 1080, 25, false, PsF),
+		MakeVideoFormat(VID_FMT_EXT_1080PSF_2997, "1080PsF 29.97", "29.97", 1920, 1080, 30, true, PsF),
+		MakeVideoFormat(VID_FMT_EXT_1080PSF_3000, "1080PsF 30", "30.00", 1920, 1080, 30, false, PsF),
+		MakeVideoFormat(VID_FMT_EXT_1080P_2398, "1080p 23.98", "23.98", 1920, 1080, 24, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_2400, "1080p 24", "24.00", 1920, 1080, 24, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_2500, "1080p 25", "25.00", 1920, 1080, 25, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_2997, "1080p 29.97", "29.97", 1920, 1080, 30, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_3000, "1080p 30", "30.00", 1920, 1080, 30, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_4795, "1080p 47.95", "47.95", 1920, 1080, 48, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_4800, "1080p 48", "48.00", 1920, 1080, 48, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_5000, "1080p 50", "50.00", 1920, 1080, 50, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_5994, "1080p 59.94", "59.94", 1920, 1080, 60, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_1080P_6000, "1080p 60", "60.00", 1920, 1080, 60, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_2398, "2160p 23.98", "23.98", 3840, 2160, 24, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_2400, "2160p 24", "24.00", 3840, 2160, 24, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_2500, "2160p 25", "25.00", 3840, 2160, 25, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_2997, "2160p 29.97", "29.97", 3840, 2160, 30, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_3000, "2160p 30", "30.00", 3840, 2160, 30, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_4795, "2160p 47.95", "47.95", 3840, 2160, 48, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_4800, "2160p 48", "48.00", 3840, 2160, 48, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_5000, "2160p 50", "50.00", 3840, 2160, 50, false, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_5994, "2160p 59.94", "59.94", 3840, 2160, 60, true, Progressive),
+		MakeVideoFormat(VID_FMT_EXT_2160P_6000, "2160p 60", "60.00", 3840, 2160, 60, false, Progressive),
+	};
+	std::sort(formats.begin(), formats.end(), detail::IsBefore);
+	return formats;
+}();
+
+constexpr VideoFormat const* FindVideoFormat(uint32_t mode)
+{
+	for (auto& format : VideoFormats)
+		if (format.Mode == mode)
+			return &format;
+	return nullptr;
+}
+
+constexpr VideoFormat const* FindVideoFormat(std::string_view name)
+{
+	for (auto& format : VideoFormats)
+		if (format.Name == name)
+			return &format;
+	return nullptr;
+}
+
+namespace detail
+{
+// Properties of a mode the catalog lacks, from bfcUtils. Rate names that no catalog format has are kept in rateNames.
+inline std::optional<VideoFormat> DescribeSdkVideoFormat(EVideoModeExt mode, std::deque<std::string>& rateNames)
+{
+	BLUE_U32 width = 0, height = 0;
+	if (BERR_NO_ERROR != bfcGetVideoWidth(mode, &width) || BERR_NO_ERROR != bfcGetVideoHeight(mode, UPD_FMT_FRAME, &height) || !width || !height)
+		return std::nullopt;
+	uint32_t fps = bfcUtilsGetFpsForVideoMode(mode);
+	auto* name = bfcUtilsGetStringForVideoMode(mode);
+	if (!fps || !name)
+		return std::nullopt;
+	auto scan = bfcUtilsIsVideoModePsF(mode) ? VideoScan::PsF : bfcUtilsIsVideoModeProgressive(mode) ? VideoScan::Progressive : VideoScan::Interlaced;
+	auto format = MakeVideoFormat(mode, name, "", width, height, fps, bfcUtilsIsVideoMode1001Framerate(mode), scan);
+	auto sameRate = std::find_if(VideoFormats.begin(), VideoFormats.end(), [&](VideoFormat const& other) {
+		return other.RateNumerator == format.RateNumerator && other.RateDenominator == format.RateDenominator;
+	});
+	if (sameRate != VideoFormats.end())
+		format.RateName = sameRate->RateName;
+	else
+	{
+		char rateName[16];
+		snprintf(rateName, sizeof(rateName), "%.2f", double(format.RateNumerator) / format.RateDenominator);
+		format.RateName = rateNames.emplace_back(rateName).c_str();
+	}
+	return format;
+}
+}
+
+// The catalog, plus the modes of the SDK it lacks (e.g. DCI and 8K) described through bfcUtils, sorted like the catalog.
+// For menus that offer every mode of the SDK. Built on first use, so the SDK must be loaded by then.
+inline std::vector<VideoFormat> const& GetSdkVideoFormats()
+{
+	static std::deque<std::string> rateNames;
+	static std::vector<VideoFormat> const formats = [] {
+		std::vector<VideoFormat> formats(VideoFormats.begin(), VideoFormats.end());
+		for (uint32_t mode = 0; mode < VID_FMT_EXT_LAST_ENTRY_V1; ++mode)
+		{
+			if (FindVideoFormat(mode))
+				continue;
+			if (auto format = detail::DescribeSdkVideoFormat(static_cast<EVideoModeExt>(mode), rateNames))
+				formats.push_back(*format);
+		}
+		std::stable_sort(formats.begin(), formats.end(), detail::IsBefore);
+		return formats;
+	}();
+	return formats;
+}
+
+static_assert(std::is_sorted(VideoFormats.begin(), VideoFormats.end(), detail::IsBefore));
+static_assert(FindVideoFormat(VID_FMT_EXT_1080I_5994)->BufferSize == 1920 * 2 * 1080);
+static_assert(!FindVideoFormat(VID_FMT_EXT_1080P_6000)->NeedsMultiLink() && FindVideoFormat(VID_FMT_EXT_2160P_2398)->NeedsMultiLink());
+static_assert(FindVideoFormat(VID_FMT_EXT_NTSC)->FirstFieldOdd && !FindVideoFormat(VID_FMT_EXT_PAL)->FirstFieldOdd);
+
+}
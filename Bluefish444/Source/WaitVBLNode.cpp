@@ -4,7 +4,8 @@
 #include <Nodos/PluginHelpers.hpp>
 
 #include "Device.hpp"
-#include "BluefishTypes_generated.h"
+#include "ChannelHelpers.hpp"
+#include "VBLWaiter.hpp"
 
 namespace nos::bluefish
 {
@@ -16,40 +17,34 @@ namespace bf
 
 struct WaitVBLNodeContext : nos::NodeContext
 {
-	WaitVBLNodeContext(const nosFbNode* node) : NodeContext(node)
+	WaitVBLNodeContext(const nosFbNode* node) : NodeContext(node), Waiter(*this)
 	{
 	}
 
-	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	void OnPinValueChanged(nos::Name pinName, nosUUID pinId, nosBuffer value) override
 	{
-		nos::bluefish::ChannelInfo* channelInfo = nullptr;
-		for (size_t i = 0; i < params->PinCount; ++i)
+		if (pinName == NOS_NAME_STATIC("Channel"))
 		{
-			auto& pin = params->Pins[i];
-			if (pin.Name == NOS_NAME_STATIC("Channel"))
-				channelInfo = nos::InterpretPinValue<nos::bluefish::ChannelInfo>(*pin.Data);
+			Handle = ResolveChannelHandle(value);
+			Waiter.SetChannel(Handle);
 		}
-		
-		if (!channelInfo->device() || !channelInfo->channel())
-			return NOS_RESULT_FAILED;
+	}
+
+	void OnPathStart() override
+	{
+		Waiter.Reset();
+	}
 
-		auto device = BluefishDevice::GetDevice(channelInfo->device()->serial()->str());
-		if (!device)
+	nosResult ExecuteNode(nosNodeExecuteParams* params) override
+	{
+		auto channel = Handle.Acquire();
+		if (!channel)
 			return NOS_RESULT_FAILED;
-		auto channel = static_cast<EBlueVideoChannel>(channelInfo->channel()->id());
-		auto videoMode = static_cast<EVideoModeExt>(channelInfo->video_mode());
-		auto prev = FieldCount;
-		device->WaitVBI(channel, FieldCount);
-		auto diff = FieldCount - prev;
-		uint8_t isInterlaced = bfcUtilsIsVideoModeProgressive(videoMode);
-		if (diff > (1 + isInterlaced))
-		{
-			nosEngine.LogW("%s dropped %d frames", bfcUtilsGetStringForVideoChannel(channel), diff / (1 + isInterlaced));
-		}
-		return NOS_RESULT_SUCCESS;
+		return Waiter.Wait(*channel, Handle) ? NOS_RESULT_SUCCESS : NOS_RESULT_FAILED;
 	}
 
-	unsigned long FieldCount = 0;
+	ChannelHandle Handle{};
+	VBLWaiter Waiter;
 };
 
 nosResult RegisterWaitVBLNode(nosNodeFunctions* outFunctions)
@@ -0,0 +1,149 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/PluginAPI.h>
+
+#include "ColorConversion.hpp"
+#include "ParallelRows.hpp"
+#include "Simd.hpp"
+#include "V210.hpp"
+
+// stl
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+NOS_INIT()
+
+namespace bf::bench
+{
+namespace
+{
+constexpr uint32_t Width = 3840, Height = 2160;
+constexpr auto MinDuration = std::chrono::milliseconds(500);
+
+template <typename Ret>
+Ret NOSAPI_CALL Log(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+	if constexpr (!std::is_void_v<Ret>)
+		return Ret{};
+}
+
+// Kernels log through the engine, which is not loaded here
+template <typename Ret>
+void SetLogger(Ret(NOSAPI_CALL*& log)(const char*, ...))
+{
+	log = &Log<Ret>;
+}
+
+// Runs one UHD frame per call at the given level
+struct Benchmark
+{
+	const char* Name;
+	uint64_t BytesPerFrame; // Of the card memory format, for the reported bandwidth
+	std::function<void(SimdLevel)> RunFrame;
+	bool DetectedLevelOnly = false; // Frame functions that pick the level themselves, e.g. to measure thread scaling
+};
+
+struct V210Frame
+{
+	uint32_t Pitch = v210::GetBytesPerLine(Width);
+	std::vector<uint8_t> Packed = std::vector<uint8_t>(size_t(Pitch) * Height, 0x55);
+	std::vector<uint16_t> Samples = std::vector<uint16_t>(size_t(Width) * Height * 2, 0x200);
+	uint16_t* Y = Samples.data();
+	uint16_t* Cb = Y + size_t(Width) * Height;
+	uint16_t* Cr = Cb + size_t(Width) * Height / 2;
+};
+
+struct YUV8Frame
+{
+	std::vector<uint8_t> YUV = std::vector<uint8_t>(size_t(Width) * Height * 2, 0x80);
+	std::vector<uint8_t> RGBA = std::vector<uint8_t>(size_t(Width) * Height * 4, 0x40);
+	color::YCbCrToRGBCoefficients ToRGB = color::GetYCbCrToRGBCoefficients(color::Matrix::Rec709, color::Range::Narrow);
+	color::RGBToYCbCrCoefficients ToYUV = color::GetRGBToYCbCrCoefficients(color::Matrix::Rec709, color::Range::Narrow);
+};
+
+std::vector<Benchmark> GetBenchmarks()
+{
+	auto v210 = std::make_shared<V210Frame>();
+	auto yuv8 = std::make_shared<YUV8Frame>();
+	return {
+		{"V210 Unpack", uint64_t(v210->Pitch) * Height, [v210](SimdLevel level) {
+			 for (uint32_t line = 0; line < Height; ++line)
+			 {
+				 size_t offset = size_t(line) * Width;
+				 v210::UnpackLine(level, v210->Packed.data() + size_t(line) * v210->Pitch, Width, v210->Y + offset, v210->Cb + offset / 2, v210->Cr + offset / 2);
+			 }
+		 }},
+		{"V210 Pack", uint64_t(v210->Pitch) * Height, [v210](SimdLevel level) {
+			 for (uint32_t line = 0; line < Height; ++line)
+			 {
+				 size_t offset = size_t(line) * Width;
+				 v210::PackLine(level, v210->Y + offset, v210->Cb + offset / 2, v210->Cr + offset / 2, Width, v210->Packed.data() + size_t(line) * v210->Pitch);
+			 }
+		 }},
+		{"YUV8 to RGBA8", uint64_t(Width) * 2 * Height, [yuv8](SimdLevel level) {
+			 for (uint32_t line = 0; line < Height; ++line)
+				 color::YUV8ToRGBA8Line(level, yuv8->ToRGB, yuv8->YUV.data() + size_t(line) * Width * 2, Width, yuv8->RGBA.data() + size_t(line) * Width * 4);
+		 }},
+		{"RGBA8 to YUV8", uint64_t(Width) * 2 * Height, [yuv8](SimdLevel level) {
+			 for (uint32_t line = 0; line < Height; ++line)
+				 color::RGBA8ToYUV8Line(level, yuv8->ToYUV, yuv8->RGBA.data() + size_t(line) * Width * 4, Width, yuv8->YUV.data() + size_t(line) * Width * 2);
+		 }},
+		{"YUV8 to RGBA8 threaded", uint64_t(Width) * 2 * Height, [yuv8](SimdLevel) {
+			 color::YUV8ToRGBA8(yuv8->YUV.data(), Width * 2, Width, Height, yuv8->RGBA.data(), Width * 4, color::Matrix::Rec709, color::Range::Narrow);
+		 }, true},
+		{"RGBA8 to YUV8 threaded", uint64_t(Width) * 2 * Height, [yuv8](SimdLevel) {
+			 color::RGBA8ToYUV8(yuv8->RGBA.data(), Width * 4, Width, Height, yuv8->YUV.data(), Width * 2, color::Matrix::Rec709, color::Range::Narrow);
+		 }, true},
+	};
+}
+}
+}
+
+// Measures the throughput of the CPU kernels on UHD frames on one thread, at each SIMD level the CPU supports, and of the
+// threaded frame conversions at the detected level.
+// Runs all benchmarks, or the ones whose name contains the first argument.
+int main(int argc, char** argv)
+{
+	using namespace bf;
+	bench::SetLogger(nosEngine.LogE);
+	bench::SetLogger(nosEngine.LogW);
+	bench::SetLogger(nosEngine.LogI);
+	bench::SetLogger(nosEngine.LogD);
+	auto maxLevel = GetSimdLevel();
+	printf("%-24s %-8s %10s %10s\n", "Benchmark", "Level", "Frames/s", "GB/s");
+	for (auto& benchmark : bench::GetBenchmarks())
+	{
+		if (argc > 1 && !strstr(benchmark.Name, argv[1]))
+			continue;
+		for (auto level : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512})
+		{
+			if (level > maxLevel || (benchmark.DetectedLevelOnly && level != maxLevel))
+				continue;
+			benchmark.RunFrame(level); // Warm up caches and pages
+			uint32_t frames = 0;
+			auto start = std::chrono::steady_clock::now();
+			auto elapsed = std::chrono::steady_clock::duration{};
+			do
+			{
+				benchmark.RunFrame(level);
+				++frames;
+				elapsed = std::chrono::steady_clock::now() - start;
+			} while (elapsed < bench::MinDuration);
+			double seconds = std::chrono::duration<double>(elapsed).count();
+			printf("%-24s %-8s %10.1f %10.2f\n", benchmark.Name, GetSimdLevelName(level), frames / seconds, benchmark.BytesPerFrame * frames / seconds / 1e9);
+		}
+	}
+	StopRowWorkers();
+	return 0;
+}
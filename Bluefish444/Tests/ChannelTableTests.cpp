@@ -0,0 +1,99 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "Device.hpp"
+#include "Test.hpp"
+
+// stl
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace bf::test
+{
+namespace
+{
+// Device objects are created by the tests instead of enumeration, on the second card so that the SDK instances of other
+// tests on the first one are not affected
+constexpr BLUE_S32 TestDeviceId = 2;
+}
+
+BF_TEST(ChannelHandleFollowsReopenedChannel)
+{
+	BErr err;
+	BluefishDevice device(TestDeviceId, err);
+	BF_REQUIRE(BERR_NO_ERROR == err);
+	auto handle = device.GetChannelHandle(BLUE_VIDEO_OUTPUT_CHANNEL_1);
+	BF_CHECK(handle.Generation == 0);
+	BF_CHECK(!handle.Acquire());
+
+	BF_REQUIRE(BERR_NO_ERROR == device.OpenChannel(BLUE_VIDEO_OUTPUT_CHANNEL_1, VID_FMT_EXT_1080P_5000));
+	uint32_t firstGeneration = 0;
+	{
+		auto channel = handle.Acquire();
+		BF_REQUIRE(channel);
+		firstGeneration = handle.Generation;
+		BF_CHECK(firstGeneration != 0);
+		BF_CHECK(channel->GetGeneration() == firstGeneration);
+		BF_CHECK(handle.Format.VideoMode == VID_FMT_EXT_1080P_5000);
+	}
+
+	device.CloseChannel(BLUE_VIDEO_OUTPUT_CHANNEL_1);
+	BF_CHECK(!handle.Acquire());
+	BF_CHECK(!device.PinChannel(BLUE_VIDEO_OUTPUT_CHANNEL_1));
+
+	// Handles resolved before are updated in place when the channel is opened again
+	BF_REQUIRE(BERR_NO_ERROR == device.OpenChannel(BLUE_VIDEO_OUTPUT_CHANNEL_1, VID_FMT_EXT_720P_5000));
+	auto channel = handle.Acquire();
+	BF_REQUIRE(channel);
+	BF_CHECK(handle.Generation > firstGeneration);
+	BF_CHECK(handle.Format.VideoMode == VID_FMT_EXT_720P_5000);
+	BF_CHECK(device.GetChannelHandle(BLUE_VIDEO_OUTPUT_CHANNEL_1).Generation == handle.Generation);
+}
+
+BF_TEST(ChannelCloseWaitsForPinnedReferences)
+{
+	BErr err;
+	BluefishDevice device(TestDeviceId, err);
+	BF_REQUIRE(BERR_NO_ERROR == err);
+	BF_REQUIRE(BERR_NO_ERROR == device.OpenChannel(BLUE_VIDEO_OUTPUT_CHANNEL_2, VID_FMT_EXT_1080P_5000));
+	auto pinned = device.PinChannel(BLUE_VIDEO_OUTPUT_CHANNEL_2);
+	BF_REQUIRE(pinned);
+	auto generation = pinned->GetGeneration();
+
+	std::atomic<bool> closed = false;
+	std::thread closer([&] {
+		device.CloseChannel(BLUE_VIDEO_OUTPUT_CHANNEL_2);
+		closed = true;
+	});
+	// The channel is unpublished at once, but not destroyed while it is pinned
+	auto until = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (device.PinChannel(BLUE_VIDEO_OUTPUT_CHANNEL_2) && std::chrono::steady_clock::now() < until)
+		std::this_thread::yield();
+	BF_CHECK(!device.PinChannel(BLUE_VIDEO_OUTPUT_CHANNEL_2));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	BF_CHECK(!closed);
+	BF_CHECK(pinned->GetGeneration() == generation);
+	pinned = {};
+	closer.join();
+	BF_CHECK(closed);
+}
+
+BF_TEST(ChannelGroupReservesItsLinks)
+{
+	BErr err;
+	BluefishDevice device(TestDeviceId, err);
+	BF_REQUIRE(BERR_NO_ERROR == err);
+	ChannelSettings quadLink{.LinkType = SIGNAL_LINK_TYPE_QUAD_LINK};
+	BF_REQUIRE(BERR_NO_ERROR == device.OpenChannel(BLUE_VIDEO_OUTPUT_CHANNEL_1, VID_FMT_EXT_2160P_5000, quadLink));
+	BF_CHECK(device.GetChannelHandle(BLUE_VIDEO_OUTPUT_CHANNEL_1).Format.LinkCount == 4);
+	BF_CHECK(device.GetGroupChannel(BLUE_VIDEO_OUTPUT_CHANNEL_2) == BLUE_VIDEO_OUTPUT_CHANNEL_1);
+	BF_CHECK(device.GetGroupChannel(BLUE_VIDEO_OUTPUT_CHANNEL_4) == BLUE_VIDEO_OUTPUT_CHANNEL_1);
+	BF_CHECK(device.GetGroupChannel(BLUE_VIDEO_OUTPUT_CHANNEL_5) == BLUE_VIDEO_OUTPUT_CHANNEL_5);
+	BF_CHECK(BERR_NO_ERROR != device.OpenChannel(BLUE_VIDEO_OUTPUT_CHANNEL_3, VID_FMT_EXT_1080P_5000));
+
+	device.CloseChannel(BLUE_VIDEO_OUTPUT_CHANNEL_1);
+	BF_CHECK(device.GetGroupChannel(BLUE_VIDEO_OUTPUT_CHANNEL_3) == BLUE_VIDEO_OUTPUT_CHANNEL_3);
+	BF_CHECK(BERR_NO_ERROR == device.OpenChannel(BLUE_VIDEO_OUTPUT_CHANNEL_3, VID_FMT_EXT_1080P_5000));
+}
+
+}
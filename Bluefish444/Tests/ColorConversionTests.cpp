@@ -0,0 +1,84 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ColorConversion.hpp"
+#include "Test.hpp"
+
+// stl
+#include <cstdlib>
+#include <vector>
+
+namespace bf::test
+{
+namespace
+{
+constexpr uint32_t TestWidths[] = {2, 46, 720, 1920};
+constexpr SimdLevel SimdLevels[] = {SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512};
+constexpr color::Matrix Matrices[] = {color::Matrix::Rec601, color::Matrix::Rec709, color::Matrix::Rec2020};
+
+std::vector<uint8_t> MakePattern(size_t size)
+{
+	std::vector<uint8_t> buffer(size);
+	for (size_t i = 0; i < size; ++i)
+		buffer[i] = uint8_t(i * 97 + i / 7);
+	return buffer;
+}
+}
+
+BF_TEST(ColorKernelsMatchScalarReference)
+{
+	for (auto matrix : Matrices)
+	{
+		for (auto range : {color::Range::Narrow, color::Range::Full})
+		{
+			auto toRGB = color::GetYCbCrToRGBCoefficients(matrix, range);
+			auto toYUV = color::GetRGBToYCbCrCoefficients(matrix, range);
+			for (auto width : TestWidths)
+			{
+				auto yuv = MakePattern(size_t(width) * 2);
+				auto rgba = MakePattern(size_t(width) * 4);
+				std::vector<uint8_t> rgbaReference(rgba.size()), yuvReference(yuv.size());
+				color::YUV8ToRGBA8Line(SimdLevel::Scalar, toRGB, yuv.data(), width, rgbaReference.data());
+				color::RGBA8ToYUV8Line(SimdLevel::Scalar, toYUV, rgba.data(), width, yuvReference.data());
+				for (auto level : SimdLevels)
+				{
+					if (level > GetSimdLevel())
+						continue;
+					std::vector<uint8_t> rgbaOut(rgba.size()), yuvOut(yuv.size());
+					color::YUV8ToRGBA8Line(level, toRGB, yuv.data(), width, rgbaOut.data());
+					color::RGBA8ToYUV8Line(level, toYUV, rgba.data(), width, yuvOut.data());
+					BF_CHECK(rgbaOut == rgbaReference);
+					BF_CHECK(yuvOut == yuvReference);
+				}
+			}
+		}
+	}
+}
+
+BF_TEST(ColorConversionKeepsGreysNeutral)
+{
+	constexpr uint32_t width = 256, height = 3;
+	std::vector<uint8_t> rgba(size_t(width) * height * 4);
+	for (uint32_t x = 0; x < width * height; ++x)
+	{
+		auto grey = uint8_t(x % width);
+		rgba[x * 4] = rgba[x * 4 + 1] = rgba[x * 4 + 2] = grey;
+		rgba[x * 4 + 3] = 255;
+	}
+	for (auto matrix : Matrices)
+	{
+		std::vector<uint8_t> yuv(size_t(width) * height * 2), roundTrip(rgba.size());
+		color::RGBA8ToYUV8(rgba.data(), width * 4, width, height, yuv.data(), width * 2, matrix, color::Range::Narrow);
+		BF_CHECK(yuv[1] == 16 && yuv[(width - 1) * 2 + 1] == 235); // Y of black and white
+		bool neutral = true;
+		for (size_t i = 0; i < yuv.size(); i += 4)
+			neutral &= yuv[i] == 128 && yuv[i + 2] == 128;
+		BF_CHECK(neutral);
+		color::YUV8ToRGBA8(yuv.data(), width * 2, width, height, roundTrip.data(), width * 4, matrix, color::Range::Narrow);
+		bool close = true;
+		for (size_t i = 0; i < rgba.size(); ++i)
+			close &= std::abs(int(roundTrip[i]) - int(rgba[i])) <= 1; // Narrow range quantizes 256 levels to 220
+		BF_CHECK(close);
+	}
+}
+
+}
@@ -0,0 +1,95 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include <Nodos/PluginAPI.h>
+#include <nosVulkanSubsystem/nosVulkanSubsystem.h>
+
+#define IMPLEMENTATION_BLUEVELVETC_FUNC_PTR
+#define LOAD_FUNC_PTR_V6_5_3
+#include <BlueVelvetCFuncPtr.h>
+
+#include "ParallelRows.hpp"
+#include "Simulator.hpp"
+#include "Test.hpp"
+
+// stl
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+NOS_INIT()
+// Not loaded either: Tested sources only map buffers of DMA buffer pools, which are not created here
+NOS_VULKAN_INIT()
+
+namespace bf::test
+{
+namespace
+{
+int FailureCount = 0;
+
+template <typename Ret>
+Ret NOSAPI_CALL Log(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+	if constexpr (!std::is_void_v<Ret>)
+		return Ret{};
+}
+
+// Plugin sources log through the engine, which is not loaded here
+template <typename Ret>
+void SetLogger(Ret(NOSAPI_CALL*& log)(const char*, ...))
+{
+	log = &Log<Ret>;
+}
+}
+
+std::vector<TestCase>& GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("%s:%d: Check failed: %s\n", file, line, expression);
+	++FailureCount;
+}
+
+}
+
+// Runs all tests, or the ones whose name contains the first argument, on simulated devices
+int main(int argc, char** argv)
+{
+	using namespace bf;
+	test::SetLogger(nosEngine.LogE);
+	test::SetLogger(nosEngine.LogW);
+	test::SetLogger(nosEngine.LogI);
+	test::SetLogger(nosEngine.LogD);
+
+	sim::SimulatorConfig config;
+	config.DeviceCount = 2; // Cards run transfers independently of each other
+	config.DMABandwidthMBps = 500.0; // A frame takes milliseconds, so that transfers are observably in flight
+	if (!sim::LoadFunctionPointers_Simulator(config))
+		return 1;
+
+	int failedTests = 0;
+	for (auto& test : test::GetTests())
+	{
+		if (argc > 1 && !strstr(test.Name, argv[1]))
+			continue;
+		printf("[ RUN  ] %s\n", test.Name);
+		auto failures = test::FailureCount;
+		test.Run();
+		bool failed = test::FailureCount != failures;
+		failedTests += failed;
+		printf("[ %s ] %s\n", failed ? "FAIL" : " OK ", test.Name);
+	}
+	StopRowWorkers();
+	sim::UnloadSimulator();
+	printf("%d test(s) failed\n", failedTests);
+	return failedTests ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "OutputPacer.hpp"
+#include "Test.hpp"
+
+// stl
+#include <chrono>
+#include <memory>
+
+namespace bf::test
+{
+namespace
+{
+using namespace std::chrono_literals;
+
+constexpr uint64_t VBIPeriod = 20'000'000; // 50p, in nanoseconds
+constexpr TelemetryClock::duration MinMargin = 1ms;
+
+// Paces frames that take 5 ms to produce and 2 ms to transfer, until the pacer measured a window of them
+struct MeasuredPacer
+{
+	OutputPacer Pacer;
+	std::unique_ptr<LatencyHistogram> TransferTime = std::make_unique<LatencyHistogram>();
+	TelemetryClock::time_point Now = TelemetryClock::time_point(100s);
+
+	MeasuredPacer()
+	{
+		Pacer.Reset(VBIPeriod, MinMargin);
+		for (uint32_t i = 0; i < OutputPacer::WindowFrames; ++i)
+		{
+			TransferTime->Record(2ms);
+			auto request = Pacer.GetRequestTime(Now, Now - 1ms);
+			Pacer.OnFrameReady(request + 5ms, *TransferTime);
+			Now += std::chrono::nanoseconds(VBIPeriod);
+		}
+	}
+};
+}
+
+BF_TEST(OutputPacerRequestsRightAwayUntilMeasured)
+{
+	OutputPacer pacer;
+	pacer.Reset(VBIPeriod, MinMargin);
+	auto now = TelemetryClock::time_point(100s);
+	BF_CHECK(pacer.GetRequestTime(now, now - 1ms) == now);
+	BF_CHECK(pacer.OnFrameReady(now + 30ms, LatencyHistogram{}));
+	BF_CHECK(pacer.GetMisses() == 0);
+	BF_CHECK(pacer.GetMargin() == MinMargin);
+}
+
+BF_TEST(OutputPacerRequestsAsLateAsDurationsAllow)
+{
+	MeasuredPacer measured;
+	auto& pacer = measured.Pacer;
+	auto now = measured.Now;
+	// Production, transfer and margin take 8 ms before the VBI 19 ms from now
+	BF_CHECK(pacer.GetRequestTime(now, now - 1ms) == now + 11ms);
+	BF_CHECK(pacer.OnFrameReady(now + 16ms, *measured.TransferTime));
+	BF_CHECK(pacer.GetMisses() == 0);
+
+	// Too late for the next VBI, so the frame is produced for the one after it
+	now += 20ms;
+	BF_CHECK(pacer.GetRequestTime(now, now - 15ms) == now + 17ms);
+	BF_CHECK(pacer.OnFrameReady(now + 22ms, *measured.TransferTime));
+}
+
+BF_TEST(OutputPacerWidensMarginOnMisses)
+{
+	MeasuredPacer measured;
+	auto& pacer = measured.Pacer;
+	auto now = measured.Now;
+	pacer.GetRequestTime(now, now - 1ms);
+	// Ready 1 ms before the VBI, which leaves no time for the 2 ms transfer
+	BF_CHECK(!pacer.OnFrameReady(now + 18ms, *measured.TransferTime));
+	BF_CHECK(pacer.GetMisses() == 1);
+	BF_CHECK(pacer.GetMargin() == 2ms);
+	// The next frame is requested a millisecond earlier
+	now += 20ms;
+	BF_CHECK(pacer.GetRequestTime(now, now - 1ms) == now + 10ms);
+
+	// Skipped frames miss their VBI too
+	pacer.OnFrameSkipped();
+	BF_CHECK(pacer.GetMisses() == 2);
+	BF_CHECK(pacer.GetMargin() == 4ms);
+	// A skip without a paced request is not a miss
+	pacer.OnFrameSkipped();
+	BF_CHECK(pacer.GetMisses() == 2);
+
+	// Margin is at most half a VBI period
+	for (int i = 0; i < 8; ++i)
+	{
+		pacer.GetRequestTime(now, now - 1ms);
+		pacer.OnFrameSkipped();
+	}
+	BF_CHECK(pacer.GetMargin() == 10ms);
+
+	// and decays back to the minimum while frames are on time
+	for (int i = 0; i < 1000; ++i)
+	{
+		now += 20ms;
+		auto request = pacer.GetRequestTime(now, now - 1ms);
+		BF_CHECK(pacer.OnFrameReady(request + 5ms, *measured.TransferTime));
+	}
+	BF_CHECK(pacer.GetMargin() < 1100us);
+	BF_CHECK(pacer.GetMargin() >= MinMargin);
+}
+
+}
@@ -0,0 +1,151 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ClipReader.hpp"
+#include "RecordingWriter.hpp"
+#include "Test.hpp"
+
+// stl
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+namespace bf::test
+{
+namespace
+{
+using namespace std::chrono_literals;
+
+constexpr uint32_t FrameSize = 10'000; // Not a multiple of a block, so that frames are padded
+constexpr uint32_t FrameCount = 7; // More than the queue depth, so that slots are reused
+
+std::string GetRecordingPath(char const* name)
+{
+	return (std::filesystem::temp_directory_path() / name).string();
+}
+
+RecordingHeader MakeHeader(bool fieldMode)
+{
+	RecordingHeader header{
+		.VideoMode = 7,
+		.Width = 1000,
+		.Height = 20,
+		.BytesPerLine = 500,
+		.FrameSize = FrameSize,
+		.DeltaSeconds = {1, 50},
+		.FieldMode = fieldMode,
+		.Progressive = !fieldMode,
+	};
+	strcpy(header.Serial, "BFTEST0001");
+	return header;
+}
+
+// Writes frames whose bytes are their index plus one, 20 ms apart
+bool WriteFrames(RecordingWriter& writer, bool fieldMode)
+{
+	auto start = TelemetryClock::time_point(100s);
+	for (uint32_t i = 0; i < FrameCount; ++i)
+	{
+		auto* data = writer.Acquire();
+		for (auto until = std::chrono::steady_clock::now() + 1s; !data && std::chrono::steady_clock::now() < until; data = writer.Acquire())
+			std::this_thread::sleep_for(1ms);
+		if (!data)
+			return false;
+		memset(data, int(i + 1), FrameSize);
+		writer.Submit(100 + i * (fieldMode ? 1 : 2), start + i * 20ms, fieldMode ? i % 2 : RecordingIndexEntry::Frame);
+	}
+	return true;
+}
+
+bool HoldsFrame(ClipReader const& reader, uint64_t frame)
+{
+	auto* data = reader.GetData(frame);
+	auto value = uint8_t(frame + 1);
+	return data[0] == value && data[FrameSize - 1] == value;
+}
+
+void CheckRoundTrip(char const* name, bool fieldMode)
+{
+	auto path = GetRecordingPath(name);
+	RecordingWriter writer;
+	BF_REQUIRE(writer.Open(path, MakeHeader(fieldMode), 3, -1));
+	BF_REQUIRE(WriteFrames(writer, fieldMode));
+	BF_CHECK(writer.Close());
+	BF_CHECK(writer.GetWritten() == FrameCount);
+	BF_CHECK(writer.GetFailed() == 0);
+
+	constexpr uint64_t stride = AlignToRecordingBlock(FrameSize);
+	constexpr uint64_t indexOffset = RecordingBlockSize + FrameCount * stride;
+	// Index is padded to a block like the frames
+	BF_CHECK(std::filesystem::file_size(path) == indexOffset + RecordingBlockSize);
+
+	ClipReader reader;
+	BF_REQUIRE(reader.Open(path, 0));
+	auto& header = reader.GetHeader();
+	BF_REQUIRE(header);
+	BF_CHECK(header->IsValid());
+	BF_CHECK(header->HeaderSize == RecordingBlockSize);
+	BF_CHECK(header->Stride == stride);
+	BF_CHECK(header->FrameSize == FrameSize);
+	BF_CHECK(header->IndexOffset == indexOffset);
+	BF_CHECK(header->IndexCount == FrameCount);
+	BF_CHECK(header->FieldMode == uint32_t(fieldMode));
+	BF_CHECK(header->Width == 1000 && header->Height == 20 && header->BytesPerLine == 500);
+	BF_CHECK(header->DeltaSeconds[0] == 1 && header->DeltaSeconds[1] == 50);
+	BF_CHECK(0 == strcmp(header->Serial, "BFTEST0001"));
+	BF_CHECK(header->StartTime != 0);
+
+	BF_REQUIRE(reader.GetFrameCount() == FrameCount);
+	for (uint32_t i = 0; i < FrameCount; ++i)
+	{
+		auto& entry = reader.GetEntry(i);
+		BF_CHECK(entry.FieldCount == 100 + i * (fieldMode ? 1 : 2));
+		BF_CHECK(entry.Time == std::chrono::nanoseconds(i * 20ms).count());
+		BF_CHECK(entry.Offset == RecordingBlockSize + i * stride);
+		BF_CHECK(entry.Offset % RecordingBlockSize == 0);
+		BF_CHECK(entry.Size == FrameSize);
+		BF_CHECK(entry.Field == (fieldMode ? i % 2 : RecordingIndexEntry::Frame));
+		BF_CHECK(HoldsFrame(reader, i));
+		// Padding up to the stride is zero
+		BF_CHECK(reader.GetData(i)[FrameSize] == 0 && reader.GetData(i)[stride - 1] == 0);
+	}
+	reader.Close();
+	std::filesystem::remove(path);
+}
+}
+
+BF_TEST(RecordingReadsBackFrames)
+{
+	CheckRoundTrip("bluefish444-recording-test.bfraw", false);
+}
+
+BF_TEST(RecordingReadsBackFields)
+{
+	CheckRoundTrip("bluefish444-recording-fields-test.bfraw", true);
+}
+
+BF_TEST(RecordingNotClosedReadsBackWithoutIndex)
+{
+	auto path = GetRecordingPath("bluefish444-recording-unclosed-test.bfraw");
+	{
+		RecordingWriter writer;
+		BF_REQUIRE(writer.Open(path, MakeHeader(false), 3, -1));
+		BF_REQUIRE(WriteFrames(writer, false));
+		BF_CHECK(writer.Close());
+	}
+	// Index is cut off, as if the recording stopped while it was written
+	std::filesystem::resize_file(path, RecordingBlockSize + FrameCount * AlignToRecordingBlock(FrameSize));
+	{
+		ClipReader reader;
+		BF_REQUIRE(reader.Open(path, 0));
+		BF_REQUIRE(reader.GetFrameCount() == FrameCount);
+		for (uint32_t i = 0; i < FrameCount; ++i)
+		{
+			BF_CHECK(reader.GetEntry(i).Offset == RecordingBlockSize + i * AlignToRecordingBlock(FrameSize));
+			BF_CHECK(HoldsFrame(reader, i));
+		}
+	}
+	std::filesystem::remove(path);
+}
+
+}
@@ -0,0 +1,145 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ReplayRing.hpp"
+#include "Recording.hpp"
+#include "Test.hpp"
+
+// stl
+#include <chrono>
+#include <cstring>
+
+namespace bf::test
+{
+namespace
+{
+using namespace std::chrono_literals;
+
+constexpr uint32_t Capacity = 4;
+constexpr uint32_t FrameSize = 5000; // Not a multiple of a page, so that slots are padded
+
+ChannelFormat MakeFormat(bool fieldMode)
+{
+	return {
+		.BufferSize = FrameSize,
+		.Progressive = !fieldMode,
+		.DeltaSeconds = {1, 50},
+		.FieldMode = fieldMode,
+		.FieldBufferSize = FrameSize,
+	};
+}
+
+// Captures a frame whose bytes are its field count, at 10 ms per field count
+bool Capture(ReplayRing& ring, uint64_t fieldCount, uint32_t field = RecordingIndexEntry::Frame)
+{
+	auto* data = ring.BeginWrite(fieldCount);
+	if (!data)
+		return false;
+	memset(data, int(fieldCount), FrameSize);
+	ring.EndWrite(fieldCount, TelemetryClock::time_point(100s) + int64_t(fieldCount) * 10ms, field, true);
+	return true;
+}
+
+bool HoldsFrame(ReplayRing::Pin const& pin, uint64_t fieldCount)
+{
+	auto* data = pin.GetData();
+	return pin.GetFieldCount() == fieldCount && data[0] == uint8_t(fieldCount) && data[FrameSize - 1] == uint8_t(fieldCount);
+}
+}
+
+BF_TEST(ReplayRingKeepsLastFramesAcrossWraparound)
+{
+	auto ring = ReplayRing::Create("ReplayRingTest", MakeFormat(false), Capacity, -1, false);
+	BF_REQUIRE(ring);
+	BF_CHECK(ring->GetFieldCountStep() == 2);
+	BF_CHECK(!ring->GetLatest());
+	BF_CHECK(!ring->Acquire(0));
+	// Two and a half times around the ring
+	for (uint64_t fieldCount = 0; fieldCount < 20; fieldCount += 2)
+		BF_REQUIRE(Capture(*ring, fieldCount));
+	BF_CHECK(ring->GetLatest() == 18u);
+	for (uint64_t fieldCount = 12; fieldCount < 20; fieldCount += 2)
+	{
+		auto pin = ring->Acquire(fieldCount);
+		BF_REQUIRE(pin);
+		BF_CHECK(HoldsFrame(pin, fieldCount));
+		BF_CHECK(pin.GetField() == RecordingIndexEntry::Frame);
+		BF_CHECK(pin.GetTime() == TelemetryClock::time_point(100s) + int64_t(fieldCount) * 10ms);
+	}
+	// Replaced by the frame one ring length later
+	BF_CHECK(!ring->Acquire(10));
+	BF_CHECK(!ring->Acquire(2));
+	// Frames are found by the time closest to their capture
+	BF_CHECK(ring->FindFieldCount(TelemetryClock::time_point(100s) + 141ms) == 14u);
+	BF_CHECK(ring->FindFieldCount(TelemetryClock::time_point(100s) + 500ms) == 18u);
+	BF_CHECK(!ring->FindFieldCount(TelemetryClock::time_point(100s)));
+	BF_CHECK(ReplayRing::Find("ReplayRingTest") == ring);
+}
+
+BF_TEST(ReplayRingDropsCaptureIntoPinnedFrame)
+{
+	auto ring = ReplayRing::Create("ReplayRingTest", MakeFormat(false), Capacity, -1, false);
+	BF_REQUIRE(ring);
+	for (uint64_t fieldCount = 0; fieldCount < 8; fieldCount += 2)
+		BF_REQUIRE(Capture(*ring, fieldCount));
+	auto pin = ring->Acquire(2);
+	BF_REQUIRE(pin);
+	// Slot of frame 2 is next to be overwritten, but is pinned
+	BF_CHECK(!Capture(*ring, 10));
+	BF_CHECK(HoldsFrame(pin, 2));
+	BF_CHECK(ring->GetLatest() == 6u);
+	BF_CHECK(!ring->Acquire(10));
+	// Other slots are written meanwhile
+	BF_CHECK(Capture(*ring, 8));
+	pin.Release();
+	BF_CHECK(Capture(*ring, 10));
+	BF_CHECK(!ring->Acquire(2));
+	auto replaced = ring->Acquire(10);
+	BF_REQUIRE(replaced);
+	BF_CHECK(HoldsFrame(replaced, 10));
+}
+
+BF_TEST(ReplayRingFailedCaptureClearsSlot)
+{
+	auto ring = ReplayRing::Create("ReplayRingTest", MakeFormat(false), Capacity, -1, false);
+	BF_REQUIRE(ring);
+	BF_REQUIRE(Capture(*ring, 0));
+	BF_REQUIRE(ring->BeginWrite(8));
+	ring->EndWrite(8, TelemetryClock::time_point(100s), RecordingIndexEntry::Frame, false);
+	BF_CHECK(!ring->Acquire(0));
+	BF_CHECK(!ring->Acquire(8));
+	BF_CHECK(ring->GetLatest() == 0u);
+}
+
+BF_TEST(ReplayRingPinKeepsRingAlive)
+{
+	auto ring = ReplayRing::Create("ReplayRingTest", MakeFormat(false), Capacity, -1, false);
+	BF_REQUIRE(ring);
+	BF_REQUIRE(Capture(*ring, 4));
+	auto pin = ring->Acquire(4);
+	BF_REQUIRE(pin);
+	ring.reset();
+	// Still registered, as the pin holds the ring
+	BF_CHECK(ReplayRing::Find("ReplayRingTest"));
+	BF_CHECK(HoldsFrame(pin, 4));
+	pin.Release();
+	BF_CHECK(!ReplayRing::Find("ReplayRingTest"));
+}
+
+BF_TEST(ReplayRingStoresEachFieldInFieldMode)
+{
+	auto ring = ReplayRing::Create("ReplayRingTest", MakeFormat(true), Capacity, -1, false);
+	BF_REQUIRE(ring);
+	BF_CHECK(ring->GetFieldCountStep() == 1);
+	for (uint64_t fieldCount = 10; fieldCount < 16; ++fieldCount)
+		BF_REQUIRE(Capture(*ring, fieldCount, uint32_t(fieldCount % 2)));
+	BF_CHECK(!ring->Acquire(11));
+	for (uint64_t fieldCount = 12; fieldCount < 16; ++fieldCount)
+	{
+		auto pin = ring->Acquire(fieldCount);
+		BF_REQUIRE(pin);
+		BF_CHECK(HoldsFrame(pin, fieldCount));
+		BF_CHECK(pin.GetField() == fieldCount % 2);
+	}
+}
+
+}
@@ -0,0 +1,317 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "DMAEngine.hpp"
+#include "DMAScheduler.hpp"
+#include "VideoFormats.hpp"
+#include "Test.hpp"
+
+// stl
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace bf::test
+{
+namespace
+{
+constexpr EVideoModeExt TestVideoMode = VID_FMT_EXT_1080P_5000;
+
+// SDK instance attached to a simulated card, the first one by default, set up for an output channel
+struct SimulatedOutput
+{
+	BLUEVELVETC_HANDLE Sdk = bfcFactory();
+	uint32_t BytesPerLine = 0;
+	uint32_t FrameSize = 0;
+
+	explicit SimulatedOutput(EBlueVideoChannel channel = BLUE_VIDEO_OUTPUT_CHANNEL_1, EVideoModeExt mode = TestVideoMode, int deviceId = 1)
+	{
+		if (BERR_NO_ERROR != bfcAttach(Sdk, deviceId))
+			return;
+		auto setup = bfcUtilsGetDefaultSetupInfoOutput(channel, mode);
+		setup.DeviceId = deviceId;
+		if (BERR_NO_ERROR != bfcUtilsSetupOutput(Sdk, &setup))
+			return;
+		if (BERR_NO_ERROR != bfcGetVideoBytesPerLineV2(mode, MEM_FMT_2VUY, &BytesPerLine))
+			return;
+		FrameSize = BytesPerLine * FindVideoFormat(mode)->Height;
+	}
+
+	~SimulatedOutput()
+	{
+		bfcDetach(Sdk);
+		bfcDestroy(Sdk);
+	}
+
+	DMATransfer Transfer(DMADirection direction, std::vector<uint8_t>& buffer, uint32_t cardBuffer = 0) const
+	{
+		return {
+			.Direction = direction,
+			.HostBuffer = buffer.data(),
+			.Size = uint32_t(buffer.size()),
+			.CardBuffer = BlueImage_DMABuffer(cardBuffer, BLUE_DMA_DATA_TYPE_IMAGE_FRAME),
+			.Offset = 0,
+			.OnComplete = nullptr,
+		};
+	}
+};
+
+std::vector<uint8_t> MakePattern(uint32_t size, uint8_t seed)
+{
+	std::vector<uint8_t> buffer(size);
+	for (uint32_t i = 0; i < size; ++i)
+		buffer[i] = uint8_t(i * 31 + seed);
+	return buffer;
+}
+
+// Splits a transfer of a field into one band of lines per link, as Channel::SubmitBands does for multi-link channels
+std::vector<DMATransfer> SplitIntoBands(DMATransfer transfer, uint32_t pitch, uint32_t linkCount)
+{
+	uint32_t partSize = (transfer.Size / pitch + linkCount - 1) / linkCount * pitch;
+	std::vector<DMATransfer> parts;
+	for (uint32_t offset = 0; offset < transfer.Size; offset += partSize)
+	{
+		auto& part = parts.emplace_back(transfer);
+		part.HostBuffer = transfer.HostBuffer + offset;
+		part.Size = std::min(partSize, transfer.Size - offset);
+		part.Offset = transfer.Offset + offset;
+	}
+	return parts;
+}
+}
+
+BF_TEST(DMAWriteThenReadReturnsFrame)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk);
+	auto written = MakePattern(output.FrameSize, 7);
+	std::vector<uint8_t> read(output.FrameSize);
+	auto writeTicket = engine.Submit(output.Transfer(DMADirection::HostToCard, written));
+	BF_REQUIRE(writeTicket);
+	BF_CHECK(engine.Wait(*writeTicket));
+	auto readTicket = engine.Submit(output.Transfer(DMADirection::CardToHost, read));
+	BF_REQUIRE(readTicket);
+	BF_CHECK(engine.Wait(*readTicket));
+	BF_CHECK(read == written);
+}
+
+BF_TEST(DMASubmitReturnsBeforeTransferCompletes)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk);
+	auto buffer = MakePattern(output.FrameSize, 1);
+	bool completed = false;
+	auto transfer = output.Transfer(DMADirection::HostToCard, buffer);
+	transfer.OnComplete = [&completed](bool success) { completed = success; };
+	auto ticket = engine.Submit(std::move(transfer));
+	BF_REQUIRE(ticket);
+	// A frame takes about 8 ms at the bandwidth the tests configure
+	BF_CHECK(engine.Poll() == 1);
+	BF_CHECK(!completed);
+	BF_CHECK(engine.Wait(*ticket));
+	BF_CHECK(completed);
+	BF_CHECK(engine.GetInFlightCount() == 0);
+}
+
+BF_TEST(DMATransfersOverlapUpToMaxInFlight)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk, 3);
+	std::vector<std::vector<uint8_t>> buffers;
+	for (uint8_t i = 0; i < 3; ++i)
+		buffers.push_back(MakePattern(output.FrameSize, i));
+	std::vector<DMAEngine::Ticket> tickets;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		auto ticket = engine.Submit(output.Transfer(DMADirection::HostToCard, buffers[i], i));
+		BF_REQUIRE(ticket);
+		tickets.push_back(*ticket);
+	}
+	BF_CHECK(engine.GetInFlightCount() == 3);
+	for (auto ticket : tickets)
+		BF_CHECK(engine.Wait(ticket));
+}
+
+BF_TEST(DMASchedulerKeepsTransfersOfAQueueInFlight)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk);
+	DMAScheduler scheduler;
+	DMAQueue queue(engine);
+	scheduler.SetMaxPending(queue, 3);
+	std::vector<std::vector<uint8_t>> buffers;
+	for (uint8_t i = 0; i < 3; ++i)
+		buffers.push_back(MakePattern(output.FrameSize, i));
+	std::vector<DMAScheduler::Ticket> tickets;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		tickets.push_back(scheduler.Submit(queue, {output.Transfer(DMADirection::HostToCard, buffers[i], i)}, TelemetryClock::now()));
+		BF_REQUIRE(tickets.back());
+	}
+	// Later ones are submitted to the SDK while the first one runs, which takes about 8 ms. Run one at a time, they are not.
+	// All 3 usually are, unless the simulator is slowed down (e.g. by sanitizers) and copies take longer than transfers.
+	uint32_t maxInFlight = 0;
+	auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+	while (maxInFlight < 3 && std::chrono::steady_clock::now() < until)
+		maxInFlight = std::max(maxInFlight, engine.GetInFlightCount());
+	BF_CHECK(maxInFlight > 1);
+	for (auto& ticket : tickets)
+		BF_CHECK(scheduler.Wait(ticket));
+	scheduler.WaitAll(queue);
+}
+
+BF_TEST(DMASchedulerCompletesQueuesIndependently)
+{
+	// On different cards, as the simulator runs the transfers of a card in submission order
+	SimulatedOutput slowOutput(BLUE_VIDEO_OUTPUT_CHANNEL_1, TestVideoMode, 1);
+	SimulatedOutput fastOutput(BLUE_VIDEO_OUTPUT_CHANNEL_1, TestVideoMode, 2);
+	BF_REQUIRE(slowOutput.FrameSize && fastOutput.FrameSize);
+	DMAEngine slowEngine(slowOutput.Sdk);
+	DMAEngine fastEngine(fastOutput.Sdk);
+	DMAScheduler scheduler;
+	DMAQueue slowQueue(slowEngine);
+	DMAQueue fastQueue(fastEngine);
+	scheduler.SetMaxPending(slowQueue, 4);
+	// 4 frames take about 32 ms, a line a few microseconds
+	std::vector<std::vector<uint8_t>> frames;
+	std::vector<DMATransfer> parts;
+	for (uint8_t i = 0; i < 4; ++i)
+	{
+		frames.push_back(MakePattern(slowOutput.FrameSize, i));
+		parts.push_back(slowOutput.Transfer(DMADirection::HostToCard, frames.back(), i));
+	}
+	auto line = MakePattern(fastOutput.BytesPerLine, 9);
+	auto slow = scheduler.Submit(slowQueue, std::move(parts), TelemetryClock::now());
+	BF_REQUIRE(slow);
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	auto fast = scheduler.Submit(fastQueue, {fastOutput.Transfer(DMADirection::HostToCard, line)}, TelemetryClock::now() + std::chrono::milliseconds(20));
+	BF_REQUIRE(fast);
+	BF_CHECK(scheduler.Wait(fast));
+	BF_CHECK(!DMAScheduler::IsDone(slow));
+	BF_CHECK(scheduler.Wait(slow));
+	scheduler.WaitAll(slowQueue);
+	scheduler.WaitAll(fastQueue);
+}
+
+BF_TEST(DMAWaitsFromSeveralThreadsReportEachTicket)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk, 4);
+	std::vector<std::vector<uint8_t>> buffers;
+	for (uint8_t i = 0; i < 4; ++i)
+		buffers.push_back(MakePattern(output.FrameSize, i));
+	std::vector<DMAEngine::Ticket> tickets;
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		auto ticket = engine.Submit(output.Transfer(DMADirection::HostToCard, buffers[i], i));
+		BF_REQUIRE(ticket);
+		tickets.push_back(*ticket);
+	}
+	std::vector<uint8_t> results(tickets.size());
+	std::vector<std::thread> waiters;
+	for (size_t i = 0; i < tickets.size(); ++i)
+		waiters.emplace_back([&, i] { results[i] = engine.Wait(tickets[tickets.size() - 1 - i]); });
+	for (auto& waiter : waiters)
+		waiter.join();
+	for (auto result : results)
+		BF_CHECK(result);
+	// Results stay known after the transfers are reaped
+	BF_CHECK(engine.Wait(tickets[0]));
+}
+
+BF_TEST(DMAToUnknownBufferIsRejected)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk);
+	auto buffer = MakePattern(output.FrameSize, 3);
+	auto transfer = output.Transfer(DMADirection::HostToCard, buffer);
+	transfer.CardBuffer = BlueImage_DMABuffer(1000, BLUE_DMA_DATA_TYPE_IMAGE_FRAME);
+	BF_CHECK(!engine.Submit(std::move(transfer)));
+	BF_CHECK(engine.GetInFlightCount() == 0);
+}
+
+BF_TEST(DMAJoinedPartsAreWaitedForIfOneIsRejected)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk);
+	auto buffer = MakePattern(output.FrameSize, 4);
+	std::vector<DMATransfer> parts;
+	parts.push_back(output.Transfer(DMADirection::HostToCard, buffer));
+	parts.push_back(output.Transfer(DMADirection::HostToCard, buffer));
+	parts.back().CardBuffer = BlueImage_DMABuffer(1000, BLUE_DMA_DATA_TYPE_IMAGE_FRAME);
+	BF_CHECK(!engine.SubmitJoined(std::move(parts)));
+	BF_CHECK(engine.GetInFlightCount() == 0);
+}
+
+BF_TEST(MultiLinkFieldBandsInterleaveIntoFrame)
+{
+	SimulatedOutput output(BLUE_VIDEO_OUTPUT_CHANNEL_1, VID_FMT_EXT_1080I_5000);
+	BF_REQUIRE(output.FrameSize);
+	DMAEngine engine(output.Sdk, 8);
+	uint32_t fieldSize = output.FrameSize / 2;
+	std::vector<std::vector<uint8_t>> fields{MakePattern(fieldSize, 11), MakePattern(fieldSize, 97)};
+	// Quad link bands for the first field, dual link bands for the second one
+	for (uint32_t field = 0; field < 2; ++field)
+	{
+		auto transfer = output.Transfer(DMADirection::HostToCard, fields[field]);
+		transfer.CardBuffer = BlueImage_DMABuffer(0, field ? BLUE_DMA_DATA_TYPE_IMAGE_FIELD2 : BLUE_DMA_DATA_TYPE_IMAGE_FIELD1);
+		auto ticket = engine.SubmitJoined(SplitIntoBands(std::move(transfer), output.BytesPerLine, field ? 2 : 4));
+		BF_REQUIRE(ticket);
+		BF_CHECK(engine.Wait(*ticket));
+	}
+	std::vector<uint8_t> frame(output.FrameSize);
+	auto frameTicket = engine.Submit(output.Transfer(DMADirection::CardToHost, frame));
+	BF_REQUIRE(frameTicket);
+	BF_CHECK(engine.Wait(*frameTicket));
+	bool interleaved = true;
+	for (uint32_t line = 0; line < output.FrameSize / output.BytesPerLine; ++line)
+		interleaved &= 0 == memcmp(frame.data() + size_t(line) * output.BytesPerLine, fields[line & 1].data() + size_t(line / 2) * output.BytesPerLine, output.BytesPerLine);
+	BF_CHECK(interleaved);
+	// Read back in bands too
+	std::vector<uint8_t> readField(fieldSize);
+	auto readTransfer = output.Transfer(DMADirection::CardToHost, readField);
+	readTransfer.CardBuffer = BlueImage_DMABuffer(0, BLUE_DMA_DATA_TYPE_IMAGE_FIELD2);
+	auto readTicket = engine.SubmitJoined(SplitIntoBands(std::move(readTransfer), output.BytesPerLine, 4));
+	BF_REQUIRE(readTicket);
+	BF_CHECK(engine.Wait(*readTicket));
+	BF_CHECK(readField == fields[1]);
+}
+
+BF_TEST(OutputVBIAdvancesOneFramePerWait)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	unsigned long first = 0, second = 0;
+	BF_REQUIRE(BERR_NO_ERROR == bfcWaitVideoOutputSync(output.Sdk, UPD_FMT_FRAME, &first));
+	auto start = std::chrono::steady_clock::now();
+	BF_REQUIRE(BERR_NO_ERROR == bfcWaitVideoOutputSync(output.Sdk, UPD_FMT_FRAME, &second));
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	BF_CHECK(second == first + 2); // Field count
+	BF_CHECK(elapsed > std::chrono::milliseconds(15) && elapsed < std::chrono::milliseconds(40)); // 20 ms at 50 Hz
+}
+
+BF_TEST(VBIWaitsOnInstanceBoundToChannel)
+{
+	SimulatedOutput output;
+	BF_REQUIRE(output.FrameSize);
+	// Like the VBI dispatcher of a channel, waits on an instance of its own that is bound without setting the channel up
+	auto waiter = bfcFactory();
+	BF_REQUIRE(BERR_NO_ERROR == bfcAttach(waiter, 1));
+	unsigned long fieldCount = 0;
+	BF_CHECK(BERR_NO_ERROR != bfcWaitVideoOutputSync(waiter, UPD_FMT_FRAME, &fieldCount));
+	BF_CHECK(BERR_NO_ERROR != bfcSetCardProperty32(waiter, DEFAULT_VIDEO_INPUT_CHANNEL, BLUE_VIDEO_OUTPUT_CHANNEL_1));
+	BF_REQUIRE(BERR_NO_ERROR == bfcSetCardProperty32(waiter, DEFAULT_VIDEO_OUTPUT_CHANNEL, BLUE_VIDEO_OUTPUT_CHANNEL_1));
+	BF_CHECK(BERR_NO_ERROR == bfcWaitVideoOutputSync(waiter, UPD_FMT_FRAME, &fieldCount));
+	bfcDetach(waiter);
+	bfcDestroy(waiter);
+}
+
+}
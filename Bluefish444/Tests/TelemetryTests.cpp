@@ -0,0 +1,220 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "Telemetry.hpp"
+#include "Test.hpp"
+
+// stl
+#include <chrono>
+#include <memory>
+
+namespace bf::test
+{
+namespace
+{
+using namespace std::chrono_literals;
+
+constexpr uint64_t FieldPeriod = 20'000'000; // 50 fields per second, in nanoseconds
+}
+
+BF_TEST(LatencyBucketsAreContiguous)
+{
+	// Values below the sub-bucket count have a bucket each
+	for (uint32_t value = 0; value < LatencyHistogram::SubBucketCount; ++value)
+	{
+		BF_CHECK(LatencyHistogram::GetBucketIndex(value) == value);
+		BF_CHECK(LatencyHistogram::GetBucketLowerBound(value) == value);
+		BF_CHECK(LatencyHistogram::GetBucketUpperBound(value) == value);
+	}
+	for (uint32_t index = 0; index < LatencyHistogram::BucketCount; ++index)
+	{
+		auto lower = LatencyHistogram::GetBucketLowerBound(index);
+		auto upper = LatencyHistogram::GetBucketUpperBound(index);
+		BF_CHECK(lower <= upper);
+		BF_CHECK(LatencyHistogram::GetBucketIndex(lower) == index);
+		BF_CHECK(LatencyHistogram::GetBucketIndex(upper) == index);
+		// Width is at most 1/16 of the values in the bucket
+		BF_CHECK(upper - lower <= lower / LatencyHistogram::SubBucketCount);
+		if (index + 1 < LatencyHistogram::BucketCount)
+			BF_CHECK(upper + 1 == LatencyHistogram::GetBucketLowerBound(index + 1));
+	}
+	// 1000 = 0b1111101000: Sub-bucket 15 of the 2^9 range, 32 values wide
+	BF_CHECK(LatencyHistogram::GetBucketLowerBound(LatencyHistogram::GetBucketIndex(1000)) == 992);
+	BF_CHECK(LatencyHistogram::GetBucketUpperBound(LatencyHistogram::GetBucketIndex(1000)) == 1023);
+}
+
+BF_TEST(LatencyValuesAboveRangeGoToLastBucket)
+{
+	constexpr uint64_t maxValue = (1ull << LatencyHistogram::MaxValueBits) - 1;
+	constexpr uint32_t lastBucket = LatencyHistogram::BucketCount - 1;
+	BF_CHECK(LatencyHistogram::GetBucketIndex(maxValue) == lastBucket);
+	BF_CHECK(LatencyHistogram::GetBucketIndex(maxValue + 1) == lastBucket);
+	BF_CHECK(LatencyHistogram::GetBucketIndex(UINT64_MAX) == lastBucket);
+	BF_CHECK(LatencyHistogram::GetBucketUpperBound(lastBucket) == maxValue);
+
+	auto histogram = std::make_unique<LatencyHistogram>();
+	histogram->Record(1ull << 45);
+	auto snapshot = histogram->GetSnapshot();
+	BF_CHECK(snapshot.Buckets[lastBucket] == 1);
+	BF_CHECK(snapshot.Max == 1ull << 45);
+	// Bucket bounds are clamped to the extremes recorded, so the value itself is reported
+	BF_CHECK(snapshot.Percentile(99) == 1ull << 45);
+	histogram->Record(maxValue + 1);
+	BF_CHECK(histogram->GetSnapshot().Percentile(0) == maxValue + 1);
+	BF_CHECK(histogram->GetSnapshot().Buckets[lastBucket] == 2);
+}
+
+BF_TEST(LatencyPercentilesAreBucketUpperBounds)
+{
+	auto histogram = std::make_unique<LatencyHistogram>();
+	BF_CHECK(histogram->GetSnapshot().Percentile(50) == 0);
+	for (uint64_t value = 1; value <= 100; ++value)
+		histogram->Record(value);
+	auto snapshot = histogram->GetSnapshot();
+	BF_CHECK(snapshot.Count == 100);
+	BF_CHECK(snapshot.Sum == 5050);
+	BF_CHECK(snapshot.Min == 1);
+	BF_CHECK(snapshot.Max == 100);
+	BF_CHECK(snapshot.Mean() == 50);
+	BF_CHECK(snapshot.Percentile(0) == 1);
+	// The 50th value is in [50, 51], the 99th in [96, 99]
+	BF_CHECK(snapshot.Percentile(50) == 51);
+	BF_CHECK(snapshot.Percentile(99) == 99);
+	// Bucket of 100 is [100, 103], clamped to Max
+	BF_CHECK(snapshot.Percentile(100) == 100);
+	BF_CHECK(snapshot.Percentile(150) == 100);
+	// Below the sub-bucket count, buckets hold single values
+	BF_CHECK(snapshot.Percentile(10) == 10);
+}
+
+BF_TEST(LatencySnapshotSinceCoversLaterValues)
+{
+	auto histogram = std::make_unique<LatencyHistogram>();
+	for (uint64_t value = 1; value <= 100; ++value)
+		histogram->Record(value);
+	auto earlier = histogram->GetSnapshot();
+	for (int i = 0; i < 10; ++i)
+		histogram->Record(1000);
+	auto window = histogram->GetSnapshot().Since(earlier);
+	BF_CHECK(window.Count == 10);
+	BF_CHECK(window.Sum == 10'000);
+	// Bounds of the bucket of 1000, [992, 1023], clamped to the extremes of all values
+	BF_CHECK(window.Min == 992);
+	BF_CHECK(window.Max == 1000);
+	BF_CHECK(window.Percentile(50) == 1000);
+	BF_CHECK(histogram->GetSnapshot().Since(histogram->GetSnapshot()).Count == 0);
+
+	histogram->Reset();
+	auto reset = histogram->GetSnapshot();
+	BF_CHECK(reset.Count == 0);
+	BF_CHECK(reset.Percentile(50) == 0);
+	BF_CHECK(reset.ToString() == "-");
+	histogram->Record(5);
+	BF_CHECK(histogram->GetSnapshot().Min == 5);
+}
+
+BF_TEST(DMALongerThanAVBIIsLate)
+{
+	auto telemetry = std::make_unique<ChannelTelemetry>();
+	telemetry->RecordDMA(telemetry->DMAWrite, 30ms);
+	BF_CHECK(telemetry->Late == 0); // Period unknown
+	telemetry->VBIPeriod = 20'000'000;
+	telemetry->RecordDMA(telemetry->DMAWrite, 10ms);
+	telemetry->RecordDMA(telemetry->DMAWrite, 30ms);
+	auto snapshot = telemetry->GetSnapshot();
+	BF_CHECK(snapshot.Late == 1);
+	BF_CHECK(snapshot.DMAWrite.Count == 3);
+	telemetry->Reset();
+	BF_CHECK(telemetry->GetSnapshot().Late == 0);
+	BF_CHECK(telemetry->GetSnapshot().DMAWrite.Count == 0);
+}
+
+BF_TEST(VBITimingClassifiesWaits)
+{
+	auto telemetry = std::make_unique<ChannelTelemetry>();
+	VBITimingMonitor monitor;
+	monitor.Reset(FieldPeriod, 2);
+	auto start = TelemetryClock::now();
+	auto update = [&](unsigned long fieldCount, std::chrono::milliseconds elapsed) { return monitor.Update(fieldCount, start + elapsed, telemetry.get()); };
+
+	auto first = update(100, 0ms);
+	BF_CHECK(first.ExpectedFieldCount == 100 && !first.Dropped && !first.Repeated && !first.Discontinuity);
+
+	auto next = update(102, 40ms);
+	BF_CHECK(next.ExpectedFieldCount == 102);
+	BF_CHECK(!next.Dropped && !next.Repeated && !next.Late && !next.Discontinuity);
+	BF_CHECK(next.Jitter == 0);
+
+	// A frame passed without a wait
+	auto dropped = update(106, 120ms);
+	BF_CHECK(dropped.ExpectedFieldCount == 104);
+	BF_CHECK(dropped.Dropped == 1);
+	BF_CHECK(!dropped.Discontinuity);
+
+	// Returned again before the next interrupt
+	auto repeated = update(106, 122ms);
+	BF_CHECK(repeated.Repeated);
+	BF_CHECK(!repeated.Late);
+
+	// Field count does not match 2 fields of elapsed time, e.g. the card was reset
+	auto jump = update(500, 160ms);
+	BF_CHECK(jump.Discontinuity);
+	BF_CHECK(!jump.Dropped && !jump.Repeated);
+
+	// Timing is resynchronized to the new field count
+	auto resynced = update(502, 200ms);
+	BF_CHECK(!resynced.Dropped && !resynced.Repeated && !resynced.Discontinuity);
+	BF_CHECK(resynced.Jitter == 0);
+
+	// 8 ms after the interrupt, more than a quarter field
+	auto late = update(504, 248ms);
+	BF_CHECK(late.Late);
+	BF_CHECK(!late.Dropped);
+	BF_CHECK(late.Jitter > int64_t(FieldPeriod / 4));
+
+	BF_CHECK(monitor.GetDropped() == 1);
+	BF_CHECK(monitor.GetRepeated() == 1);
+	BF_CHECK(monitor.GetDiscontinuities() == 1);
+	BF_CHECK(monitor.GetLateWakeups() == 1);
+	auto snapshot = telemetry->GetSnapshot();
+	BF_CHECK(snapshot.Dropped == 1);
+	BF_CHECK(snapshot.Repeated == 1);
+	BF_CHECK(snapshot.Discontinuities == 1);
+	BF_CHECK(snapshot.LateWakeups == 1);
+	// All waits after the first one but the discontinuity
+	BF_CHECK(snapshot.VBIJitter.Count == 5);
+
+	monitor.Reset(FieldPeriod, 2);
+	BF_CHECK(monitor.GetDropped() == 0);
+	BF_CHECK(!monitor.Update(900, start + 300ms).Discontinuity);
+}
+
+BF_TEST(VBITimingCountsDroppedFieldInterrupts)
+{
+	VBITimingMonitor monitor;
+	monitor.Reset(FieldPeriod, 1);
+	auto start = TelemetryClock::now();
+	monitor.Update(10, start);
+	BF_CHECK(monitor.Update(11, start + 20ms).Dropped == 0);
+	BF_CHECK(monitor.Update(14, start + 80ms).Dropped == 2);
+	BF_CHECK(monitor.Update(14, start + 81ms).Repeated);
+	BF_CHECK(monitor.GetDropped() == 2);
+	BF_CHECK(monitor.GetRepeated() == 1);
+}
+
+BF_TEST(TelemetryLogIsDueOncePerInterval)
+{
+	TelemetryLogInterval interval;
+	interval.Interval = std::chrono::hours(1);
+	BF_CHECK(interval.IsDue());
+	BF_CHECK(!interval.IsDue());
+	interval.Next = TelemetryClock::now();
+	BF_CHECK(interval.IsDue());
+	BF_CHECK(!interval.IsDue());
+
+	TelemetryLogInterval always;
+	always.Interval = TelemetryClock::duration::zero();
+	BF_CHECK(always.IsDue());
+	BF_CHECK(always.IsDue());
+}
+
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+ */
+
+#pragma once
+
+// stl
+#include <vector>
+
+namespace bf::test
+{
+
+// Minimal test registry, so that the tests build with the plugin's own dependencies only.
+struct TestCase
+{
+	const char* Name;
+	void (*Run)();
+};
+
+std::vector<TestCase>& GetTests();
+void ReportFailure(const char* file, int line, const char* expression);
+
+struct Registrar
+{
+	Registrar(const char* name, void (*run)()) { GetTests().push_back({name, run}); }
+};
+
+}
+
+#define BF_TEST(name) \
+	static void name(); \
+	static ::bf::test::Registrar name##Registrar(#name, &name); \
+	static void name()
+
+// Records a failure and continues the test
+#define BF_CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+			::bf::test::ReportFailure(__FILE__, __LINE__, #expression); \
+	} while (0)
+
+// Records a failure and returns from the test
+#define BF_REQUIRE(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			::bf::test::ReportFailure(__FILE__, __LINE__, #expression); \
+			return; \
+		} \
+	} while (0)
@@ -0,0 +1,87 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "ThreadPlacement.hpp"
+#include "Test.hpp"
+
+// stl
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace bf::test
+{
+namespace
+{
+// Settings are given for a serial no card has, so that variables set for the machine do not apply
+constexpr const char* TestSerial = "BFTEST0001";
+
+// Sets the variable for the lifetime of the object
+struct ScopedEnvironment
+{
+	std::string Name;
+
+	ScopedEnvironment(const char* name, const char* value) : Name(std::string(name) + "_" + TestSerial)
+	{
+#if _WIN32
+		_putenv_s(Name.c_str(), value);
+#else
+		setenv(Name.c_str(), value, 1);
+#endif
+	}
+
+	~ScopedEnvironment()
+	{
+#if _WIN32
+		_putenv_s(Name.c_str(), "");
+#else
+		unsetenv(Name.c_str());
+#endif
+	}
+};
+}
+
+BF_TEST(ThreadPlacementDefaultsToCardNumaNode)
+{
+	auto placement = LoadThreadPlacement(TestSerial, 1);
+	// Unless set for all cards on this machine
+	if (!std::getenv("BLUEFISH444_NUMA_NODE"))
+		BF_CHECK(placement.NumaNode == 1);
+	if (!std::getenv("BLUEFISH444_CPUS"))
+		BF_CHECK(placement.Cpus.empty());
+}
+
+BF_TEST(ThreadPlacementParsesCardSettings)
+{
+	ScopedEnvironment node("BLUEFISH444_NUMA_NODE", "0");
+	ScopedEnvironment cpus("BLUEFISH444_CPUS", "12,8-10, 3 ,9,x,11-11");
+	ScopedEnvironment priority("BLUEFISH444_THREAD_PRIORITY", "realtime");
+	auto placement = LoadThreadPlacement(TestSerial, 1);
+	BF_CHECK(placement.NumaNode == 0);
+	// Sorted, without duplicates; entries that are not numbers are skipped
+	BF_CHECK((placement.Cpus == std::vector<uint32_t>{3, 8, 9, 10, 11, 12}));
+	BF_CHECK(placement.Priority == ThreadPriority::RealTime);
+	BF_CHECK(placement.ToString() == "NUMA node 0, CPUs 3,8-12, real-time priority");
+}
+
+BF_TEST(ThreadPlacementIgnoresUnknownPriority)
+{
+	ScopedEnvironment priority("BLUEFISH444_THREAD_PRIORITY", "urgent");
+	auto placement = LoadThreadPlacement(TestSerial, -1);
+	BF_CHECK(placement.Priority == ThreadPriority::Normal);
+	ThreadPlacement any;
+	BF_CHECK(any.ToString() == "any NUMA node, normal priority");
+}
+
+BF_TEST(HostMemoryIsPageAligned)
+{
+	constexpr size_t size = 3 * 4096 + 100;
+	auto* data = static_cast<uint8_t*>(AllocateHostMemory(size, -1));
+	BF_REQUIRE(data);
+	BF_CHECK(uintptr_t(data) % 4096 == 0);
+	memset(data, 0xab, size);
+	BF_CHECK(data[size - 1] == 0xab);
+	FreeHostMemory(data, size);
+}
+
+}
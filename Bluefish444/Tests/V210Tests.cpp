@@ -0,0 +1,87 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "V210.hpp"
+#include "Test.hpp"
+
+// stl
+#include <vector>
+
+namespace bf::test
+{
+namespace
+{
+// Odd block counts and widths that are not a multiple of a block exercise the scalar tails of the SIMD kernels
+constexpr uint32_t TestWidths[] = {6, 46, 720, 1280, 1920, 3840};
+
+struct PlanarLine
+{
+	std::vector<uint16_t> Y, Cb, Cr;
+
+	explicit PlanarLine(uint32_t width) : Y(width), Cb(width / 2), Cr(width / 2) {}
+
+	static PlanarLine MakePattern(uint32_t width)
+	{
+		PlanarLine line(width);
+		for (uint32_t x = 0; x < width; ++x)
+			line.Y[x] = uint16_t((x * 37 + 64) & 0x3ff);
+		for (uint32_t x = 0; x < width / 2; ++x)
+		{
+			line.Cb[x] = uint16_t((x * 53 + 512) & 0x3ff);
+			line.Cr[x] = uint16_t((x * 71 + 100) & 0x3ff);
+		}
+		return line;
+	}
+};
+}
+
+BF_TEST(V210PackUnpackRoundTripsAtEveryLevel)
+{
+	for (auto width : TestWidths)
+	{
+		auto line = PlanarLine::MakePattern(width);
+		for (auto level : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512})
+		{
+			if (level > GetSimdLevel())
+				continue;
+			std::vector<uint8_t> packed(v210::GetBytesPerLine(width));
+			v210::PackLine(level, line.Y.data(), line.Cb.data(), line.Cr.data(), width, packed.data());
+			PlanarLine unpacked(width);
+			v210::UnpackLine(level, packed.data(), width, unpacked.Y.data(), unpacked.Cb.data(), unpacked.Cr.data());
+			BF_CHECK(unpacked.Y == line.Y && unpacked.Cb == line.Cb && unpacked.Cr == line.Cr);
+		}
+	}
+}
+
+BF_TEST(V210KernelsMatchScalarReference)
+{
+	for (auto width : TestWidths)
+	{
+		auto line = PlanarLine::MakePattern(width);
+		std::vector<uint8_t> reference(v210::GetBytesPerLine(width));
+		v210::PackLine(SimdLevel::Scalar, line.Y.data(), line.Cb.data(), line.Cr.data(), width, reference.data());
+		for (auto level : {SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512})
+		{
+			if (level > GetSimdLevel())
+				continue;
+			std::vector<uint8_t> packed(reference.size());
+			v210::PackLine(level, line.Y.data(), line.Cb.data(), line.Cr.data(), width, packed.data());
+			BF_CHECK(packed == reference);
+		}
+	}
+}
+
+BF_TEST(V210FramePackZeroesLinePadding)
+{
+	constexpr uint32_t width = 1280, height = 4; // 1280 pixels use 3424 of the 3456 bytes of a line
+	uint32_t pitch = v210::GetBytesPerLine(width);
+	std::vector<uint16_t> samples(size_t(width) * height * 2, 0x3ff);
+	v210::Planar16 planes{.Y = samples.data(), .Cb = samples.data() + width * height, .Cr = samples.data() + width * height * 3 / 2};
+	std::vector<uint8_t> packed(size_t(pitch) * height, 0xff);
+	v210::Pack(planes, width, height, packed.data(), pitch);
+	uint32_t usedBytes = (width + v210::PixelsPerBlock - 1) / v210::PixelsPerBlock * v210::BytesPerBlock;
+	for (uint32_t line = 0; line < height; ++line)
+		for (uint32_t i = usedBytes; i < pitch; ++i)
+			BF_CHECK(packed[size_t(line) * pitch + i] == 0);
+}
+
+}
@@ -0,0 +1,207 @@
+// Copyright MediaZ Teknoloji A.S. All Rights Reserved.
+
+#include "VBIDispatcher.hpp"
+#include "Test.hpp"
+
+// stl
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bf::test
+{
+namespace
+{
+using namespace std::chrono_literals;
+
+// Hardware wait that returns once the test raises an interrupt, with field counts advancing by 2 per interrupt
+struct SimulatedInterrupt
+{
+	std::mutex Mutex;
+	std::condition_variable Raised;
+	uint32_t Pending = 0;
+	unsigned long FieldCount = 0;
+	bool Fail = false;
+	bool Released = false; // Lets the dispatcher thread return for Stop
+
+	bool Wait(unsigned long& fieldCount)
+	{
+		std::unique_lock lock(Mutex);
+		if (!Raised.wait_for(lock, 1s, [this] { return Pending || Released; }) || !Pending)
+			return false;
+		--Pending;
+		FieldCount += 2;
+		fieldCount = FieldCount;
+		return !Fail;
+	}
+
+	void Raise()
+	{
+		{
+			std::unique_lock lock(Mutex);
+			++Pending;
+		}
+		Raised.notify_all();
+	}
+
+	void Release()
+	{
+		{
+			std::unique_lock lock(Mutex);
+			Released = true;
+		}
+		Raised.notify_all();
+	}
+};
+
+// Raises interrupts until the waiter returns
+VBISample WaitRaising(VBIDispatcher& dispatcher, SimulatedInterrupt& interrupt)
+{
+	std::atomic<bool> done = false;
+	std::thread raiser([&] {
+		while (!done)
+		{
+			interrupt.Raise();
+			std::this_thread::sleep_for(2ms);
+		}
+	});
+	auto sample = dispatcher.Wait();
+	done = true;
+	raiser.join();
+	return sample;
+}
+}
+
+BF_TEST(VBIWaitReturnsNextPublishedInterrupt)
+{
+	SimulatedInterrupt interrupt;
+	ChannelTelemetry telemetry;
+	VBIDispatcher dispatcher([&](unsigned long& fieldCount) { return interrupt.Wait(fieldCount); }, 1ms, &telemetry);
+	BF_CHECK(dispatcher.GetLatest().Sequence == 0);
+
+	auto first = WaitRaising(dispatcher, interrupt);
+	BF_CHECK(first.Sequence >= 1);
+	BF_CHECK(!first.Failed);
+	BF_CHECK(first.FieldCount == 2 * first.Sequence);
+	auto second = WaitRaising(dispatcher, interrupt);
+	BF_CHECK(second.Sequence > first.Sequence);
+	BF_CHECK(second.FieldCount > first.FieldCount);
+	BF_CHECK(dispatcher.GetLatest().Sequence >= second.Sequence);
+	BF_CHECK(telemetry.Frames >= 2);
+
+	interrupt.Release();
+	dispatcher.Stop();
+}
+
+BF_TEST(VBIWaitersAreAllWokenByOneInterrupt)
+{
+	SimulatedInterrupt interrupt;
+	VBIDispatcher dispatcher([&](unsigned long& fieldCount) { return interrupt.Wait(fieldCount); }, 1ms);
+	dispatcher.Start();
+	constexpr int waiterCount = 4;
+	std::atomic<int> woken = 0;
+	std::vector<VBISample> samples(waiterCount);
+	std::vector<std::thread> waiters;
+	for (int i = 0; i < waiterCount; ++i)
+		waiters.emplace_back([&, i] {
+			samples[i] = dispatcher.Wait();
+			++woken;
+		});
+	// Waiters started before the interrupt all see it; a waiter that starts late waits for the next one
+	auto until = std::chrono::steady_clock::now() + 2s;
+	while (woken < waiterCount && std::chrono::steady_clock::now() < until)
+	{
+		interrupt.Raise();
+		std::this_thread::sleep_for(5ms);
+	}
+	for (auto& waiter : waiters)
+		waiter.join();
+	BF_CHECK(woken == waiterCount);
+	for (auto& sample : samples)
+	{
+		BF_CHECK(sample.Sequence >= 1);
+		BF_CHECK(!sample.Failed);
+		BF_CHECK(sample.FieldCount == 2 * sample.Sequence);
+	}
+
+	interrupt.Release();
+	dispatcher.Stop();
+}
+
+BF_TEST(VBIStopReleasesWaitersPermanently)
+{
+	SimulatedInterrupt interrupt;
+	VBIDispatcher dispatcher([&](unsigned long& fieldCount) { return interrupt.Wait(fieldCount); }, 1ms);
+	std::atomic<bool> returned = false;
+	VBISample blocked;
+	std::thread waiter([&] {
+		blocked = dispatcher.Wait();
+		returned = true;
+	});
+	std::this_thread::sleep_for(20ms);
+	BF_CHECK(!returned);
+	interrupt.Release();
+	dispatcher.Stop();
+	waiter.join();
+	BF_CHECK(returned);
+	BF_CHECK(blocked.Failed);
+	// Later waits neither block nor restart the thread
+	auto later = dispatcher.Wait();
+	BF_CHECK(later.Failed);
+	BF_CHECK(dispatcher.GetLatest().Failed);
+}
+
+BF_TEST(VBIFailedHardwareWaitsArePublished)
+{
+	SimulatedInterrupt interrupt;
+	interrupt.Fail = true;
+	ChannelTelemetry telemetry;
+	VBIDispatcher dispatcher([&](unsigned long& fieldCount) { return interrupt.Wait(fieldCount); }, 1ms, &telemetry);
+	auto sample = WaitRaising(dispatcher, interrupt);
+	BF_CHECK(sample.Failed);
+	BF_CHECK(telemetry.Frames == 0);
+	interrupt.Release();
+	dispatcher.Stop();
+}
+
+BF_TEST(VBISamplesAreReadConsistently)
+{
+	// Published as fast as possible, so that readers race the writer on every slot of the seqlock
+	std::atomic<unsigned long> calls = 0;
+	VBIDispatcher dispatcher(
+		[&](unsigned long& fieldCount) {
+			fieldCount = 2 * ++calls;
+			return true;
+		},
+		1ms);
+	dispatcher.Start();
+	std::atomic<uint32_t> torn = 0;
+	std::atomic<uint64_t> reads = 0;
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 3; ++i)
+		readers.emplace_back([&] {
+			uint64_t last = 0;
+			auto until = std::chrono::steady_clock::now() + 50ms;
+			while (std::chrono::steady_clock::now() < until)
+			{
+				auto sample = dispatcher.GetLatest();
+				if (!sample.Sequence)
+					continue;
+				// Each sample is published by one hardware wait, so its field count is twice its sequence
+				torn += sample.FieldCount != 2 * sample.Sequence || sample.Sequence < last;
+				last = sample.Sequence;
+				++reads;
+			}
+		});
+	for (auto& reader : readers)
+		reader.join();
+	dispatcher.Stop();
+	BF_CHECK(reads > 0);
+	BF_CHECK(torn == 0);
+	BF_CHECK(calls > 100); // Writer lapped the 8 slots many times
+}
+
+}